@@ -5,7 +5,8 @@ enum InternalState {
   IDLE = 0,
   TOUCHING = 1,
   TYPING = 2,
-  PASSWORD_READY = 3
+  PASSWORD_READY = 3,
+  AWAITING_CONFIRMATION = 4  // results (batch or returned password) wait for a touch before being sent to the host
 };
 
 #endif
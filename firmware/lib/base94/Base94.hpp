@@ -127,6 +127,35 @@ public:
     }
     return true;
   }
+  /* buffer variant: no allocation, s must hold encodedLength(n) chars	*/
+  static uint32_t encodedLength(uint32_t n) {
+    uint32_t block_count = (n + BASE94_INPUT_BLOCK_SIZE - 1) / BASE94_INPUT_BLOCK_SIZE;
+    uint32_t tail = n % BASE94_INPUT_BLOCK_SIZE;
+    return block_count * BASE94_OUTPUT_BLOCK_SIZE - (tail > 0 ? encode_tail_cut[tail] : 0);
+  }
+  bool encode(const uint8_t* v, uint32_t n, char* s, uint32_t capacity, uint32_t& written) {
+    uint32_t tail = n % BASE94_INPUT_BLOCK_SIZE;
+    written = 0;
+    if (capacity < encodedLength(n) + (tail > 0 ? encode_tail_cut[tail] : 0))
+      return false;
+    uint32_t off_v = 0, off_s = 0;
+    for (; off_v + BASE94_INPUT_BLOCK_SIZE <= n; off_v += BASE94_INPUT_BLOCK_SIZE, off_s += BASE94_OUTPUT_BLOCK_SIZE) {
+      if (!encode_block(*(const base94_input_block*)(v + off_v), *(base94_output_block*)(s + off_s)))
+        return false;
+    }
+    if (tail > 0) {
+      base94_input_block buff = { 0 };
+      for (uint32_t i = 0; i < tail; i++)
+        buff[i] = v[off_v + i];
+      bool ok = encode_block(buff, *(base94_output_block*)(s + off_s));
+      for (uint32_t i = 0; i < tail; i++)
+        buff[i] = 0;
+      if (!ok)
+        return false;
+    }
+    written = encodedLength(n);
+    return true;
+  }
   bool decode(const std::string& /*in*/ s, std::vector<uint8_t>& /*out*/ v) {
     uint32_t block_count = (s.size() + BASE94_OUTPUT_BLOCK_SIZE - 1) / BASE94_OUTPUT_BLOCK_SIZE;
     uint32_t buffer_size = block_count * BASE94_INPUT_BLOCK_SIZE;
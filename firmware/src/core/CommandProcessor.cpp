@@ -2,24 +2,35 @@
 #include "proto/ProtoHelper.h"
 #include "CommandProcessor.h"
 #include "proto/ProtoHelper.h"
+#include "proto/CommandDecoder.h"
+#include "keyboard/HidKeyboard.h"
 #include <cstring>
 
-CommandProcessor::CommandProcessor(SeedManager& seedManager, Kdf& kdf, LedManager& ledManager, InternalState& state, uint8_t* outputBuffer, size_t outputBufferSize)
-: seedManager_(seedManager), kdf_(kdf), ledManager_(ledManager), state_(state), outputBuffer_(outputBuffer), outputBufferSize_(outputBufferSize) {
+CommandProcessor::CommandProcessor(SeedManager& seedManager, Kdf& kdf, CryptoWorker& worker, PasswordPrecompute& precompute, PasswordBatch& batch, LedManager& ledManager, InternalState& state, uint8_t* outputBuffer, size_t outputBufferSize)
+: seedManager_(seedManager), kdf_(kdf), worker_(worker), precompute_(precompute), batch_(batch), ledManager_(ledManager), state_(state), outputBuffer_(outputBuffer), outputBufferSize_(outputBufferSize), requestId_(0),
+  command_(turtlpass_Command_init_zero), batchSlot_(0), batchEpoch_(0),
+  deliveryPending_(false), deliveryRequestId_(0), deliveryAtMs_(0),
+  seedJobs_(0), seedCommitPending_(false), seedCommitSlot_(0), seedCommitRequestId_(0),
+  calibrationPending_(false), calibrationProfile_(0), calibrationRequestId_(0), keyboardLayout_(turtlpass_KeyboardLayout_US),
+  hostProfile_(0), hostTimingLoaded_(false), hostTiming_() {
     // ensure output buffer is zeroed
     if (outputBuffer_ && outputBufferSize_ > 0) {
         memset(outputBuffer_, 0, outputBufferSize_);
     }
 }
 
-void CommandProcessor::processProtoCommand(const uint8_t* data, size_t length) {
-    turtlpass_Command command = turtlpass_Command_init_zero;
-    pb_istream_t stream = pb_istream_from_buffer(data, length);
+bool CommandProcessor::processProtoCommand(const uint8_t* data, size_t length) {
+    turtlpass_Command& command = command_;  // decodeCommand() resets it to defaults
 
-    if (!pb_decode(&stream, turtlpass_Command_fields, &command)) {
-        sendErrorResponse(turtlpass_ErrorCode_PROTO_DECODING_FAILED);
-        return;
+    if (!decodeCommand(data, length, command)) {
+        sendErrorResponse(turtlpass_ErrorCode_PROTO_DECODING_FAILED);  // request_id unknown
+        return true;
+    }
+    if (mustWait(command)) {
+        return false;  // caller keeps the frame until the worker catches up
     }
+    requestId_ = command.request_id;
+
     switch (command.type) {
         case turtlpass_CommandType_GET_DEVICE_INFO:
             handleGetDeviceInfo();
@@ -33,15 +44,86 @@ void CommandProcessor::processProtoCommand(const uint8_t* data, size_t length) {
             handleInitializeSeed(command);
             break;
 
+        case turtlpass_CommandType_GENERATE_PASSWORD_BATCH:
+            handleGeneratePasswordBatch(command);
+            break;
+
         case turtlpass_CommandType_FACTORY_RESET:
             handleFactoryReset();
             break;
 
+        case turtlpass_CommandType_SET_SESSION_TIMEOUT:
+            handleSetSessionTimeout(command);
+            break;
+
+        case turtlpass_CommandType_GET_SESSION_STATE:
+            handleGetSessionState();
+            break;
+
+        case turtlpass_CommandType_LOCK_SESSION:
+            handleLockSession();
+            break;
+
+        case turtlpass_CommandType_SET_KEYBOARD_LAYOUT:
+            handleSetKeyboardLayout(command);
+            break;
+
+        case turtlpass_CommandType_CALIBRATE_KEYBOARD:
+            handleCalibrateKeyboard(command);
+            break;
+
+        case turtlpass_CommandType_SET_FRAMING:
+            handleSetFraming(command);
+            break;
+
         default:
-            sendErrorResponse(turtlpass_ErrorCode_INVALID_COMMAND);
+            sendErrorResponse(turtlpass_ErrorCode_INVALID_COMMAND, requestId_);
             state_ = IDLE;
             break;
     }
+    return true;
+}
+
+bool CommandProcessor::mustWait(const turtlpass_Command& command) const {
+    const bool readOnly = command.type == turtlpass_CommandType_GET_DEVICE_INFO ||
+                          command.type == turtlpass_CommandType_GET_SESSION_STATE;
+    if (command.request_id != 0 && readOnly) {
+        return false;  // may overtake queued jobs and a pending batch
+    }
+    // the calibration probes own the HID endpoint; queries with a request_id are still answered
+    if (calibrationPending_) {
+        return true;
+    }
+    // the batch or returned password owns the button until it is confirmed and sent
+    if (batch_.isActive() || deliveryPending_) {
+        return true;
+    }
+    // outputBuffer_ is being typed; queries are still answered
+    if (state_ == TYPING && !readOnly) {
+        return true;
+    }
+    // lockstep host: one command at a time, answered in order
+    if (command.request_id == 0) {
+        return isBusy();
+    }
+    switch (command.type) {
+        case turtlpass_CommandType_GENERATE_PASSWORD:
+            // a new seed is only readable once committed: derivations queued behind an INITIALIZE_SEED
+            // would find its slot staged and fail with SEED_NOT_INITIALIZED
+            return seedJobs_ > 0 || seedCommitPending_ || !worker_.hasFreeJob();
+
+        case turtlpass_CommandType_INITIALIZE_SEED:
+            // the worker runs jobs in submission order; only a full pool blocks
+            return !worker_.hasFreeJob();
+
+        default:
+            // reset/session changes and batches must not overtake earlier jobs
+            return isBusy();
+    }
+}
+
+bool CommandProcessor::isBusy() const {
+    return worker_.isBusy() || seedCommitPending_;
 }
 
 bool CommandProcessor::getSelectedSeed(char* outSeed, size_t outSize, const size_t seedSize) {
@@ -65,12 +147,80 @@ uint8_t CommandProcessor::getSelectedSeedSlot() {
 }
 
 bool CommandProcessor::deriveDefaultPassword() {
+    // precomputed on core1 after the slot was selected
+    if (precompute_.take(getSelectedSeedSlot(), outputBuffer_, outputBufferSize_)) {
+        return outputBuffer_[0] != 0;
+    }
+
+    // derive on core0 while core1 stays free for serial jobs
+    CryptoJob::Status status = CryptoWorker::derivePassword(seedManager_, kdf_, getSelectedSeedSlot(),
+        turtlpass_Charset_LETTERS_NUMBERS, outputBuffer_, DEFAULT_PASS_SIZE, "default");
+    return status == CryptoJob::OK && outputBuffer_[0] != 0;
+}
+
+void CommandProcessor::prefetchDefaultPassword() {
+    uint8_t seedSlot = getSelectedSeedSlot();
+    if (precompute_.covers(seedSlot)) {
+        return;
+    }
     char seed[SeedManager::SEED_SIZE + 1];
-    if (!getSelectedSeed(seed, sizeof(seed))) {
-        return false;
+    if (getSelectedSeed(seed, sizeof(seed))) {
+        precompute_.request(seedSlot, seed, DEFAULT_PASS_SIZE);
+    } else {
+        precompute_.discard();
+    }
+    memset(seed, 0, sizeof(seed));
+}
+
+void CommandProcessor::confirmPending() {
+    if (state_ != AWAITING_CONFIRMATION) {
+        return;
+    }
+    if (batch_.isActive()) {
+        batch_.confirm();
+        ledManager_.setBlinking();
+    } else if (deliveryPending_) {
+        size_t len = strnlen(reinterpret_cast<const char*>(outputBuffer_), outputBufferSize_ - 1);
+        sendSuccessBytesResponse(outputBuffer_, len, deliveryRequestId_);
+        finishDelivery();
+    }
+}
+
+void CommandProcessor::loop() {
+    serviceBatch();
+    serviceDelivery();
+    serviceSeedCommit();
+    serviceCalibration();
+
+    // core0 takes a queued derivation while core1 runs another one; not while typing,
+    // which paces its reports from this loop
+    if (state_ != TYPING) {
+        worker_.work(kdf_);
+    }
+
+    // completions from the crypto worker, in submission order; they wait while outputBuffer_
+    // holds a password for the host or is being typed, and behind a seed awaiting the flush
+    while (!deliveryPending_ && !seedCommitPending_ && state_ != TYPING) {
+        CryptoJob* job = worker_.poll();
+        if (!job) break;
+        requestId_ = job->requestId;
+        completeJob(*job);
+        worker_.release(job);
+    }
+
+    uint8_t seedSlot = getSelectedSeedSlot();
+    seedManager_.session().loop(seedSlot);
+    precompute_.expire(seedSlot);
+}
+
+void CommandProcessor::lockSession() {
+    seedManager_.session().lock();
+    if (batch_.isActive()) {
+        finishBatch();  // host is gone, results are dropped
+    }
+    if (deliveryPending_) {
+        finishDelivery();
     }
-    bool result = kdf_.derivatePass(outputBuffer_, DEFAULT_PASS_SIZE, const_cast<char*>("default"), seed);
-    return result && outputBuffer_[0] != 0;
 }
 
 uint8_t* CommandProcessor::getOutputBuffer() {
@@ -82,33 +232,30 @@ size_t CommandProcessor::getOutputBufferSize() {
 }
 
 void CommandProcessor::clearOutputBuffer() {
-    memset(outputBuffer_, 0, outputBufferSize_);
+    clean(outputBuffer_, outputBufferSize_);
 }
 
 // ---------------- Command Handlers ----------------
 
 void CommandProcessor::handleGetDeviceInfo() {
-    turtlpass_Response response = turtlpass_Response_init_zero;
-    deviceInfo(response);
-    sendProtoResponse(response);
-    state_ = IDLE;
+    sendDeviceInfoResponse(requestId_);  // encoded once at boot
 }
 
 void CommandProcessor::handleGeneratePassword(const turtlpass_Command& command) {
     if (command.which_parameters != turtlpass_Command_gen_pass_tag) {
-        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS);
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
         state_ = IDLE;
         return;
     }
 
     const auto &params = command.parameters.gen_pass;
     if (params.entropy.size == 0 || params.entropy.size > MAX_ENTROPY_SIZE) {
-        sendErrorResponse(turtlpass_ErrorCode_INVALID_ENTROPY_LENGTH);
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_ENTROPY_LENGTH, requestId_);
         state_ = IDLE;
         return;
     }
     if (params.length < 1 || params.length > MAX_PASS_SIZE) {
-        sendErrorResponse(turtlpass_ErrorCode_INVALID_PASSWORD_LENGTH);
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PASSWORD_LENGTH, requestId_);
         state_ = IDLE;
         return;
     }
@@ -116,63 +263,102 @@ void CommandProcessor::handleGeneratePassword(const turtlpass_Command& command)
     uint32_t pass_len = params.length;
     if (pass_len > outputBufferSize_ - 1) pass_len = outputBufferSize_ - 1;
 
-    // get seed
-    char seed[SeedManager::SEED_SIZE + 1];
-    if (!getSelectedSeed(seed, sizeof(seed))) {
-        sendErrorResponse(turtlpass_ErrorCode_SEED_NOT_INITIALIZED);
+    CryptoJob* job = worker_.acquire();
+    if (!job) {
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Crypto worker busy", requestId_);
         state_ = IDLE;
         return;
     }
+    job->type = CryptoJob::DERIVE_PASSWORD;
+    job->requestId = requestId_;
+    job->slot = getSelectedSeedSlot();
+    job->charset = params.charset;
+    job->delivery = params.delivery;
+    job->length = pass_len;
+    memcpy(job->input, params.entropy.bytes, params.entropy.size);
+    job->input[params.entropy.size] = '\0';
+    worker_.submit(job);  // response sent from loop() on completion
+}
 
-    const char* entropy = reinterpret_cast<const char*>(params.entropy.bytes);
+void CommandProcessor::handleInitializeSeed(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_init_seed_tag) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    const turtlpass_InitializeSeedParams &params = command.parameters.init_seed;
+    if (params.seed.size != SeedManager::SEED_SIZE) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_SEED_LENGTH, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    CryptoJob* job = worker_.acquire();
+    if (!job) {
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Crypto worker busy", requestId_);
+        state_ = IDLE;
+        return;
+    }
+    job->type = CryptoJob::INITIALIZE_SEED;
+    job->requestId = requestId_;
+    job->slot = getSelectedSeedSlot();
+    memcpy(job->seed, params.seed.bytes, sizeof(job->seed));
+    worker_.submit(job);  // response sent from loop() on completion
+    seedJobs_++;
+}
 
-    bool result = false;
-    switch (params.charset) {
-        case turtlpass_Charset_NUMBERS_ONLY:
-            result = kdf_.derivatePassNumbersOnly(outputBuffer_, pass_len, entropy, seed);
-            break;
-        case turtlpass_Charset_LETTERS_ONLY:
-            result = kdf_.derivatePassLettersOnly(outputBuffer_, pass_len, entropy, seed);
+void CommandProcessor::completeJob(CryptoJob& job) {
+    switch (job.type) {
+        case CryptoJob::DERIVE_PASSWORD:
+            completeGeneratePassword(job);
             break;
-        case turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS:
-            result = kdf_.derivatePassWithSymbols(outputBuffer_, pass_len, entropy, seed);
+        case CryptoJob::INITIALIZE_SEED:
+            seedJobs_--;
+            completeInitializeSeed(job.initResult, job.slot);
             break;
         default:
-            result = kdf_.derivatePass(outputBuffer_, pass_len, entropy, seed);
+            sendErrorResponse(turtlpass_ErrorCode_INTERNAL_ERROR, requestId_);
+            state_ = IDLE;
             break;
     }
+}
 
-    if (result) {
+void CommandProcessor::completeGeneratePassword(const CryptoJob& job) {
+    if (job.status == CryptoJob::OK) {
+        size_t len = strnlen(reinterpret_cast<const char*>(job.output), outputBufferSize_ - 1);
+        memcpy(outputBuffer_, job.output, len);
+        outputBuffer_[len] = 0;
         ledManager_.setPulsing();
-        sendSuccessResponse();
+        if (job.delivery == turtlpass_PasswordDelivery_RETURN_ON_TOUCH) {
+            // answered with the password once the user touches the button
+            deliveryPending_ = true;
+            deliveryRequestId_ = requestId_;
+            deliveryAtMs_ = millis();
+            state_ = AWAITING_CONFIRMATION;
+            return;
+        }
+        sendSuccessResponse(requestId_);
         state_ = PASSWORD_READY;
+    } else if (job.status == CryptoJob::SEED_NOT_INITIALIZED) {
+        sendErrorResponse(turtlpass_ErrorCode_SEED_NOT_INITIALIZED, requestId_);
+        state_ = IDLE;
     } else {
         if (outputBuffer_) memset(outputBuffer_, 0, outputBufferSize_);
-        sendErrorResponse(turtlpass_ErrorCode_PASSWORD_FAILED);
+        sendErrorResponse(turtlpass_ErrorCode_PASSWORD_FAILED, requestId_);
         state_ = IDLE;
     }
 }
 
-void CommandProcessor::handleInitializeSeed(const turtlpass_Command& command) {
-    if (command.which_parameters != turtlpass_Command_init_seed_tag) {
-        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS);
-        state_ = IDLE;
+void CommandProcessor::completeInitializeSeed(SeedManager::SeedInitResult result, uint8_t seedSlot) {
+    if (result == SeedManager::SeedInitResult::STAGED) {
+        // answered by serviceSeedCommit() once the idle flush stored or dropped it
+        seedCommitPending_ = true;
+        seedCommitSlot_ = seedSlot;
+        seedCommitRequestId_ = requestId_;
         return;
     }
-    const turtlpass_InitializeSeedParams &params = command.parameters.init_seed;
-    if (params.seed.size != SeedManager::SEED_SIZE) {
-        sendErrorResponse(turtlpass_ErrorCode_INVALID_SEED_LENGTH);
-        state_ = IDLE;
-        return;
-    }
-    uint8_t seedSlot = getSelectedSeedSlot();
-    auto result = seedManager_.initializeSeed(
-        seedSlot,
-        params.seed.bytes,
-        params.seed.size
-    );
     if (result == SeedManager::SeedInitResult::OK) {
-        sendSuccessResponse();
+        precompute_.discard();
+        sendSuccessResponse(requestId_);
         state_ = IDLE;
         return;
     }
@@ -188,24 +374,310 @@ void CommandProcessor::handleInitializeSeed(const turtlpass_Command& command) {
             msg = "Seed slot already populated";
             break;
         case SeedManager::SeedInitResult::WRITE_FAIL:
-            msg = "Failed to write encrypted seed to EEPROM";
+            msg = "Failed to write encrypted seed to storage";
             break;
         case SeedManager::SeedInitResult::READ_FAIL:
-            msg = "Failed to read encrypted seed back from EEPROM";
+            msg = "Failed to read encrypted seed back from storage";
             break;
         case SeedManager::SeedInitResult::VERIFY_FAIL:
-            msg = "Seed verification failed after write";
+            msg = "Failed to commit encrypted seed to flash";
             break;
         default:
             msg = "Unknown seed initialization result";
             break;
     }
-    sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, msg);
+    sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, msg, requestId_);
+    state_ = IDLE;
+}
+
+void CommandProcessor::serviceSeedCommit() {
+    if (!seedCommitPending_ || state_ == TYPING) {
+        return;
+    }
+    SeedManager::SeedInitResult result = seedManager_.commitResult(seedCommitSlot_);
+    if (result == SeedManager::SeedInitResult::STAGED) {
+        return;
+    }
+    requestId_ = seedCommitRequestId_;
+    seedCommitPending_ = false;
+    seedCommitSlot_ = 0;
+    seedCommitRequestId_ = 0;
+    completeInitializeSeed(result, 0);
+}
+
+void CommandProcessor::handleGeneratePasswordBatch(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_gen_batch_tag) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    const turtlpass_GeneratePasswordBatchParams &params = command.parameters.gen_batch;
+    if (params.entries_count == 0 || params.entries_count > BATCH_MAX_ENTRIES) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    for (pb_size_t i = 0; i < params.entries_count; ++i) {
+        const turtlpass_GeneratePasswordParams &entry = params.entries[i];
+        if (entry.entropy.size == 0 || entry.entropy.size > MAX_ENTROPY_SIZE) {
+            sendErrorResponse(turtlpass_ErrorCode_INVALID_ENTROPY_LENGTH, requestId_);
+            state_ = IDLE;
+            return;
+        }
+        if (entry.length < 1 || entry.length > MAX_PASS_SIZE) {
+            sendErrorResponse(turtlpass_ErrorCode_INVALID_PASSWORD_LENGTH, requestId_);
+            state_ = IDLE;
+            return;
+        }
+    }
+
+    // fetch and decrypt the seed once for the whole batch
+    char seed[SeedManager::SEED_SIZE + 1];
+    if (!getSelectedSeed(seed, sizeof(seed))) {
+        memset(seed, 0, sizeof(seed));
+        sendErrorResponse(turtlpass_ErrorCode_SEED_NOT_INITIALIZED, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    batchSlot_ = getSelectedSeedSlot();
+    HmacSha512::Midstate saltMidstate;
+    seedManager_.loadSaltMidstate(batchSlot_, saltMidstate, batchEpoch_);
+    bool started = batch_.start(seed, saltMidstate, params.entries, params.entries_count, requestId_);
+    saltMidstate.clear();
+    clean(seed, sizeof(seed));
+    if (!started) {
+        sendErrorResponse(turtlpass_ErrorCode_INTERNAL_ERROR, requestId_);
+        state_ = IDLE;
+        return;
+    }
+
+    // an unclaimed GENERATE_PASSWORD result is replaced by the batch
+    clearOutputBuffer();
+    ledManager_.setPulsing();
+    state_ = AWAITING_CONFIRMATION;  // response sent from loop() after the touch
+}
+
+void CommandProcessor::serviceBatch() {
+    if (!batch_.isActive()) {
+        return;
+    }
+    // core0's share of the entries, one per loop so serial and the button stay responsive
+    batch_.work(kdf_);
+
+    if (!batch_.isConfirmed()) {
+        if (batch_.confirmationExpired()) {
+            requestId_ = batch_.requestId();
+            finishBatch();
+            sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Batch not confirmed", requestId_);
+        }
+        return;
+    }
+    sendBatchChunk();
+}
+
+void CommandProcessor::sendBatchChunk() {
+    size_t length = 0;
+    if (!batch_.nextReady(length)) {
+        return;
+    }
+    turtlpass_Response response = turtlpass_Response_init_zero;
+    response.success = true;
+    response.error = turtlpass_ErrorCode_NONE;
+    response.request_id = batch_.requestId();
+    response.has_batch = true;
+    response.batch.first_index = batch_.taken();
+    response.batch.total = batch_.total();
+
+    // pack whole passwords, each followed by its NUL terminator
+    uint8_t data[RESPONSE_DATA_MAX_SIZE];
+    ProtoBytes bytes = { data, 0 };
+    while (batch_.nextReady(length) && bytes.size + length + 1 <= sizeof(data)) {
+        if (!batch_.take(data + bytes.size, sizeof(data) - bytes.size, length)) {
+            break;
+        }
+        bytes.size += length + 1;
+        response.batch.count++;
+    }
+    response.batch.complete = batch_.isComplete();
+    setResponseData(response, bytes);
+    sendProtoResponse(response);
+    clean(data, bytes.size);
+
+    if (response.batch.complete) {
+        finishBatch();
+    }
+}
+
+void CommandProcessor::finishBatch() {
+    HmacSha512::Midstate saltMidstate;
+    if (batch_.saltMidstate(saltMidstate)) {
+        seedManager_.storeSaltMidstate(batchSlot_, saltMidstate, batchEpoch_);
+    }
+    saltMidstate.clear();
+    batch_.discard();
+    batchSlot_ = 0;
+    batchEpoch_ = 0;
+    ledManager_.setOn();
+    state_ = IDLE;
+}
+
+void CommandProcessor::serviceDelivery() {
+    if (deliveryPending_ && millis() - deliveryAtMs_ >= CONFIRM_TIMEOUT_MS) {
+        requestId_ = deliveryRequestId_;
+        finishDelivery();
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Password not confirmed", requestId_);
+    }
+}
+
+void CommandProcessor::finishDelivery() {
+    clearOutputBuffer();
+    deliveryPending_ = false;
+    deliveryRequestId_ = 0;
+    deliveryAtMs_ = 0;
+    ledManager_.setOn();
     state_ = IDLE;
 }
 
 void CommandProcessor::handleFactoryReset() {
+    precompute_.discard();
     seedManager_.factoryReset();
-    sendSuccessResponse();
+    hostTimingLoaded_ = false;  // stored host timings are gone
+    sendSuccessResponse(requestId_);
     state_ = IDLE;
 }
+
+void CommandProcessor::handleSetSessionTimeout(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_session_tag) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    if (!seedManager_.session().setTimeout(command.parameters.session.timeout_ms)) {
+        sendErrorMessageResponse(turtlpass_ErrorCode_INVALID_PARAMS, "Session timeout too long", requestId_);
+        state_ = IDLE;
+        return;
+    }
+    sendSessionStateResponse();
+    state_ = IDLE;
+}
+
+void CommandProcessor::handleGetSessionState() {
+    sendSessionStateResponse();  // read-only: a pending password, batch or typing is kept
+}
+
+void CommandProcessor::handleLockSession() {
+    seedManager_.session().lock();
+    sendSessionStateResponse();
+    state_ = IDLE;
+}
+
+void CommandProcessor::handleSetKeyboardLayout(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_keyboard_tag ||
+        command.parameters.keyboard.layout < _turtlpass_KeyboardLayout_MIN ||
+        command.parameters.keyboard.layout > _turtlpass_KeyboardLayout_MAX ||
+        command.parameters.keyboard.host_profile >= HID_HOST_PROFILES) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    keyboardLayout_ = command.parameters.keyboard.layout;
+    loadHostTiming((uint8_t)command.parameters.keyboard.host_profile);
+    sendSuccessResponse(requestId_);
+    state_ = IDLE;
+}
+
+void CommandProcessor::handleCalibrateKeyboard(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_keyboard_tag ||
+        command.parameters.keyboard.host_profile >= HID_HOST_PROFILES) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    if (!hidCalibrateStart()) {
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Keyboard busy", requestId_);
+        state_ = IDLE;
+        return;
+    }
+    // probed from loop(), so serial, the button and the LED keep running meanwhile
+    calibrationPending_ = true;
+    calibrationProfile_ = (uint8_t)command.parameters.keyboard.host_profile;
+    calibrationRequestId_ = requestId_;
+    state_ = IDLE;
+}
+
+void CommandProcessor::serviceCalibration() {
+    if (!calibrationPending_ || hidCalibratePoll()) {
+        return;
+    }
+    calibrationPending_ = false;
+    requestId_ = calibrationRequestId_;
+    HidHostTiming timing = {};
+    const bool calibrated = hidCalibrateResult(timing);
+
+    // a failed calibration stores the conservative timing, so the host is not typed into too fast
+    seedManager_.writeSetting(HID_TIMING_SETTING_KEY + calibrationProfile_, (const uint8_t*)&timing, sizeof(timing));
+    hostProfile_ = calibrationProfile_;
+    hostTiming_ = timing;
+    hostTimingLoaded_ = true;
+
+    if (!calibrated) {
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "Keyboard calibration failed", requestId_);
+        return;
+    }
+    uint8_t result[2] = { timing.pressMs, timing.releaseMs };
+    sendSuccessBytesResponse(result, sizeof(result), requestId_);
+}
+
+bool CommandProcessor::isCalibrating() const {
+    return calibrationPending_;
+}
+
+void CommandProcessor::handleSetFraming(const turtlpass_Command& command) {
+    if (command.which_parameters != turtlpass_Command_framing_tag ||
+        command.parameters.framing.framing < _turtlpass_Framing_MIN ||
+        command.parameters.framing.framing > _turtlpass_Framing_MAX) {
+        sendErrorResponse(turtlpass_ErrorCode_INVALID_PARAMS, requestId_);
+        state_ = IDLE;
+        return;
+    }
+    // the reply still uses the old framing; earlier jobs were answered first (mustWait())
+    sendSuccessResponse(requestId_);
+    setProtoFraming(command.parameters.framing.framing);
+    state_ = IDLE;
+}
+
+void CommandProcessor::loadHostTiming(uint8_t hostProfile) {
+    hostProfile_ = hostProfile;
+    hostTiming_ = HidHostTiming();
+    if (!seedManager_.readSetting(HID_TIMING_SETTING_KEY + hostProfile, (uint8_t*)&hostTiming_, sizeof(hostTiming_)) ||
+        hostTiming_.version != HID_TIMING_VERSION) {
+        hostTiming_ = HidHostTiming();  // not calibrated yet
+    }
+    hostTimingLoaded_ = true;
+}
+
+turtlpass_KeyboardLayout CommandProcessor::getKeyboardLayout() const {
+    return keyboardLayout_;
+}
+
+const HidHostTiming& CommandProcessor::getHostTiming() {
+    if (!hostTimingLoaded_) {
+        loadHostTiming(hostProfile_);
+    }
+    return hostTiming_;
+}
+
+void CommandProcessor::sendSessionStateResponse() {
+    SeedSession& session = seedManager_.session();
+    turtlpass_Response response = turtlpass_Response_init_zero;
+    response.success = true;
+    response.error = turtlpass_ErrorCode_NONE;
+    response.has_session_state = true;
+    response.session_state.enabled = session.isEnabled();
+    response.session_state.unlocked = session.isUnlocked();
+    response.session_state.slot = session.slot();
+    response.session_state.timeout_ms = session.timeout();
+    response.session_state.remaining_ms = session.remainingMs();
+    response.request_id = requestId_;
+    sendProtoResponse(response);
+}
@@ -5,18 +5,38 @@
 #include "proto/turtlpass.pb.h"
 #include "storage/SeedManager.h"
 #include "crypto/Kdf.h"
+#include "core/PasswordPrecompute.h"
+#include "core/CryptoWorker.h"
+#include "core/PasswordBatch.h"
 #include "ui/LedManager.h"
 #include "InternalState.h"
+#include "keyboard/HidCalibrator.h"
 #include <cstddef>
 #include "system/SystemInfo.h"
 
-#define DEFAULT_PASS_SIZE 100  // 100 characters by default
-#define MAX_PASS_SIZE 128
-#define MAX_ENTROPY_SIZE 64
+#define DEFAULT_PASS_SIZE 100  // 100 characters by default (MAX_PASS_SIZE/MAX_ENTROPY_SIZE live in Kdf.h)
 
 /**
 * @class CommandProcessor
 * @brief Handles incoming protobuf commands and delegates logic for password generation, seed management, and device info queries.
+*
+* Commands carrying a non-zero request_id are pipelined: crypto commands queue on the worker (up to CRYPTO_QUEUE_DEPTH
+* in flight) while read-only commands are answered at once, so responses may arrive out of order and are matched by
+* their echoed request_id. Commands with request_id 0 keep the original lockstep behaviour and wait for in-flight jobs.
+*
+* While a password is being typed only read-only queries are answered; other commands and job completions wait
+* until typing ends, since they may replace the output buffer.
+*
+* CALIBRATE_KEYBOARD probes the host from loop() and is answered when the measurement ends; meanwhile only read-only
+* queries with a request_id are answered.
+*
+* INITIALIZE_SEED is answered once the seed is in flash: the worker stages it and the reply waits for the idle-gated
+* storage flush (SeedManager::serviceStorage()). Later completions queue behind it, so replies keep their order, and
+* pipelined GENERATE_PASSWORD commands are held until then so they can read the new seed.
+*
+* GENERATE_PASSWORD_BATCH derives its entries on both cores right away but only streams them back, in chunks, after
+* the user confirms with a touch. GENERATE_PASSWORD with delivery RETURN_ON_TOUCH likewise answers only after a touch,
+* with the password in Response.data instead of typing it over HID.
 */
 class CommandProcessor {
 public:
@@ -25,17 +45,22 @@ public:
     * @param ledManager Reference to LED manager for state indication.
     * @param seedManager Reference to SeedManager for seed operations.
     * @param kdf Reference to key derivation function implementation.
+    * @param worker Reference to the core1 crypto worker running GENERATE_PASSWORD and INITIALIZE_SEED.
+    * @param precompute Reference to the background default-password precompute (run on core1).
+    * @param batch Reference to the batch engine shared with core1.
     * @param outputBuffer Pointer to output password buffer.
     * @param outputBufferSize Size of the output password buffer.
     */
-    CommandProcessor(SeedManager& seedManager, Kdf& kdf, LedManager& ledManager, InternalState& state, uint8_t* outputBuffer, size_t outputBufferSize);
+    CommandProcessor(SeedManager& seedManager, Kdf& kdf, CryptoWorker& worker, PasswordPrecompute& precompute, PasswordBatch& batch, LedManager& ledManager, InternalState& state, uint8_t* outputBuffer, size_t outputBufferSize);
 
     /**
      * @brief Processes a decoded protobuf command buffer.
      * @param data Pointer to command data bytes.
      * @param length Length of the protobuf message.
+     * @return false if the command must wait for in-flight jobs (nothing was sent; retry the same frame later),
+     *         true once it was handled or answered with an error.
      */
-    void processProtoCommand(const uint8_t* data, size_t length);
+    bool processProtoCommand(const uint8_t* data, size_t length);
 
     /**
      * @brief Returns the currently selected seed slot based on the active LED color index.
@@ -58,11 +83,40 @@ public:
 
     /**
      * @brief Derives the default password using the selected seed.
-     *        Used for long-touch operations.
+     *        Used for long-touch operations. Takes the precomputed result when one is ready
+     *        for the selected slot, otherwise derives synchronously.
      * @return true if the password was successfully derived and written to outputBuffer, false otherwise.
      */
     bool deriveDefaultPassword();
 
+    /**
+     * @brief Queues a background derivation of the default password for the selected slot.
+     *        Called when the slot changes (and at boot) so a long touch finds it ready.
+     *        Does nothing if a result for this slot is already queued or ready.
+     */
+    void prefetchDefaultPassword();
+
+    /**
+     * @brief Confirms the command waiting for a touch (AWAITING_CONFIRMATION): starts streaming the batch results
+     *        or sends the returned password.
+     */
+    void confirmPending();
+
+    /**
+     * @brief Must be called in Arduino loop().
+     *        Derives one batch entry or queued GENERATE_PASSWORD job on core0 and streams confirmed batch results, expires an unconfirmed returned password,
+     *        sends the responses of completed crypto jobs (with their request_id) and of seeds the storage flush committed, advances
+     *        a keyboard calibration and answers it once done, locks the unlocked-seed session and discards the precomputed password
+     *        on idle timeout or when the selected slot changes.
+     */
+    void loop();
+
+    /**
+     * @brief Wipes the unlocked-seed session immediately (e.g. on USB suspend).
+     *        An unconfirmed or streaming batch and an unconfirmed returned password are dropped as well.
+     */
+    void lockSession();
+
     /**
      * @brief Returns a pointer to the internal output buffer.
      *        Intended for read-only access or HID typing.
@@ -79,14 +133,66 @@ public:
      */
     void clearOutputBuffer();
 
+    /**
+     * @brief Returns the host keyboard layout passwords are typed for (SET_KEYBOARD_LAYOUT, US after boot).
+     */
+    turtlpass_KeyboardLayout getKeyboardLayout() const;
+
+    /**
+     * @brief Returns the typing timing of the selected host profile (loaded from storage on first use).
+     */
+    const HidHostTiming& getHostTiming();
+
+    /**
+     * @brief Returns true while CALIBRATE_KEYBOARD probes the host (HID typing and flash programs must wait).
+     */
+    bool isCalibrating() const;
+
 private:
     SeedManager& seedManager_;
     Kdf& kdf_;
+    CryptoWorker& worker_;
+    PasswordPrecompute& precompute_;
+    PasswordBatch& batch_;
     LedManager& ledManager_;
     InternalState& state_;
     // char* outputBuffer_;
     uint8_t *outputBuffer_;
     size_t outputBufferSize_;
+    uint32_t requestId_;  ///< request_id of the command or job being answered
+    turtlpass_Command command_;  ///< Decoded command (~1.2 KB with a full batch, kept off the stack)
+    uint8_t batchSlot_;          ///< Slot of the active batch
+    uint32_t batchEpoch_;        ///< Salt midstate epoch of the active batch
+    bool deliveryPending_;       ///< outputBuffer_ holds a RETURN_ON_TOUCH password awaiting its touch
+    uint32_t deliveryRequestId_; ///< request_id to answer the returned password with
+    uint32_t deliveryAtMs_;      ///< millis() when the returned password became ready
+    uint8_t seedJobs_;           ///< INITIALIZE_SEED jobs submitted and not yet completed
+    bool seedCommitPending_;     ///< An INITIALIZE_SEED reply waits for its seed to reach flash
+    uint8_t seedCommitSlot_;     ///< Slot of the pending seed
+    uint32_t seedCommitRequestId_;  ///< request_id to answer the pending seed with
+    bool calibrationPending_;    ///< CALIBRATE_KEYBOARD is probing the host
+    uint8_t calibrationProfile_; ///< Host profile the calibrated timing is stored for
+    uint32_t calibrationRequestId_;  ///< request_id to answer the calibration with
+    turtlpass_KeyboardLayout keyboardLayout_;  ///< Host layout for HID typing
+    uint8_t hostProfile_;        ///< Host profile whose stored timing is used for HID typing
+    bool hostTimingLoaded_;      ///< hostTiming_ holds the stored timing of hostProfile_
+    HidHostTiming hostTiming_;   ///< Typing timing of hostProfile_
+
+    /**
+     * @brief Decides whether a command has to wait for in-flight crypto jobs.
+     *        Lockstep commands (request_id 0) and state-changing commands wait for the worker to drain;
+     *        pipelined crypto commands only wait for a free job, and derivations also for a new seed to be
+     *        committed; read-only queries never wait. While a keyboard calibration runs, everything but pipelined
+     *        read-only queries waits.
+     * @param command Decoded command.
+     * @return true if the command must be retried later.
+     */
+    bool mustWait(const turtlpass_Command &command) const;
+
+    /**
+     * @brief Returns true while crypto jobs are in flight or an INITIALIZE_SEED reply waits for the flush.
+     */
+    bool isBusy() const;
 
     /**
      * @brief Handles the GET_DEVICE_INFO command type.
@@ -96,23 +202,138 @@ private:
 
     /**
      * @brief Handles the GENERATE_PASSWORD command type.
-     *        Uses the KDF and selected seed to derive a password based on provided parameters.
+     *        Validates the parameters and queues the derivation on the crypto worker.
      * @param command Reference to decoded turtlpass_Command protobuf object.
      */
     void handleGeneratePassword(const turtlpass_Command &command);
 
     /**
      * @brief Handles the INITIALIZE_SEED command type.
-     *        Stores and verifies a new seed in the SeedManager.
+     *        Queues storing and verifying a new seed on the crypto worker.
      * @param command Reference to decoded turtlpass_Command protobuf object.
      */
     void handleInitializeSeed(const turtlpass_Command &command);
 
+    /**
+     * @brief Dispatches a completed crypto job to its completion handler.
+     * @param job Completed job (released by the caller).
+     */
+    void completeJob(CryptoJob &job);
+
+    /**
+     * @brief Finishes GENERATE_PASSWORD: copies the password to the output buffer and responds,
+     *        or, for RETURN_ON_TOUCH, holds the response until the touch.
+     * @param job Completed DERIVE_PASSWORD job.
+     */
+    void completeGeneratePassword(const CryptoJob &job);
+
+    /**
+     * @brief Finishes INITIALIZE_SEED: maps the result to a response, or waits for the flush of a staged seed.
+     * @param result Result of SeedManager::initializeSeed() or SeedManager::commitResult().
+     * @param seedSlot Slot of the seed.
+     */
+    void completeInitializeSeed(SeedManager::SeedInitResult result, uint8_t seedSlot);
+
+    /**
+     * @brief Answers the pending INITIALIZE_SEED once its seed was committed to flash or dropped.
+     */
+    void serviceSeedCommit();
+
+    /**
+     * @brief Handles the GENERATE_PASSWORD_BATCH command type.
+     *        Validates every entry, fetches the seed once and starts the batch; results are sent after a touch.
+     * @param command Reference to decoded turtlpass_Command protobuf object.
+     */
+    void handleGeneratePasswordBatch(const turtlpass_Command &command);
+
+    /**
+     * @brief Drives the active batch from loop(): derives an entry, handles the confirmation timeout
+     *        and sends the next chunk once confirmed.
+     */
+    void serviceBatch();
+
+    /**
+     * @brief Sends the ready batch results, in entry order, packed into one response.
+     *        Each password is followed by a NUL byte in Response.data.
+     */
+    void sendBatchChunk();
+
+    /**
+     * @brief Stores the batch's salt midstate back, wipes the batch and returns to IDLE.
+     */
+    void finishBatch();
+
+    /**
+     * @brief Drops a returned password that was not confirmed within CONFIRM_TIMEOUT_MS.
+     */
+    void serviceDelivery();
+
+    /**
+     * @brief Wipes the returned password and returns to IDLE.
+     */
+    void finishDelivery();
+
     /**
      * @brief Handles the FACTORY_RESET command type.
      *        Resets all stored seeds to factory default.
      */
     void handleFactoryReset();
+
+    /**
+     * @brief Handles the SET_SESSION_TIMEOUT command type.
+     *        Sets the unlocked-seed session idle timeout (0 disables sessions) and replies with the session state.
+     * @param command Reference to decoded turtlpass_Command protobuf object.
+     */
+    void handleSetSessionTimeout(const turtlpass_Command &command);
+
+    /**
+     * @brief Handles the GET_SESSION_STATE command type.
+     *        Replies with the current unlocked-seed session state.
+     */
+    void handleGetSessionState();
+
+    /**
+     * @brief Handles the LOCK_SESSION command type.
+     *        Wipes the unlocked seed and replies with the session state.
+     */
+    void handleLockSession();
+
+    /**
+     * @brief Handles the SET_KEYBOARD_LAYOUT command type.
+     *        Selects the host keyboard layout used when typing passwords.
+     * @param command Reference to decoded turtlpass_Command protobuf object.
+     */
+    void handleSetKeyboardLayout(const turtlpass_Command &command);
+
+    /**
+     * @brief Handles the CALIBRATE_KEYBOARD command type.
+     *        Starts measuring the host's report timing over HID (nothing is typed); serviceCalibration() answers it.
+     * @param command Reference to decoded turtlpass_Command protobuf object.
+     */
+    void handleCalibrateKeyboard(const turtlpass_Command &command);
+
+    /**
+     * @brief Advances the running calibration by one probe; once done, stores the timing for the host profile
+     *        and replies with [press ms, release ms], or an error after storing the conservative fallback timing.
+     */
+    void serviceCalibration();
+
+    /**
+     * @brief Handles the SET_FRAMING command type.
+     *        Replies in the current framing, then switches both directions to the requested one.
+     * @param command Reference to decoded turtlpass_Command protobuf object.
+     */
+    void handleSetFraming(const turtlpass_Command &command);
+
+    /**
+     * @brief Selects a host profile and loads its stored timing (HID_TIMING_DEFAULT if none).
+     */
+    void loadHostTiming(uint8_t hostProfile);
+
+    /**
+     * @brief Builds and sends a success response carrying the session state.
+     */
+    void sendSessionStateResponse();
 };
 
 #endif // COMMAND_PROCESSOR_H
@@ -0,0 +1,148 @@
+#include "core/CryptoWorker.h"
+#include "core/PasswordDerivation.h"
+#include "system/CoreLock.h"
+#include <cstring>
+
+CryptoWorker::CryptoWorker(SeedManager &seedManager)
+    : seedManager_(seedManager), running_(0), seedRunning_(false) {
+    memset(jobs_, 0, sizeof(jobs_));
+    memset(inUse_, 0, sizeof(inUse_));
+    for (size_t i = 0; i < CRYPTO_QUEUE_DEPTH; ++i) {
+        done_[i].store(false, std::memory_order_relaxed);
+    }
+    mutex_init(&mutex_);
+}
+
+CryptoWorker::~CryptoWorker() {
+    clean(jobs_, sizeof(jobs_));
+}
+
+CryptoJob *CryptoWorker::acquire() {
+    for (size_t i = 0; i < CRYPTO_QUEUE_DEPTH; ++i) {
+        if (!inUse_[i]) {
+            inUse_[i] = true;
+            memset(&jobs_[i], 0, sizeof(CryptoJob));
+            return &jobs_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool CryptoWorker::submit(CryptoJob *job) {
+    if (job < jobs_ || job >= jobs_ + CRYPTO_QUEUE_DEPTH) return false;
+    // cannot overflow: at most CRYPTO_QUEUE_DEPTH jobs are acquired
+    const uint8_t index = (uint8_t)(job - jobs_);
+    submitted_.push(index);
+    return pending_.push(index);
+}
+
+CryptoJob *CryptoWorker::poll() {
+    uint8_t index;
+    if (submitted_.peek(&index, 1) == 0 || !done_[index].load(std::memory_order_acquire)) {
+        return nullptr;  // the oldest job is still queued or running
+    }
+    submitted_.skip(1);
+    return &jobs_[index];
+}
+
+void CryptoWorker::release(CryptoJob *job) {
+    if (job < jobs_ || job >= jobs_ + CRYPTO_QUEUE_DEPTH) return;
+    clean(job, sizeof(CryptoJob));
+    done_[job - jobs_].store(false, std::memory_order_relaxed);
+    inUse_[job - jobs_] = false;
+}
+
+bool CryptoWorker::hasFreeJob() const {
+    for (size_t i = 0; i < CRYPTO_QUEUE_DEPTH; ++i) {
+        if (!inUse_[i]) return true;
+    }
+    return false;
+}
+
+bool CryptoWorker::isBusy() const {
+    for (size_t i = 0; i < CRYPTO_QUEUE_DEPTH; ++i) {
+        if (inUse_[i]) return true;
+    }
+    return false;
+}
+
+void CryptoWorker::loop() {
+    int index = claim(false);
+    if (index >= 0) run((uint8_t)index, kdf_);
+}
+
+bool CryptoWorker::work(Kdf &kdf) {
+    int index = claim(true);
+    if (index < 0) return false;
+    run((uint8_t)index, kdf);
+    return true;
+}
+
+int CryptoWorker::claim(bool onlyAlongside) {
+    CoreLock lock(mutex_);
+    uint8_t index;
+    if (pending_.peek(&index, 1) == 0) return -1;
+    const bool derive = jobs_[index].type == CryptoJob::DERIVE_PASSWORD;
+    // derivations only read seeds, so they may overlap; a seed job runs alone
+    if (running_ > 0 && (!derive || seedRunning_)) return -1;
+    if (onlyAlongside && (running_ == 0 || !derive)) return -1;  // core1 takes it
+    pending_.skip(1);
+    running_++;
+    seedRunning_ = !derive;
+    return index;
+}
+
+void CryptoWorker::run(uint8_t index, Kdf &kdf) {
+    CryptoJob &job = jobs_[index];
+    switch (job.type) {
+        case CryptoJob::DERIVE_PASSWORD:
+            job.status = derivePassword(seedManager_, kdf, job.slot, job.charset,
+                                        job.output, job.length, job.input);
+            break;
+
+        case CryptoJob::INITIALIZE_SEED:
+            job.initResult = seedManager_.initializeSeed(job.slot, job.seed, sizeof(job.seed));
+            job.status = job.initResult == SeedManager::SeedInitResult::STAGED ? CryptoJob::OK : CryptoJob::FAILED;
+            clean(job.seed, sizeof(job.seed));
+            break;
+
+        default:
+            job.status = CryptoJob::FAILED;
+            break;
+    }
+    {
+        CoreLock lock(mutex_);
+        running_--;
+        seedRunning_ = false;
+    }
+    done_[index].store(true, std::memory_order_release);
+}
+
+CryptoJob::Status CryptoWorker::derivePassword(SeedManager &seedManager, Kdf &kdf, uint8_t seedSlot,
+                                               turtlpass_Charset charset, uint8_t *dst, size_t length,
+                                               const char *input) {
+    // get seed (as the NUL-terminated string Kdf expects)
+    uint8_t seedBytes[SeedManager::SEED_SIZE];
+    if (!seedManager.getSeed(seedSlot, seedBytes, sizeof(seedBytes))) {
+        clean(seedBytes, sizeof(seedBytes));
+        return CryptoJob::SEED_NOT_INITIALIZED;
+    }
+    char seed[SeedManager::SEED_SIZE + 1];
+    for (size_t i = 0; i < SeedManager::SEED_SIZE; ++i) {
+        seed[i] = static_cast<char>(seedBytes[i]);
+    }
+    seed[SeedManager::SEED_SIZE] = '\0';
+    clean(seedBytes, sizeof(seedBytes));
+
+    // private copy of the slot's salt midstate
+    HmacSha512::Midstate saltMidstate;
+    uint32_t epoch = 0;
+    seedManager.loadSaltMidstate(seedSlot, saltMidstate, epoch);
+
+    bool result = derivePasswordForCharset(kdf, charset, dst, length, input, seed, &saltMidstate);
+
+    seedManager.storeSaltMidstate(seedSlot, saltMidstate, epoch);
+    saltMidstate.clear();
+    clean(seed, sizeof(seed));
+    return result ? CryptoJob::OK : CryptoJob::FAILED;
+}
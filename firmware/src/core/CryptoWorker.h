@@ -0,0 +1,178 @@
+#ifndef CRYPTO_WORKER_H
+#define CRYPTO_WORKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "proto/turtlpass.pb.h"
+#include "storage/SeedManager.h"
+#include "crypto/Kdf.h"
+#include "pico/mutex.h"
+#include "system/SpscRing.h"
+#include <atomic>
+
+#if defined(TP_CRYPTO_QUEUE_DEPTH)
+#define CRYPTO_QUEUE_DEPTH TP_CRYPTO_QUEUE_DEPTH
+#else
+#define CRYPTO_QUEUE_DEPTH 8  ///< Jobs in flight between core0 and core1 (power of two)
+#endif
+
+/**
+ * @struct CryptoJob
+ * @brief One unit of work for the crypto worker, including its result.
+ *
+ * Jobs live in the worker's fixed pool; only their index crosses cores.
+ */
+struct CryptoJob {
+    enum Type : uint8_t {
+        DERIVE_PASSWORD = 1,  ///< Read the slot's seed and derive a password
+        INITIALIZE_SEED       ///< Hash, encrypt and stage a new seed (committed by the idle flush)
+    };
+
+    enum Status : uint8_t {
+        OK = 0,
+        SEED_NOT_INITIALIZED,  ///< DERIVE_PASSWORD: slot has no seed
+        FAILED                 ///< Derivation or seed initialization failed
+    };
+
+    Type type;
+    uint32_t requestId;                           ///< request_id echoed in the response
+    uint8_t slot;                                 ///< Seed slot (1–NUM_SLOTS)
+
+    // DERIVE_PASSWORD
+    turtlpass_Charset charset;                    ///< Character set
+    turtlpass_PasswordDelivery delivery;          ///< Type on touch or return to the host
+    uint32_t length;                              ///< Password length
+    char input[MAX_ENTROPY_SIZE + 1];             ///< Entropy, NUL-terminated
+
+    // INITIALIZE_SEED
+    uint8_t seed[SeedManager::SEED_SIZE];         ///< Seed to store
+
+    // Result
+    Status status;
+    SeedManager::SeedInitResult initResult;       ///< INITIALIZE_SEED detail
+    uint8_t output[MAX_PASS_SIZE + 1];            ///< Derived password, NUL-terminated
+};
+
+/**
+ * @class CryptoWorker
+ * @brief Runs seed and derivation jobs; both cores can take derivation jobs.
+ *
+ * core0 takes a job from the pool with acquire(), fills it and submit()s it;
+ * a runner marks it done, and core0 collects it with poll() and returns it
+ * with release(). Submitting only pushes to a ring, so the command handler
+ * itself does not wait for HKDF.
+ *
+ * core1 runs every kind of job in loop(). While core1 runs a derivation,
+ * core0 may take the next queued one with work(), so core0 runs HKDF too and
+ * serial framing and the button wait for that one job. Seed jobs only run
+ * alone, so they stay ordered with the derivations around them, and poll()
+ * returns jobs in submission order whichever core finished first.
+ *
+ * acquire(), submit(), work(), poll(), release(), hasFreeJob() and isBusy() are
+ * core0-only; loop() is core1-only.
+ */
+class CryptoWorker {
+public:
+    /**
+     * @brief Constructor.
+     * @param seedManager Seed storage shared with core0 (internally locked).
+     */
+    explicit CryptoWorker(SeedManager &seedManager);
+
+    /**
+     * @brief Destructor. Wipes every job.
+     */
+    ~CryptoWorker();
+
+    /**
+     * @brief Take a free job from the pool (core0).
+     * @return Zeroed job, or nullptr if all CRYPTO_QUEUE_DEPTH jobs are in flight.
+     */
+    CryptoJob *acquire();
+
+    /**
+     * @brief Queue a filled job for core1 (core0).
+     * @return false if the job does not belong to this worker.
+     */
+    bool submit(CryptoJob *job);
+
+    /**
+     * @brief Collect the next completed job, in submission order (core0).
+     * @return Completed job, or nullptr if none. Must be passed to release().
+     */
+    CryptoJob *poll();
+
+    /**
+     * @brief Wipe a job and return it to the pool (core0).
+     */
+    void release(CryptoJob *job);
+
+    /**
+     * @brief Returns true if acquire() would succeed (core0).
+     */
+    bool hasFreeJob() const;
+
+    /**
+     * @brief Returns true while any job is acquired, queued, running or awaiting poll() (core0).
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief Run at most one queued job (core1).
+     */
+    void loop();
+
+    /**
+     * @brief Run the next queued derivation while core1 runs another one (core0).
+     *
+     * @param kdf Derivation helper owned by core0.
+     * @return true if a job was run, false if there was nothing to take.
+     */
+    bool work(Kdf &kdf);
+
+    /**
+     * @brief Derive a password from a slot's seed.
+     *
+     * Shared by the worker and core0's synchronous long-press path. Uses (and fills)
+     * the slot's cached salt midstate through a private copy.
+     *
+     * @param seedManager Seed storage.
+     * @param kdf Derivation helper owned by the calling core.
+     * @param seedSlot Slot number (1–NUM_SLOTS).
+     * @param charset Character set.
+     * @param dst Output buffer (length + 1 bytes).
+     * @param length Password length.
+     * @param input NUL-terminated derivation input.
+     * @return OK, SEED_NOT_INITIALIZED or FAILED.
+     */
+    static CryptoJob::Status derivePassword(SeedManager &seedManager, Kdf &kdf, uint8_t seedSlot,
+                                            turtlpass_Charset charset, uint8_t *dst, size_t length,
+                                            const char *input);
+
+private:
+    /**
+     * @brief Take the next queued job, if it may run now.
+     *
+     * @param onlyAlongside Take a derivation only while another one runs (core0).
+     * @return Job index, or -1 if none may run.
+     */
+    int claim(bool onlyAlongside);
+
+    /**
+     * @brief Execute a claimed job with a core's Kdf, fill its result and mark it done.
+     */
+    void run(uint8_t index, Kdf &kdf);
+
+    SeedManager &seedManager_;
+    Kdf kdf_;                                           ///< core1's own derivation helper
+    CryptoJob jobs_[CRYPTO_QUEUE_DEPTH];                ///< Job pool
+    bool inUse_[CRYPTO_QUEUE_DEPTH];                    ///< Pool bookkeeping (core0 only)
+    std::atomic<bool> done_[CRYPTO_QUEUE_DEPTH];        ///< Result ready (set by the running core)
+    SpscRing<uint8_t, CRYPTO_QUEUE_DEPTH> pending_;     ///< core0 → runners, popped under mutex_
+    SpscRing<uint8_t, CRYPTO_QUEUE_DEPTH> submitted_;   ///< Submission order for poll() (core0 only)
+    uint8_t running_;                                   ///< Jobs being run (under mutex_)
+    bool seedRunning_;                                  ///< The running job is INITIALIZE_SEED (under mutex_)
+    mutex_t mutex_;                                     ///< Serializes claiming jobs on both cores
+};
+
+#endif  // CRYPTO_WORKER_H
@@ -0,0 +1,193 @@
+#include "core/PasswordBatch.h"
+#include "core/PasswordDerivation.h"
+#include "system/CoreLock.h"
+#include <cstring>
+
+PasswordBatch::PasswordBatch()
+    : active_(false), confirmed_(false), requestId_(0), startedAtMs_(0), generation_(0),
+      count_(0), next_(0), taken_(0) {
+    mutex_init(&mutex_);
+    memset(seed_, 0, sizeof(seed_));
+    memset(entries_, 0, sizeof(entries_));
+}
+
+PasswordBatch::~PasswordBatch() {
+    clean(seed_, sizeof(seed_));
+    clean(entries_, sizeof(entries_));
+    salt_.clear();
+}
+
+bool PasswordBatch::start(const char *seed, const HmacSha512::Midstate &saltMidstate,
+                          const turtlpass_GeneratePasswordParams *entries, size_t count, uint32_t requestId) {
+    if (!seed || !entries || count == 0 || count > BATCH_MAX_ENTRIES) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].entropy.size == 0 || entries[i].entropy.size > MAX_ENTROPY_SIZE ||
+            entries[i].length < 1 || entries[i].length > MAX_PASS_SIZE) {
+            return false;
+        }
+    }
+
+    CoreLock lock(mutex_);
+    if (active_) return false;
+    wipeLocked();
+    memcpy(seed_, seed, BATCH_SEED_SIZE);
+    seed_[BATCH_SEED_SIZE] = '\0';
+    salt_ = saltMidstate;
+    for (size_t i = 0; i < count; ++i) {
+        Entry &entry = entries_[i];
+        entry.charset = entries[i].charset;
+        entry.length = entries[i].length;
+        memcpy(entry.input, entries[i].entropy.bytes, entries[i].entropy.size);
+        entry.input[entries[i].entropy.size] = '\0';
+        entry.state = QUEUED;
+    }
+    count_ = count;
+    requestId_ = requestId;
+    startedAtMs_ = millis();
+    active_ = true;
+    return true;
+}
+
+bool PasswordBatch::work(Kdf &kdf) {
+    char seed[BATCH_SEED_SIZE + 1];
+    char input[MAX_ENTROPY_SIZE + 1];
+    HmacSha512::Midstate salt;
+    turtlpass_Charset charset;
+    size_t length;
+    size_t index;
+    uint32_t generation;
+
+    // claim the next entry, leaving the lock free while deriving
+    {
+        CoreLock lock(mutex_);
+        if (!active_ || next_ >= count_) return false;
+        index = next_++;
+        Entry &entry = entries_[index];
+        entry.state = RUNNING;
+        charset = entry.charset;
+        length = entry.length;
+        memcpy(input, entry.input, sizeof(input));
+        memcpy(seed, seed_, sizeof(seed));
+        salt = salt_;
+        generation = generation_;
+        if (next_ == count_) {
+            clean(seed_, sizeof(seed_));  // every entry claimed
+        }
+    }
+
+    uint8_t password[MAX_PASS_SIZE + 1] = {0};
+    if (!derivePasswordForCharset(kdf, charset, password, length, input, seed, &salt)) {
+        clean(password, sizeof(password));  // reported as an empty password
+    }
+    clean(seed, sizeof(seed));
+    clean(input, sizeof(input));
+
+    {
+        CoreLock lock(mutex_);
+        // a discard or a new batch superseded this entry
+        if (generation == generation_) {
+            Entry &entry = entries_[index];
+            memcpy(entry.output, password, sizeof(entry.output));
+            clean(entry.input, sizeof(entry.input));
+            entry.state = DONE;
+            if (salt.valid && !salt_.valid) {
+                salt_ = salt;  // later entries skip the salt key schedule
+            }
+        }
+    }
+    salt.clear();
+    clean(password, sizeof(password));
+    return true;
+}
+
+void PasswordBatch::loop() {
+    work(kdf_);
+}
+
+void PasswordBatch::confirm() {
+    CoreLock lock(mutex_);
+    if (active_) confirmed_ = true;
+}
+
+bool PasswordBatch::isActive() {
+    CoreLock lock(mutex_);
+    return active_;
+}
+
+bool PasswordBatch::isConfirmed() {
+    CoreLock lock(mutex_);
+    return active_ && confirmed_;
+}
+
+bool PasswordBatch::confirmationExpired() {
+    CoreLock lock(mutex_);
+    return active_ && !confirmed_ && millis() - startedAtMs_ >= CONFIRM_TIMEOUT_MS;
+}
+
+bool PasswordBatch::isComplete() {
+    CoreLock lock(mutex_);
+    return active_ && taken_ == count_;
+}
+
+uint32_t PasswordBatch::requestId() {
+    CoreLock lock(mutex_);
+    return requestId_;
+}
+
+size_t PasswordBatch::total() {
+    CoreLock lock(mutex_);
+    return count_;
+}
+
+size_t PasswordBatch::taken() {
+    CoreLock lock(mutex_);
+    return taken_;
+}
+
+bool PasswordBatch::nextReady(size_t &length) {
+    CoreLock lock(mutex_);
+    if (!active_ || taken_ >= count_ || entries_[taken_].state != DONE) return false;
+    length = strnlen((const char *)entries_[taken_].output, MAX_PASS_SIZE);
+    return true;
+}
+
+bool PasswordBatch::take(uint8_t *out, size_t outSize, size_t &length) {
+    if (!out || outSize == 0) return false;
+
+    CoreLock lock(mutex_);
+    if (!active_ || taken_ >= count_ || entries_[taken_].state != DONE) return false;
+    Entry &entry = entries_[taken_];
+    size_t len = strnlen((const char *)entry.output, MAX_PASS_SIZE);
+    if (len + 1 > outSize) return false;
+    memcpy(out, entry.output, len);
+    out[len] = 0;
+    clean(&entry, sizeof(entry));
+    length = len;
+    ++taken_;
+    return true;
+}
+
+bool PasswordBatch::saltMidstate(HmacSha512::Midstate &out) {
+    CoreLock lock(mutex_);
+    out = salt_;
+    return salt_.valid;
+}
+
+void PasswordBatch::discard() {
+    CoreLock lock(mutex_);
+    wipeLocked();
+}
+
+void PasswordBatch::wipeLocked() {
+    clean(seed_, sizeof(seed_));
+    clean(entries_, sizeof(entries_));
+    salt_.clear();
+    active_ = false;
+    confirmed_ = false;
+    requestId_ = 0;
+    startedAtMs_ = 0;
+    count_ = 0;
+    next_ = 0;
+    taken_ = 0;
+    ++generation_;
+}
@@ -0,0 +1,177 @@
+#ifndef PASSWORD_BATCH_H
+#define PASSWORD_BATCH_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/mutex.h"
+#include "proto/turtlpass.pb.h"
+#include "crypto/Kdf.h"
+
+#if defined(TP_CONFIRM_TIMEOUT_MS)
+#define CONFIRM_TIMEOUT_MS TP_CONFIRM_TIMEOUT_MS
+#else
+#define CONFIRM_TIMEOUT_MS 30000  ///< A batch or returned password waits at most 30 s for its touch
+#endif
+
+#define BATCH_MAX_ENTRIES pb_arraysize(turtlpass_GeneratePasswordBatchParams, entries)  ///< 16
+#define BATCH_SEED_SIZE 64              ///< Seed length in bytes (SeedManager::SEED_SIZE)
+
+/**
+ * @class PasswordBatch
+ * @brief Derives the passwords of a GENERATE_PASSWORD_BATCH command on both cores.
+ *
+ * core0 starts a batch with the seed (fetched and decrypted once) and the slot's
+ * salt midstate. Each call to work() then claims the next entry and derives it;
+ * core1 calls it from loop() and core0 between serial frames, so the entries are
+ * split across both cores while sharing one HMAC salt state.
+ *
+ * Results are collected in entry order with take(), once the user has confirmed
+ * the batch with a touch. The seed is wiped as soon as the last entry is claimed,
+ * each result when it is taken, and everything on discard().
+ */
+class PasswordBatch {
+public:
+    /**
+     * @brief Constructor. Starts inactive.
+     */
+    PasswordBatch();
+
+    /**
+     * @brief Destructor. Wipes all buffers.
+     */
+    ~PasswordBatch();
+
+    /**
+     * @brief Start a batch (core0).
+     *
+     * @param seed Seed string as passed to Kdf (BATCH_SEED_SIZE + 1 bytes).
+     * @param saltMidstate Cached salt midstate of the slot (may be invalid).
+     * @param entries Validated password parameters.
+     * @param count Number of entries (1–BATCH_MAX_ENTRIES).
+     * @param requestId request_id to answer with.
+     * @return false if a batch is already active or the arguments are invalid.
+     */
+    bool start(const char *seed, const HmacSha512::Midstate &saltMidstate,
+               const turtlpass_GeneratePasswordParams *entries, size_t count, uint32_t requestId);
+
+    /**
+     * @brief Derive the next unclaimed entry on the calling core.
+     *
+     * @param kdf Derivation helper owned by the calling core.
+     * @return true if an entry was derived, false if there was nothing to do.
+     */
+    bool work(Kdf &kdf);
+
+    /**
+     * @brief Derive one entry with core1's own Kdf (core1).
+     */
+    void loop();
+
+    /**
+     * @brief Mark the batch as confirmed by the user (core0).
+     */
+    void confirm();
+
+    /**
+     * @brief Returns true between start() and discard().
+     */
+    bool isActive();
+
+    /**
+     * @brief Returns true once confirm() was called on the active batch.
+     */
+    bool isConfirmed();
+
+    /**
+     * @brief Returns true if the active batch was not confirmed within CONFIRM_TIMEOUT_MS.
+     */
+    bool confirmationExpired();
+
+    /**
+     * @brief Returns true once every result has been taken.
+     */
+    bool isComplete();
+
+    /**
+     * @brief request_id of the active batch.
+     */
+    uint32_t requestId();
+
+    /**
+     * @brief Number of entries in the active batch.
+     */
+    size_t total();
+
+    /**
+     * @brief Number of results already taken (index of the next one).
+     */
+    size_t taken();
+
+    /**
+     * @brief Check whether the next result (in entry order) is ready.
+     *
+     * @param length Receives its length (0 if the derivation failed).
+     * @return true if ready.
+     */
+    bool nextReady(size_t &length);
+
+    /**
+     * @brief Copy the next result and wipe it here.
+     *
+     * @param out Output buffer, receives the NUL-terminated password.
+     * @param outSize Size of the output buffer.
+     * @param length Receives the password length.
+     * @return false if the next result is not ready or does not fit.
+     */
+    bool take(uint8_t *out, size_t outSize, size_t &length);
+
+    /**
+     * @brief Copy the salt midstate, filled by the first derivation if it was not cached.
+     *
+     * @param out Receives the midstate.
+     * @return true if it is valid (and worth storing back in SeedManager).
+     */
+    bool saltMidstate(HmacSha512::Midstate &out);
+
+    /**
+     * @brief Wipe everything and deactivate. A derivation still running is dropped.
+     */
+    void discard();
+
+private:
+    enum EntryState : uint8_t {
+        QUEUED = 0,  // waiting for a core
+        RUNNING,     // being derived
+        DONE         // result available (empty if the derivation failed)
+    };
+
+    struct Entry {
+        turtlpass_Charset charset;
+        size_t length;
+        char input[MAX_ENTROPY_SIZE + 1];
+        uint8_t output[MAX_PASS_SIZE + 1];
+        EntryState state;
+    };
+
+    /**
+     * @brief Wipe buffers and deactivate. Mutex must be held.
+     */
+    void wipeLocked();
+
+    mutex_t mutex_;                          ///< Guards every field below
+    bool active_;                            ///< A batch is in progress
+    bool confirmed_;                         ///< The user confirmed it with a touch
+    uint32_t requestId_;                     ///< request_id of the batch
+    uint32_t startedAtMs_;                   ///< millis() at start()
+    uint32_t generation_;                    ///< Bumped by every start/discard
+    size_t count_;                           ///< Number of entries
+    size_t next_;                            ///< Next entry to claim
+    size_t taken_;                           ///< Next result to take
+    char seed_[BATCH_SEED_SIZE + 1];         ///< Seed, wiped once every entry is claimed
+    HmacSha512::Midstate salt_;              ///< Shared salt midstate
+    Entry entries_[BATCH_MAX_ENTRIES];       ///< Parameters and results
+    Kdf kdf_;                                ///< core1's own derivation helper
+};
+
+#endif  // PASSWORD_BATCH_H
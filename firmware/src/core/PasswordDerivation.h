@@ -0,0 +1,38 @@
+#ifndef PASSWORD_DERIVATION_H
+#define PASSWORD_DERIVATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "proto/turtlpass.pb.h"
+#include "crypto/Kdf.h"
+
+/**
+ * @brief Derive a password with the Kdf variant matching a protobuf charset.
+ *
+ * Shared by the crypto worker and the batch engine so both map charsets the same way.
+ *
+ * @param kdf Derivation helper owned by the calling core.
+ * @param charset Character set (unknown values fall back to LETTERS_NUMBERS).
+ * @param dst Output buffer (length + 1 bytes).
+ * @param length Password length.
+ * @param input NUL-terminated derivation input.
+ * @param seed NUL-terminated seed string.
+ * @param saltMidstate Optional cached salt midstate (see Kdf).
+ * @return true on success.
+ */
+inline bool derivePasswordForCharset(Kdf &kdf, turtlpass_Charset charset, uint8_t *dst, size_t length,
+                                     const char *input, const char *seed,
+                                     HmacSha512::Midstate *saltMidstate = nullptr) {
+    switch (charset) {
+        case turtlpass_Charset_NUMBERS_ONLY:
+            return kdf.derivatePassNumbersOnly(dst, length, input, seed, saltMidstate);
+        case turtlpass_Charset_LETTERS_ONLY:
+            return kdf.derivatePassLettersOnly(dst, length, input, seed, saltMidstate);
+        case turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS:
+            return kdf.derivatePassWithSymbols(dst, length, input, seed, saltMidstate);
+        default:
+            return kdf.derivatePass(dst, length, input, seed, saltMidstate);
+    }
+}
+
+#endif  // PASSWORD_DERIVATION_H
@@ -0,0 +1,110 @@
+#include "core/PasswordPrecompute.h"
+#include "system/CoreLock.h"
+#include <cstring>
+
+PasswordPrecompute::PasswordPrecompute()
+    : state_(EMPTY), slot_(0), length_(0), generation_(0), readyAtMs_(0) {
+    mutex_init(&mutex_);
+    memset(seed_, 0, sizeof(seed_));
+    memset(password_, 0, sizeof(password_));
+}
+
+PasswordPrecompute::~PasswordPrecompute() {
+    clean(seed_, sizeof(seed_));
+    clean(password_, sizeof(password_));
+}
+
+bool PasswordPrecompute::request(uint8_t seedSlot, const char *seed, size_t length) {
+    if (seedSlot == 0 || !seed || length == 0 || length > MAX_PASS_SIZE) return false;
+
+    CoreLock lock(mutex_);
+    wipeLocked();
+    memcpy(seed_, seed, sizeof(seed_));
+    seed_[PRECOMPUTE_SEED_SIZE] = '\0';
+    slot_ = seedSlot;
+    length_ = length;
+    state_ = PENDING;
+    return true;
+}
+
+void PasswordPrecompute::loop() {
+    char seed[PRECOMPUTE_SEED_SIZE + 1];
+    size_t length;
+    uint32_t generation;
+
+    // take the job, leaving the lock free while deriving
+    {
+        CoreLock lock(mutex_);
+        if (state_ != PENDING) return;
+        memcpy(seed, seed_, sizeof(seed));
+        clean(seed_, sizeof(seed_));
+        length = length_;
+        generation = generation_;
+        state_ = RUNNING;
+    }
+
+    uint8_t password[MAX_PASS_SIZE + 1] = {0};
+    bool ok = kdf_.derivatePass(password, length, "default", seed) && password[0] != 0;
+    clean(seed, sizeof(seed));
+
+    {
+        CoreLock lock(mutex_);
+        // a newer request or a discard superseded this job
+        if (generation == generation_ && state_ == RUNNING) {
+            if (ok) {
+                memcpy(password_, password, sizeof(password_));
+                readyAtMs_ = millis();
+                state_ = READY;
+            } else {
+                wipeLocked();
+            }
+        }
+    }
+    clean(password, sizeof(password));
+}
+
+bool PasswordPrecompute::take(uint8_t seedSlot, uint8_t *out, size_t outSize) {
+    if (!out || outSize == 0) return false;
+
+    CoreLock lock(mutex_);
+    if (state_ != READY || slot_ != seedSlot) return false;
+    if (millis() - readyAtMs_ >= PRECOMPUTE_TIMEOUT_MS) {
+        wipeLocked();
+        return false;
+    }
+    size_t len = strnlen((const char *)password_, sizeof(password_));
+    if (len + 1 > outSize) return false;
+    memcpy(out, password_, len);
+    out[len] = 0;
+    wipeLocked();
+    return true;
+}
+
+bool PasswordPrecompute::covers(uint8_t seedSlot) {
+    CoreLock lock(mutex_);
+    return state_ != EMPTY && slot_ == seedSlot;
+}
+
+void PasswordPrecompute::expire(uint8_t activeSlot) {
+    CoreLock lock(mutex_);
+    if (state_ == EMPTY) return;
+    if (slot_ != activeSlot ||
+        (state_ == READY && millis() - readyAtMs_ >= PRECOMPUTE_TIMEOUT_MS)) {
+        wipeLocked();
+    }
+}
+
+void PasswordPrecompute::discard() {
+    CoreLock lock(mutex_);
+    wipeLocked();
+}
+
+void PasswordPrecompute::wipeLocked() {
+    clean(seed_, sizeof(seed_));
+    clean(password_, sizeof(password_));
+    slot_ = 0;
+    length_ = 0;
+    readyAtMs_ = 0;
+    state_ = EMPTY;
+    ++generation_;
+}
@@ -0,0 +1,112 @@
+#ifndef PASSWORD_PRECOMPUTE_H
+#define PASSWORD_PRECOMPUTE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/mutex.h"
+#include "crypto/Kdf.h"
+
+#if defined(TP_PRECOMPUTE_TIMEOUT_MS)
+#define PRECOMPUTE_TIMEOUT_MS TP_PRECOMPUTE_TIMEOUT_MS
+#else
+#define PRECOMPUTE_TIMEOUT_MS 30000  ///< A precomputed password is discarded after 30 s
+#endif
+
+#define PRECOMPUTE_SEED_SIZE 64      ///< Seed length in bytes (SeedManager::SEED_SIZE)
+
+/**
+ * @class PasswordPrecompute
+ * @brief Derives the "default" password of the selected slot ahead of a long press.
+ *
+ * core0 queues a request with request() when the slot changes; core1 runs the
+ * derivation in loop() and parks the result in a mutex-guarded buffer. A long
+ * press then collects it with take() instead of deriving synchronously.
+ *
+ * The result is wiped when it is taken, when another request replaces it,
+ * on discard() and after PRECOMPUTE_TIMEOUT_MS. A request that is replaced
+ * while core1 is still deriving is dropped when it completes.
+ */
+class PasswordPrecompute {
+public:
+    /**
+     * @brief Constructor. Starts empty.
+     */
+    PasswordPrecompute();
+
+    /**
+     * @brief Destructor. Wipes all buffers.
+     */
+    ~PasswordPrecompute();
+
+    /**
+     * @brief Queue a derivation for a slot (core0).
+     *
+     * Replaces and wipes any pending or ready result.
+     *
+     * @param seedSlot Slot the seed belongs to.
+     * @param seed Seed string as passed to Kdf (PRECOMPUTE_SEED_SIZE + 1 bytes).
+     * @param length Password length (1–MAX_PASS_SIZE).
+     * @return true if queued, false on invalid arguments.
+     */
+    bool request(uint8_t seedSlot, const char *seed, size_t length);
+
+    /**
+     * @brief Run a pending derivation, if any (core1).
+     */
+    void loop();
+
+    /**
+     * @brief Collect the precomputed password for a slot (core0).
+     *
+     * On success the password is copied to `out` (NUL-terminated) and wiped here.
+     *
+     * @param seedSlot Slot the caller expects.
+     * @param out Output buffer.
+     * @param outSize Size of the output buffer.
+     * @return true if a ready, unexpired result for this slot was copied.
+     */
+    bool take(uint8_t seedSlot, uint8_t *out, size_t outSize);
+
+    /**
+     * @brief Returns true if a result for this slot is pending, running or ready.
+     */
+    bool covers(uint8_t seedSlot);
+
+    /**
+     * @brief Discard the result on timeout or if it belongs to another slot (core0).
+     *
+     * @param activeSlot Currently selected slot.
+     */
+    void expire(uint8_t activeSlot);
+
+    /**
+     * @brief Wipe everything (factory reset, seed change).
+     */
+    void discard();
+
+private:
+    enum State : uint8_t {
+        EMPTY = 0,   // nothing queued
+        PENDING,     // queued, waiting for core1
+        RUNNING,     // core1 is deriving
+        READY        // result available
+    };
+
+    /**
+     * @brief Wipe buffers and reset to EMPTY. Mutex must be held.
+     */
+    void wipeLocked();
+
+    mutex_t mutex_;                              ///< Guards every field below
+    State state_;                                ///< Current state
+    uint8_t slot_;                               ///< Slot of the queued/ready result
+    size_t length_;                              ///< Requested password length
+    uint32_t generation_;                        ///< Bumped by every request/discard
+    uint32_t readyAtMs_;                         ///< millis() when the result became ready
+    char seed_[PRECOMPUTE_SEED_SIZE + 1];        ///< Seed of the pending request
+    uint8_t password_[MAX_PASS_SIZE + 1];        ///< Precomputed password
+    Kdf kdf_;                                    ///< core1's own derivation helper
+};
+
+#endif  // PASSWORD_PRECOMPUTE_H
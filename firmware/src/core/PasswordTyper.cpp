@@ -10,7 +10,6 @@ void PasswordTyper::type() {
         ledManager_.setBlinking();
         hidTypeString((char*)buffer_);
         memset(buffer_, 0, bufferSize_);
-        delay(100);
         ledManager_.setOn();
     }
 }
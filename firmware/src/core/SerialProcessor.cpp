@@ -1,54 +1,167 @@
 #include "SerialProcessor.h"
 #include <cstring>
+#include <algorithm>
 #include "proto/ProtoHelper.h"
 
 SerialProcessor::SerialProcessor(CommandProcessor &cmdProcessor)
-    : commandProcessor_(cmdProcessor), bytesRead_(0), expectedLength_(0), lastByteTime_(0) {}
+    : commandProcessor_(cmdProcessor), decoder_(buffer_, sizeof(buffer_)), bytesRead_(0), expectedLength_(0),
+      frame_(buffer_), frameLength_(0), lastByteTime_(0), framePending_(false), resyncing_(false), dtr_(false) {}
+
+#if defined(USE_TINYUSB)
+// Set from the USB task when a packet arrives; cleared before the CDC FIFO is drained
+static volatile bool rxSignalled = true;
+
+extern "C" void tud_cdc_rx_cb(uint8_t itf) {
+    (void)itf;
+    rxSignalled = true;
+}
+#endif
 
 // Protobuf Serial Reader
 void SerialProcessor::loop() {
-    while (Serial.available() > 0) {
-        uint8_t byte = Serial.read();
-        lastByteTime_ = millis();
+    // The host closed the port: the next one starts with the default framing
+    const bool dtr = Serial.dtr();
+    if (dtr_ && !dtr && protoFraming() != turtlpass_Framing_LENGTH_PREFIXED) {
+        setProtoFraming(turtlpass_Framing_LENGTH_PREFIXED);
+        if (!framePending_) {
+            dropPartialFrame();
+        }
+    }
+    dtr_ = dtr;
 
-        if (bytesRead_ < 2) {
-            // Read 2-byte length prefix
-            buffer_[bytesRead_++] = byte;
-
-            if (bytesRead_ == 2) {
-                expectedLength_ = buffer_[0] | (buffer_[1] << 8);
-                
-                // Sanity check for frame size
-                if (expectedLength_ == 0 || expectedLength_ > sizeof(buffer_) - 2) {
-                    sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "<PROTO-BAD-LENGTH>");
-                    
-                    // Shift buffer left by one and try again with the next byte
-                    buffer_[0] = buffer_[1];
-                    bytesRead_ = 1;
-                    expectedLength_ = 0;
-                    continue;
-                }
-            }
-        } else {
-            // Read message payload
-            buffer_[bytesRead_++] = byte;
-
-            // Full message received
-            if (bytesRead_ == expectedLength_ + 2) {
-                commandProcessor_.processProtoCommand(buffer_ + 2, expectedLength_);
-                bytesRead_ = 0;
-                expectedLength_ = 0;
-                memset(buffer_, 0, sizeof(buffer_));
-                return;
-            }
+    // A deferred frame is retried before reading any further bytes
+    if (framePending_ && !dispatchFrame()) {
+        return;
+    }
+
+    // SET_FRAMING takes effect from the frame after it
+    while (!rx_.empty() || receive()) {
+        bool dispatched = protoFraming() == turtlpass_Framing_COBS_CRC16 ? parseCobs() : parseLengthPrefixed();
+        if (!dispatched) {
+            framePending_ = true;
+            return;
         }
     }
 
     // Timeout handling: reset partial frames if input stalls
-    if (bytesRead_ > 0 && millis() - lastByteTime_ > SERIAL_TIMEOUT_MS) {
-        bytesRead_ = 0;
-        expectedLength_ = 0;
-        memset(buffer_, 0, sizeof(buffer_));
+    if ((bytesRead_ > 0 || decoder_.inFrame()) && millis() - lastByteTime_ > SERIAL_TIMEOUT_MS) {
+        dropPartialFrame();
         sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "<PROTO-TIMEOUT>");
     }
 }
+
+bool SerialProcessor::parseLengthPrefixed() {
+    if (bytesRead_ < 2) {
+        // Read 2-byte length prefix
+        bytesRead_ += rx_.pop(buffer_ + bytesRead_, 2 - bytesRead_, true);
+        if (bytesRead_ < 2) {
+            return true;
+        }
+        expectedLength_ = buffer_[0] | (buffer_[1] << 8);
+
+        // Sanity check for frame size
+        if (expectedLength_ == 0 || expectedLength_ > sizeof(buffer_) - 2) {
+            // One error per resync: garbage would otherwise cost a response per byte
+            if (!resyncing_) {
+                sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "<PROTO-BAD-LENGTH>");
+                resyncing_ = true;
+            }
+
+            // Shift buffer left by one and try again with the next byte
+            buffer_[0] = buffer_[1];
+            buffer_[1] = 0;
+            bytesRead_ = 1;
+            expectedLength_ = 0;
+        }
+        return true;
+    }
+
+    // Read message payload, as much of it as the ring holds
+    bytesRead_ += rx_.pop(buffer_ + bytesRead_, expectedLength_ + 2 - bytesRead_, true);
+    if (bytesRead_ < expectedLength_ + 2) {
+        return true;
+    }
+
+    // Full message received: dispatch and keep draining pipelined frames
+    frame_ = buffer_ + 2;
+    frameLength_ = expectedLength_;
+    return dispatchFrame();
+}
+
+bool SerialProcessor::parseCobs() {
+    uint8_t chunk[SERIAL_RX_PACKET_SIZE];
+    size_t len = rx_.peek(chunk, sizeof(chunk));
+    size_t used = 0;
+    CobsFrameDecoder::Result result = decoder_.feed(chunk, len, used);
+    rx_.skip(used, true);
+    memset(chunk, 0, len);
+
+    if (result == CobsFrameDecoder::FRAME_ERROR) {
+        // coalesced by the decoder: one report until a good frame arrives
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, "<PROTO-BAD-FRAME>");
+    }
+    if (result != CobsFrameDecoder::FRAME_OK) {
+        return true;
+    }
+    frame_ = decoder_.message();
+    frameLength_ = decoder_.messageLength();
+    return dispatchFrame();
+}
+
+void SerialProcessor::dropPartialFrame() {
+    memset(buffer_, 0, bytesRead_);
+    bytesRead_ = 0;
+    expectedLength_ = 0;
+    resyncing_ = false;
+    decoder_.reset();
+}
+
+bool SerialProcessor::receive() {
+#if defined(USE_TINYUSB)
+    // Nothing new since the FIFO was last drained: skip the USB stack entirely
+    if (!rxSignalled) {
+        return false;
+    }
+    rxSignalled = false;  // a packet arriving from here on signals again
+#endif
+
+    uint8_t packet[SERIAL_RX_PACKET_SIZE];
+    bool received = false;
+    int available;
+    while ((available = Serial.available()) > 0) {
+        size_t len = std::min(std::min((size_t)available, sizeof(packet)), rx_.space());
+        if (len == 0) {
+#if defined(USE_TINYUSB)
+            rxSignalled = true;  // ring full: the rest waits in the CDC FIFO
+#endif
+            break;
+        }
+        len = Serial.read(packet, len);
+        if (len == 0) {
+            break;
+        }
+        rx_.push(packet, len);
+        received = true;
+    }
+    memset(packet, 0, sizeof(packet));
+
+    if (received) {
+        lastByteTime_ = millis();
+    }
+    return received;
+}
+
+bool SerialProcessor::dispatchFrame() {
+    if (!commandProcessor_.processProtoCommand(frame_, frameLength_)) {
+        return false;
+    }
+    // Only the bytes of this frame were written
+    memset(buffer_, 0, (frame_ - buffer_) + frameLength_);
+    decoder_.release();
+    bytesRead_ = 0;
+    expectedLength_ = 0;
+    frameLength_ = 0;
+    framePending_ = false;
+    resyncing_ = false;
+    return true;
+}
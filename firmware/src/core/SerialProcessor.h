@@ -4,16 +4,33 @@
 #include <cstddef>
 #include <cstdint>
 #include "core/CommandProcessor.h"
+#include "system/SpscRing.h"
+#include "proto/FrameCodec.h"
 
+#if defined(TP_SERIAL_RX_RING_SIZE)
+#define SERIAL_RX_RING_SIZE TP_SERIAL_RX_RING_SIZE
+#else
+#define SERIAL_RX_RING_SIZE 1024  // received bytes awaiting the parser (power of two)
+#endif
+
+#define SERIAL_RX_PACKET_SIZE 64  // CDC bulk packet (full speed)
 
 /**
  * @brief Processes protobuf frames received via Serial.
  * 
  * Handles:
- * - Reading bytes from Serial
- * - Assembling frames with 2-byte length prefix
+ * - Pulling whole USB packets from the CDC FIFO into a ring buffer when
+ *   TinyUSB signals new data (tud_cdc_rx_cb)
+ * - Assembling frames in the framing selected by SET_FRAMING (protoFraming()):
+ *   2-byte length prefix, copied out of the ring in blocks, or COBS with CRC-16,
+ *   which resynchronises at the next delimiter
+ * - Reporting damaged input once per resync, not once per byte
  * - Handling timeouts for incomplete frames
- * - Delegating complete frames to CommandProcessor
+ * - Returning to the length prefix when the host closes the port (DTR drops)
+ * - Delegating complete frames to CommandProcessor, several per loop so
+ *   pipelined (request_id) commands are queued back to back
+ * - Holding a complete frame back while CommandProcessor asks it to wait
+ *   for in-flight crypto jobs
  */
 class SerialProcessor {
 public:
@@ -27,18 +44,57 @@ public:
     /**
      * @brief Must be called in Arduino loop().
      * 
-     * Reads incoming bytes, assembles frames, checks for timeouts,
-     * and calls CommandProcessor when a full frame is available.
+     * Receives pending packets, assembles frames, checks for timeouts,
+     * and calls CommandProcessor for every full frame available, so a burst of
+     * frames is handled in one pass. Stops reading while a frame is held back;
+     * the host is then throttled by the full CDC FIFO.
      */
     void loop();
 
 private:
+    /**
+     * @brief Moves received packets from the CDC FIFO into the ring, as far as it has room.
+     * @return true if bytes were received.
+     */
+    bool receive();
+
+    /**
+     * @brief Assembles length-prefixed frames from the ring and dispatches them.
+     * @return false if a frame was deferred.
+     */
+    bool parseLengthPrefixed();
+
+    /**
+     * @brief Decodes COBS frames from the ring and dispatches them.
+     * @return false if a frame was deferred.
+     */
+    bool parseCobs();
+
+    /**
+     * @brief Drops a partial frame (wiped) without reporting it.
+     */
+    void dropPartialFrame();
+
+    /**
+     * @brief Hands the assembled frame to CommandProcessor and resets the buffer.
+     * @return false if CommandProcessor deferred the frame (buffer kept).
+     */
+    bool dispatchFrame();
+
     CommandProcessor &commandProcessor_; /**< Reference to command processor */
 
-    uint8_t buffer_[512];     /**< Temporary buffer for assembling a frame */
+    SpscRing<uint8_t, SERIAL_RX_RING_SIZE> rx_; /**< Received bytes not yet assembled (wiped once read) */
+
+    uint8_t buffer_[turtlpass_Command_size + 2]; /**< Temporary buffer for assembling a frame (largest Command + length prefix or CRC) */
+    CobsFrameDecoder decoder_; /**< COBS framing, decoding into buffer_ */
     size_t bytesRead_;        /**< Number of bytes currently read into buffer */
     size_t expectedLength_;   /**< Length of the current frame payload */
+    const uint8_t *frame_;    /**< Complete frame in buffer_ */
+    size_t frameLength_;      /**< Length of the complete frame */
     unsigned long lastByteTime_; /**< Timestamp of the last byte received */
+    bool framePending_;       /**< A complete frame waits for in-flight crypto jobs */
+    bool resyncing_;          /**< Bad length reported, input skipped until the next good frame */
+    bool dtr_;                /**< Host had the port open at the last loop */
 
     static const unsigned long SERIAL_TIMEOUT_MS = 500; /**< Timeout for incomplete frames */
 };
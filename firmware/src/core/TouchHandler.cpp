@@ -2,6 +2,11 @@
 #include "keyboard/HidKeyboard.h"
 #include <cstring>
 
+static_assert((int)LAYOUT_US == (int)turtlpass_KeyboardLayout_US &&
+              (int)LAYOUT_DVORAK == (int)turtlpass_KeyboardLayout_DVORAK &&
+              (int)LAYOUT_COUNT == (int)_turtlpass_KeyboardLayout_ARRAYSIZE,
+              "KeyboardLayoutId must match turtlpass_KeyboardLayout");
+
 
 TouchHandler::TouchHandler(InternalState &state, LedManager &led, CommandProcessor &cmdProcessor)
     : internalState_(state), ledManager_(led), commandProcessor_(cmdProcessor) {}
@@ -10,11 +15,18 @@ void TouchHandler::onSingleTouch() {
     switch (internalState_) {
         case IDLE:
             ledManager_.showNextColor();
+            commandProcessor_.prefetchDefaultPassword();
             break;
         case PASSWORD_READY:
-            internalState_ = TYPING;
-            typePassword();
-            internalState_ = IDLE;
+            if (!commandProcessor_.isCalibrating()) {  // keep the password until the probes are done
+                typePassword();
+            }
+            break;
+        case TYPING:
+            cancelTyping();
+            break;
+        case AWAITING_CONFIRMATION:
+            commandProcessor_.confirmPending();
             break;
         default:
             break;
@@ -22,22 +34,25 @@ void TouchHandler::onSingleTouch() {
 }
 
 void TouchHandler::onLongTouchStart() {
-    if (internalState_ == IDLE) {
+    if (internalState_ == TYPING) {
+        cancelTyping();
+    } else if (internalState_ == IDLE && !commandProcessor_.isCalibrating()) {
         internalState_ = TOUCHING;
         ledManager_.setFadeOutOnce(2);
+        // overlap the derivation with the fade-out if nothing is precomputed yet
+        commandProcessor_.prefetchDefaultPassword();
     }
 }
 
 void TouchHandler::onLongTouchEnd() {
     if (internalState_ == TOUCHING) {
         if (commandProcessor_.deriveDefaultPassword()) {
-            internalState_ = TYPING;
             typePassword();
         }
         else {
             commandProcessor_.clearOutputBuffer();
+            internalState_ = IDLE;
         }
-        internalState_ = IDLE;
     }
 }
 
@@ -48,10 +63,29 @@ void TouchHandler::onLongTouchCancelled() {
     }
 }
 
+void TouchHandler::loop() {
+    if (internalState_ == TYPING && !hidTypePoll()) {
+        finishTyping();  // last report taken, cancelled or host gone
+    }
+}
+
 void TouchHandler::typePassword() {
+    internalState_ = TYPING;
     ledManager_.setBlinking();
-    hidTypeString((char *)commandProcessor_.getOutputBuffer());
+    hidKeyboardSetLayout((KeyboardLayoutId)commandProcessor_.getKeyboardLayout());
+    hidKeyboardSetTiming(commandProcessor_.getHostTiming());
+    if (!hidTypeStart((char *)commandProcessor_.getOutputBuffer())) {
+        finishTyping();
+    }
+}
+
+void TouchHandler::cancelTyping() {
+    hidTypeCancel();  // loop() finishes once the keys are released
+    commandProcessor_.clearOutputBuffer();
+}
+
+void TouchHandler::finishTyping() {
     commandProcessor_.clearOutputBuffer();
-    delay(100);
     ledManager_.setOn();
+    internalState_ = IDLE;
 }
@@ -29,8 +29,10 @@ public:
      * @brief Handles a single touch event.
      * 
      * Behavior depends on the current internal state:
-     * - IDLE: cycles to the next LED color
-     * - PASSWORD_READY: triggers typing the password
+     * - IDLE: cycles to the next LED color and precomputes its default password
+     * - PASSWORD_READY: starts typing the password
+     * - TYPING: cancels typing
+     * - AWAITING_CONFIRMATION: confirms the pending batch or returned password so it is sent
      * - Other states: ignored
      */
     void onSingleTouch();
@@ -39,6 +41,8 @@ public:
      * @brief Handles the start of a long touch event.
      * 
      * Typically transitions the state from IDLE to TOUCHING and updates LEDs.
+     * Queues the default password derivation if it is not already precomputed.
+     * Cancels typing if a password is being typed.
      */
     void onLongTouchStart();
 
@@ -46,7 +50,7 @@ public:
      * @brief Handles the end of a long touch event.
      * 
      * Typically triggers default password derivation using CommandProcessor
-     * and HID typing if successful. Updates internal state back to IDLE.
+     * and starts HID typing if successful, otherwise returns to IDLE.
      */
     void onLongTouchEnd();
 
@@ -58,22 +62,34 @@ public:
     void onLongTouchCancelled();
     
     /**
-     * @brief Types the currently derived password via HID.
-     * 
-     * This method transitions the internal state to `TYPING`, provides LED feedback
-     * during the typing process, and sends the password string through the HID interface.
-     * Once typing is complete, it clears the output buffer and restores the LED to steady on.
+     * @brief Must be called in Arduino loop().
+     *
+     * Sends the next HID report while `TYPING`; once the password is typed (or typing
+     * was cancelled or the host stopped polling) clears the output buffer, turns the
+     * LED solid on and returns to IDLE.
+     */
+    void loop();
+
+    /**
+     * @brief Starts typing the currently derived password via HID.
      * 
-     * Typical sequence:
-     * 1. Set internal state to `TYPING`
-     * 2. Blink LED to indicate typing activity
-     * 3. Send password from CommandProcessor output buffer via HID
-     * 4. Clear output buffer and delay briefly
-     * 5. Turn LED solid on to signal completion
+     * This method transitions the internal state to `TYPING`, blinks the LED and starts
+     * sending the password from the CommandProcessor output buffer. It returns at once;
+     * loop() sends the reports so serial commands and the button stay responsive.
      */
     void typePassword();
 
 private:
+    /**
+     * @brief Stops typing: releases any key still down and wipes the output buffer.
+     */
+    void cancelTyping();
+
+    /**
+     * @brief Clears the output buffer, restores the LED and returns to IDLE.
+     */
+    void finishTyping();
+
     InternalState &internalState_;       /**< Reference to the shared internal state */
     LedManager &ledManager_;             /**< Reference to the LED manager */
     CommandProcessor &commandProcessor_; /**< Reference to the command processor */
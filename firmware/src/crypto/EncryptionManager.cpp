@@ -4,34 +4,56 @@
 EncryptionManager::EncryptionManager() : initializedSlot(-1) {
     memset(encryptionKey, 0, sizeof(encryptionKey));
     memset(encryptionIV, 0, sizeof(encryptionIV));
+    memset(slotCache, 0, sizeof(slotCache));
 }
 
 void EncryptionManager::init(uint8_t seedSlot) {
     // wipe previous key/IV and slot
     clear();  
 
+    if (seedSlot >= 1 && seedSlot <= ENCRYPTION_CACHE_SLOTS) {
+        // cached slot: derive once, then copy from RAM
+        SlotKeys &entry = slotCache[seedSlot - 1];
+        if (!entry.valid) {
+            deriveSlotKeys(seedSlot, entry.key, entry.iv);
+            entry.valid = true;
+        }
+        memcpy(encryptionKey, entry.key, ENCRYPTION_KEY_SIZE);
+        memcpy(encryptionIV, entry.iv, ENCRYPTION_IV_SIZE);
+    } else {
+        deriveSlotKeys(seedSlot, encryptionKey, encryptionIV);
+    }
+
+    // store the slot
+    initializedSlot = seedSlot;
+}
+
+void EncryptionManager::deriveSlotKeys(uint8_t seedSlot, uint8_t* key, uint8_t* iv) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
     // Get unique hardware ID (binary 8 bytes)
     pico_unique_board_id_t unique_id;
     pico_get_unique_board_id(&unique_id);
 
     // Convert binary ID: hex string for deterministic KDF seed
     char boardIdHex[17]; // 8 bytes = 16 hex chars + null terminator
-    for (int i = 0; i < 8; ++i)
-        snprintf(&boardIdHex[i * 2], 3, "%02X", unique_id.id[i]);
+    for (int i = 0; i < 8; ++i) {
+        boardIdHex[i * 2] = HEX_DIGITS[unique_id.id[i] >> 4];
+        boardIdHex[i * 2 + 1] = HEX_DIGITS[unique_id.id[i] & 0x0F];
+    }
     boardIdHex[16] = '\0';
 
     // Derive encryption key
     char keyContext[32];
     snprintf(keyContext, sizeof(keyContext), "key_slot_%u", seedSlot);
-    kdf.derivateKey(encryptionKey, ENCRYPTION_KEY_SIZE, keyContext, boardIdHex);
+    kdf.derivateKey(key, ENCRYPTION_KEY_SIZE, keyContext, boardIdHex);
 
     // Derive deterministic IV per seed slot
     char ivContext[32];
     snprintf(ivContext, sizeof(ivContext), "iv_slot_%u", seedSlot);
-    kdf.derivateKey(encryptionIV, ENCRYPTION_IV_SIZE, ivContext, boardIdHex);
+    kdf.derivateKey(iv, ENCRYPTION_IV_SIZE, ivContext, boardIdHex);
 
-    // store the slot
-    initializedSlot = seedSlot;
+    clean(boardIdHex, sizeof(boardIdHex));
 }
 
 bool EncryptionManager::isInitialized() {
@@ -66,6 +88,11 @@ void EncryptionManager::clear() {
     initializedSlot = -1;
 }
 
+void EncryptionManager::clearCache() {
+    clear();
+    clean(slotCache, sizeof(slotCache));
+}
+
 // Helper function
 bool EncryptionManager::isAllZero(const uint8_t* data, size_t len) {
     for (size_t i = 0; i < len; ++i) {
@@ -11,6 +11,7 @@
 
 #define ENCRYPTION_KEY_SIZE 32  ///< 32 bytes = 256-bit encryption key
 #define ENCRYPTION_IV_SIZE 12   ///< 12 bytes = 96-bit IV (nonce)
+#define ENCRYPTION_CACHE_SLOTS 9  ///< Slots 1–9 keep their derived key/IV in RAM
 
 
 /**
@@ -21,6 +22,7 @@
  *  - Slot-based deterministic key and IV derivation via KDF.
  *  - Encrypt/decrypt arbitrary byte arrays.
  *  - Secure clearing of key and IV when resetting or re-initializing.
+ *  - Per-slot key/IV cache: the KDF runs once per slot, later init() calls copy from RAM.
  *
  * Notes:
  *  - Uses Pico unique board ID for deterministic key derivation.
@@ -37,7 +39,8 @@ public:
      * @brief Initialize encryption for a specific seed slot.
      *
      * Derives a deterministic key and IV for the slot using the board's unique ID.
-     * Clears any previous key/IV before derivation.
+     * Clears any previous key/IV before derivation. Slots 1–ENCRYPTION_CACHE_SLOTS
+     * are derived once and served from the key cache afterwards.
      *
      * @param seedSlot Slot number (used in context string for deterministic KDF derivation)
      */
@@ -79,7 +82,32 @@ public:
      */
     void clear();
 
+    /**
+     * @brief Wipe every cached slot key/IV as well as the current key/IV.
+     *
+     * Must be called on factory reset; the next init() re-derives from the board ID.
+     */
+    void clearCache();
+
 private:
+    /**
+     * @brief Cached key schedule for one slot.
+     */
+    struct SlotKeys {
+        uint8_t key[ENCRYPTION_KEY_SIZE];
+        uint8_t iv[ENCRYPTION_IV_SIZE];
+        bool valid;
+    };
+
+    /**
+     * @brief Derive the key and IV of a slot from the board ID.
+     *
+     * @param seedSlot Slot number used in the KDF context strings
+     * @param key Output key buffer (ENCRYPTION_KEY_SIZE bytes)
+     * @param iv Output IV buffer (ENCRYPTION_IV_SIZE bytes)
+     */
+    void deriveSlotKeys(uint8_t seedSlot, uint8_t* key, uint8_t* iv);
+
     /**
      * @brief Check if a data buffer contains only zero bytes.
      *
@@ -94,6 +122,7 @@ private:
     uint8_t encryptionKey[ENCRYPTION_KEY_SIZE]; ///< Derived encryption key
     uint8_t encryptionIV[ENCRYPTION_IV_SIZE];   ///< Derived IV / nonce
     int initializedSlot;                        ///< Slot currently initialized (-1 if none)
+    SlotKeys slotCache[ENCRYPTION_CACHE_SLOTS]; ///< Derived key/IV per slot (RAM only)
 };
 
 
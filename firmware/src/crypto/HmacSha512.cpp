@@ -0,0 +1,53 @@
+#include "crypto/HmacSha512.h"
+#include <string.h>
+
+void HmacSha512::precompute(Midstate &midstate, const void *key, size_t keyLen) {
+    // inner: compress key ^ ipad
+    resetHMAC(key, keyLen);
+    memcpy(midstate.inner, state.h, sizeof(midstate.inner));
+
+    // outer: compress key ^ opad
+    formatHMACKey(state.w, key, keyLen, 0x5C);
+    processChunk();
+    memcpy(midstate.outer, state.h, sizeof(midstate.outer));
+
+    // long keys are hashed down to HASH_SIZE once per pad
+    uint32_t keyBlocks = keyLen > BLOCK_SIZE ? blocksFor(keyLen) : 0;
+    compressions_ += 2 + 2 * keyBlocks;
+
+    clear();
+    midstate.valid = true;
+}
+
+void HmacSha512::begin(const Midstate &midstate) {
+    resumeFrom(midstate.inner);
+}
+
+void HmacSha512::finish(const Midstate &midstate, void *mac, size_t macLen) {
+    uint8_t temp[HASH_SIZE];
+
+    // inner hash: everything after the key block, plus padding
+    compressions_ += blocksFor((state.lengthLow >> 3) - BLOCK_SIZE);
+    finalize(temp, sizeof(temp));
+
+    // outer hash: one block holding the inner digest and padding
+    resumeFrom(midstate.outer);
+    update(temp, sizeof(temp));
+    compressions_ += blocksFor(sizeof(temp));
+    finalize(mac, macLen);
+
+    clean(temp);
+    clear();
+}
+
+void HmacSha512::resumeFrom(const uint64_t chainingValue[8]) {
+    memcpy(state.h, chainingValue, sizeof(state.h));
+    state.chunkSize = 0;
+    state.lengthLow = BLOCK_SIZE * 8;
+    state.lengthHigh = 0;
+}
+
+uint32_t HmacSha512::blocksFor(uint64_t len) {
+    // 0x80 terminator + 16-byte length, rounded up to whole blocks
+    return (uint32_t)((len + 17 + BLOCK_SIZE - 1) / BLOCK_SIZE);
+}
@@ -0,0 +1,100 @@
+#ifndef HMAC_SHA512_H
+#define HMAC_SHA512_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SHA512.h"
+#include "Crypto.h"
+
+
+/**
+ * @class HmacSha512
+ * @brief HMAC-SHA512 that can resume from precomputed key midstates.
+ *
+ * An HMAC computation always starts by compressing one block of `key ^ ipad`
+ * and finishes by compressing one block of `key ^ opad`. Both depend only on the
+ * key, so for a key that is used repeatedly (a seed slot salt, or the PRK across
+ * HKDF expand blocks) the two chaining values can be computed once with
+ * precompute() and reused, saving two SHA-512 compressions per MAC.
+ *
+ * Usage:
+ * @code
+ * HmacSha512::Midstate midstate;
+ * HmacSha512::precompute(midstate, key, keyLen);   // once per key
+ * HmacSha512 hmac;
+ * hmac.begin(midstate);
+ * hmac.update(data, dataLen);
+ * hmac.finish(midstate, mac, sizeof(mac));
+ * @endcode
+ *
+ * The object also counts SHA-512 compressions, which is used to benchmark
+ * the derivation pipeline.
+ */
+class HmacSha512 : public SHA512 {
+public:
+    /**
+     * @struct Midstate
+     * @brief SHA-512 chaining values after the ipad and opad key blocks.
+     *
+     * Holds key-equivalent secret material: wipe it with clear() when the key
+     * is no longer valid.
+     */
+    struct Midstate {
+        uint64_t inner[8];   ///< Chaining value after compressing key ^ ipad
+        uint64_t outer[8];   ///< Chaining value after compressing key ^ opad
+        bool valid = false;  ///< True once precompute() has filled this midstate
+
+        /** @brief Securely wipe the chaining values and mark the midstate invalid. */
+        void clear() {
+            clean(inner, sizeof(inner));
+            clean(outer, sizeof(outer));
+            valid = false;
+        }
+    };
+
+    HmacSha512() : compressions_(0) {}
+
+    /**
+     * @brief Compute the inner/outer midstates for an HMAC key.
+     *
+     * Costs two SHA-512 compressions (plus hashing the key if it is longer
+     * than one block).
+     *
+     * @param midstate Output midstate, marked valid on return.
+     * @param key HMAC key.
+     * @param keyLen Length of the key in bytes.
+     */
+    void precompute(Midstate &midstate, const void *key, size_t keyLen);
+
+    /**
+     * @brief Start a MAC by resuming from the inner midstate (no compression).
+     * @param midstate Valid midstate from precompute().
+     */
+    void begin(const Midstate &midstate);
+
+    /**
+     * @brief Finish the MAC: finalize the inner hash and run the outer hash
+     *        from the outer midstate.
+     *
+     * @param midstate The same midstate passed to begin().
+     * @param mac Output buffer for the MAC.
+     * @param macLen Number of MAC bytes to write (at most HASH_SIZE).
+     */
+    void finish(const Midstate &midstate, void *mac, size_t macLen);
+
+    /**
+     * @brief Number of SHA-512 compressions performed by this object so far.
+     */
+    uint32_t compressions() const { return compressions_; }
+
+private:
+    /** @brief Load a chaining value as if one key block had just been processed. */
+    void resumeFrom(const uint64_t chainingValue[8]);
+
+    /** @brief Compressions needed to hash `len` bytes, including padding. */
+    static uint32_t blocksFor(uint64_t len);
+
+    uint32_t compressions_;
+};
+
+#endif // HMAC_SHA512_H
@@ -9,85 +9,27 @@ bool Kdf::derivateKey(uint8_t *dst, size_t dstLength, char *input, const char *s
   if (!dst || !input || !seed) {
     return false;
   }
-  size_t srcLength = strlen(input);
-  uint8_t *src = (uint8_t *)malloc(srcLength + 1);
-  if (src == nullptr) {
-    return false;  // memory allocation failed
-  }
-  memcpy(src, input, srcLength);
-  src[srcLength] = '\0';  // ensure null-terminated
-
-  const size_t seedLength = strlen(seed);
-  const size_t saltLength = seedLength / 2;
-  // allocate memory for salt
-  uint8_t *salt = (uint8_t *)malloc(saltLength);
-  if (salt == nullptr) {
-    free(src);
-    return false;  // memory allocation failed
-  }
-  // convert seed to salt
-  for (size_t i = 0; i < saltLength; i++) {
-    char buf[3] = { seed[i * 2], seed[i * 2 + 1], '\0' };
-    unsigned long value = strtoul(buf, NULL, 16);
-    if (value > UINT8_MAX) {
-      free(src);
-      free(salt);
-      return false;  // value exceeds uint8_t range
-    }
-    salt[i] = (uint8_t)value;
-  }
-  // execute hkdf
-  hkdf(dst, dstLength, src, srcLength, salt, saltLength);
-  // free allocated memory
-  free(src);
-  free(salt);
-  return true;
+  return derivateKeyParts(dst, dstLength, input, strlen(input), nullptr, 0, seed);
 }
 
-bool Kdf::derivatePass(uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
-  auto keyLenFunc = base62InputLength;
-  auto encodeFunc = [](const std::vector<uint8_t>& key, std::string& out) -> bool {
-    size_t encodedKeyLength = (key.size() * 2) + 1;
-    char *encoded = base62_encode((char *)malloc(encodedKeyLength), encodedKeyLength, key.data(), key.size());
-    if (!encoded) return false;
-    out.assign(encoded);
-    free(encoded);
-    return true;
-  };
-  return deriveAndEncode(dst, dstLength, input, seed, keyLenFunc, encodeFunc);
+bool Kdf::derivatePass(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                 HmacSha512::Midstate *saltMidstate) {
+  return deriveAndEncode<Base62Encoder>(dst, dstLength, input, seed, saltMidstate);
 }
 
-bool Kdf::derivatePassWithSymbols(uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
-  auto keyLenFunc = base94InputLength;
-  auto encodeFunc = [](const std::vector<uint8_t>& key, std::string& out) -> bool {
-    Base94 base94;
-    return base94.encode(key, out);
-  };
-  return deriveAndEncode(dst, dstLength, input, seed, keyLenFunc, encodeFunc);
+bool Kdf::derivatePassWithSymbols(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                            HmacSha512::Midstate *saltMidstate) {
+  return deriveAndEncode<Base94Encoder>(dst, dstLength, input, seed, saltMidstate);
 }
 
-bool Kdf::derivatePassLettersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
-  auto keyLenFunc = base52InputLength;
-  return deriveAndEncode(
-      dst,
-      dstLength,
-      input,
-      seed,
-      keyLenFunc,
-      encodeLettersOnly
-  );
+bool Kdf::derivatePassLettersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                            HmacSha512::Midstate *saltMidstate) {
+  return deriveAndEncode<Base52Encoder>(dst, dstLength, input, seed, saltMidstate);
 }
 
-bool Kdf::derivatePassNumbersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
-  auto keyLenFunc = base10InputLength;
-  return deriveAndEncode(
-      dst,
-      dstLength,
-      input,
-      seed,
-      keyLenFunc,
-      encodeNumbersOnly
-  );
+bool Kdf::derivatePassNumbersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                            HmacSha512::Midstate *saltMidstate) {
+  return deriveAndEncode<Base10Encoder>(dst, dstLength, input, seed, saltMidstate);
 }
 
 
@@ -95,49 +37,162 @@ bool Kdf::derivatePassNumbersOnly(uint8_t *dst, size_t dstLength, const char *in
 // Private //
 /////////////
 
-bool Kdf::deriveAndEncode(
-    uint8_t *dst,
-    size_t dstLength,
-    const char *input,
-    const char *seed,
-    size_t (*keyLengthFunc)(size_t), // baseXXInputLength
-    std::function<bool(const std::vector<uint8_t>&, std::string&)> encodeFunc // baseXX encoder
-) {
+template <typename Encoder>
+bool Kdf::deriveAndEncode(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                          HmacSha512::Midstate *saltMidstate) {
   if (!dst || !input || !seed) {
     return false;
   }
+  if (dstLength > MAX_PASS_SIZE) {
+    return false;  // beyond the bounded scratch buffers
+  }
 
-  // Prepare input with appended dstLength
-  char lengthStr[32];
-  snprintf(lengthStr, sizeof(lengthStr), "%zu", dstLength);
-  std::string inputWithLength(input);
-  inputWithLength += lengthStr;
-
-  // Allocate key buffer
-  size_t keyLength = keyLengthFunc(dstLength);
-  std::vector<uint8_t> key(keyLength);
-  if (key.empty()) {
+  // Key length depends on the encoding
+  const size_t keyLength = Encoder::inputLength(dstLength);
+  if (keyLength == 0 || keyLength > MAX_KEY_SIZE) {
     return false;
   }
 
+  // Input is suffixed with the textual dstLength
+  char lengthStr[MAX_LENGTH_DIGITS];
+  const size_t lengthStrLength = formatLength(dstLength, lengthStr, sizeof(lengthStr));
+
   // Derive key
-  if (!derivateKey(key.data(), keyLength, inputWithLength.data(), seed)) {
+  uint8_t key[MAX_KEY_SIZE];
+  if (!derivateKeyParts(key, keyLength, input, strlen(input), lengthStr, lengthStrLength, seed, saltMidstate)) {
+    clean(key, sizeof(key));
     return false;
   }
 
-  // Encode key using provided encoding function
-  std::string encodedKey;
-  if (!encodeFunc(key, encodedKey)) {
-    return false;
-  }
+  // Encode key
+  char encoded[MAX_ENCODED_SIZE];
+  size_t encodedLength = 0;
+  bool ok = Encoder::encode(key, keyLength, encoded, sizeof(encoded), encodedLength);
 
   // Copy encoded result to destination
-  size_t copyLength = std::min(encodedKey.size(), dstLength);
-  std::memcpy(dst, encodedKey.data(), copyLength);
-  dst[copyLength] = '\0';
+  if (ok) {
+    size_t copyLength = std::min(encodedLength, dstLength);
+    memcpy(dst, encoded, copyLength);
+    dst[copyLength] = '\0';
+  }
+
+  clean(key, sizeof(key));
+  clean(encoded, sizeof(encoded));
+  return ok;
+}
+
+bool Kdf::derivateKeyParts(uint8_t *dst, size_t dstLength,
+                           const char *input, size_t inputLength,
+                           const char *suffix, size_t suffixLength,
+                           const char *seed, HmacSha512::Midstate *saltMidstate) {
+  HmacSha512 hmac;
+  HmacSha512::Midstate localSalt;
+  HmacSha512::Midstate *salt = saltMidstate ? saltMidstate : &localSalt;
+
+  if (!salt->valid) {
+    // convert seed to salt and compute its ipad/opad midstates
+    uint8_t saltBytes[MAX_SALT_SIZE];
+    size_t saltLength = 0;
+    if (!seedToSalt(seed, saltBytes, saltLength)) {
+      clean(saltBytes, sizeof(saltBytes));
+      return false;
+    }
+    if (saltLength == 0) {
+      // RFC 5869: no salt means a string of HashLen zeroes
+      memset(saltBytes, 0, SHA512::HASH_SIZE);
+      saltLength = SHA512::HASH_SIZE;
+    }
+    hmac.precompute(*salt, saltBytes, saltLength);
+    clean(saltBytes, sizeof(saltBytes));
+  }
+
+  // HKDF-Extract: PRK = HMAC(salt, input || suffix)
+  uint8_t prk[SHA512::HASH_SIZE];
+  hmac.begin(*salt);
+  hmac.update(input, inputLength);
+  if (suffix && suffixLength) {
+    hmac.update(suffix, suffixLength);
+  }
+  hmac.finish(*salt, prk, sizeof(prk));
+
+  // HKDF-Expand: T(i) = HMAC(PRK, T(i-1) || info || i), PRK midstate shared by all blocks
+  HmacSha512::Midstate prkState;
+  hmac.precompute(prkState, prk, sizeof(prk));
+
+  const char *info = "turtlpass";
+  const size_t infoLen = strlen(info);
+  uint8_t block[SHA512::HASH_SIZE];
+  uint8_t counter = 1;
+  while (dstLength > 0) {
+    hmac.begin(prkState);
+    if (counter != 1) {
+      hmac.update(block, sizeof(block));
+    }
+    hmac.update(info, infoLen);
+    hmac.update(&counter, 1);
+    hmac.finish(prkState, block, sizeof(block));
+    ++counter;
+
+    size_t len = std::min(dstLength, sizeof(block));
+    memcpy(dst, block, len);
+    dst += len;
+    dstLength -= len;
+  }
+  compressionCount_ += hmac.compressions();
+
+  // wipe sensitive intermediates (a caller-owned salt midstate is kept)
+  localSalt.clear();
+  prkState.clear();
+  clean(prk, sizeof(prk));
+  clean(block, sizeof(block));
   return true;
 }
 
+bool Kdf::seedToSalt(const char *seed, uint8_t *salt, size_t &saltLength) {
+  const size_t seedLength = strlen(seed);
+  const size_t length = seedLength / 2;
+  SHA512 sha512;  // only used for salts longer than one block
+
+  for (size_t i = 0; i < length; i++) {
+    char buf[3] = { seed[i * 2], seed[i * 2 + 1], '\0' };
+    unsigned long value = strtoul(buf, NULL, 16);
+    if (value > UINT8_MAX) {
+      return false;  // value exceeds uint8_t range
+    }
+    if (length <= MAX_SALT_SIZE) {
+      salt[i] = (uint8_t)value;
+    } else {
+      uint8_t byte = (uint8_t)value;
+      sha512.update(&byte, 1);
+    }
+  }
+
+  if (length <= MAX_SALT_SIZE) {
+    saltLength = length;
+  } else {
+    sha512.finalize(salt, SHA512::HASH_SIZE);
+    sha512.clear();
+    saltLength = SHA512::HASH_SIZE;
+  }
+  return true;
+}
+
+size_t Kdf::formatLength(size_t value, char *out, size_t outSize) {
+  char digits[MAX_LENGTH_DIGITS];
+  size_t count = 0;
+  do {
+    digits[count++] = (char)('0' + (value % 10));
+    value /= 10;
+  } while (value > 0 && count < sizeof(digits));
+
+  size_t written = 0;
+  while (count > 0 && written + 1 < outSize) {
+    out[written++] = digits[--count];
+  }
+  out[written] = '\0';
+  return written;
+}
+
 void Kdf::hkdf(uint8_t *dst, size_t dstLength, const uint8_t *src, size_t srcLength, const uint8_t *salt, size_t saltLength) {
   // validate input pointers
   if (!dst || !src || !salt) {
@@ -182,25 +237,47 @@ size_t Kdf::base10InputLength(size_t dstLength) {
     return dstLength; // 1:1 mapping
 }
 
-bool Kdf::encodeLettersOnly(const std::vector<uint8_t>& key, std::string& out) {
-    const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+//////////////////////
+// Encoder policies //
+//////////////////////
+
+bool Kdf::Base62Encoder::encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength) {
+    // Same buffer bound as the original encoder: 2 characters per key byte
+    size_t bufferLength = (keyLength * 2) + 1;
+    if (bufferLength > outSize) return false;
+    if (!base62_encode(out, bufferLength, key, keyLength)) return false;
+    outLength = strlen(out);
+    return true;
+}
+
+bool Kdf::Base94Encoder::encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength) {
+    Base94 base94;
+    uint32_t written = 0;
+    if (!base94.encode(key, keyLength, out, outSize, written)) return false;
+    outLength = written;
+    return true;
+}
+
+bool Kdf::Base52Encoder::encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength) {
+    static const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
     const size_t LETTERS_COUNT = sizeof(LETTERS) - 1; // 52
 
-    out.clear();
-    for (size_t i = 0; i < key.size(); ++i) {
-        out += LETTERS[key[i] % LETTERS_COUNT];
+    if (keyLength > outSize) return false;
+    for (size_t i = 0; i < keyLength; ++i) {
+        out[i] = LETTERS[key[i] % LETTERS_COUNT];
     }
+    outLength = keyLength;
     return true;
 }
 
-bool Kdf::encodeNumbersOnly(const std::vector<uint8_t>& key, std::string& out) {
-    const char DIGITS[] = "0123456789";
+bool Kdf::Base10Encoder::encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength) {
+    static const char DIGITS[] = "0123456789";
     const size_t DIGIT_COUNT = sizeof(DIGITS) - 1; // 10
 
-    out.clear();
-    out.reserve(key.size());
-    for (size_t i = 0; i < key.size(); ++i) {
-        out += DIGITS[key[i] % DIGIT_COUNT];
+    if (keyLength > outSize) return false;
+    for (size_t i = 0; i < keyLength; ++i) {
+        out[i] = DIGITS[key[i] % DIGIT_COUNT];
     }
+    outLength = keyLength;
     return true;
 }
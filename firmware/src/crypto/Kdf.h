@@ -6,11 +6,19 @@
 #include <cstring>
 #include <cctype>
 #include <cmath>
-#include <functional>
+#include <algorithm>
 #include "SHA512.h"
 #include "HKDF.h"
 #include "Base62.h"
 #include "Base94.hpp"
+#include "crypto/HmacSha512.h"
+
+#ifndef MAX_PASS_SIZE
+#define MAX_PASS_SIZE 128     ///< Longest password the derivation pipeline can produce
+#endif
+#ifndef MAX_ENTROPY_SIZE
+#define MAX_ENTROPY_SIZE 64   ///< Largest entropy (input) accepted from the host
+#endif
 
 
 /**
@@ -30,6 +38,19 @@
  *   - Use an HKDF-based key derivation with a provided seed.
  *   - Encode the derived key using the specified base or character set.
  *
+ * The whole pipeline runs without touching the heap: the input and its length
+ * suffix are streamed straight into HMAC-SHA512, the salt is decoded into a
+ * fixed block-sized buffer, and the intermediate key and encoded output live in
+ * stack buffers bounded by `MAX_PASS_SIZE`. Encoders are compile-time policies,
+ * so no `std::function` or `std::string` is involved. Passwords longer than
+ * `MAX_PASS_SIZE` are rejected.
+ *
+ * The salt (seed) only changes on factory reset, so callers can pass a per-slot
+ * `HmacSha512::Midstate` to the password methods. It is filled on first use and
+ * lets the HKDF extract step skip the ipad/opad compressions of the salt on every
+ * later call. The PRK midstate is likewise computed once per derivation and
+ * reused across all HKDF expand blocks.
+ *
  * This design ensures that for a given (input, seed, output length, encoding),
  * the same password or key is always produced — providing deterministic,
  * secure, and flexible derivation for both machine and human use.
@@ -74,9 +95,11 @@ public:
    * @param dstLength Desired length of the password.
    * @param input Null-terminated input string (e.g., a password).
    * @param seed Null-terminated seed string.
+   * @param saltMidstate Optional per-slot salt midstate cache; filled from `seed` if not yet valid.
    * @return true if the password was successfully derived and encoded, false otherwise.
    */
-  bool derivatePass(uint8_t *dst, size_t dstLength, const char *input, const char *seed);
+  bool derivatePass(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                            HmacSha512::Midstate *saltMidstate = nullptr);
 
   /**
    * @brief Derive a password string from input and seed, using extended symbols.
@@ -95,9 +118,11 @@ public:
    * @param dstLength Desired length of the password.
    * @param input Null-terminated input string (e.g., a password).
    * @param seed Null-terminated seed string.
+   * @param saltMidstate Optional per-slot salt midstate cache; filled from `seed` if not yet valid.
    * @return true if the password was successfully derived and encoded, false otherwise.
    */
-  bool derivatePassWithSymbols(uint8_t *dst, size_t dstLength, const char *input, const char *seed);
+  bool derivatePassWithSymbols(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                                       HmacSha512::Midstate *saltMidstate = nullptr);
 
   /**
    * @brief Derive a password string from input and seed, using letters only.
@@ -116,9 +141,11 @@ public:
    * @param dstLength Desired length of the password.
    * @param input Null-terminated input string (e.g., a password).
    * @param seed Null-terminated seed string.
+   * @param saltMidstate Optional per-slot salt midstate cache; filled from `seed` if not yet valid.
    * @return true if the password was successfully derived and encoded, false otherwise.
    */
-  bool derivatePassLettersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed);
+  bool derivatePassLettersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                                       HmacSha512::Midstate *saltMidstate = nullptr);
 
   /**
    * @brief Derive a password string from input and seed, using digits only.
@@ -135,13 +162,26 @@ public:
    * @param dstLength Desired length of the password.
    * @param input Null-terminated input string (e.g., a password).
    * @param seed Null-terminated seed string.
+   * @param saltMidstate Optional per-slot salt midstate cache; filled from `seed` if not yet valid.
    * @return true if the password was successfully derived and encoded, false otherwise.
    *
    * @note This function uses the internal deriveAndEncode() helper, similar to
    *       derivatePass(), derivatePassWithSymbols(), and derivatePassLettersOnly(),
    *       but restricts the output to numeric characters only.
    */
-  bool derivatePassNumbersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed);
+  bool derivatePassNumbersOnly(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                                       HmacSha512::Midstate *saltMidstate = nullptr);
+
+  /**
+   * @brief Total SHA-512 compressions performed by the password/key derivations
+   *        of this instance. Used for benchmarking the key schedule.
+   */
+  uint32_t compressionCount() const { return compressionCount_; }
+
+  /**
+   * @brief Reset the compression counter to zero.
+   */
+  void resetCompressionCount() { compressionCount_ = 0; }
 
 
 private:
@@ -150,50 +190,105 @@ private:
   static constexpr size_t BASE94_INPUT_BLOCK_SIZE = 9;
   static constexpr size_t BASE94_OUTPUT_BLOCK_SIZE = 11;
 
+  static constexpr size_t MAX_KEY_SIZE = MAX_PASS_SIZE;               ///< Letters/digits map 1:1, the widest ratio
+  static constexpr size_t MAX_ENCODED_SIZE = (MAX_KEY_SIZE * 2) + 1;  ///< Base62 worst case plus terminator
+  static constexpr size_t MAX_SALT_SIZE = SHA512::BLOCK_SIZE;         ///< Longer HMAC keys are hashed first
+  static constexpr size_t MAX_LENGTH_DIGITS = 24;                     ///< Decimal digits of a size_t plus terminator
+
+  /**
+   * @brief Compile-time encoder policies used by deriveAndEncode().
+   *
+   * Each policy exposes:
+   *   - `inputLength(n)`: intermediate key bytes needed for an `n`-character password.
+   *   - `encode(key, keyLength, out, outSize, outLength)`: writes the encoded key to
+   *     `out` (at most `outSize` bytes, including the terminator) and reports its
+   *     length. Returns false if the output does not fit.
+   */
+  struct Base62Encoder {
+    static size_t inputLength(size_t encodedLength) { return base62InputLength(encodedLength); }
+    static bool encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength);
+  };
+  struct Base94Encoder {
+    static size_t inputLength(size_t encodedLength) { return base94InputLength(encodedLength); }
+    static bool encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength);
+  };
+  struct Base52Encoder {
+    static size_t inputLength(size_t encodedLength) { return base52InputLength(encodedLength); }
+    static bool encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength);
+  };
+  struct Base10Encoder {
+    static size_t inputLength(size_t encodedLength) { return base10InputLength(encodedLength); }
+    static bool encode(const uint8_t *key, size_t keyLength, char *out, size_t outSize, size_t &outLength);
+  };
+
   /**
    * @brief Derives a cryptographic key from the input and encodes it.
    *
-   * This is a shared helper function used by different password derivation
-   * methods (e.g., Base62, Base94). It performs the following steps:
-   *   1. Validates input pointers.
-   *   2. Appends the textual value of `dstLength` to the input string.
-   *   3. Allocates a buffer for the intermediate key based on the desired
-   *      output length using `keyLengthFunc`.
-   *   4. Calls `derivateKey()` to derive the key using the modified input
-   *      and the provided seed.
-   *   5. Encodes the derived key using the provided encoding function
-   *      (`encodeFunc`).
-   *   6. Copies the encoded key to the destination buffer (`dst`) and
-   *      ensures null-termination.
+   * This is the shared helper behind every password derivation method. It performs
+   * the following steps:
+   *   1. Validates input pointers and the requested length (1..MAX_PASS_SIZE).
+   *   2. Formats `dstLength` as decimal text, used as a suffix of the input.
+   *   3. Derives `Encoder::inputLength(dstLength)` key bytes from input + suffix
+   *      and the provided seed, into a stack buffer.
+   *   4. Encodes the derived key with `Encoder::encode()` into a stack buffer.
+   *   5. Copies the encoded key to `dst`, null-terminates it and wipes the scratch buffers.
    *
+   * @tparam Encoder One of the encoder policies above.
    * @param dst Pointer to the buffer where the final encoded key will be stored.
    *            Must be at least `dstLength + 1` bytes.
-   * @param dstLength Length of the destination buffer (`dst`). The derived
-   *                  key will be truncated if necessary.
+   * @param dstLength Desired password length (1..MAX_PASS_SIZE).
    * @param input Null-terminated input string (e.g., a password).
    * @param seed Null-terminated seed string used for key derivation.
-   * @param keyLengthFunc Function pointer to compute the intermediate key length
-   *                      from the desired encoded length (e.g., `base62InputLength`
-   *                      or `base94InputLength`). Must return `size_t`.
-   * @param encodeFunc Function pointer or lambda that encodes the intermediate key
-   *                   into a string. Signature: `bool encodeFunc(const std::vector<uint8_t>& key, std::string& out)`.
-   *                   Returns true if encoding succeeds.
-   *
+   * @param saltMidstate Optional salt midstate cache (see derivateKeyParts()).
    * @return true if the key was successfully derived and encoded, false otherwise.
    *
-   * @note This function is intended to be used internally as a private helper.
-   *       It does not perform any memory allocation for the destination buffer;
-   *       `dst` must be pre-allocated.
-   * @note The function appends `dstLength` to the input string before deriving
-   *       the key to ensure uniqueness of the derived key for different lengths.
+   * @note No heap memory is used.
+   */
+  template <typename Encoder>
+  bool deriveAndEncode(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                       HmacSha512::Midstate *saltMidstate);
+
+  /**
+   * @brief Derive key material from a two-part input and a hex-encoded seed.
+   *
+   * Equivalent to calling derivateKey() on the concatenation `input || suffix`,
+   * but both parts are streamed into HMAC-SHA512 so no concatenated copy is built.
+   *
+   * @param dst Output buffer for the derived key.
+   * @param dstLength Number of key bytes to derive.
+   * @param input First part of the input key material.
+   * @param inputLength Length of `input` in bytes.
+   * @param suffix Second part of the input key material (may be nullptr if `suffixLength` is 0).
+   * @param suffixLength Length of `suffix` in bytes.
+   * @param seed Null-terminated seed string; each pair of characters is parsed as a hex byte.
+   * @param saltMidstate Optional salt midstate cache. If valid, `seed` is not parsed and the
+   *                     extract step resumes from it; otherwise it is filled from `seed`.
+   * @return true on success, false if the seed could not be converted to a salt.
+   */
+  bool derivateKeyParts(uint8_t *dst, size_t dstLength,
+                        const char *input, size_t inputLength,
+                        const char *suffix, size_t suffixLength,
+                        const char *seed, HmacSha512::Midstate *saltMidstate = nullptr);
+
+  /**
+   * @brief Convert a seed string into an HMAC salt.
+   *
+   * Each pair of characters is parsed with `strtoul(..., 16)`, exactly as the
+   * original implementation did. Salts longer than one SHA-512 block are replaced
+   * by their SHA-512 digest, which is what HMAC does with long keys anyway.
+   *
+   * @param seed Null-terminated seed string.
+   * @param salt Output buffer of MAX_SALT_SIZE bytes.
+   * @param saltLength Receives the number of salt bytes written.
+   * @return false if a character pair does not fit in a byte.
    */
-  bool deriveAndEncode(
-      uint8_t *dst,
-      size_t dstLength,
-      const char *input,
-      const char *seed,
-      size_t (*keyLengthFunc)(size_t),
-      std::function<bool(const std::vector<uint8_t>&, std::string&)> encodeFunc);
+  static bool seedToSalt(const char *seed, uint8_t *salt, size_t &saltLength);
+
+  /**
+   * @brief Format `value` as decimal text without going through printf.
+   * @return Number of characters written (excluding the terminator).
+   */
+  static size_t formatLength(size_t value, char *out, size_t outSize);
 
   /**
    * @brief Perform HKDF (HMAC-based Key Derivation Function) to derive key material.
@@ -289,40 +384,7 @@ private:
    */
   static size_t base10InputLength(size_t encodedLength);
 
-  /**
-   * @brief Encode an intermediate key into a letters-only string.
-   *
-   * This function maps each byte of the derived key to a letter in the
-   * range a-z, A-Z. It is intended for use with derivatePassLettersOnly().
-   *
-   * @param key Reference to the vector containing the derived key bytes.
-   * @param out Reference to a std::string where the encoded password will be stored.
-   * @return true if encoding succeeds, false otherwise.
-   *
-   * @note Each byte is mapped modulo 52 to select a letter from the
-   *       52-character set. The output string is cleared before encoding.
-   * @note This function preserves the entropy of the derived key within the
-   *       constraints of the letters-only encoding.
-   */
-  static bool encodeLettersOnly(const std::vector<uint8_t>& key, std::string& out);
-
-  /**
-   * @brief Encode an intermediate key into a numeric string.
-   *
-   * This function maps each byte of the derived key to a digit (0–9). It is used
-   * internally by derivatePassNumbersOnly() to produce numeric-only passwords or PINs.
-   *
-   * @param key Reference to the vector containing the derived key bytes.
-   * @param out Reference to a std::string where the encoded numeric password will be stored.
-   * @return true if encoding succeeds, false otherwise.
-   *
-   * @note Each byte is mapped modulo 10 to select a digit from the 10-character set.
-   *       The output string is cleared before encoding.
-   * @note This encoding preserves determinism while restricting the output space
-   *       to numeric characters, making it suitable for PIN-style passwords or
-   *       systems that accept digits only.
-   */
-  static bool encodeNumbersOnly(const std::vector<uint8_t>& key, std::string& out);
+  uint32_t compressionCount_ = 0;  ///< SHA-512 compressions since construction/reset
 };
 
 #endif  // KDF_H
@@ -0,0 +1,107 @@
+#include "HidCalibrator.h"
+#include <Arduino.h>
+
+HidTypingProfile hidTimingProfile(const HidHostTiming &timing, HidTypingSpeed defaultSpeed) {
+  if (timing.version != HID_TIMING_VERSION) {
+    return hidTypingProfile(defaultSpeed);
+  }
+  switch (timing.source) {
+    case HID_TIMING_CALIBRATED: {
+      HidTypingProfile profile = { HID_KEYS_PER_REPORT, timing.pressMs, timing.releaseMs };
+      return profile;
+    }
+    case HID_TIMING_FALLBACK:
+      return hidTypingProfile(HID_SPEED_COMPATIBLE);
+    default:
+      return hidTypingProfile(defaultSpeed);
+  }
+}
+
+HidCalibrator::HidCalibrator(IHidReportSink &sink)
+  : sink_(sink), result_(), sentUs_(0), sentAtMs_(0), completions_(0), roundMaxUs_(0),
+    samples_(0), rounds_(0), previousMs_(0), waiting_(false), active_(false) {}
+
+void HidCalibrator::start() {
+  result_ = HidHostTiming();
+  sentAtMs_ = millis();
+  roundMaxUs_ = 0;
+  samples_ = 0;
+  rounds_ = 0;
+  previousMs_ = 0;
+  waiting_ = false;
+  active_ = true;
+}
+
+bool HidCalibrator::poll() {
+  if (!active_) return false;
+
+  if (waiting_) {
+    if (sink_.completedReports() == completions_) {
+      if (millis() - sentAtMs_ >= HID_REPORT_TIMEOUT_MS) fail();  // no feedback or stalled
+      return active_;
+    }
+    uint32_t latencyUs = sink_.lastCompletedUs() - sentUs_;
+    if (latencyUs > roundMaxUs_) roundMaxUs_ = latencyUs;
+    waiting_ = false;
+    sentAtMs_ = millis();
+    if (++samples_ == HID_CALIBRATION_SAMPLES) finishRound();
+    if (!active_) return false;
+    // queue the next probe right away, so it waits for a full host poll
+  }
+
+  if (!sink_.ready()) {
+    if (millis() - sentAtMs_ >= HID_REPORT_TIMEOUT_MS) fail();
+    return active_;
+  }
+  const HidReport probe = {};  // no key down: nothing is typed
+  completions_ = sink_.completedReports();
+  sentUs_ = micros();
+  if (sink_.send(probe)) {
+    sentAtMs_ = millis();
+    waiting_ = true;
+  }
+  return true;
+}
+
+bool HidCalibrator::run() {
+  start();
+  while (poll()) {
+    sink_.idle();
+  }
+  return result_.source == HID_TIMING_CALIBRATED;
+}
+
+void HidCalibrator::finishRound() {
+  uint32_t ms = (roundMaxUs_ + 999) / 1000;
+  if (ms < 1) ms = 1;
+  samples_ = 0;
+  roundMaxUs_ = 0;
+  rounds_++;
+
+  if (ms > hidTypingProfile(HID_SPEED_COMPATIBLE).pressMs) {
+    fail();  // slower than the conservative timing already is
+    return;
+  }
+  if (ms == previousMs_) {
+    result_.version = HID_TIMING_VERSION;
+    result_.source = HID_TIMING_CALIBRATED;
+    result_.pressMs = (uint8_t)ms;
+    result_.releaseMs = (uint8_t)ms;
+    active_ = false;
+    return;
+  }
+  previousMs_ = (uint8_t)ms;
+  if (rounds_ >= HID_CALIBRATION_ROUNDS) {
+    fail();  // too much jitter to settle
+  }
+}
+
+void HidCalibrator::fail() {
+  const HidTypingProfile &conservative = hidTypingProfile(HID_SPEED_COMPATIBLE);
+  result_.version = HID_TIMING_VERSION;
+  result_.source = HID_TIMING_FALLBACK;
+  result_.pressMs = conservative.pressMs;
+  result_.releaseMs = conservative.releaseMs;
+  waiting_ = false;
+  active_ = false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HidReportStream.h"
+
+#define HID_CALIBRATION_SAMPLES 16  // probe reports per round
+#define HID_CALIBRATION_ROUNDS 6    // rounds allowed to agree before giving up
+#define HID_HOST_PROFILES 4         // hosts with their own stored timing
+#define HID_TIMING_SETTING_KEY 0x48540000u  // storage key of host profile 0 ('HT'), +profile
+
+// Where the typing timings of a host come from
+enum HidTimingSource : uint8_t {
+  HID_TIMING_DEFAULT = 0,     // not calibrated: HID_TYPING_SPEED profile
+  HID_TIMING_CALIBRATED = 1,  // measured by HidCalibrator
+  HID_TIMING_FALLBACK = 2     // calibration failed: conservative (COMPATIBLE) timings
+};
+
+// Typing timings of one host profile, stored as a device setting
+struct HidHostTiming {
+  uint8_t version;  // HID_TIMING_VERSION once stored
+  uint8_t source;   // HidTimingSource
+  uint8_t pressMs;
+  uint8_t releaseMs;
+};
+
+#define HID_TIMING_VERSION 1
+
+// Typing profile for a host timing (DEFAULT maps to the given speed)
+HidTypingProfile hidTimingProfile(const HidHostTiming &timing, HidTypingSpeed defaultSpeed);
+
+// Measures how fast the host consumes reports from report-complete timestamps.
+//
+// Each round queues HID_CALIBRATION_SAMPLES empty reports back to back (nothing is typed)
+// and takes the slowest send-to-complete latency, rounded up to whole milliseconds. Once
+// two consecutive rounds agree, that value becomes the press and release time: every
+// report then stays current for at least one host poll. A stalled host, a sink without
+// feedback, rounds that never agree or a host slower than the COMPATIBLE timings yield
+// the conservative FALLBACK timing instead.
+class HidCalibrator {
+public:
+  explicit HidCalibrator(IHidReportSink &sink);
+
+  void start();
+
+  // Queue or time the next probe; returns true while calibrating
+  bool poll();
+
+  // Calibrate to the end (blocking); returns false if the fallback timing was chosen
+  bool run();
+
+  bool isCalibrating() const { return active_; }
+  const HidHostTiming &result() const { return result_; }
+
+private:
+  // Turn the round's slowest latency into a timing; finish once it repeats
+  void finishRound();
+
+  // Settle on the conservative timing
+  void fail();
+
+  IHidReportSink &sink_;
+  HidHostTiming result_;
+  uint32_t sentUs_;        // micros() when the probe was queued
+  uint32_t sentAtMs_;      // millis() of the last progress, for the timeout
+  uint32_t completions_;   // sink completion count before the probe
+  uint32_t roundMaxUs_;    // slowest latency of the round
+  uint8_t samples_;        // probes timed in this round
+  uint8_t rounds_;         // rounds finished
+  uint8_t previousMs_;     // timing of the previous round (0 = none)
+  bool waiting_;           // probe queued, completion pending
+  bool active_;
+};
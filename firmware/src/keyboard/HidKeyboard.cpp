@@ -1,8 +1,5 @@
 #include "HidKeyboard.h"
 
-// Build a constant conversion table from ASCII → (shift, keycode)
-static const uint8_t conv_table[128][2] = { HID_ASCII_TO_KEYCODE };
-
 static const uint8_t HID_REPORT_DESCRIPTOR_KEYBOARD[] = {
   TUD_HID_REPORT_DESC_KEYBOARD()
 };
@@ -25,32 +22,91 @@ void hidKeyboardInit() {
   }
 }
 
+// Report-complete timestamps, written from the USB task
+static volatile uint32_t completedReports = 0;
+static volatile uint32_t lastCompletedUs = 0;
+
+extern "C" void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len) {
+  (void)instance;
+  (void)report;
+  (void)len;
+  lastCompletedUs = micros();
+  completedReports = completedReports + 1;
+}
+
+// Reports go straight to the TinyUSB endpoint; tud_hid_ready() turns true on report completion
+class TinyUsbReportSink : public IHidReportSink {
+public:
+  bool ready() override { return tud_hid_ready(); }
+  bool send(const HidReport &report) override {
+    return tud_hid_keyboard_report(0, report.modifier, report.keycodes);
+  }
+  uint32_t completedReports() override { return ::completedReports; }
+  uint32_t lastCompletedUs() override { return ::lastCompletedUs; }
+};
+
+static TinyUsbReportSink sink;
+static HidTyper typer(sink);
+static HidCalibrator calibrator(sink);
+static HidTypingSpeed typingSpeed = HID_TYPING_SPEED;
+static KeyboardLayoutId typingLayout = LAYOUT_US;
+static HidHostTiming hostTiming = {};
+
+void hidKeyboardSetSpeed(HidTypingSpeed speed) {
+  typingSpeed = speed;
+}
+
+void hidKeyboardSetLayout(KeyboardLayoutId layout) {
+  typingLayout = layout;
+}
+
+void hidKeyboardSetTiming(const HidHostTiming& timing) {
+  hostTiming = timing;
+}
+
+bool hidCalibrateStart() {
+  if (typer.isTyping()) return false;
+  calibrator.start();
+  return true;
+}
+
+bool hidCalibratePoll() {
+  return calibrator.poll();
+}
+
+bool hidCalibrateResult(HidHostTiming& timing) {
+  timing = calibrator.result();
+  return timing.source == HID_TIMING_CALIBRATED;
+}
+
 // Send a single ASCII character via USB HID
 void hidSendKey(char c) {
-  if (c < 0 || c >= 128) return; // ignore non-printable chars
-
-  uint8_t shift = conv_table[(uint8_t)c][0];
-  uint8_t keycode = conv_table[(uint8_t)c][1];
+  const char str[2] = { c, 0 };
+  hidTypeString(str);
+}
 
-  if (keycode == 0) return; // unmapped char
+// Type a string: reports are rendered up front and sent as fast as the host polls
+bool hidTypeString(const char* str) {
+  if (calibrator.isCalibrating()) return false;  // the probes own the endpoint
+  return typer.type(str, hidTimingProfile(hostTiming, typingSpeed), keyboardLayout(typingLayout));
+}
 
-  uint8_t modifier = shift ? KEYBOARD_MODIFIER_LEFTSHIFT : 0;
-  uint8_t keycodes[6] = { keycode, 0, 0, 0, 0, 0 };
+bool hidTypeStart(const char* str) {
+  if (calibrator.isCalibrating()) return false;
+  return typer.start(str, hidTimingProfile(hostTiming, typingSpeed), keyboardLayout(typingLayout));
+}
 
-  // Send the keypress
-  tud_hid_keyboard_report(0, modifier, keycodes);
-  sleep_ms(8);
+bool hidTypePoll() {
+  return typer.poll();
+}
 
-  // Release all keys
-  tud_hid_keyboard_report(0, 0, NULL);
-  sleep_ms(5);
+void hidTypeCancel() {
+  typer.cancel();
 }
 
-// Type a string
-void hidTypeString(const char* str) {
-  while (*str) {
-    hidSendKey(*str++);
-  }
+void hidTypeProgress(size_t* typed, size_t* total) {
+  if (typed) *typed = typer.typed();
+  if (total) *total = typer.total();
 }
 
 // Send Enter
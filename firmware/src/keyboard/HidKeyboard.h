@@ -1,15 +1,57 @@
 #pragma once
 #include "Adafruit_TinyUSB.h"
 #include "tusb.h"
+#include "HidTyper.h"
+#include "HidCalibrator.h"
+
+#if defined(TP_HID_TYPING_SPEED)
+#define HID_TYPING_SPEED TP_HID_TYPING_SPEED
+#else
+#define HID_TYPING_SPEED HID_SPEED_STANDARD  // default speed profile (HidTypingSpeed)
+#endif
 
 // Initialize TinyUSB keyboard interface
 void hidKeyboardInit();
 
+// Select the speed profile used for typing
+void hidKeyboardSetSpeed(HidTypingSpeed speed);
+
+// Select the host keyboard layout characters are typed for (default US)
+void hidKeyboardSetLayout(KeyboardLayoutId layout);
+
+// Select the timings of the current host (HID_TIMING_DEFAULT uses the speed profile)
+void hidKeyboardSetTiming(const HidHostTiming& timing);
+
+// Start measuring the host's report timing in the background (nothing is typed);
+// returns false while typing
+bool hidCalibrateStart();
+
+// Queue or time the next calibration probe; returns true while calibrating
+bool hidCalibratePoll();
+
+// Result of the last calibration: timing receives the calibrated or, on failure, the
+// conservative fallback timing. Returns false on failure.
+bool hidCalibrateResult(HidHostTiming& timing);
+
 // Send a single key (ASCII-aware)
 void hidSendKey(char c);
 
-// Type a full string (ASCII-aware)
-void hidTypeString(const char* str);
+// Type a full string (ASCII-aware, blocking); returns false if the host stopped polling
+// or a calibration is running
+bool hidTypeString(const char* str);
+
+// Start typing a string in the background (str must stay valid until done); returns
+// false while a calibration is running
+bool hidTypeStart(const char* str);
+
+// Advance background typing by one report; returns true while typing
+bool hidTypePoll();
+
+// Stop background typing (keys are released)
+void hidTypeCancel();
+
+// Background typing progress in characters
+void hidTypeProgress(size_t* typed, size_t* total);
 
 // Send Enter key
 void hidSendEnter();
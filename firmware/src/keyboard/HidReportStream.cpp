@@ -0,0 +1,71 @@
+#include "HidReportStream.h"
+#include <string.h>
+
+static const HidTypingProfile PROFILES[] = {
+  { 1, 8, 5 },                    // HID_SPEED_COMPATIBLE
+  { HID_KEYS_PER_REPORT, 2, 2 },  // HID_SPEED_STANDARD
+  { HID_KEYS_PER_REPORT, 0, 0 },  // HID_SPEED_FAST
+};
+
+const HidTypingProfile &hidTypingProfile(HidTypingSpeed speed) {
+  if (speed >= sizeof(PROFILES) / sizeof(PROFILES[0])) {
+    return PROFILES[HID_SPEED_COMPATIBLE];
+  }
+  return PROFILES[speed];
+}
+
+// Release every key down
+static void emitRelease(HidReport *out, size_t &count, HidReport &held, uint8_t &heldCount) {
+  memset(&out[count++], 0, sizeof(HidReport));
+  memset(&held, 0, sizeof(held));
+  heldCount = 0;
+}
+
+// Add one key to the keys already down
+static void emitPress(HidReport *out, size_t &count, HidReport &held, uint8_t &heldCount,
+                      uint8_t modifier, uint8_t keycode) {
+  held.modifier = modifier;
+  held.keycodes[heldCount++] = keycode;
+  out[count++] = held;
+}
+
+size_t renderHidReports(const char *str, const KeyboardLayout &layout, uint8_t maxKeysPerReport,
+                        HidReport *out, size_t capacity, size_t *consumed) {
+  size_t count = 0;
+  size_t chars = 0;
+  HidReport held = {};
+  uint8_t heldCount = 0;
+
+  if (maxKeysPerReport < 1) maxKeysPerReport = 1;
+  if (maxKeysPerReport > HID_KEYS_PER_REPORT) maxKeysPerReport = HID_KEYS_PER_REPORT;
+
+  for (; str && str[chars]; ++chars) {
+    uint8_t c = (uint8_t)str[chars];
+    if (c >= 128 || layout.keys[c].keycode == 0) continue;  // not on this layout
+    const HidKey &key = layout.keys[c];
+
+    bool release = false;
+    if (heldCount > 0) {
+      release = key.modifier != held.modifier || heldCount == maxKeysPerReport ||
+                memchr(held.keycodes, key.keycode, heldCount) != NULL;
+    }
+    // the character's reports and the final release must fit
+    size_t needed = (release ? 1 : 0) + 1 + (key.dead ? 2 : 0) + 1;
+    if (count + needed > capacity) break;
+
+    if (release) {
+      emitRelease(out, count, held, heldCount);
+    }
+    emitPress(out, count, held, heldCount, key.modifier, key.keycode);
+    if (key.dead) {
+      emitRelease(out, count, held, heldCount);
+      emitPress(out, count, held, heldCount, 0, HID_KEY_SPACE_CODE);
+    }
+  }
+  if (heldCount > 0) {
+    emitRelease(out, count, held, heldCount);
+  }
+
+  if (consumed) *consumed = chars;
+  return count;
+}
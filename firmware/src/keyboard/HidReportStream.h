@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "KeyboardLayout.h"
+
+#if defined(TP_HID_REPORT_TIMEOUT_MS)
+#define HID_REPORT_TIMEOUT_MS TP_HID_REPORT_TIMEOUT_MS
+#else
+#define HID_REPORT_TIMEOUT_MS 250  // give up when the host stops polling for this long
+#endif
+
+#define HID_KEYS_PER_REPORT 6  // boot keyboard report: 6 keycodes
+
+// One boot keyboard input report (modifier byte + 6 keycodes)
+struct HidReport {
+  uint8_t modifier;
+  uint8_t keycodes[HID_KEYS_PER_REPORT];
+};
+
+// Speed profiles for HidTyper
+enum HidTypingSpeed : uint8_t {
+  HID_SPEED_COMPATIBLE = 0,  // one key per report, 8 ms press / 5 ms release (legacy timing)
+  HID_SPEED_STANDARD = 1,    // key rollover, at most one report per 2 ms poll interval
+  HID_SPEED_FAST = 2         // key rollover, paced by the host only
+};
+
+// Report packing and pacing of a speed profile
+struct HidTypingProfile {
+  uint8_t maxKeysPerReport;  // 1 disables rollover
+  uint8_t pressMs;           // minimum time a report pressing a key stays current
+  uint8_t releaseMs;         // minimum time a release report stays current
+};
+
+// Profile of a speed (unknown values map to COMPATIBLE)
+const HidTypingProfile &hidTypingProfile(HidTypingSpeed speed);
+
+// Receives reports; implemented over TinyUSB on the device and by a simulated host in tests
+class IHidReportSink {
+public:
+  virtual ~IHidReportSink() = default;
+
+  // True once the previous report was taken by the host (tud_hid_ready())
+  virtual bool ready() = 0;
+
+  // Queue a report for the next host poll
+  virtual bool send(const HidReport &report) = 0;
+
+  // Called by HidTyper::type() while waiting for the host to take a report
+  virtual void idle() {}
+
+  // Report-complete feedback (tud_hid_report_complete_cb): reports the host took so far
+  // and micros() when it took the last one. Sinks without feedback never count.
+  virtual uint32_t completedReports() { return 0; }
+  virtual uint32_t lastCompletedUs() { return 0; }
+};
+
+// Translate ASCII text into a report stream.
+//
+// Consecutive distinct keys with the same modifier are rolled over: each report keeps the
+// keys already down and adds exactly one, so the host still sees one key-down per report in
+// typing order. A release report is only inserted when the modifier changes, a key repeats
+// or the report is full, and after the last key. A dead key is released and followed by a
+// space. Characters the layout cannot type are skipped.
+//
+// layout: host keyboard layout
+// out/capacity: report buffer; rendering stops at the last character that fits
+// consumed: receives the number of characters rendered (may be NULL)
+// Returns the number of reports written.
+size_t renderHidReports(const char *str, const KeyboardLayout &layout, uint8_t maxKeysPerReport,
+                        HidReport *out, size_t capacity, size_t *consumed);
+
@@ -0,0 +1,110 @@
+#include "HidTyper.h"
+#include <Arduino.h>
+#include <string.h>
+
+HidTyper::HidTyper(IHidReportSink &sink)
+  : sink_(sink), layout_(&keyboardLayout(LAYOUT_US)), profile_(hidTypingProfile(HID_SPEED_COMPATIBLE)), str_(NULL),
+    rendered_(0), typed_(0), total_(0), count_(0), sent_(0), sentAt_(0), minMs_(0),
+    keyDown_(false), active_(false), failed_(false) {
+  memset(reports_, 0, sizeof(reports_));
+}
+
+HidTyper::~HidTyper() {
+  memset(reports_, 0, sizeof(reports_));
+}
+
+bool HidTyper::start(const char *str, const HidTypingProfile &profile,
+                     const KeyboardLayout &layout) {
+  if (active_ || !str) return false;
+  profile_ = profile;
+  layout_ = &layout;
+  str_ = str;
+  rendered_ = 0;
+  typed_ = 0;
+  total_ = strlen(str);
+  count_ = 0;
+  sent_ = 0;
+  sentAt_ = millis();
+  minMs_ = 0;
+  keyDown_ = false;
+  failed_ = false;
+  active_ = true;
+  renderNext();  // typing is then pure report dispatch
+  return true;
+}
+
+bool HidTyper::renderNext() {
+  memset(reports_, 0, count_ * sizeof(HidReport));
+  if (str_) typed_ = rendered_;  // unmapped characters count as typed
+  count_ = 0;
+  sent_ = 0;
+  if (!str_ || rendered_ >= total_) return false;
+
+  size_t consumed = 0;
+  count_ = renderHidReports(str_ + rendered_, *layout_, profile_.maxKeysPerReport,
+                            reports_, HID_REPORT_BUFFER_SIZE, &consumed);
+  rendered_ += consumed;
+  return count_ > 0 || rendered_ < total_;
+}
+
+bool HidTyper::poll() {
+  if (!active_) return false;
+
+  // wait until the host took the last report and it stayed current long enough
+  if (!sink_.ready() || millis() - sentAt_ < minMs_) {
+    if (millis() - sentAt_ >= HID_REPORT_TIMEOUT_MS) {
+      failed_ = true;
+      finish();
+      return false;
+    }
+    return true;
+  }
+
+  while (sent_ == count_) {
+    if (!renderNext()) {
+      finish();  // last report taken
+      return false;
+    }
+  }
+
+  const HidReport &report = reports_[sent_];
+  if (!sink_.send(report)) {
+    return true;  // retried on the next poll
+  }
+  keyDown_ = report.keycodes[0] != 0;
+  if (keyDown_ && typed_ < rendered_) typed_++;
+  minMs_ = keyDown_ ? profile_.pressMs : profile_.releaseMs;
+  sentAt_ = millis();
+  sent_++;
+  return true;
+}
+
+void HidTyper::cancel() {
+  if (!active_) return;
+  memset(reports_, 0, count_ * sizeof(HidReport));
+  str_ = NULL;
+  if (keyDown_) {
+    count_ = 1;  // one release report, sent by poll()
+    sent_ = 0;
+  } else {
+    finish();
+  }
+}
+
+bool HidTyper::type(const char *str, const HidTypingProfile &profile,
+                    const KeyboardLayout &layout) {
+  if (!start(str, profile, layout)) return false;
+  while (poll()) {
+    sink_.idle();
+  }
+  return !failed_;
+}
+
+void HidTyper::finish() {
+  memset(reports_, 0, sizeof(reports_));
+  str_ = NULL;
+  count_ = 0;
+  sent_ = 0;
+  keyDown_ = false;
+  active_ = false;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HidReportStream.h"
+
+#define HID_REPORT_BUFFER_SIZE 256  // reports rendered at a time (4 per character worst case)
+
+// Incremental typing engine: renders a string into reports when typing starts and sends
+// one report per poll() once the host took the previous one, so the caller's loop keeps
+// running (serial, button) while a password is typed. Strings longer than the buffer are
+// rendered in chunks as it drains.
+class HidTyper {
+public:
+  explicit HidTyper(IHidReportSink &sink);
+  ~HidTyper();
+
+  // Render str for the host layout and start typing it (str must stay valid until done);
+  // false if already typing
+  bool start(const char *str, const HidTypingProfile &profile, const KeyboardLayout &layout);
+
+  // Send the next report if the host is ready; returns true while typing
+  bool poll();
+
+  // Stop after releasing any key still down
+  void cancel();
+
+  // Type str to the end (blocking); returns false on host timeout
+  bool type(const char *str, const HidTypingProfile &profile, const KeyboardLayout &layout);
+
+  bool isTyping() const { return active_; }
+
+  // True if the last string stopped because the host stopped polling
+  bool failed() const { return failed_; }
+
+  // Characters typed so far and in total
+  size_t typed() const { return typed_; }
+  size_t total() const { return total_; }
+
+private:
+  // Render the next chunk of the string; false if nothing is left
+  bool renderNext();
+
+  // Wipe the reports and go idle
+  void finish();
+
+  IHidReportSink &sink_;
+  const KeyboardLayout *layout_;
+  HidTypingProfile profile_;
+  const char *str_;       // string being typed (NULL once cancelled)
+  size_t rendered_;       // characters rendered so far
+  size_t typed_;          // characters whose key-down was sent
+  size_t total_;          // string length
+  size_t count_;          // reports in the current chunk
+  size_t sent_;           // reports of the chunk already sent
+  uint32_t sentAt_;       // millis() of the last report
+  uint8_t minMs_;         // minimum time the last report stays current
+  bool keyDown_;          // the last report sent holds keys
+  bool active_;
+  bool failed_;
+  HidReport reports_[HID_REPORT_BUFFER_SIZE];  // keycodes spell the password: wiped after each chunk
+};
@@ -0,0 +1,40 @@
+#include "KeyboardLayout.h"
+
+namespace layout_detail {
+
+constexpr size_t length(const char *s) {
+  size_t n = 0;
+  while (s && s[n]) ++n;
+  return n;
+}
+
+constexpr bool validSpec(const LayoutSpec &spec) {
+  return length(spec.normal) == ROW_LENGTH && length(spec.shift) == ROW_LENGTH &&
+         (!spec.altGr || length(spec.altGr) == ROW_LENGTH) && (!spec.iso || length(spec.iso) == 3);
+}
+
+static_assert(validSpec(US) && validSpec(UK) && validSpec(DE) && validSpec(FR) && validSpec(DVORAK),
+              "layout rows must cover keycodes 0x04-0x38");
+
+}  // namespace layout_detail
+
+// Generated at compile time, stored in flash
+static constexpr KeyboardLayout LAYOUTS[LAYOUT_COUNT] = {
+  layout_detail::build(layout_detail::US),
+  layout_detail::build(layout_detail::UK),
+  layout_detail::build(layout_detail::DE),
+  layout_detail::build(layout_detail::FR),
+  layout_detail::build(layout_detail::DVORAK),
+};
+
+static_assert(LAYOUTS[LAYOUT_US].keys['A'].modifier == HID_MODIFIER_LEFTSHIFT && LAYOUTS[LAYOUT_US].keys['A'].keycode == 0x04,
+              "US: A is Shift+0x04");
+static_assert(LAYOUTS[LAYOUT_DE].keys['@'].modifier == HID_MODIFIER_RIGHTALT && LAYOUTS[LAYOUT_DE].keys['@'].keycode == 0x14,
+              "DE: @ is AltGr+Q");
+static_assert(LAYOUTS[LAYOUT_FR].keys['a'].keycode == 0x14 && LAYOUTS[LAYOUT_FR].keys['^'].keycode == 0x26,
+              "FR: AZERTY letters, plain ^ on AltGr+9");
+
+const KeyboardLayout &keyboardLayout(KeyboardLayoutId id) {
+  if (id >= LAYOUT_COUNT) return LAYOUTS[LAYOUT_US];
+  return LAYOUTS[id];
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HID_MODIFIER_LEFTSHIFT 0x02    // KEYBOARD_MODIFIER_LEFTSHIFT
+#define HID_MODIFIER_RIGHTALT 0x40     // KEYBOARD_MODIFIER_RIGHTALT (AltGr)
+#define HID_KEY_SPACE_CODE 0x2C        // HID_KEY_SPACE
+
+// Host keyboard layouts (same values as turtlpass_KeyboardLayout)
+enum KeyboardLayoutId : uint8_t {
+  LAYOUT_US = 0,
+  LAYOUT_UK = 1,
+  LAYOUT_DE = 2,
+  LAYOUT_FR = 3,
+  LAYOUT_DVORAK = 4,
+  LAYOUT_COUNT
+};
+
+// Key producing one ASCII character on the host
+struct HidKey {
+  uint8_t modifier;  // HID modifier bits
+  uint8_t keycode;   // 0 = not typeable on this layout
+  bool dead;         // dead key: followed by a space to produce the character
+};
+
+// ASCII -> key for one host layout
+struct KeyboardLayout {
+  HidKey keys[128];
+};
+
+// Layout of a host (unknown values map to US)
+const KeyboardLayout &keyboardLayout(KeyboardLayoutId id);
+
+namespace layout_detail {
+
+// Rows are indexed by keycode - 0x04 and cover 0x04 (A) to 0x38 (/), i.e. letters, the
+// number row, the punctuation keys and 0x32, the ISO key next to Enter. A blank means the
+// key has no ASCII character there (Enter, Tab and Space are added for every layout).
+constexpr uint8_t FIRST_KEY = 0x04;
+constexpr size_t ROW_LENGTH = 0x38 - FIRST_KEY + 1;
+constexpr uint8_t ISO_KEY = 0x64;  // extra key left of Z on ISO keyboards
+
+struct LayoutSpec {
+  const char *normal;      // ROW_LENGTH characters without modifier
+  const char *shift;       // with Shift
+  const char *altGr;       // with AltGr (NULL if unused)
+  const char *iso;         // 0x64: without modifier, Shift, AltGr
+  const char *deadKeys;    // characters whose key is a dead key
+};
+
+// First definition wins, so rows are applied from the plainest modifier up
+constexpr void assign(KeyboardLayout &layout, char c, uint8_t modifier, uint8_t keycode) {
+  uint8_t index = (uint8_t)c;
+  if (c == ' ' || index >= 128 || layout.keys[index].keycode != 0) return;
+  layout.keys[index].modifier = modifier;
+  layout.keys[index].keycode = keycode;
+}
+
+constexpr void assignRow(KeyboardLayout &layout, const char *row, uint8_t modifier) {
+  if (!row) return;
+  for (size_t i = 0; i < ROW_LENGTH && row[i]; ++i) {
+    assign(layout, row[i], modifier, (uint8_t)(FIRST_KEY + i));
+  }
+}
+
+constexpr KeyboardLayout build(const LayoutSpec &spec) {
+  KeyboardLayout layout = {};
+  layout.keys[(uint8_t)' '] = { 0, HID_KEY_SPACE_CODE, false };
+  layout.keys[(uint8_t)'\n'] = { 0, 0x28, false };
+  layout.keys[(uint8_t)'\t'] = { 0, 0x2B, false };
+  assignRow(layout, spec.normal, 0);
+  assignRow(layout, spec.shift, HID_MODIFIER_LEFTSHIFT);
+  assignRow(layout, spec.altGr, HID_MODIFIER_RIGHTALT);
+  if (spec.iso) {
+    assign(layout, spec.iso[0], 0, ISO_KEY);
+    assign(layout, spec.iso[1], HID_MODIFIER_LEFTSHIFT, ISO_KEY);
+    assign(layout, spec.iso[2], HID_MODIFIER_RIGHTALT, ISO_KEY);
+  }
+  for (const char *c = spec.deadKeys; c && *c; ++c) {
+    layout.keys[(uint8_t)*c].dead = true;
+  }
+  return layout;
+}
+
+//                                 letters (0x04-0x1D)         digits (0x1E-0x27) 0x28-0x2C  0x2D-0x38
+constexpr LayoutSpec US = {
+  "abcdefghijklmnopqrstuvwxyz" "1234567890" "     " "-=[]\\ ;'`,./",
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "!@#$%^&*()" "     " "_+{}| :\"~<>?",
+  nullptr, nullptr, nullptr };
+
+constexpr LayoutSpec UK = {
+  "abcdefghijklmnopqrstuvwxyz" "1234567890" "     " "-=[] #;'`,./",
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "!\" $%^&*()" "     " "_+{} ~:@ <>?",
+  nullptr, "\\| ", nullptr };
+
+// Windows German (T1): ^ ` are dead keys, ~ is not
+constexpr LayoutSpec DE = {
+  "abcdefghijklmnopqrstuvwxzy" "1234567890" "     " "   + #  ^,.-",
+  "ABCDEFGHIJKLMNOPQRSTUVWXZY" "!\" $%&/()=" "     " "?` * '   ;:_",
+  "                @         " "      {[]}" "     " "\\  ~        ",
+  "<>|", "^`" };
+
+// Windows French: AltGr ~ ` are dead keys, AltGr+9 gives a plain ^
+constexpr LayoutSpec FR = {
+  "qbcdefghijkl,noparstuvzxyw" "& \"'(- _  " "     " ")= $ *m  ;:!",
+  "QBCDEFGHIJKL?NOPARSTUVZXYW" "1234567890" "     " " +    M% ./ ",
+  "                          " " ~#{[|`\\^@" "     " "]}          ",
+  "<> ", "~`" };
+
+constexpr LayoutSpec DVORAK = {
+  "axje.uidchtnmbrl'poygk,qf;" "1234567890" "     " "[]/=\\ s-`wvz",
+  "AXJE>UIDCHTNMBRL\"POYGK<QF:" "!@#$%^&*()" "     " "{}?+| S_~WVZ",
+  nullptr, nullptr, nullptr };
+
+}  // namespace layout_detail
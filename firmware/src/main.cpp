@@ -1,14 +1,19 @@
 #include <Arduino.h>
 #include "InternalState.h"
 #include "storage/SeedManager.h"
+#include "storage/backend/StorageBackendFactory.h"
 #include "ui/LedManager.h"
 #include "ui/driver/LedDriverFactory.h"
 #include "crypto/Kdf.h"
 #include "crypto/EncryptionManager.h"
 #include "keyboard/HidKeyboard.h"
 #include "core/CommandProcessor.h"
+#include "core/PasswordPrecompute.h"
+#include "core/CryptoWorker.h"
+#include "core/PasswordBatch.h"
 #include "core/TouchHandler.h"
 #include "core/SerialProcessor.h"
+#include "proto/ProtoHelper.h"
 
 #if defined(TP_PIN_TTP223)
 #include "input/TTP223.h"
@@ -19,10 +24,14 @@
 InternalState internalState = IDLE;
 LedManager ledManager(LedDriverFactory::create());
 Kdf kdf;
-SeedManager seedManager;
+IStorageBackend* storageBackend = StorageBackendFactory::create();
+SeedManager seedManager(*storageBackend);
 EncryptionManager encryption;
+CryptoWorker cryptoWorker(seedManager);
+PasswordPrecompute passwordPrecompute;
+PasswordBatch passwordBatch;
 uint8_t output[MAX_PASS_SIZE + 1];
-CommandProcessor commandProcessor(seedManager, kdf, ledManager, internalState, output, sizeof(output));
+CommandProcessor commandProcessor(seedManager, kdf, cryptoWorker, passwordPrecompute, passwordBatch, ledManager, internalState, output, sizeof(output));
 TouchHandler touchHandler(internalState, ledManager, commandProcessor);
 SerialProcessor serialProcessor(commandProcessor);
 
@@ -46,12 +55,22 @@ BootselButton bootselButton(
 
 void setup() {
   Serial.begin(115200);
+  initConstantResponses();  // success, error and device info replies
   seedManager.begin();
+  // seeds of firmware before the flash log: migrate once, then wipe the old copy
+  size_t legacySize = 0;
+  const uint8_t* legacyImage = storageBackend->legacyImage(legacySize);
+  if (seedManager.importLegacy(legacyImage, legacySize)) {
+    storageBackend->eraseLegacyImage();
+  }
   hidKeyboardInit();
 
 #if defined(TP_PIN_TTP223)
   ttp223.begin();
 #endif
+
+  // default password of the boot slot, derived on core1
+  commandProcessor.prefetchDefaultPassword();
 }
 
 void loop() {
@@ -60,7 +79,25 @@ void loop() {
 #else
   bootselButton.loop(ledManager.getCurrentBrightness());
 #endif
+  touchHandler.loop();  // background HID typing
   serialProcessor.loop();
+
+  // Unlocked-seed session: wipe on USB suspend, idle timeout or slot change
+  if (TinyUSBDevice.suspended()) {
+    commandProcessor.lockSession();
+  }
+  commandProcessor.loop();
+
+  // Staged writes (new seeds included) and log compaction: flash programs stall both
+  // cores, so never while typing or timing the host's reports, and during an LED
+  // animation only once writes waited too long
+  if (internalState != TYPING && !commandProcessor.isCalibrating()) {
+    seedManager.serviceStorage(internalState == IDLE && !ledManager.isAnimating());
+  }
+
+  // LED frames come from whichever core is free, so a derivation on one core does not
+  // freeze the animation
+  ledManager.tick();
 }
 
 ///////////////////////////
@@ -73,5 +110,9 @@ void setup1() {
 }
 
 void loop1() {
-  ledManager.loop();
+  // crypto jobs first, LED frames in between (non-blocking; core0 renders too)
+  cryptoWorker.loop();
+  passwordBatch.loop();
+  passwordPrecompute.loop();
+  ledManager.tick();
 }
@@ -0,0 +1,295 @@
+#include "proto/CommandDecoder.h"
+#include "pb_decode.h"
+#include <string.h>
+
+// ---------------- Schema ----------------
+
+struct FieldSpec {
+    pb_size_t tag;
+    pb_type_t type;
+};
+
+#define FIELD_SPEC(tag, atype, htype, ltype) { tag, (pb_type_t)(PB_ATYPE_##atype | PB_HTYPE_##htype | PB_LTYPE_MAP_##ltype) }
+#define GENERATED_FIELD(a, atype, htype, ltype, name, tag) FIELD_SPEC(tag, atype, htype, ltype),
+
+template <size_t N, size_t M>
+static constexpr bool sameFields(const FieldSpec (&generated)[N], const FieldSpec (&handled)[M]) {
+    if (N != M) return false;
+    for (size_t i = 0; i < N; i++) {
+        if (generated[i].tag != handled[i].tag || generated[i].type != handled[i].type) return false;
+    }
+    return true;
+}
+
+// What the decoders below handle, in FIELDLIST order
+static constexpr FieldSpec GENERATE_PASSWORD_FIELDS[] = {
+    FIELD_SPEC(turtlpass_GeneratePasswordParams_entropy_tag, STATIC, SINGULAR, BYTES),
+    FIELD_SPEC(turtlpass_GeneratePasswordParams_length_tag, STATIC, SINGULAR, UINT32),
+    FIELD_SPEC(turtlpass_GeneratePasswordParams_charset_tag, STATIC, SINGULAR, UENUM),
+    FIELD_SPEC(turtlpass_GeneratePasswordParams_delivery_tag, STATIC, SINGULAR, UENUM) };
+static constexpr FieldSpec INITIALIZE_SEED_FIELDS[] = {
+    FIELD_SPEC(turtlpass_InitializeSeedParams_seed_tag, STATIC, SINGULAR, BYTES) };
+static constexpr FieldSpec BATCH_FIELDS[] = {
+    FIELD_SPEC(turtlpass_GeneratePasswordBatchParams_entries_tag, STATIC, REPEATED, MESSAGE) };
+static constexpr FieldSpec SESSION_FIELDS[] = {
+    FIELD_SPEC(turtlpass_SessionParams_timeout_ms_tag, STATIC, SINGULAR, UINT32) };
+static constexpr FieldSpec KEYBOARD_FIELDS[] = {
+    FIELD_SPEC(turtlpass_KeyboardParams_layout_tag, STATIC, SINGULAR, UENUM),
+    FIELD_SPEC(turtlpass_KeyboardParams_host_profile_tag, STATIC, SINGULAR, UINT32) };
+static constexpr FieldSpec FRAMING_FIELDS[] = {
+    FIELD_SPEC(turtlpass_FramingParams_framing_tag, STATIC, SINGULAR, UENUM) };
+static constexpr FieldSpec COMMAND_FIELDS[] = {
+    FIELD_SPEC(turtlpass_Command_type_tag, STATIC, SINGULAR, UENUM),
+    FIELD_SPEC(turtlpass_Command_gen_pass_tag, STATIC, ONEOF, MESSAGE),
+    FIELD_SPEC(turtlpass_Command_init_seed_tag, STATIC, ONEOF, MESSAGE),
+    FIELD_SPEC(turtlpass_Command_session_tag, STATIC, ONEOF, MESSAGE),
+    FIELD_SPEC(turtlpass_Command_request_id_tag, STATIC, SINGULAR, UINT32),
+    FIELD_SPEC(turtlpass_Command_gen_batch_tag, STATIC, ONEOF, MESSAGE),
+    FIELD_SPEC(turtlpass_Command_keyboard_tag, STATIC, ONEOF, MESSAGE),
+    FIELD_SPEC(turtlpass_Command_framing_tag, STATIC, ONEOF, MESSAGE) };
+
+#define CHECK_SCHEMA(message, handled)                                                      \
+    static constexpr FieldSpec message##_GENERATED[] = { message##_FIELDLIST(GENERATED_FIELD, 0) }; \
+    static_assert(sameFields(message##_GENERATED, handled), #message " changed: update CommandDecoder")
+
+CHECK_SCHEMA(turtlpass_GeneratePasswordParams, GENERATE_PASSWORD_FIELDS);
+CHECK_SCHEMA(turtlpass_InitializeSeedParams, INITIALIZE_SEED_FIELDS);
+CHECK_SCHEMA(turtlpass_GeneratePasswordBatchParams, BATCH_FIELDS);
+CHECK_SCHEMA(turtlpass_SessionParams, SESSION_FIELDS);
+CHECK_SCHEMA(turtlpass_KeyboardParams, KEYBOARD_FIELDS);
+CHECK_SCHEMA(turtlpass_FramingParams, FRAMING_FIELDS);
+CHECK_SCHEMA(turtlpass_Command, COMMAND_FIELDS);
+
+// UINT32 and enum fields are stored as 32 bits, as pb_decode() does
+static_assert(sizeof(turtlpass_CommandType) == sizeof(uint32_t), "enum size");
+static_assert(sizeof(turtlpass_Charset) == sizeof(uint32_t), "enum size");
+static_assert(sizeof(turtlpass_PasswordDelivery) == sizeof(uint32_t), "enum size");
+static_assert(sizeof(turtlpass_KeyboardLayout) == sizeof(uint32_t), "enum size");
+static_assert(sizeof(turtlpass_Framing) == sizeof(uint32_t), "enum size");
+
+
+// ---------------- Wire format ----------------
+
+#define KEY(tag, wireType) (((uint32_t)(tag) << 3) | (wireType))
+
+// Bytes of the message being decoded
+struct Reader {
+    const uint8_t *pos;
+    const uint8_t *end;
+};
+
+// Varints of at most 5 bytes that fit in 32 bits; anything else is left to pb_decode()
+static inline bool readVarint(Reader &in, uint32_t &value) {
+    uint32_t result = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (in.pos == in.end) return false;
+        const uint8_t byte = *in.pos++;
+        if (shift == 28 && byte > 0x0F) return false;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+static inline bool readUint32(Reader &in, T &field) {
+    static_assert(sizeof(T) == sizeof(uint32_t), "32-bit field");
+    uint32_t value;
+    if (!readVarint(in, value)) return false;
+    memcpy(&field, &value, sizeof(value));  // enums are not range-checked, as in pb_decode()
+    return true;
+}
+
+// Length-delimited value: in skips it, value covers it
+static inline bool readLength(Reader &in, Reader &value) {
+    uint32_t length;
+    if (!readVarint(in, length) || length > (size_t)(in.end - in.pos)) return false;
+    value.pos = in.pos;
+    value.end = in.pos + length;
+    in.pos = value.end;
+    return true;
+}
+
+template <typename T>
+static inline bool readBytes(Reader &in, T &field) {
+    Reader value;
+    if (!readLength(in, value)) return false;
+    const size_t size = (size_t)(value.end - value.pos);
+    if (size > sizeof(field.bytes)) return false;
+    field.size = (pb_size_t)size;
+    memcpy(field.bytes, value.pos, size);
+    return true;
+}
+
+
+// ---------------- Messages ----------------
+// Submessages merge into what is already there, like pb_decode(); unknown keys return false.
+
+static bool decodeGeneratePassword(Reader in, turtlpass_GeneratePasswordParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        if (!readVarint(in, key)) return false;
+        bool ok;
+        switch (key) {
+            case KEY(turtlpass_GeneratePasswordParams_entropy_tag, PB_WT_STRING):
+                ok = readBytes(in, params.entropy);
+                break;
+            case KEY(turtlpass_GeneratePasswordParams_length_tag, PB_WT_VARINT):
+                ok = readUint32(in, params.length);
+                break;
+            case KEY(turtlpass_GeneratePasswordParams_charset_tag, PB_WT_VARINT):
+                ok = readUint32(in, params.charset);
+                break;
+            case KEY(turtlpass_GeneratePasswordParams_delivery_tag, PB_WT_VARINT):
+                ok = readUint32(in, params.delivery);
+                break;
+            default:
+                return false;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static bool decodeInitializeSeed(Reader in, turtlpass_InitializeSeedParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        if (!readVarint(in, key) || key != KEY(turtlpass_InitializeSeedParams_seed_tag, PB_WT_STRING) ||
+            !readBytes(in, params.seed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool decodeBatch(Reader in, turtlpass_GeneratePasswordBatchParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        Reader value;
+        if (!readVarint(in, key) || key != KEY(turtlpass_GeneratePasswordBatchParams_entries_tag, PB_WT_STRING) ||
+            !readLength(in, value) ||
+            params.entries_count >= pb_arraysize(turtlpass_GeneratePasswordBatchParams, entries)) {
+            return false;
+        }
+        // each entry starts from its defaults
+        turtlpass_GeneratePasswordParams &entry = params.entries[params.entries_count++];
+        memset(&entry, 0, sizeof(entry));
+        if (!decodeGeneratePassword(value, entry)) return false;
+    }
+    return true;
+}
+
+static bool decodeSession(Reader in, turtlpass_SessionParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        if (!readVarint(in, key) || key != KEY(turtlpass_SessionParams_timeout_ms_tag, PB_WT_VARINT) ||
+            !readUint32(in, params.timeout_ms)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool decodeKeyboard(Reader in, turtlpass_KeyboardParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        if (!readVarint(in, key)) return false;
+        bool ok;
+        switch (key) {
+            case KEY(turtlpass_KeyboardParams_layout_tag, PB_WT_VARINT):
+                ok = readUint32(in, params.layout);
+                break;
+            case KEY(turtlpass_KeyboardParams_host_profile_tag, PB_WT_VARINT):
+                ok = readUint32(in, params.host_profile);
+                break;
+            default:
+                return false;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static bool decodeFraming(Reader in, turtlpass_FramingParams &params) {
+    while (in.pos < in.end) {
+        uint32_t key;
+        if (!readVarint(in, key) || key != KEY(turtlpass_FramingParams_framing_tag, PB_WT_VARINT) ||
+            !readUint32(in, params.framing)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Selects a oneof member; switching members zeroes the new one first, as pb_decode() does
+template <typename T>
+static inline T &selectParameters(turtlpass_Command &command, pb_size_t tag, T &member) {
+    if (command.which_parameters != tag) {
+        memset(&member, 0, sizeof(member));
+        command.which_parameters = tag;
+    }
+    return member;
+}
+
+bool decodeCommandFast(const uint8_t *data, size_t length, turtlpass_Command &command) {
+    Reader in = { data, data + length };
+
+    // defaults, field by field like pb_decode(): the union is left to the oneof
+    memset(&command.type, 0, sizeof(command.type));
+    command.which_parameters = 0;
+    command.request_id = 0;
+
+    while (in.pos < in.end) {
+        uint32_t key;
+        Reader value;
+        if (!readVarint(in, key)) return false;
+        bool ok;
+        switch (key) {
+            case KEY(turtlpass_Command_type_tag, PB_WT_VARINT):
+                ok = readUint32(in, command.type);
+                break;
+            case KEY(turtlpass_Command_request_id_tag, PB_WT_VARINT):
+                ok = readUint32(in, command.request_id);
+                break;
+            case KEY(turtlpass_Command_gen_pass_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeGeneratePassword(value,
+                    selectParameters(command, turtlpass_Command_gen_pass_tag, command.parameters.gen_pass));
+                break;
+            case KEY(turtlpass_Command_init_seed_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeInitializeSeed(value,
+                    selectParameters(command, turtlpass_Command_init_seed_tag, command.parameters.init_seed));
+                break;
+            case KEY(turtlpass_Command_session_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeSession(value,
+                    selectParameters(command, turtlpass_Command_session_tag, command.parameters.session));
+                break;
+            case KEY(turtlpass_Command_gen_batch_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeBatch(value,
+                    selectParameters(command, turtlpass_Command_gen_batch_tag, command.parameters.gen_batch));
+                break;
+            case KEY(turtlpass_Command_keyboard_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeKeyboard(value,
+                    selectParameters(command, turtlpass_Command_keyboard_tag, command.parameters.keyboard));
+                break;
+            case KEY(turtlpass_Command_framing_tag, PB_WT_STRING):
+                ok = readLength(in, value) && decodeFraming(value,
+                    selectParameters(command, turtlpass_Command_framing_tag, command.parameters.framing));
+                break;
+            default:
+                return false;  // unknown field, another wire type or a zero tag
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool decodeCommand(const uint8_t *data, size_t length, turtlpass_Command &command) {
+    if (decodeCommandFast(data, length, command)) {
+        return true;
+    }
+    pb_istream_t stream = pb_istream_from_buffer(data, length);
+    return pb_decode(&stream, turtlpass_Command_fields, &command);
+}
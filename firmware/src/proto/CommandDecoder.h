@@ -0,0 +1,39 @@
+#ifndef COMMAND_DECODER_H
+#define COMMAND_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pb.h"
+#include "proto/turtlpass.pb.h"
+
+/**
+ * @brief Decodes a turtlpass_Command, with the same result as pb_decode().
+ *
+ * The fields of Command and its parameter messages are decoded by a switch on
+ * their keys, in one pass over the frame, without walking nanopb's field
+ * descriptors. The schema is checked against the FIELDLISTs of turtlpass.pb.h at
+ * compile time, so a regenerated header with a new or changed field does not
+ * build until the decoder handles it.
+ *
+ * Anything the fast path does not expect (an unknown field, another wire type, a
+ * varint wider than its field, oversized bytes, a malformed frame) hands the
+ * whole frame to pb_decode(), so results and errors stay exactly nanopb's.
+ *
+ * @param data Encoded message.
+ * @param length Number of bytes.
+ * @param command Receives the decoded command.
+ * @return true if decoded, false if the frame is not a valid Command.
+ */
+bool decodeCommand(const uint8_t *data, size_t length, turtlpass_Command &command);
+
+/**
+ * @brief The fast path of decodeCommand() alone, without the pb_decode() fallback.
+ *
+ * @param data Encoded message.
+ * @param length Number of bytes.
+ * @param command Receives the decoded command (undefined on false).
+ * @return true if decoded, false if the frame needs pb_decode().
+ */
+bool decodeCommandFast(const uint8_t *data, size_t length, turtlpass_Command &command);
+
+#endif // COMMAND_DECODER_H
@@ -0,0 +1,101 @@
+#include "proto/FrameCodec.h"
+#include <string.h>
+
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc) {
+    // half-byte table: 32 bytes of flash instead of 512
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF };
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+CobsFrameDecoder::CobsFrameDecoder(uint8_t *buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity), length_(0), messageLength_(0), code_(0), remaining_(0),
+      started_(false), overflow_(false), reported_(false), droppedFrames_(0) {}
+
+CobsFrameDecoder::Result CobsFrameDecoder::feed(const uint8_t *data, size_t len, size_t &used) {
+    for (used = 0; used < len;) {
+        const uint8_t byte = data[used++];
+
+        if (byte == FRAME_DELIMITER) {
+            if (!started_) {
+                continue;  // delimiters between frames (hosts may send one to flush noise)
+            }
+            Result result = finishFrame();
+            if (result != FRAME_NONE) {
+                return result;
+            }
+            continue;
+        }
+
+        started_ = true;
+        if (overflow_) {
+            continue;  // skip to the delimiter
+        }
+        if (remaining_ == 0) {
+            // a new block: the previous one ended with an implied zero unless it was full
+            if (code_ != 0 && code_ != COBS_MAX_RUN + 1) {
+                if (length_ == capacity_) {
+                    overflow_ = true;
+                    continue;
+                }
+                buffer_[length_++] = 0;
+            }
+            code_ = byte;
+            remaining_ = byte - 1;
+            continue;
+        }
+        if (length_ == capacity_) {
+            overflow_ = true;
+            continue;
+        }
+        buffer_[length_++] = byte;
+        remaining_--;
+    }
+    return FRAME_NONE;
+}
+
+CobsFrameDecoder::Result CobsFrameDecoder::finishFrame() {
+    bool ok = !overflow_ && remaining_ == 0 && length_ >= FRAME_CRC_SIZE;
+    if (ok) {
+        const size_t messageLength = length_ - FRAME_CRC_SIZE;
+        const uint16_t crc = (uint16_t)(buffer_[messageLength] | (buffer_[messageLength + 1] << 8));
+        ok = crc16(buffer_, messageLength) == crc;
+    }
+
+    if (ok) {
+        messageLength_ = length_ - FRAME_CRC_SIZE;
+        memset(buffer_ + messageLength_, 0, FRAME_CRC_SIZE);
+        length_ = 0;  // the message stays until release()
+        code_ = 0;
+        started_ = false;
+        reported_ = false;
+        return FRAME_OK;
+    }
+
+    reset();
+    droppedFrames_++;
+    if (reported_) {
+        return FRAME_NONE;  // still resyncing: already reported
+    }
+    reported_ = true;
+    return FRAME_ERROR;
+}
+
+void CobsFrameDecoder::release() {
+    memset(buffer_, 0, messageLength_);
+    messageLength_ = 0;
+}
+
+void CobsFrameDecoder::reset() {
+    memset(buffer_, 0, length_);
+    length_ = 0;
+    code_ = 0;
+    remaining_ = 0;
+    started_ = false;
+    overflow_ = false;
+}
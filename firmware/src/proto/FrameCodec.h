@@ -0,0 +1,193 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FRAME_DELIMITER 0x00  // ends a COBS frame; never occurs inside one
+#define FRAME_CRC_SIZE 2      // CRC-16 after the message, little-endian
+#define COBS_MAX_RUN 254      // data bytes per COBS block
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE of a buffer (poly 0x1021, init 0xFFFF).
+ *
+ * @param data Bytes to check.
+ * @param len Number of bytes.
+ * @param crc CRC so far, to continue over several buffers.
+ * @return The updated CRC.
+ */
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief Encodes one COBS frame from a message streamed in pieces.
+ *
+ * The message is never held whole: each COBS block (at most COBS_MAX_RUN bytes)
+ * is written out as soon as its end is known, so an encoder can stream a
+ * protobuf straight to the serial port.
+ *
+ * @tparam Write Callable taking (const uint8_t *data, size_t len).
+ */
+template <typename Write>
+class CobsFrameEncoder {
+public:
+    /**
+     * @brief Starts a frame.
+     *
+     * @param write Receives the encoded output.
+     */
+    explicit CobsFrameEncoder(Write write) : write_(write), crc_(0xFFFF), length_(1) {}
+
+    /**
+     * @brief Wipes the last block.
+     */
+    ~CobsFrameEncoder() { memset(block_, 0, sizeof(block_)); }
+
+    /**
+     * @brief Appends message bytes.
+     *
+     * @param data Message bytes.
+     * @param len Number of bytes.
+     */
+    void append(const uint8_t *data, size_t len) {
+        crc_ = crc16(data, len, crc_);
+        for (size_t i = 0; i < len; i++) put(data[i]);
+    }
+
+    /**
+     * @brief Appends the CRC-16 and ends the frame with FRAME_DELIMITER.
+     */
+    void finish() {
+        const uint16_t crc = crc_;
+        put((uint8_t)(crc & 0xFF));
+        put((uint8_t)(crc >> 8));
+        writeBlock();
+        const uint8_t delimiter = FRAME_DELIMITER;
+        write_(&delimiter, 1);
+    }
+
+private:
+    void put(uint8_t byte) {
+        if (length_ == COBS_MAX_RUN + 1) {
+            writeBlock();  // full block: no zero implied
+        }
+        if (byte == 0) {
+            writeBlock();  // a short block implies the zero
+            return;
+        }
+        block_[length_++] = byte;
+    }
+
+    void writeBlock() {
+        block_[0] = (uint8_t)length_;
+        write_(block_, length_);
+        length_ = 1;
+    }
+
+    Write write_;
+    uint16_t crc_;
+    size_t length_;                     ///< Code byte + data bytes of the current block
+    uint8_t block_[COBS_MAX_RUN + 1];
+};
+
+/**
+ * @brief Writes a message as one COBS frame: COBS(message + CRC-16) followed by FRAME_DELIMITER.
+ *
+ * @param message Message bytes.
+ * @param len Number of bytes.
+ * @param write Called with each piece of output: write(const uint8_t *data, size_t len).
+ */
+template <typename Write>
+void writeCobsFrame(const uint8_t *message, size_t len, Write write) {
+    CobsFrameEncoder<Write> encoder(write);
+    encoder.append(message, len);
+    encoder.finish();
+}
+
+/**
+ * @brief Reassembles COBS frames from a byte stream and checks their CRC-16.
+ *
+ * Decoding happens in place as bytes arrive. Any damage (a CRC mismatch, a
+ * truncated block, a frame larger than the buffer) drops the frame, and the
+ * decoder is back in sync at the next delimiter. Errors are coalesced: only the
+ * first bad frame after a good one is reported, so line noise costs one error
+ * response, not one per garbage byte.
+ */
+class CobsFrameDecoder {
+public:
+    enum Result : uint8_t {
+        FRAME_NONE = 0,  ///< All bytes consumed, no frame complete
+        FRAME_OK,        ///< A verified message is in the buffer (message()/messageLength())
+        FRAME_ERROR      ///< A frame was dropped; the first since the last good frame
+    };
+
+    /**
+     * @brief Constructs a decoder writing into a buffer.
+     *
+     * @param buffer Receives the decoded message and its CRC (must outlive the decoder).
+     * @param capacity Size of the buffer: largest message + FRAME_CRC_SIZE.
+     */
+    CobsFrameDecoder(uint8_t *buffer, size_t capacity);
+
+    /**
+     * @brief Decodes bytes until a frame completes, is dropped, or the bytes run out.
+     *
+     * After FRAME_OK the message stays in the buffer until the next call; wipe it
+     * with release() once handled.
+     *
+     * @param data Received bytes.
+     * @param len Number of bytes.
+     * @param used Receives the number of bytes consumed.
+     * @return Result of the call.
+     */
+    Result feed(const uint8_t *data, size_t len, size_t &used);
+
+    /**
+     * @brief Decoded message after FRAME_OK.
+     */
+    const uint8_t *message() const { return buffer_; }
+
+    /**
+     * @brief Length of the decoded message after FRAME_OK.
+     */
+    size_t messageLength() const { return messageLength_; }
+
+    /**
+     * @brief Wipes the bytes of the last message.
+     */
+    void release();
+
+    /**
+     * @brief Drops a partial frame (wiped) and starts over without reporting it.
+     */
+    void reset();
+
+    /**
+     * @brief Whether bytes of an unfinished frame were received.
+     */
+    bool inFrame() const { return started_; }
+
+    /**
+     * @brief Frames dropped so far, reported or not.
+     */
+    uint32_t droppedFrames() const { return droppedFrames_; }
+
+private:
+    /**
+     * @brief Ends the current frame at a delimiter.
+     */
+    Result finishFrame();
+
+    uint8_t *buffer_;
+    size_t capacity_;
+    size_t length_;          ///< Decoded bytes of the current frame
+    size_t messageLength_;   ///< Length of the last verified message
+    uint8_t code_;           ///< Code of the current block (0 = no block yet)
+    uint8_t remaining_;      ///< Data bytes left in the current block
+    bool started_;           ///< Bytes received since the last delimiter
+    bool overflow_;          ///< The current frame does not fit: dropped at the delimiter
+    bool reported_;          ///< An error was reported since the last good frame
+    uint32_t droppedFrames_;
+};
+
+#endif // FRAME_CODEC_H
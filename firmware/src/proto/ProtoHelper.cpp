@@ -1,85 +1,283 @@
 #include "proto/ProtoHelper.h"
+#include "proto/FrameCodec.h"
+#include "system/SystemInfo.h"
+#include "Crypto.h"
 
+#define RESPONSE_STAGE_SIZE 32  // Small encoder writes are gathered before reaching the CDC FIFO
+
+// Success, one error reply per code, and device info with its own success field and header
+#define CONSTANT_RESPONSES_SIZE (2 + 2 * _turtlpass_ErrorCode_ARRAYSIZE + 2 + 3 + turtlpass_DeviceInfo_size)
+
+static turtlpass_Framing framing = turtlpass_Framing_LENGTH_PREFIXED;
+
+turtlpass_Framing protoFraming() {
+    return framing;
+}
+
+void setProtoFraming(turtlpass_Framing newFraming) {
+    framing = newFraming;
+}
+
+static bool encodeData(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+    const ProtoBytes *data = static_cast<const ProtoBytes *>(*arg);
+    if (data == nullptr || data->size == 0) {
+        return true;  // an empty bytes field is not sent, as before
+    }
+    return pb_encode_tag_for_field(stream, field) && pb_encode_string(stream, data->bytes, data->size);
+}
+
+void setResponseData(turtlpass_Response &response, const ProtoBytes &data) {
+    response.data.funcs.encode = encodeData;
+    response.data.arg = const_cast<ProtoBytes *>(&data);
+}
+
+// Serial output of one frame: tags and varints are gathered, large fields go straight through
+struct SerialStage {
+    uint8_t bytes[RESPONSE_STAGE_SIZE];
+    size_t length;
+
+    void write(const uint8_t *data, size_t len) {
+        if (length + len > sizeof(bytes)) {
+            flush();
+        }
+        if (len >= sizeof(bytes)) {
+            Serial.write(data, len);
+            return;
+        }
+        memcpy(bytes + length, data, len);
+        length += len;
+    }
+
+    void flush() {
+        Serial.write(bytes, length);
+        clean(bytes, length);  // may hold part of a password
+        length = 0;
+    }
+};
+
+struct StageWrite {
+    SerialStage *stage;
+    void operator()(const uint8_t *data, size_t len) const { stage->write(data, len); }
+};
+
+static bool writeStage(pb_ostream_t *stream, const pb_byte_t *buf, size_t count) {
+    static_cast<SerialStage *>(stream->state)->write(buf, count);
+    return true;
+}
+
+static bool writeCobs(pb_ostream_t *stream, const pb_byte_t *buf, size_t count) {
+    static_cast<CobsFrameEncoder<StageWrite> *>(stream->state)->append(buf, count);
+    return true;
+}
+
+// Writes one message to a stream: run once to size it, once to send it
+typedef bool (*MessageWriter)(pb_ostream_t *stream, const void *message);
+
+static bool encodeResponse(pb_ostream_t *stream, const void *message) {
+    return pb_encode(stream, turtlpass_Response_fields, static_cast<const turtlpass_Response *>(message));
+}
+
+// 2-byte length prefix, then the message
+static void streamLengthPrefixed(MessageWriter writer, const void *message, size_t size, SerialStage &stage) {
+    const uint8_t prefix[2] = { (uint8_t)(size & 0xFF), (uint8_t)((size >> 8) & 0xFF) };
+    stage.write(prefix, sizeof(prefix));
+
+    pb_ostream_t stream = PB_OSTREAM_SIZING;
+    stream.callback = writeStage;
+    stream.state = &stage;
+    stream.max_size = size;
+    if (!writer(&stream, message)) {
+        // cannot happen after the sizing pass; pad so the host stays in step (and rejects it)
+        const uint8_t zero = 0;
+        while (stream.bytes_written++ < size) stage.write(&zero, 1);
+    }
+}
+
+// COBS(message + CRC-16) + delimiter; kept out of line so only this framing pays for the COBS block
+__attribute__((noinline))
+static void streamCobs(MessageWriter writer, const void *message, size_t size, SerialStage &stage) {
+    CobsFrameEncoder<StageWrite> encoder(StageWrite{ &stage });
+
+    pb_ostream_t stream = PB_OSTREAM_SIZING;
+    stream.callback = writeCobs;
+    stream.state = &encoder;
+    stream.max_size = size;
+    if (writer(&stream, message)) {
+        encoder.finish();
+    } else {
+        const uint8_t delimiter = FRAME_DELIMITER;
+        stage.write(&delimiter, 1);  // no CRC: the host drops the partial frame
+    }
+}
+
+// Writes a message straight to Serial in the current framing, as one transfer.
+// The sizing pass fails before anything is written if the message cannot be encoded.
+static bool streamMessage(MessageWriter writer, const void *message, const char *&error) {
+    pb_ostream_t sizing = PB_OSTREAM_SIZING;  // what pb_get_encoded_size() does, keeping the error
+    if (!writer(&sizing, message)) {
+        error = PB_GET_ERROR(&sizing);
+        return false;
+    }
+    if (sizing.bytes_written > 0xFFFF) {
+        error = "too long for the length prefix";
+        return false;
+    }
+
+    SerialStage stage;
+    stage.length = 0;
+    if (framing == turtlpass_Framing_COBS_CRC16) {
+        streamCobs(writer, message, sizing.bytes_written, stage);
+    } else {
+        streamLengthPrefixed(writer, message, sizing.bytes_written, stage);
+    }
+    stage.flush();
+    Serial.flush();  // the whole reply is in the CDC FIFO: send it now
+    return true;
+}
+
+
+// ---------------- Constant responses ----------------
+
+// A reply encoded by initConstantResponses(), without its request_id
+struct EncodedResponse {
+    const uint8_t *bytes;  // nullptr until encoded
+    size_t length;
+};
+
+struct ConstantReply {
+    const EncodedResponse *encoded;
+    uint32_t requestId;
+};
+
+static uint8_t constantBytes[CONSTANT_RESPONSES_SIZE];
+static size_t constantBytesUsed = 0;
+static EncodedResponse successReply = { nullptr, 0 };
+static EncodedResponse errorReplies[_turtlpass_ErrorCode_ARRAYSIZE] = {};
+static EncodedResponse deviceInfoReply = { nullptr, 0 };
+
+// request_id (field 6) is the last field these replies carry, so appending it
+// yields exactly what pb_encode() would
+static bool writeConstant(pb_ostream_t *stream, const void *message) {
+    const ConstantReply *reply = static_cast<const ConstantReply *>(message);
+    if (!pb_write(stream, reply->encoded->bytes, reply->encoded->length)) {
+        return false;
+    }
+    return reply->requestId == 0 ||
+           (pb_encode_tag(stream, PB_WT_VARINT, turtlpass_Response_request_id_tag) &&
+            pb_encode_varint(stream, reply->requestId));
+}
+
+static void preencode(const turtlpass_Response &response, EncodedResponse &encoded) {
+    pb_ostream_t stream = pb_ostream_from_buffer(constantBytes + constantBytesUsed,
+                                                 sizeof(constantBytes) - constantBytesUsed);
+    if (pb_encode(&stream, turtlpass_Response_fields, &response)) {
+        encoded.bytes = constantBytes + constantBytesUsed;
+        encoded.length = stream.bytes_written;
+        constantBytesUsed += stream.bytes_written;
+    }
+}
+
+// Sends a pre-encoded reply; false if it was not encoded (sent live instead)
+static bool sendConstantResponse(const EncodedResponse &encoded, uint32_t requestId) {
+    if (encoded.bytes == nullptr) {
+        return false;
+    }
+    const ConstantReply reply = { &encoded, requestId };
+    const char *err = nullptr;
+    return streamMessage(writeConstant, &reply, err);
+}
+
+void initConstantResponses() {
+    constantBytesUsed = 0;
 
-void sendSuccessResponse() {
     turtlpass_Response response = turtlpass_Response_init_zero;
     response.success = true;
+    preencode(response, successReply);
+
+    for (int error = _turtlpass_ErrorCode_MIN; error <= _turtlpass_ErrorCode_MAX; error++) {
+        response = turtlpass_Response_init_zero;
+        response.error = (turtlpass_ErrorCode)error;
+        preencode(response, errorReplies[error]);
+    }
+
+    response = turtlpass_Response_init_zero;
+    deviceInfo(response);
+    preencode(response, deviceInfoReply);
+}
+
+void sendDeviceInfoResponse(uint32_t requestId) {
+    if (sendConstantResponse(deviceInfoReply, requestId)) {
+        return;
+    }
+    turtlpass_Response response = turtlpass_Response_init_zero;
+    deviceInfo(response);
+    response.request_id = requestId;
+    sendProtoResponse(response);
+}
+
+void sendSuccessResponse(uint32_t requestId) {
+    if (sendConstantResponse(successReply, requestId)) {
+        return;
+    }
+    turtlpass_Response response = turtlpass_Response_init_zero;
+    response.request_id = requestId;
+    response.success = true;
     response.error = turtlpass_ErrorCode_NONE;
     sendProtoResponse(response);
 }
 
-void sendSuccessBytesResponse(uint8_t* data, const uint16_t length) {
+void sendSuccessBytesResponse(uint8_t* data, const uint16_t length, uint32_t requestId) {
     turtlpass_Response response = turtlpass_Response_init_zero;
+    response.request_id = requestId;
     response.success = true;
     response.error = turtlpass_ErrorCode_NONE;
-    response.data.size = length;
-    memcpy(response.data.bytes, data, length);
+    const ProtoBytes bytes = { data, length };
+    setResponseData(response, bytes);
     sendProtoResponse(response);
 }
 
-void sendErrorResponse(const turtlpass_ErrorCode error) {
+void sendErrorResponse(const turtlpass_ErrorCode error, uint32_t requestId) {
+    if (error >= _turtlpass_ErrorCode_MIN && error <= _turtlpass_ErrorCode_MAX &&
+        sendConstantResponse(errorReplies[error], requestId)) {
+        return;
+    }
     turtlpass_Response response = turtlpass_Response_init_zero;
+    response.request_id = requestId;
     response.success = false;
     response.error = error;
     sendProtoResponse(response);
 }
 
-void sendErrorMessageResponse(const turtlpass_ErrorCode error, const char* msg) {
+void sendErrorMessageResponse(const turtlpass_ErrorCode error, const char* msg, uint32_t requestId) {
     turtlpass_Response response = turtlpass_Response_init_zero;
+    response.request_id = requestId;
     response.success = false;
     response.error = error;
-
-    size_t msg_len = strlen(msg);
-    if (msg_len > sizeof(response.data.bytes)) {
-        msg_len = sizeof(response.data.bytes);
-    }
-    memcpy(response.data.bytes, msg, msg_len);
-    response.data.size = msg_len;
-
-    if (response.data.size > sizeof(response.data.bytes)) {
-        response.data.size = sizeof(response.data.bytes);
-        // add truncation marker
-        const char *trunc = "...";
-        size_t trunc_len = strlen(trunc);
-        if (response.data.size > trunc_len) {
-            memcpy(response.data.bytes + response.data.size - trunc_len, trunc, trunc_len);
-        }
-    }
+    const ProtoBytes bytes = { reinterpret_cast<const uint8_t*>(msg), strnlen(msg, RESPONSE_DATA_MAX_SIZE) };
+    setResponseData(response, bytes);
     sendProtoResponse(response);
 }
 
 void sendProtoResponse(const turtlpass_Response &response) {
-    uint8_t buffer[1024];  // Enough for 512 bytes data + overhead
-    pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+    const char *err = nullptr;
+    if (streamMessage(encodeResponse, &response, err)) {
+        return;
+    }
 
-    if (pb_encode(&stream, turtlpass_Response_fields, &response)) {
-        // --- Success: send normally ---
-        // Send 2-byte length prefix
-        Serial.write((uint8_t)(stream.bytes_written & 0xFF));
-        Serial.write((uint8_t)((stream.bytes_written >> 8) & 0xFF));
-        // Send encoded protobuf bytes
-        Serial.write(buffer, stream.bytes_written);
-    } else {
-        // --- Failure: report encoding error back as a structured Response ---
-        turtlpass_Response error_response = turtlpass_Response_init_zero;
-        error_response.success = false;
-        error_response.error = turtlpass_ErrorCode_PROTO_ENCODING_FAILED;
-
-        const char *err = PB_GET_ERROR(&stream);
-        snprintf((char *)buffer, sizeof(buffer), "Encoding failed: %s", err ? err : "unknown");
-
-        error_response.data.size = strlen((char *)buffer);
-        memcpy(error_response.data.bytes, buffer, error_response.data.size);
-
-        pb_ostream_t err_stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
-        if (pb_encode(&err_stream, turtlpass_Response_fields, &error_response)) {
-            Serial.write((uint8_t)(err_stream.bytes_written & 0xFF));
-            Serial.write((uint8_t)((err_stream.bytes_written >> 8) & 0xFF));
-            Serial.write(buffer, err_stream.bytes_written);
-        } else {
-            // Worst case fallback — print to debug serial
-            Serial.print("❌ sendProtoResponse: DOUBLE encoding failure: ");
-            Serial.println(PB_GET_ERROR(&err_stream));
-        }
+    // --- Failure: report encoding error back as a structured Response ---
+    turtlpass_Response error_response = turtlpass_Response_init_zero;
+    error_response.success = false;
+    error_response.error = turtlpass_ErrorCode_PROTO_ENCODING_FAILED;
+    error_response.request_id = response.request_id;
+
+    char message[64];
+    snprintf(message, sizeof(message), "Encoding failed: %s", err ? err : "unknown");
+    const ProtoBytes bytes = { reinterpret_cast<const uint8_t*>(message), strlen(message) };
+    setResponseData(error_response, bytes);
+
+    if (!streamMessage(encodeResponse, &error_response, err)) {
+        // Worst case fallback — print to debug serial
+        Serial.print("❌ sendProtoResponse: DOUBLE encoding failure: ");
+        Serial.println(err ? err : "unknown");
     }
 }
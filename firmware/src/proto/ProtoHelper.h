@@ -7,11 +7,33 @@
 #include "pb_decode.h"
 #include "proto/turtlpass.pb.h"
 
+// Serial framing of both directions (LENGTH_PREFIXED after power-up); set by SET_FRAMING
+turtlpass_Framing protoFraming();
+void setProtoFraming(turtlpass_Framing framing);
 
-void sendSuccessResponse();
-void sendSuccessBytesResponse(uint8_t* data, const uint16_t length);
-void sendErrorResponse(const turtlpass_ErrorCode error);
-void sendErrorMessageResponse(const turtlpass_ErrorCode error, const char* msg);
+
+#define RESPONSE_DATA_MAX_SIZE 512  // Longest Response.data hosts accept
+
+// Bytes for Response.data; they stay with the caller and must outlive sendProtoResponse()
+struct ProtoBytes {
+    const uint8_t *bytes;
+    size_t size;
+};
+
+// Points response.data at data: the bytes are streamed by the encoder, never copied
+void setResponseData(turtlpass_Response &response, const ProtoBytes &data);
+
+
+// Encodes the replies without variable fields (success, each error code, device info) once, at boot
+void initConstantResponses();
+
+
+// requestId: request_id of the command being answered (0 for in-order/lockstep hosts)
+void sendSuccessResponse(uint32_t requestId = 0);
+void sendSuccessBytesResponse(uint8_t* data, const uint16_t length, uint32_t requestId = 0);
+void sendErrorResponse(const turtlpass_ErrorCode error, uint32_t requestId = 0);
+void sendDeviceInfoResponse(uint32_t requestId = 0);
+void sendErrorMessageResponse(const turtlpass_ErrorCode error, const char* msg, uint32_t requestId = 0);
 void sendProtoResponse(const turtlpass_Response &response);
 
 #endif // PROTO_HELPER_H
@@ -12,10 +12,28 @@ PB_BIND(turtlpass_GeneratePasswordParams, turtlpass_GeneratePasswordParams, AUTO
 PB_BIND(turtlpass_InitializeSeedParams, turtlpass_InitializeSeedParams, AUTO)
 
 
+PB_BIND(turtlpass_GeneratePasswordBatchParams, turtlpass_GeneratePasswordBatchParams, 2)
+
+
+PB_BIND(turtlpass_SessionParams, turtlpass_SessionParams, AUTO)
+
+
+PB_BIND(turtlpass_KeyboardParams, turtlpass_KeyboardParams, AUTO)
+
+
+PB_BIND(turtlpass_FramingParams, turtlpass_FramingParams, AUTO)
+
+
 PB_BIND(turtlpass_DeviceInfo, turtlpass_DeviceInfo, AUTO)
 
 
-PB_BIND(turtlpass_Command, turtlpass_Command, AUTO)
+PB_BIND(turtlpass_SessionState, turtlpass_SessionState, AUTO)
+
+
+PB_BIND(turtlpass_PasswordBatchChunk, turtlpass_PasswordBatchChunk, AUTO)
+
+
+PB_BIND(turtlpass_Command, turtlpass_Command, 2)
 
 
 PB_BIND(turtlpass_Response, turtlpass_Response, 2)
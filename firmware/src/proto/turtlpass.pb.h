@@ -16,7 +16,14 @@ typedef enum _turtlpass_CommandType {
     turtlpass_CommandType_GET_DEVICE_INFO = 1, /* Returns version, seed state, etc. */
     turtlpass_CommandType_INITIALIZE_SEED = 2, /* Store seed for password derivation */
     turtlpass_CommandType_GENERATE_PASSWORD = 3, /* Derives a password based on parameters */
-    turtlpass_CommandType_FACTORY_RESET = 4 /* Resets device to default state (no seeds) */
+    turtlpass_CommandType_FACTORY_RESET = 4, /* Resets device to default state (no seeds) */
+    turtlpass_CommandType_SET_SESSION_TIMEOUT = 5, /* Sets the unlocked-seed session idle timeout (0 = disabled) */
+    turtlpass_CommandType_GET_SESSION_STATE = 6, /* Returns the unlocked-seed session state */
+    turtlpass_CommandType_LOCK_SESSION = 7, /* Wipes the unlocked seed immediately */
+    turtlpass_CommandType_GENERATE_PASSWORD_BATCH = 8, /* Derives several passwords, returned after a touch */
+    turtlpass_CommandType_SET_KEYBOARD_LAYOUT = 9, /* Selects the host keyboard layout and timing profile used for typing */
+    turtlpass_CommandType_CALIBRATE_KEYBOARD = 10, /* Measures and stores the typing timing of a host profile */
+    turtlpass_CommandType_SET_FRAMING = 11 /* Switches the serial framing after the reply */
 } turtlpass_CommandType;
 
 /* Character set options for password generation */
@@ -27,6 +34,27 @@ typedef enum _turtlpass_Charset {
     turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS = 3
 } turtlpass_Charset;
 
+/* What happens to a generated password */
+typedef enum _turtlpass_PasswordDelivery {
+    turtlpass_PasswordDelivery_TYPE_ON_TOUCH = 0, /* Typed over HID on the next touch (default) */
+    turtlpass_PasswordDelivery_RETURN_ON_TOUCH = 1 /* Returned in Response.data after a touch, never typed */
+} turtlpass_PasswordDelivery;
+
+/* Host keyboard layouts the device can type for */
+typedef enum _turtlpass_KeyboardLayout {
+    turtlpass_KeyboardLayout_US = 0, /* US QWERTY (default) */
+    turtlpass_KeyboardLayout_UK = 1, /* UK QWERTY */
+    turtlpass_KeyboardLayout_DE = 2, /* German QWERTZ */
+    turtlpass_KeyboardLayout_FR = 3, /* French AZERTY */
+    turtlpass_KeyboardLayout_DVORAK = 4 /* US Dvorak */
+} turtlpass_KeyboardLayout;
+
+/* Serial frame formats */
+typedef enum _turtlpass_Framing {
+    turtlpass_Framing_LENGTH_PREFIXED = 0, /* 2-byte little-endian length, then the message (default) */
+    turtlpass_Framing_COBS_CRC16 = 1 /* COBS-encoded message + CRC-16, terminated by a 0x00 delimiter */
+} turtlpass_Framing;
+
 /* Error codes for responses */
 typedef enum _turtlpass_ErrorCode {
     turtlpass_ErrorCode_NONE = 0, /* No error */
@@ -49,6 +77,7 @@ typedef struct _turtlpass_GeneratePasswordParams {
     turtlpass_GeneratePasswordParams_entropy_t entropy; /* Entropy source (1–64 bytes) */
     uint32_t length; /* Desired password length (default: 100 chars) */
     turtlpass_Charset charset; /* Character set to use (default: LETTERS_NUMBERS) */
+    turtlpass_PasswordDelivery delivery; /* Type or return the password (ignored in batches, always returned) */
 } turtlpass_GeneratePasswordParams;
 
 typedef PB_BYTES_ARRAY_T(64) turtlpass_InitializeSeedParams_seed_t;
@@ -57,7 +86,30 @@ typedef struct _turtlpass_InitializeSeedParams {
     turtlpass_InitializeSeedParams_seed_t seed; /* Seed data to store securely in emulated EEPROM */
 } turtlpass_InitializeSeedParams;
 
+/* Parameters for batch password generation */
+typedef struct _turtlpass_GeneratePasswordBatchParams {
+    pb_size_t entries_count;
+    turtlpass_GeneratePasswordParams entries[16]; /* One entry per password (1–16) */
+} turtlpass_GeneratePasswordBatchParams;
+
+/* Parameters for the unlocked-seed session */
+typedef struct _turtlpass_SessionParams {
+    uint32_t timeout_ms; /* Idle timeout in milliseconds (0 = sessions disabled) */
+} turtlpass_SessionParams;
+
+/* Parameters for SET_KEYBOARD_LAYOUT and CALIBRATE_KEYBOARD */
+typedef struct _turtlpass_KeyboardParams {
+    turtlpass_KeyboardLayout layout; /* Layout of the host the passwords are typed into */
+    uint32_t host_profile; /* Stored typing timing to use (0-3) */
+} turtlpass_KeyboardParams;
+
+/* Parameters for SET_FRAMING */
+typedef struct _turtlpass_FramingParams {
+    turtlpass_Framing framing; /* Frame format used from the next frame on */
+} turtlpass_FramingParams;
+
 typedef PB_BYTES_ARRAY_T(16) turtlpass_DeviceInfo_unique_board_id_t;
+typedef PB_BYTES_ARRAY_T(16) turtlpass_DeviceInfo_info_hash_t;
 typedef struct _turtlpass_DeviceInfo {
     char turtlpass_version[32]; /* e.g., "3.0.0" */
     char arduino_version[16]; /* e.g., "10810" */
@@ -65,8 +117,26 @@ typedef struct _turtlpass_DeviceInfo {
     char nanopb_version[32]; /* e.g., "nanopb-1.0.0" */
     char board_name[32]; /* e.g., "pico" */
     turtlpass_DeviceInfo_unique_board_id_t unique_board_id; /* 16-byte unique MCU identifier */
+    turtlpass_DeviceInfo_info_hash_t info_hash; /* First 16 bytes of SHA-512 over fields 1-6 as encoded; a cache key for this reply */
 } turtlpass_DeviceInfo;
 
+/* Unlocked-seed session state */
+typedef struct _turtlpass_SessionState {
+    bool enabled; /* True if sessions are enabled (timeout_ms > 0) */
+    bool unlocked; /* True if a seed is currently held in RAM */
+    uint32_t slot; /* Unlocked slot (1–9), 0 if locked */
+    uint32_t timeout_ms; /* Configured idle timeout */
+    uint32_t remaining_ms; /* Time left before the session locks */
+} turtlpass_SessionState;
+
+/* One chunk of batch results; the passwords are in Response.data, each followed by a NUL byte */
+typedef struct _turtlpass_PasswordBatchChunk {
+    uint32_t first_index; /* Index of the first password in this chunk */
+    uint32_t count; /* Number of passwords in this chunk */
+    uint32_t total; /* Number of entries in the batch */
+    bool complete; /* True on the last chunk */
+} turtlpass_PasswordBatchChunk;
+
 /* Main command sent from host to MCU */
 typedef struct _turtlpass_Command {
     turtlpass_CommandType type;
@@ -74,17 +144,26 @@ typedef struct _turtlpass_Command {
     union {
         turtlpass_GeneratePasswordParams gen_pass;
         turtlpass_InitializeSeedParams init_seed;
+        turtlpass_SessionParams session;
+        turtlpass_GeneratePasswordBatchParams gen_batch;
+        turtlpass_KeyboardParams keyboard;
+        turtlpass_FramingParams framing;
     } parameters;
+    uint32_t request_id; /* Host-chosen tag echoed in the response (0 = in-order, lockstep) */
 } turtlpass_Command;
 
-typedef PB_BYTES_ARRAY_T(512) turtlpass_Response_data_t;
 /* Response sent from MCU to host */
 typedef struct _turtlpass_Response {
     bool success; /* True if command succeeded */
     turtlpass_ErrorCode error; /* Error code (NONE if success=true) */
     bool has_device_info;
     turtlpass_DeviceInfo device_info; /* Structured info for GET_DEVICE_INFO */
-    turtlpass_Response_data_t data; /* Optional command-specific data */
+    pb_callback_t data; /* Optional command-specific data */
+    bool has_session_state;
+    turtlpass_SessionState session_state; /* Structured state for session commands */
+    uint32_t request_id; /* request_id of the command being answered */
+    bool has_batch;
+    turtlpass_PasswordBatchChunk batch; /* Chunk header for GENERATE_PASSWORD_BATCH */
 } turtlpass_Response;
 
 
@@ -94,20 +173,37 @@ extern "C" {
 
 /* Helper constants for enums */
 #define _turtlpass_CommandType_MIN turtlpass_CommandType_UNKNOWN
-#define _turtlpass_CommandType_MAX turtlpass_CommandType_FACTORY_RESET
-#define _turtlpass_CommandType_ARRAYSIZE ((turtlpass_CommandType)(turtlpass_CommandType_FACTORY_RESET+1))
+#define _turtlpass_CommandType_MAX turtlpass_CommandType_SET_FRAMING
+#define _turtlpass_CommandType_ARRAYSIZE ((turtlpass_CommandType)(turtlpass_CommandType_SET_FRAMING+1))
 
 #define _turtlpass_Charset_MIN turtlpass_Charset_LETTERS_ONLY
 #define _turtlpass_Charset_MAX turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS
 #define _turtlpass_Charset_ARRAYSIZE ((turtlpass_Charset)(turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS+1))
 
+#define _turtlpass_PasswordDelivery_MIN turtlpass_PasswordDelivery_TYPE_ON_TOUCH
+#define _turtlpass_PasswordDelivery_MAX turtlpass_PasswordDelivery_RETURN_ON_TOUCH
+#define _turtlpass_PasswordDelivery_ARRAYSIZE ((turtlpass_PasswordDelivery)(turtlpass_PasswordDelivery_RETURN_ON_TOUCH+1))
+
+#define _turtlpass_KeyboardLayout_MIN turtlpass_KeyboardLayout_US
+#define _turtlpass_KeyboardLayout_MAX turtlpass_KeyboardLayout_DVORAK
+#define _turtlpass_KeyboardLayout_ARRAYSIZE ((turtlpass_KeyboardLayout)(turtlpass_KeyboardLayout_DVORAK+1))
+
+#define _turtlpass_Framing_MIN turtlpass_Framing_LENGTH_PREFIXED
+#define _turtlpass_Framing_MAX turtlpass_Framing_COBS_CRC16
+#define _turtlpass_Framing_ARRAYSIZE ((turtlpass_Framing)(turtlpass_Framing_COBS_CRC16+1))
+
 #define _turtlpass_ErrorCode_MIN turtlpass_ErrorCode_NONE
 #define _turtlpass_ErrorCode_MAX turtlpass_ErrorCode_INTERNAL_ERROR
 #define _turtlpass_ErrorCode_ARRAYSIZE ((turtlpass_ErrorCode)(turtlpass_ErrorCode_INTERNAL_ERROR+1))
 
 #define turtlpass_GeneratePasswordParams_charset_ENUMTYPE turtlpass_Charset
+#define turtlpass_GeneratePasswordParams_delivery_ENUMTYPE turtlpass_PasswordDelivery
+
 
 
+#define turtlpass_KeyboardParams_layout_ENUMTYPE turtlpass_KeyboardLayout
+
+#define turtlpass_FramingParams_framing_ENUMTYPE turtlpass_Framing
 
 #define turtlpass_Command_type_ENUMTYPE turtlpass_CommandType
 
@@ -115,41 +211,78 @@ extern "C" {
 
 
 /* Initializer values for message structs */
-#define turtlpass_GeneratePasswordParams_init_default {{0, {0}}, 0, _turtlpass_Charset_MIN}
+#define turtlpass_GeneratePasswordParams_init_default {{0, {0}}, 0, _turtlpass_Charset_MIN, _turtlpass_PasswordDelivery_MIN}
 #define turtlpass_InitializeSeedParams_init_default {{0, {0}}}
-#define turtlpass_DeviceInfo_init_default        {"", "", "", "", "", {0, {0}}}
-#define turtlpass_Command_init_default           {_turtlpass_CommandType_MIN, 0, {turtlpass_GeneratePasswordParams_init_default}}
-#define turtlpass_Response_init_default          {0, _turtlpass_ErrorCode_MIN, false, turtlpass_DeviceInfo_init_default, {0, {0}}}
-#define turtlpass_GeneratePasswordParams_init_zero {{0, {0}}, 0, _turtlpass_Charset_MIN}
+#define turtlpass_GeneratePasswordBatchParams_init_default {0, {turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default, turtlpass_GeneratePasswordParams_init_default}}
+#define turtlpass_SessionParams_init_default     {0}
+#define turtlpass_KeyboardParams_init_default    {_turtlpass_KeyboardLayout_MIN, 0}
+#define turtlpass_FramingParams_init_default     {_turtlpass_Framing_MIN}
+#define turtlpass_DeviceInfo_init_default        {"", "", "", "", "", {0, {0}}, {0, {0}}}
+#define turtlpass_SessionState_init_default      {0, 0, 0, 0, 0}
+#define turtlpass_PasswordBatchChunk_init_default {0, 0, 0, 0}
+#define turtlpass_Command_init_default           {_turtlpass_CommandType_MIN, 0, {turtlpass_GeneratePasswordParams_init_default}, 0}
+#define turtlpass_Response_init_default          {0, _turtlpass_ErrorCode_MIN, false, turtlpass_DeviceInfo_init_default, {{NULL}, NULL}, false, turtlpass_SessionState_init_default, 0, false, turtlpass_PasswordBatchChunk_init_default}
+#define turtlpass_GeneratePasswordParams_init_zero {{0, {0}}, 0, _turtlpass_Charset_MIN, _turtlpass_PasswordDelivery_MIN}
 #define turtlpass_InitializeSeedParams_init_zero {{0, {0}}}
-#define turtlpass_DeviceInfo_init_zero           {"", "", "", "", "", {0, {0}}}
-#define turtlpass_Command_init_zero              {_turtlpass_CommandType_MIN, 0, {turtlpass_GeneratePasswordParams_init_zero}}
-#define turtlpass_Response_init_zero             {0, _turtlpass_ErrorCode_MIN, false, turtlpass_DeviceInfo_init_zero, {0, {0}}}
+#define turtlpass_GeneratePasswordBatchParams_init_zero {0, {turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero, turtlpass_GeneratePasswordParams_init_zero}}
+#define turtlpass_SessionParams_init_zero        {0}
+#define turtlpass_KeyboardParams_init_zero       {_turtlpass_KeyboardLayout_MIN, 0}
+#define turtlpass_FramingParams_init_zero        {_turtlpass_Framing_MIN}
+#define turtlpass_DeviceInfo_init_zero           {"", "", "", "", "", {0, {0}}, {0, {0}}}
+#define turtlpass_SessionState_init_zero         {0, 0, 0, 0, 0}
+#define turtlpass_PasswordBatchChunk_init_zero   {0, 0, 0, 0}
+#define turtlpass_Command_init_zero              {_turtlpass_CommandType_MIN, 0, {turtlpass_GeneratePasswordParams_init_zero}, 0}
+#define turtlpass_Response_init_zero             {0, _turtlpass_ErrorCode_MIN, false, turtlpass_DeviceInfo_init_zero, {{NULL}, NULL}, false, turtlpass_SessionState_init_zero, 0, false, turtlpass_PasswordBatchChunk_init_zero}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define turtlpass_GeneratePasswordParams_entropy_tag 1
 #define turtlpass_GeneratePasswordParams_length_tag 2
 #define turtlpass_GeneratePasswordParams_charset_tag 3
+#define turtlpass_GeneratePasswordParams_delivery_tag 4
 #define turtlpass_InitializeSeedParams_seed_tag  1
+#define turtlpass_GeneratePasswordBatchParams_entries_tag 1
+#define turtlpass_SessionParams_timeout_ms_tag   1
+#define turtlpass_KeyboardParams_layout_tag      1
+#define turtlpass_KeyboardParams_host_profile_tag 2
+#define turtlpass_FramingParams_framing_tag      1
 #define turtlpass_DeviceInfo_turtlpass_version_tag 1
 #define turtlpass_DeviceInfo_arduino_version_tag 2
 #define turtlpass_DeviceInfo_compiler_version_tag 3
 #define turtlpass_DeviceInfo_nanopb_version_tag  4
 #define turtlpass_DeviceInfo_board_name_tag      5
 #define turtlpass_DeviceInfo_unique_board_id_tag 6
+#define turtlpass_DeviceInfo_info_hash_tag       7
+#define turtlpass_SessionState_enabled_tag       1
+#define turtlpass_SessionState_unlocked_tag      2
+#define turtlpass_SessionState_slot_tag          3
+#define turtlpass_SessionState_timeout_ms_tag    4
+#define turtlpass_SessionState_remaining_ms_tag  5
+#define turtlpass_PasswordBatchChunk_first_index_tag 1
+#define turtlpass_PasswordBatchChunk_count_tag   2
+#define turtlpass_PasswordBatchChunk_total_tag   3
+#define turtlpass_PasswordBatchChunk_complete_tag 4
 #define turtlpass_Command_type_tag               1
 #define turtlpass_Command_gen_pass_tag           2
 #define turtlpass_Command_init_seed_tag          3
+#define turtlpass_Command_session_tag            4
+#define turtlpass_Command_request_id_tag         5
+#define turtlpass_Command_gen_batch_tag          6
+#define turtlpass_Command_keyboard_tag           7
+#define turtlpass_Command_framing_tag            8
 #define turtlpass_Response_success_tag           1
 #define turtlpass_Response_error_tag             2
 #define turtlpass_Response_device_info_tag       3
 #define turtlpass_Response_data_tag              4
+#define turtlpass_Response_session_state_tag     5
+#define turtlpass_Response_request_id_tag        6
+#define turtlpass_Response_batch_tag             7
 
 /* Struct field encoding specification for nanopb */
 #define turtlpass_GeneratePasswordParams_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, BYTES,    entropy,           1) \
 X(a, STATIC,   SINGULAR, UINT32,   length,            2) \
-X(a, STATIC,   SINGULAR, UENUM,    charset,           3)
+X(a, STATIC,   SINGULAR, UENUM,    charset,           3) \
+X(a, STATIC,   SINGULAR, UENUM,    delivery,          4)
 #define turtlpass_GeneratePasswordParams_CALLBACK NULL
 #define turtlpass_GeneratePasswordParams_DEFAULT NULL
 
@@ -158,54 +291,126 @@ X(a, STATIC,   SINGULAR, BYTES,    seed,              1)
 #define turtlpass_InitializeSeedParams_CALLBACK NULL
 #define turtlpass_InitializeSeedParams_DEFAULT NULL
 
+#define turtlpass_GeneratePasswordBatchParams_FIELDLIST(X, a) \
+X(a, STATIC,   REPEATED, MESSAGE,  entries,           1)
+#define turtlpass_GeneratePasswordBatchParams_CALLBACK NULL
+#define turtlpass_GeneratePasswordBatchParams_DEFAULT NULL
+#define turtlpass_GeneratePasswordBatchParams_entries_MSGTYPE turtlpass_GeneratePasswordParams
+
+#define turtlpass_SessionParams_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT32,   timeout_ms,        1)
+#define turtlpass_SessionParams_CALLBACK NULL
+#define turtlpass_SessionParams_DEFAULT NULL
+
+#define turtlpass_KeyboardParams_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UENUM,    layout,            1) \
+X(a, STATIC,   SINGULAR, UINT32,   host_profile,      2)
+#define turtlpass_KeyboardParams_CALLBACK NULL
+#define turtlpass_KeyboardParams_DEFAULT NULL
+
+#define turtlpass_FramingParams_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UENUM,    framing,           1)
+#define turtlpass_FramingParams_CALLBACK NULL
+#define turtlpass_FramingParams_DEFAULT NULL
+
 #define turtlpass_DeviceInfo_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, STRING,   turtlpass_version,   1) \
 X(a, STATIC,   SINGULAR, STRING,   arduino_version,   2) \
 X(a, STATIC,   SINGULAR, STRING,   compiler_version,   3) \
 X(a, STATIC,   SINGULAR, STRING,   nanopb_version,    4) \
 X(a, STATIC,   SINGULAR, STRING,   board_name,        5) \
-X(a, STATIC,   SINGULAR, BYTES,    unique_board_id,   6)
+X(a, STATIC,   SINGULAR, BYTES,    unique_board_id,   6) \
+X(a, STATIC,   SINGULAR, BYTES,    info_hash,         7)
 #define turtlpass_DeviceInfo_CALLBACK NULL
 #define turtlpass_DeviceInfo_DEFAULT NULL
 
+#define turtlpass_SessionState_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, BOOL,     enabled,           1) \
+X(a, STATIC,   SINGULAR, BOOL,     unlocked,          2) \
+X(a, STATIC,   SINGULAR, UINT32,   slot,              3) \
+X(a, STATIC,   SINGULAR, UINT32,   timeout_ms,        4) \
+X(a, STATIC,   SINGULAR, UINT32,   remaining_ms,      5)
+#define turtlpass_SessionState_CALLBACK NULL
+#define turtlpass_SessionState_DEFAULT NULL
+
+#define turtlpass_PasswordBatchChunk_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT32,   first_index,       1) \
+X(a, STATIC,   SINGULAR, UINT32,   count,             2) \
+X(a, STATIC,   SINGULAR, UINT32,   total,             3) \
+X(a, STATIC,   SINGULAR, BOOL,     complete,          4)
+#define turtlpass_PasswordBatchChunk_CALLBACK NULL
+#define turtlpass_PasswordBatchChunk_DEFAULT NULL
+
 #define turtlpass_Command_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, UENUM,    type,              1) \
 X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,gen_pass,parameters.gen_pass),   2) \
-X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,init_seed,parameters.init_seed),   3)
+X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,init_seed,parameters.init_seed),   3) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,session,parameters.session),   4) \
+X(a, STATIC,   SINGULAR, UINT32,   request_id,        5) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,gen_batch,parameters.gen_batch),   6) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,keyboard,parameters.keyboard),   7) \
+X(a, STATIC,   ONEOF,    MESSAGE,  (parameters,framing,parameters.framing),   8)
 #define turtlpass_Command_CALLBACK NULL
 #define turtlpass_Command_DEFAULT NULL
 #define turtlpass_Command_parameters_gen_pass_MSGTYPE turtlpass_GeneratePasswordParams
 #define turtlpass_Command_parameters_init_seed_MSGTYPE turtlpass_InitializeSeedParams
+#define turtlpass_Command_parameters_session_MSGTYPE turtlpass_SessionParams
+#define turtlpass_Command_parameters_gen_batch_MSGTYPE turtlpass_GeneratePasswordBatchParams
+#define turtlpass_Command_parameters_keyboard_MSGTYPE turtlpass_KeyboardParams
+#define turtlpass_Command_parameters_framing_MSGTYPE turtlpass_FramingParams
 
 #define turtlpass_Response_FIELDLIST(X, a) \
 X(a, STATIC,   SINGULAR, BOOL,     success,           1) \
 X(a, STATIC,   SINGULAR, UENUM,    error,             2) \
 X(a, STATIC,   OPTIONAL, MESSAGE,  device_info,       3) \
-X(a, STATIC,   SINGULAR, BYTES,    data,              4)
-#define turtlpass_Response_CALLBACK NULL
+X(a, CALLBACK, SINGULAR, BYTES,    data,              4) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  session_state,     5) \
+X(a, STATIC,   SINGULAR, UINT32,   request_id,        6) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  batch,             7)
+#define turtlpass_Response_CALLBACK pb_default_field_callback
 #define turtlpass_Response_DEFAULT NULL
 #define turtlpass_Response_device_info_MSGTYPE turtlpass_DeviceInfo
+#define turtlpass_Response_session_state_MSGTYPE turtlpass_SessionState
+#define turtlpass_Response_batch_MSGTYPE turtlpass_PasswordBatchChunk
 
 extern const pb_msgdesc_t turtlpass_GeneratePasswordParams_msg;
 extern const pb_msgdesc_t turtlpass_InitializeSeedParams_msg;
+extern const pb_msgdesc_t turtlpass_GeneratePasswordBatchParams_msg;
+extern const pb_msgdesc_t turtlpass_SessionParams_msg;
+extern const pb_msgdesc_t turtlpass_KeyboardParams_msg;
+extern const pb_msgdesc_t turtlpass_FramingParams_msg;
 extern const pb_msgdesc_t turtlpass_DeviceInfo_msg;
+extern const pb_msgdesc_t turtlpass_SessionState_msg;
+extern const pb_msgdesc_t turtlpass_PasswordBatchChunk_msg;
 extern const pb_msgdesc_t turtlpass_Command_msg;
 extern const pb_msgdesc_t turtlpass_Response_msg;
 
 /* Defines for backwards compatibility with code written before nanopb-0.4.0 */
 #define turtlpass_GeneratePasswordParams_fields &turtlpass_GeneratePasswordParams_msg
 #define turtlpass_InitializeSeedParams_fields &turtlpass_InitializeSeedParams_msg
+#define turtlpass_GeneratePasswordBatchParams_fields &turtlpass_GeneratePasswordBatchParams_msg
+#define turtlpass_SessionParams_fields &turtlpass_SessionParams_msg
+#define turtlpass_KeyboardParams_fields &turtlpass_KeyboardParams_msg
+#define turtlpass_FramingParams_fields &turtlpass_FramingParams_msg
 #define turtlpass_DeviceInfo_fields &turtlpass_DeviceInfo_msg
+#define turtlpass_SessionState_fields &turtlpass_SessionState_msg
+#define turtlpass_PasswordBatchChunk_fields &turtlpass_PasswordBatchChunk_msg
 #define turtlpass_Command_fields &turtlpass_Command_msg
 #define turtlpass_Response_fields &turtlpass_Response_msg
 
 /* Maximum encoded size of messages (where known) */
-#define TURTLPASS_TURTLPASS_PB_H_MAX_SIZE        turtlpass_Response_size
-#define turtlpass_Command_size                   78
-#define turtlpass_DeviceInfo_size                167
-#define turtlpass_GeneratePasswordParams_size    74
+/* turtlpass_Response_size depends on runtime parameters */
+#define TURTLPASS_TURTLPASS_PB_H_MAX_SIZE        turtlpass_Command_size
+#define turtlpass_Command_size                   1259
+#define turtlpass_DeviceInfo_size                185
+#define turtlpass_FramingParams_size             2
+#define turtlpass_GeneratePasswordBatchParams_size 1248
+#define turtlpass_GeneratePasswordParams_size    76
 #define turtlpass_InitializeSeedParams_size      66
-#define turtlpass_Response_size                  689
+#define turtlpass_KeyboardParams_size            8
+#define turtlpass_PasswordBatchChunk_size        20
+#define turtlpass_SessionParams_size             6
+#define turtlpass_SessionState_size              22
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -1,23 +1,103 @@
 #include "SeedManager.h"
+#include "system/CoreLock.h"
 
-SeedManager::SeedManager() {}
+SeedManager::SeedManager(IStorageBackend& backend)
+    : storageManager(backend), pendingSinceMs(0), pendingWrites(false), stagedSeeds(0), failedSeeds(0) {
+    mutex_init(&mutex);
+    memset(saltEpochs, 0, sizeof(saltEpochs));
+}
 
 void SeedManager::begin() {
-    storageManager.begin(EEPROM_SIZE);
+    CoreLock lock(mutex);
+    storageManager.begin();
+}
+
+bool SeedManager::importLegacy(const uint8_t* image, size_t size) {
+    CoreLock lock(mutex);
+    return storageManager.importLegacy(image, size);
+}
+
+bool SeedManager::serviceStorage(bool idle) {
+    CoreLock lock(mutex);
+    if (stagedSeeds) settleSeeds(false);  // e.g. placed by a stage overflow
+    if (!storageManager.hasPendingWrites()) {
+        pendingWrites = false;
+        return idle && storageManager.service();
+    }
+    if (!pendingWrites) {
+        pendingWrites = true;
+        pendingSinceMs = millis();
+    }
+    if (!idle && millis() - pendingSinceMs < STORAGE_FLUSH_DEADLINE_MS) return false;
+    if (storageManager.inTransaction()) return false;  // its records stay staged until committed
+    const bool flushed = storageManager.flush();
+    settleSeeds(!flushed);
+    return flushed;
+}
+
+bool SeedManager::flushStorage() {
+    CoreLock lock(mutex);
+    const bool flushed = storageManager.flush();
+    settleSeeds(!flushed);
+    return flushed;
+}
+
+void SeedManager::settleSeeds(bool flushFailed) {
+    for (uint8_t slot = 1; slot <= NUM_SLOTS; ++slot) {
+        const uint16_t bit = (uint16_t)(1u << slot);
+        if (!(stagedSeeds & bit)) continue;
+        // unstage it so a retry is not ALREADY_POPULATED and a later flush does not store it
+        if (flushFailed) storageManager.discardStaged(slot);
+        if (storageManager.isStaged(slot)) continue;  // awaits the flush (or its transaction)
+
+        stagedSeeds &= (uint16_t)~bit;
+        if (!storageManager.keyExists(slot)) {
+            failedSeeds |= bit;
+            continue;
+        }
+        // New seed in this slot: drop any stale salt midstate
+        saltMidstates[slot - 1].clear();
+        saltEpochs[slot - 1]++;
+    }
+}
+
+SeedManager::SeedInitResult SeedManager::commitResult(uint8_t seedSlot) {
+    if (seedSlot == 0 || seedSlot > NUM_SLOTS) return SeedInitResult::INVALID_SLOT;
+    CoreLock lock(mutex);
+    const uint16_t bit = (uint16_t)(1u << seedSlot);
+    if (stagedSeeds & bit) return SeedInitResult::STAGED;
+    if (failedSeeds & bit) {
+        failedSeeds &= (uint16_t)~bit;
+        return SeedInitResult::VERIFY_FAIL;
+    }
+    return SeedInitResult::OK;
+}
+
+bool SeedManager::beginTransaction() {
+    CoreLock lock(mutex);
+    return storageManager.beginTransaction();
+}
+
+bool SeedManager::commitTransaction() {
+    CoreLock lock(mutex);
+    return storageManager.commitTransaction();
 }
 
-SeedManager::SeedInitResult SeedManager::initializeSeed(uint8_t seedSlot, const uint8_t* seedInput, size_t seedLen) {
+void SeedManager::abortTransaction() {
+    CoreLock lock(mutex);
+    storageManager.abortTransaction();
+}
+
+SeedManager::SeedInitResult SeedManager::initializeSeed(uint8_t seedSlot, const uint8_t* seedInput,
+                                                        size_t seedLen) {
+    CoreLock lock(mutex);
+
     // --- Validate input ---
     if (!seedInput || seedLen != SEED_SIZE) return SeedInitResult::INVALID_INPUT; // Must match SEED_SIZE
     if (seedSlot == 0 || seedSlot > NUM_SLOTS) return SeedInitResult::INVALID_SLOT; // Only slots 1–9
 
-    // --- Check if slot is already populated ---
-    uint8_t existing[SEED_SIZE] = {0};
-    if (getSeed(seedSlot, existing, SEED_SIZE)) {
-        memset(existing, 0, sizeof(existing));
-        return SeedInitResult::ALREADY_POPULATED;
-    }
-    memset(existing, 0, sizeof(existing));
+    // --- Check if slot is already populated (no decrypt needed) ---
+    if (storageManager.keyExists(seedSlot)) return SeedInitResult::ALREADY_POPULATED;
 
     // --- Hash the input seed ---
     uint8_t seed[SHA512::HASH_SIZE] = {0};
@@ -29,66 +109,41 @@ SeedManager::SeedInitResult SeedManager::initializeSeed(uint8_t seedSlot, const
     // --- Encrypt the seed ---
     encryption.init(seedSlot); // Initialize encryption for this slot
     uint8_t ciphertext[SEED_SIZE] = {0};
-    if (!encryption.encrypt(ciphertext, seed, sizeof(seed))) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::WRITE_FAIL;
-    }
-
-    // --- Write the ciphertext to EEPROM ---
-    if (!storageManager.writeKeyValue(seedSlot, ciphertext, (uint16_t)sizeof(seed))) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::WRITE_FAIL;
-    }
-
-    // --- Read back ciphertext for verification ---
-    uint8_t readback[SEED_SIZE] = {0};
-    if (!storageManager.readValueByKey(seedSlot, readback, (uint16_t)sizeof(seed))) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(readback, 0, sizeof(readback));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::READ_FAIL;
-    }
-
-    // --- Verify written data matches readback ---
-    if (memcmp(ciphertext, readback, sizeof(seed)) != 0) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(readback, 0, sizeof(readback));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::WRITE_FAIL;
-    }
-
-    // --- Decrypt the stored ciphertext and verify against original ---
-    encryption.init(seedSlot);
-    uint8_t decrypted[SEED_SIZE] = {0};
-    if (!encryption.decrypt(decrypted, readback, sizeof(seed))) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(readback, 0, sizeof(readback));
-        memset(decrypted, 0, sizeof(decrypted));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::VERIFY_FAIL;
-    }
-    if (memcmp(decrypted, seed, sizeof(seed)) != 0) {
-        memset(ciphertext, 0, sizeof(ciphertext));
-        memset(readback, 0, sizeof(readback));
-        memset(decrypted, 0, sizeof(decrypted));
-        memset(seed, 0, sizeof(seed));
-        return SeedInitResult::VERIFY_FAIL;
-    }
-
-    // --- Success: zero sensitive buffers before returning ---
-    memset(ciphertext, 0, sizeof(ciphertext));
-    memset(readback, 0, sizeof(readback));
-    memset(decrypted, 0, sizeof(decrypted));
+    bool encrypted = encryption.encrypt(ciphertext, seed, sizeof(seed));
     memset(seed, 0, sizeof(seed));
 
-    return SeedInitResult::OK;
+    // --- Write the ciphertext to storage ---
+    bool written = encrypted &&
+                   storageManager.writeKeyValue(seedSlot, ciphertext, (uint16_t)sizeof(ciphertext));
+    memset(ciphertext, 0, sizeof(ciphertext));
+    if (!written) return SeedInitResult::WRITE_FAIL;
+
+    // --- Commit: with the next flush, when the device is idle. flush() reads the record
+    //     back before committing it and its CRC is checked on every boot, so no
+    //     readback/decrypt round is needed. ---
+    const uint16_t bit = (uint16_t)(1u << seedSlot);
+    stagedSeeds |= bit;
+    failedSeeds &= (uint16_t)~bit;
+    return SeedInitResult::STAGED;
 }
 
 bool SeedManager::getSeed(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen) {
     if (!seedOut || seedLen < SEED_SIZE) return false; // Output must be valid and large enough
     if (seedSlot == 0 || seedSlot > NUM_SLOTS) return false;
+    CoreLock lock(mutex);
+    if (stagedSeeds & (1u << seedSlot)) return false;  // not in flash yet: may still be dropped
+
+    // Unlocked session: RAM only
+    if (seedSession.read(seedSlot, seedOut, seedLen)) return true;
+
+    if (!readSeed(seedSlot, seedOut, seedLen)) return false;
+    seedSession.unlock(seedSlot, seedOut, SEED_SIZE); // no-op unless sessions are enabled
+    return true;
+}
+
+bool SeedManager::readSeed(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen) {
+    if (!seedOut || seedLen < SEED_SIZE) return false;
+    if (seedSlot == 0 || seedSlot > NUM_SLOTS) return false;
 
     // Read ciphertext from storage
     uint8_t encrypted[SEED_SIZE] = {0};
@@ -117,7 +172,46 @@ bool SeedManager::getSeed(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen) {
     return ok;
 }
 
+SeedSession& SeedManager::session() {
+    return seedSession;
+}
+
+bool SeedManager::loadSaltMidstate(uint8_t seedSlot, HmacSha512::Midstate& out, uint32_t& epoch) {
+    if (seedSlot == 0 || seedSlot > NUM_SLOTS) return false;
+    CoreLock lock(mutex);
+    out = saltMidstates[seedSlot - 1];
+    epoch = saltEpochs[seedSlot - 1];
+    return true;
+}
+
+void SeedManager::storeSaltMidstate(uint8_t seedSlot, const HmacSha512::Midstate& midstate, uint32_t epoch) {
+    if (seedSlot == 0 || seedSlot > NUM_SLOTS || !midstate.valid) return;
+    CoreLock lock(mutex);
+    if (saltEpochs[seedSlot - 1] != epoch) return; // slot re-seeded or reset meanwhile
+    saltMidstates[seedSlot - 1] = midstate;
+}
+
 void SeedManager::factoryReset() {
+    CoreLock lock(mutex);
+    seedSession.lock();
+    for (size_t i = 0; i < NUM_SLOTS; ++i) {
+        saltMidstates[i].clear();
+        saltEpochs[i]++;
+    }
+    encryption.clearCache();
     storageManager.factoryReset();
-    storageManager.begin(storageManager.capacity()); // Re-initialize storage
+    failedSeeds |= stagedSeeds;  // wiped before reaching flash
+    stagedSeeds = 0;
+}
+
+bool SeedManager::readSetting(uint32_t key, uint8_t* dst, uint16_t len) {
+    if (key <= NUM_SLOTS) return false;
+    CoreLock lock(mutex);
+    return storageManager.readValueByKey(key, dst, len);
+}
+
+bool SeedManager::writeSetting(uint32_t key, const uint8_t* value, uint16_t len) {
+    if (key <= NUM_SLOTS) return false;
+    CoreLock lock(mutex);
+    return storageManager.updateKeyValue(key, value, len);
 }
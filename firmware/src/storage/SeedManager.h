@@ -3,24 +3,34 @@
 
 #include "storage/StorageManager.h"
 #include "crypto/EncryptionManager.h"
+#include "storage/SeedSession.h"
+#include "pico/mutex.h"
 #include <stdint.h>
 #include <stddef.h>
 
-#if defined(TP_EEPROM_SIZE)
-#define EEPROM_SIZE TP_EEPROM_SIZE
+#if defined(TP_STORAGE_FLUSH_DEADLINE_MS)
+#define STORAGE_FLUSH_DEADLINE_MS TP_STORAGE_FLUSH_DEADLINE_MS
 #else
-#define EEPROM_SIZE 4096
+#define STORAGE_FLUSH_DEADLINE_MS 2000  // staged writes wait at most this long for an idle device
 #endif
 
 /**
  * @class SeedManager
- * @brief Manages storage, encryption, and retrieval of seeds in EEPROM.
+ * @brief Manages storage, encryption, and retrieval of seeds in flash.
  *
  * Handles:
  *  - Storing a new seed securely in slots 1–9.
  *  - Retrieving stored seeds and decrypting them.
  *  - Verifying data integrity.
  *  - Factory reset of all seeds.
+ *  - Optional unlocked-seed session that serves repeated reads from RAM.
+ *
+ * Public methods are serialized by an internal mutex so that the crypto worker
+ * on core1 and the UI paths on core0 can share one instance.
+ *
+ * Seeds and settings are staged in RAM when written and reach flash with the next
+ * serviceStorage() or flushStorage() (see StorageManager for the crash guarantees). A
+ * new seed is only readable once it is in flash; commitResult() tells when that is.
  */
 class SeedManager {
 public:
@@ -29,6 +39,9 @@ public:
 
     // Maximum number of slots available
     static const size_t NUM_SLOTS = 9;
+    static_assert(NUM_SLOTS <= ENCRYPTION_CACHE_SLOTS, "every slot needs a key cache entry");
+    static_assert(SEED_SIZE == SeedSession::SEED_SIZE, "session buffer must hold one seed");
+    static_assert(NUM_SLOTS < 16, "staged seeds are tracked in a 16-bit mask");
 
     /**
      * @enum SeedInitResult
@@ -39,37 +52,107 @@ public:
         INVALID_SLOT,          // Slot number is invalid (not 1–NUM_SLOTS)
         INVALID_INPUT,         // Input seed is null or wrong length
         ALREADY_POPULATED,     // Slot already contains a seed
-        WRITE_FAIL,            // Failed to write encrypted seed to EEPROM
-        READ_FAIL,             // Failed to read encrypted seed back from EEPROM
-        VERIFY_FAIL            // Seed verification failed after write
+        WRITE_FAIL,            // Failed to write encrypted seed to storage
+        READ_FAIL,             // Failed to read encrypted seed back from storage (unused)
+        VERIFY_FAIL,           // Seed could not be committed to flash (verification failed)
+        STAGED                 // Seed staged, awaiting the next flush (see commitResult())
     };
 
     /**
      * @brief Constructor. Does not initialize storage.
+     *
+     * @param backend Flash holding seeds and settings (the filesystem region on the device).
      */
-    SeedManager();
+    explicit SeedManager(IStorageBackend& backend);
 
     /**
      * @brief Initializes the storage manager backend.
      */
     void begin();
 
+    /**
+     * @brief Copies seeds stored by earlier firmware (EEPROM layout) into a blank store.
+     *
+     * @param image Legacy EEPROM contents (may be NULL).
+     * @param size Length of the image.
+     * @return true if the legacy data is held by the store and the image can be erased.
+     */
+    bool importLegacy(const uint8_t* image, size_t size);
+
+    /**
+     * @brief Background storage maintenance: flushes staged writes, compacts the log.
+     *
+     * Call from the main loop, except while typing. Flash programs stall both cores, so
+     * work is only done when the device is idle, or once writes have been staged for
+     * STORAGE_FLUSH_DEADLINE_MS (e.g. during a long LED animation). Settles the staged
+     * seeds (commitResult()).
+     *
+     * @param idle Nothing timing-sensitive is running (no command, no LED animation).
+     * @return true if work was done.
+     */
+    bool serviceStorage(bool idle);
+
+    /**
+     * @brief Writes staged seeds and settings to flash now.
+     *
+     * @return true if every write is durable.
+     */
+    bool flushStorage();
+
+    /**
+     * @brief Starts a storage transaction: seeds and settings written until
+     *        commitTransaction() survive a power loss together or not at all.
+     *
+     * Internal API: no command opens a transaction yet.
+     *
+     * @return true if the transaction was started.
+     */
+    bool beginTransaction();
+
+    /**
+     * @brief Commits the storage transaction (written to flash with the next flush).
+     *
+     * @return true if a transaction was open.
+     */
+    bool commitTransaction();
+
+    /**
+     * @brief Discards the writes of the storage transaction.
+     */
+    void abortTransaction();
+
     /**
      * @brief Initializes a new seed in the specified slot.
      *
-     * Performs validation, hashes the seed, encrypts it, stores it, reads back for
-     * verification, and decrypts to confirm integrity.
+     * Performs validation, hashes the seed, encrypts it and stages it. The seed reaches
+     * flash with the next serviceStorage(), so it waits for an idle device like any other
+     * write; until then the slot reads as empty. The storage log verifies the programmed
+     * record before committing it, and its CRC on every boot.
      *
      * @param seedSlot Slot number (1–NUM_SLOTS) to store the seed.
      * @param seed Pointer to the seed bytes to store.
      * @param seedLen Length of the seed (must equal SEED_SIZE).
-     * @return SeedInitResult Enum indicating success or failure reason.
+     * @return STAGED, or the reason the seed was rejected.
      */
     SeedInitResult initializeSeed(uint8_t seedSlot, const uint8_t* seed, size_t seedLen);
 
+    /**
+     * @brief Outcome of the seed staged in a slot by initializeSeed().
+     *
+     * A seed whose flush failed is unstaged, so the slot stays empty and the host can
+     * retry. VERIFY_FAIL is reported once.
+     *
+     * @param seedSlot Slot number (1–NUM_SLOTS).
+     * @return STAGED while it awaits the flush, OK once in flash, VERIFY_FAIL if dropped.
+     */
+    SeedInitResult commitResult(uint8_t seedSlot);
+
     /**
      * @brief Retrieves a stored seed from a slot.
      *
+     * Served from the unlocked session when it holds this slot; otherwise read from
+     * storage, decrypted, and cached in the session if sessions are enabled.
+     *
      * @param seedSlot Slot number (1–NUM_SLOTS) to retrieve the seed from.
      * @param seedOut Output buffer to store the decrypted seed (must be at least SEED_SIZE bytes).
      * @param seedLen Length of the output buffer.
@@ -79,12 +162,92 @@ public:
 
     /**
      * @brief Factory reset: clears all stored seeds and reinitializes storage.
+     *
+     * Also wipes every cached HMAC salt midstate and slot encryption key.
      */
     void factoryReset();
 
+    /**
+     * @brief Copies the cached HKDF salt midstate of a slot.
+     *
+     * The midstate is filled lazily by Kdf on the first derivation with the slot's seed
+     * and reused afterwards, saving the salt's ipad/opad compressions on every request.
+     * Callers derive with the copy and hand it back with storeSaltMidstate(), so two
+     * cores never write the same cache entry.
+     *
+     * @param seedSlot Slot number (1–NUM_SLOTS).
+     * @param out Receives the midstate (invalid if not cached yet).
+     * @param epoch Receives the cache entry's epoch, to pass back to storeSaltMidstate().
+     * @return true if the slot is valid, false otherwise.
+     */
+    bool loadSaltMidstate(uint8_t seedSlot, HmacSha512::Midstate& out, uint32_t& epoch);
+
+    /**
+     * @brief Stores a salt midstate computed for a slot.
+     *
+     * Ignored if the midstate is invalid or the slot was re-seeded/reset meanwhile
+     * (i.e. the cache entry changed since loadSaltMidstate()).
+     *
+     * @param seedSlot Slot number (1–NUM_SLOTS).
+     * @param midstate Midstate filled by Kdf.
+     * @param epoch Epoch returned by loadSaltMidstate().
+     */
+    void storeSaltMidstate(uint8_t seedSlot, const HmacSha512::Midstate& midstate, uint32_t epoch);
+
+    /**
+     * @brief Returns the unlocked-seed session.
+     */
+    SeedSession& session();
+
+    /**
+     * @brief Reads a device setting stored next to the seeds.
+     *
+     * @param key Setting key (must be above NUM_SLOTS, which are seed keys).
+     * @param dst Output buffer.
+     * @param len Length of the setting.
+     * @return true if the setting was found, false otherwise.
+     */
+    bool readSetting(uint32_t key, uint8_t* dst, uint16_t len);
+
+    /**
+     * @brief Stores or overwrites a device setting. Settings are cleared by factoryReset().
+     *
+     * @param key Setting key (must be above NUM_SLOTS, which are seed keys).
+     * @param value Setting bytes.
+     * @param len Length of the setting (fixed per key).
+     * @return true if successful, false otherwise.
+     */
+    bool writeSetting(uint32_t key, const uint8_t* value, uint16_t len);
+
 private:
-    StorageManager storageManager;  // Handles low-level EEPROM read/write
+    /**
+     * @brief Reads and decrypts a seed from storage, bypassing the session.
+     *
+     * @param seedSlot Slot number (1–NUM_SLOTS).
+     * @param seedOut Output buffer (at least SEED_SIZE bytes).
+     * @param seedLen Length of the output buffer.
+     * @return true if successful, false otherwise.
+     */
+    bool readSeed(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen);
+
+    /**
+     * @brief Settles the staged seeds after storage was written: a seed in flash is
+     *        committed, one a failed flush left behind is unstaged.
+     *
+     * @param flushFailed The last flush() failed.
+     */
+    void settleSeeds(bool flushFailed);
+
+    StorageManager storageManager;  // Log-structured flash store
     EncryptionManager encryption;   // Handles seed encryption and decryption
+    HmacSha512::Midstate saltMidstates[NUM_SLOTS];  // Per-slot HKDF salt midstates (RAM only)
+    uint32_t saltEpochs[NUM_SLOTS];  // Bumped whenever a slot's midstate is invalidated
+    SeedSession seedSession;        // Unlocked seed kept for the idle timeout
+    uint32_t pendingSinceMs;        // When serviceStorage() first saw staged writes
+    bool pendingWrites;             // pendingSinceMs is valid
+    uint16_t stagedSeeds;           // Bit per slot: seed staged, not yet in flash
+    uint16_t failedSeeds;           // Bit per slot: seed dropped, VERIFY_FAIL not yet reported
+    mutex_t mutex;                  // Serializes access from both cores
 };
 
 #endif
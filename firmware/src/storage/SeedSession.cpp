@@ -0,0 +1,95 @@
+#include "storage/SeedSession.h"
+#include "system/CoreLock.h"
+#include "Crypto.h"
+#include <cstring>
+
+SeedSession::SeedSession()
+    : slot_(0), timeoutMs_(SEED_SESSION_DEFAULT_TIMEOUT_MS), lastUseMs_(0) {
+    mutex_init(&mutex_);
+    memset(seed_, 0, sizeof(seed_));
+}
+
+SeedSession::~SeedSession() {
+    clean(seed_, sizeof(seed_));
+}
+
+bool SeedSession::setTimeout(uint32_t timeoutMs) {
+    if (timeoutMs > SEED_SESSION_MAX_TIMEOUT_MS) return false;
+    CoreLock lock(mutex_);
+    lockLocked();
+    timeoutMs_ = timeoutMs;
+    return true;
+}
+
+uint32_t SeedSession::timeout() {
+    CoreLock lock(mutex_);
+    return timeoutMs_;
+}
+
+bool SeedSession::isEnabled() {
+    CoreLock lock(mutex_);
+    return timeoutMs_ > 0;
+}
+
+bool SeedSession::isUnlocked() {
+    CoreLock lock(mutex_);
+    return slot_ != 0 && !isExpiredLocked();
+}
+
+uint8_t SeedSession::slot() {
+    CoreLock lock(mutex_);
+    return (slot_ != 0 && !isExpiredLocked()) ? slot_ : 0;
+}
+
+uint32_t SeedSession::remainingMs() {
+    CoreLock lock(mutex_);
+    if (slot_ == 0 || isExpiredLocked()) return 0;
+    return timeoutMs_ - (millis() - lastUseMs_);
+}
+
+bool SeedSession::unlock(uint8_t seedSlot, const uint8_t* seed, size_t seedLen) {
+    if (seedSlot == 0 || !seed || seedLen != SEED_SIZE) return false;
+    CoreLock lock(mutex_);
+    if (timeoutMs_ == 0) return false;
+    lockLocked();
+    memcpy(seed_, seed, SEED_SIZE);
+    slot_ = seedSlot;
+    lastUseMs_ = millis();
+    return true;
+}
+
+bool SeedSession::read(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen) {
+    if (!seedOut || seedLen < SEED_SIZE) return false;
+    CoreLock lock(mutex_);
+    if (slot_ == 0) return false;
+    if (isExpiredLocked() || seedSlot != slot_) {
+        lockLocked();
+        return false;
+    }
+    memcpy(seedOut, seed_, SEED_SIZE);
+    lastUseMs_ = millis();
+    return true;
+}
+
+void SeedSession::lock() {
+    CoreLock lock(mutex_);
+    lockLocked();
+}
+
+void SeedSession::loop(uint8_t activeSlot) {
+    CoreLock lock(mutex_);
+    if (slot_ == 0) return;
+    if (isExpiredLocked() || activeSlot != slot_) {
+        lockLocked();
+    }
+}
+
+bool SeedSession::isExpiredLocked() const {
+    return timeoutMs_ == 0 || (uint32_t)(millis() - lastUseMs_) >= timeoutMs_;
+}
+
+void SeedSession::lockLocked() {
+    clean(seed_, sizeof(seed_));
+    slot_ = 0;
+    lastUseMs_ = 0;
+}
@@ -0,0 +1,136 @@
+#ifndef SEED_SESSION_H
+#define SEED_SESSION_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/mutex.h"
+
+#if defined(TP_SESSION_TIMEOUT_MS)
+#define SEED_SESSION_DEFAULT_TIMEOUT_MS TP_SESSION_TIMEOUT_MS
+#else
+#define SEED_SESSION_DEFAULT_TIMEOUT_MS 0  ///< Sessions are opt-in: disabled by default
+#endif
+
+#define SEED_SESSION_MAX_TIMEOUT_MS 3600000UL  ///< Upper bound for the idle timeout (1 hour)
+
+/**
+ * @class SeedSession
+ * @brief Keeps the plaintext seed of one unlocked slot in RAM for an idle timeout.
+ *
+ * Once a slot has been read from storage, its decrypted seed is kept here so that
+ * bursts of requests skip the storage read and decryption. Every hit restarts the
+ * idle timer.
+ *
+ * The seed lives in a single dedicated buffer that is never handed out by pointer;
+ * it is wiped with clean() on timeout, slot change, USB suspend and factory reset.
+ * A timeout of 0 disables the session entirely.
+ *
+ * All methods are safe to call from either core.
+ */
+class SeedSession {
+public:
+    // Size of the cached seed in bytes (SeedManager::SEED_SIZE)
+    static const size_t SEED_SIZE = 64;
+
+    /**
+     * @brief Constructor. Starts locked with the build-time default timeout.
+     */
+    SeedSession();
+
+    /**
+     * @brief Destructor. Wipes the cached seed.
+     */
+    ~SeedSession();
+
+    /**
+     * @brief Set the idle timeout.
+     *
+     * Changing the timeout always locks the session.
+     *
+     * @param timeoutMs Idle timeout in milliseconds (0 disables sessions).
+     * @return true on success, false if the value exceeds SEED_SESSION_MAX_TIMEOUT_MS.
+     */
+    bool setTimeout(uint32_t timeoutMs);
+
+    /**
+     * @brief Returns the configured idle timeout in milliseconds (0 = disabled).
+     */
+    uint32_t timeout();
+
+    /**
+     * @brief Returns true if sessions are enabled (timeout > 0).
+     */
+    bool isEnabled();
+
+    /**
+     * @brief Returns true if a seed is currently cached and not expired.
+     */
+    bool isUnlocked();
+
+    /**
+     * @brief Returns the unlocked slot (1–9), or 0 if locked.
+     */
+    uint8_t slot();
+
+    /**
+     * @brief Returns the milliseconds left before the session locks (0 if locked).
+     */
+    uint32_t remainingMs();
+
+    /**
+     * @brief Cache a seed for a slot.
+     *
+     * Ignored when sessions are disabled. Replaces (and wipes) any previous slot.
+     *
+     * @param seedSlot Slot number the seed belongs to.
+     * @param seed Pointer to the plaintext seed.
+     * @param seedLen Length of the seed (must equal SEED_SIZE).
+     * @return true if the seed was cached, false otherwise.
+     */
+    bool unlock(uint8_t seedSlot, const uint8_t* seed, size_t seedLen);
+
+    /**
+     * @brief Copy the cached seed for a slot and restart the idle timer.
+     *
+     * A request for another slot locks the session.
+     *
+     * @param seedSlot Slot number requested.
+     * @param seedOut Output buffer (at least SEED_SIZE bytes).
+     * @param seedLen Length of the output buffer.
+     * @return true on a cache hit, false otherwise.
+     */
+    bool read(uint8_t seedSlot, uint8_t* seedOut, size_t seedLen);
+
+    /**
+     * @brief Wipe the cached seed and lock the session.
+     */
+    void lock();
+
+    /**
+     * @brief Must be called periodically. Locks the session on idle timeout
+     *        or when the active slot no longer matches the unlocked one.
+     *
+     * @param activeSlot Currently selected slot.
+     */
+    void loop(uint8_t activeSlot);
+
+private:
+    /**
+     * @brief Returns true if the idle timeout elapsed. Mutex must be held.
+     */
+    bool isExpiredLocked() const;
+
+    /**
+     * @brief Wipe the seed and lock. Mutex must be held.
+     */
+    void lockLocked();
+
+    mutex_t mutex_;            ///< Guards every field below
+    uint8_t seed_[SEED_SIZE];  ///< Plaintext seed of the unlocked slot
+    uint8_t slot_;             ///< Unlocked slot (0 if locked)
+    uint32_t timeoutMs_;       ///< Idle timeout (0 = disabled)
+    uint32_t lastUseMs_;       ///< millis() of the last unlock or hit
+};
+
+#endif
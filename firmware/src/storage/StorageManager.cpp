@@ -4,82 +4,298 @@
 // Constructor & Initialization
 ///////////////////////////////////////////////////////////////
 
-StorageManager::StorageManager() {}
+StorageManager::StorageManager(IStorageBackend& backend)
+: backend(backend), sectorBytes(0), sectorCount(0), head(NO_SECTOR), maxSequence(0),
+  liveBytes(0), blank(true), stageUsed(0), transactionStart(0), transactionOpen(false) {
+    memset(sectors, 0, sizeof(sectors));
+    memset(stage, 0, sizeof(stage));
+    clearDirectory();
+}
 
-void StorageManager::begin(size_t size) {
-    eepromSize = size; 
-    EEPROM.begin(size);
+bool StorageManager::begin() {
+    sectorCount = 0;
+    head = NO_SECTOR;
+    maxSequence = 0;
+    blank = true;
+    dropStaged(stageUsed);
+    transactionOpen = false;
+    clearDirectory();
+    if (!backend.begin())
+        return false;
 
-    uint16_t magic = readUInt16(0);
-    uint16_t totalUsed = readUInt16(2);
+    sectorBytes = backend.sectorSize();
+    const size_t pageBytes = backend.pageSize();
+    if (pageBytes == 0 || pageBytes > STORAGE_PAGE_SIZE || sectorBytes % pageBytes != 0 ||
+        sectorBytes <= SECTOR_HEADER_SIZE || sectorBytes > 0x8000)
+        return false;  // geometry the log cannot use
+    sectorCount = (uint8_t)std::min(backend.sectorCount(), (size_t)STORAGE_MAX_SECTORS);
+
+    for (uint8_t s = 0; s < sectorCount; s++) {
+        uint8_t header[SECTOR_HEADER_SIZE];
+        SectorInfo &info = sectors[s];
+        memset(&info, 0, sizeof(info));
+        info.used = SECTOR_HEADER_SIZE;
+        info.sequence = SECTOR_FREE_SEQUENCE;
+        info.state = SECTOR_DIRTY;
+        if (!backend.read(s * sectorBytes, header, sizeof(header)))
+            continue;
+
+        if (getUInt32(header) == STORAGE_LOG_MAGIC) {
+            blank = false;
+            info.eraseCount = getUInt32(header + 4);
+            info.sequence = getUInt32(header + 8);
+            if (info.sequence == SECTOR_FREE_SEQUENCE) {
+                info.state = SECTOR_ERASED;
+            } else {
+                info.state = SECTOR_LOG;
+                maxSequence = std::max(maxSequence, info.sequence);
+            }
+            continue;
+        }
 
-    if (magic != EEPROM_MAGIC || isHeaderInvalid(totalUsed)) {
-        factoryReset();  // reset if invalid or uninitialized
+        // No header: erased (never used, or power lost before the header was written)
+        bool erased = true;
+        for (uint32_t offset = 0; erased && offset < sectorBytes; offset += pageBytes) {
+            if (!backend.read(s * sectorBytes + offset, page, pageBytes))
+                erased = false;
+            for (size_t i = 0; erased && i < pageBytes; i++)
+                erased = page[i] == 0xFF;
+        }
+        if (erased)
+            info.state = SECTOR_ERASED;
     }
+    rebuildDirectory();
+    return sectorCount > 0;
+}
+
+bool StorageManager::isBlank() const {
+    return blank;
 }
 
 size_t StorageManager::capacity() {
-    return eepromSize;
+    // one reserved sector for compaction, one sector of slack for fragmentation
+    if (sectorCount < STORAGE_MIN_SECTORS)
+        return 0;
+    return (sectorCount - STORAGE_RESERVED_SECTORS - 1) * (sectorBytes - SECTOR_HEADER_SIZE);
+}
+
+size_t StorageManager::usedBytes() const {
+    return liveBytes;
+}
+
+uint32_t StorageManager::sectorEraseCount(size_t sector) const {
+    return sector < sectorCount ? sectors[sector].eraseCount : 0;
 }
 
 ///////////////////////////////////////////////////////////////
-// Header & Factory Reset
+// Factory Reset
 ///////////////////////////////////////////////////////////////
 
 void StorageManager::factoryReset() {
-    eraseEEPROM();
+    dropStaged(stageUsed);
+    transactionOpen = false;
+    for (uint8_t s = 0; s < sectorCount; s++) {
+        if (sectors[s].state != SECTOR_ERASED)
+            eraseSector(s);
+    }
+    clearDirectory();
+    head = NO_SECTOR;
+}
+
+///////////////////////////////////////////////////////////////
+// Directory
+///////////////////////////////////////////////////////////////
 
-    // Write header: [magic][totalUsedBytes]
-    writeUInt16(0, EEPROM_MAGIC); // write magic number at offset 0
-    writeUInt16(2, HEADER_SIZE); // totalUsed at offset 2
-    EEPROM.commit();
+static inline bool isValueRecord(uint8_t type) {
+    return type == RECORD_VALUE || type == RECORD_TXN_VALUE;
 }
 
-void StorageManager::writeTotalUsedBytes(uint16_t value) {
-    writeUInt16(2, value);
+static inline bool isTransactionRecord(uint8_t type) {
+    return type == RECORD_TXN_VALUE || type == RECORD_TXN_TOMBSTONE;
 }
 
-uint16_t StorageManager::readTotalUsedBytes() {
-    uint16_t magic = readUInt16(0); // magic number at offset 0
-    uint16_t totalUsed = readUInt16(2);  // totalUsed at offset 2
-    if (magic != EEPROM_MAGIC || isHeaderInvalid(totalUsed)) 
-        return HEADER_SIZE;
-    return totalUsed;
+// Fibonacci hashing: spreads sequential keys (slots 1..9, setting ranges) across the table
+static inline uint32_t directorySlot(uint32_t key) {
+    return (key * 2654435761u) & (STORAGE_DIRECTORY_SLOTS - 1);
 }
 
-bool StorageManager::isHeaderInvalid(uint16_t headerValue) {
-    // return (headerValue == 0xFFFF || headerValue == 0x0000 || headerValue > eepromSize);
-    return (headerValue < HEADER_SIZE || headerValue > eepromSize);
+void StorageManager::clearDirectory() {
+    memset(directory, 0, sizeof(directory));
+    directoryKeys = 0;
+    directoryComplete = true;
+    liveBytes = 0;
+    for (uint8_t s = 0; s < sectorCount; s++)
+        sectors[s].live = 0;
 }
 
-void StorageManager::eraseEEPROM() {
-    for (uint16_t i = 0; i < EEPROM.length(); i++) {
-        EEPROM.write(i, 0xFF);
+template <typename Visit>
+void StorageManager::walkLog(Visit visit, uint16_t *ends) {
+    uint8_t order[STORAGE_MAX_SECTORS];
+    uint8_t count = logOrder(order);
+
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t s = order[i];
+        uint32_t offset = SECTOR_HEADER_SIZE;
+        uint32_t members = 0;  // offset of the pending transaction's first record (0 = none)
+        Record record;
+        RecordScan scan;
+        for (uint32_t start = offset; (scan = readRecord(s, offset, record)) == RECORD_OK; start = offset) {
+            if (isTransactionRecord(record.type)) {
+                if (members == 0)
+                    members = start;
+                continue;
+            }
+            if (record.type == RECORD_TXN_COMMIT) {
+                // a transaction's records share its sector and take effect together
+                for (uint32_t m = members; members != 0 && m < start;) {
+                    if (readRecord(s, m, record) != RECORD_OK)
+                        break;
+                    visit(record);
+                }
+            } else {
+                visit(record);
+            }
+            members = 0;
+        }
+        // a torn record or an uncommitted transaction seals the sector
+        if (ends)
+            ends[s] = scan == RECORD_END && members == 0 ? offset : sectorBytes;
+    }
+
+    for (uint32_t offset = 0; offset < stageUsed;) {
+        Record record = stagedRecord(offset);
+        offset += recordSize(record.length);
+        if (record.type != RECORD_TXN_COMMIT)
+            visit(record);
     }
-    EEPROM.commit();
 }
 
-///////////////////////////////////////////////////////////////
-// Key Existence Check
-///////////////////////////////////////////////////////////////
+void StorageManager::rebuildDirectory() {
+    clearDirectory();
+    uint16_t ends[STORAGE_MAX_SECTORS];
+    walkLog([this](const Record &record) { applyRecord(record); }, ends);
+
+    uint8_t order[STORAGE_MAX_SECTORS];
+    uint8_t count = logOrder(order);
+    for (uint8_t i = 0; i < count; i++)
+        sectors[order[i]].used = ends[order[i]];
+    head = count > 0 ? order[count - 1] : NO_SECTOR;
+
+    // Appends continue in the newest sector only if its tail is still erased
+    if (head != NO_SECTOR) {
+        SectorInfo &info = sectors[head];
+        uint8_t chunk[32];
+        for (uint32_t offset = info.used; offset < sectorBytes; offset += sizeof(chunk)) {
+            size_t len = std::min(sizeof(chunk), (size_t)(sectorBytes - offset));
+            bool erased = backend.read(head * sectorBytes + offset, chunk, len);
+            for (size_t i = 0; erased && i < len; i++)
+                erased = chunk[i] == 0xFF;
+            if (!erased) {
+                info.used = sectorBytes;
+                break;
+            }
+        }
+    }
+}
 
-bool StorageManager::keyExists(uint32_t key) {
-    uint16_t totalUsed = readTotalUsedBytes();
-    uint16_t address = HEADER_SIZE; // skip header
+void StorageManager::applyRecord(const Record &record) {
+    int32_t slot = directorySlotOf(record.key);
+    if (slot >= 0) {
+        const DirectoryEntry &old = directory[slot];
+        uint32_t size = recordSize(old.length);
+        if (!(old.address & STAGED_ADDRESS))
+            sectors[old.address / sectorBytes].live -= size;
+        liveBytes -= size;
+    }
 
-    while (address + ENTRY_OVERHEAD <= totalUsed) {
-        uint16_t valueLength = readUInt16(address);
-        address += sizeof(uint16_t);
+    if (!isValueRecord(record.type)) {
+        if (slot >= 0) {
+            removeSlot(slot);
+            directoryKeys--;
+        }
+        return;
+    }
 
-        uint32_t storedKey = readUInt32(address);
-        address += sizeof(uint32_t);
+    uint32_t size = recordSize(record.length);
+    if (!(record.address & STAGED_ADDRESS))
+        sectors[record.address / sectorBytes].live += size;
+    liveBytes += size;
+    if (slot >= 0) {
+        directory[slot].address = record.address;
+        directory[slot].length = record.length;
+        return;
+    }
 
-        if (storedKey == key) {
-            return true; // key found
+    for (uint32_t i = directorySlot(record.key);; i = (i + 1) & (STORAGE_DIRECTORY_SLOTS - 1)) {
+        DirectoryEntry &entry = directory[i];
+        if (entry.address == 0) {
+            if (directoryKeys >= STORAGE_DIRECTORY_MAX_KEYS) {
+                directoryComplete = false;  // found by scanning from now on
+                return;
+            }
+            entry.key = record.key;
+            entry.address = record.address;
+            entry.length = record.length;
+            directoryKeys++;
+            return;
         }
-        address += valueLength; // skip value
     }
-    return false; // key not found
+}
+
+int32_t StorageManager::directorySlotOf(uint32_t key) {
+    // empty slots always remain (MAX_KEYS < SLOTS), so the probe terminates
+    for (uint32_t i = directorySlot(key);; i = (i + 1) & (STORAGE_DIRECTORY_SLOTS - 1)) {
+        const DirectoryEntry &entry = directory[i];
+        if (entry.address == 0)
+            return -1;
+        if (entry.key == key)
+            return (int32_t)i;
+    }
+}
+
+void StorageManager::removeSlot(uint32_t slot) {
+    const uint32_t mask = STORAGE_DIRECTORY_SLOTS - 1;
+    for (uint32_t next = (slot + 1) & mask; directory[next].address != 0; next = (next + 1) & mask) {
+        // an entry may fill the hole unless its home slot lies between the hole and itself
+        uint32_t home = directorySlot(directory[next].key);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            directory[slot] = directory[next];
+            slot = next;
+        }
+    }
+    memset(&directory[slot], 0, sizeof(DirectoryEntry));
+}
+
+bool StorageManager::findValue(uint32_t key, uint32_t &valueAddress, uint16_t &valueLength) {
+    int32_t slot = directorySlotOf(key);
+    if (slot >= 0) {
+        valueAddress = directory[slot].address;
+        valueLength = directory[slot].length;
+        return true;
+    }
+    return !directoryComplete && scanForValue(key, valueAddress, valueLength);
+}
+
+bool StorageManager::scanForValue(uint32_t key, uint32_t &valueAddress, uint16_t &valueLength) {
+    bool found = false;
+    walkLog([&](const Record &record) {
+        if (record.key != key)
+            return;
+        found = isValueRecord(record.type);  // the newest record wins
+        valueAddress = record.address;
+        valueLength = record.length;
+    }, nullptr);
+    return found;
+}
+
+///////////////////////////////////////////////////////////////
+// Key Existence Check
+///////////////////////////////////////////////////////////////
+
+bool StorageManager::keyExists(uint32_t key) {
+    uint32_t address = 0;
+    uint16_t valueLength = 0;
+    return findValue(key, address, valueLength);
 }
 
 ///////////////////////////////////////////////////////////////
@@ -94,33 +310,84 @@ bool StorageManager::writeKeyValue(uint32_t key, uint8_t* value, uint16_t valueL
         return false; // key already populated
     }
 
-    if (valueLength + ENTRY_OVERHEAD > eepromSize)
-        return false;  // Not enough EEPROM space
+    if (liveBytes + recordSize(valueLength) > capacity())
+        return false;  // log full
+
+    return stageRecord(key, RECORD_VALUE, value, valueLength);
+}
 
-    uint16_t totalUsed = readTotalUsedBytes();
-    uint16_t nextAddress = totalUsed;
-    uint16_t newUsedBytes = nextAddress + ENTRY_OVERHEAD + valueLength;
+bool StorageManager::updateKeyValue(uint32_t key, const uint8_t* value, uint16_t valueLength) {
+    if (!value || valueLength == 0)
+        return false;
 
-    if (newUsedBytes > EEPROM.length())
-        return false;  // EEPROM full
+    uint32_t address = 0;
+    uint16_t storedLength = 0;
+    if (!findValue(key, address, storedLength)) {
+        return writeKeyValue(key, const_cast<uint8_t*>(value), valueLength);
+    }
+    if (storedLength == valueLength && equalsStored(address, value, valueLength))
+        return true;  // unchanged: no wear
 
-    // Write [length][key][data]
-    writeUInt16(nextAddress, valueLength);
-    nextAddress += sizeof(uint16_t);
+    if (liveBytes - recordSize(storedLength) + recordSize(valueLength) > capacity())
+        return false;
 
-    writeUInt32(nextAddress, key);
-    nextAddress += sizeof(uint32_t);
+    return stageRecord(key, RECORD_VALUE, value, valueLength);
+}
 
-    writeBytes(nextAddress, value, valueLength);
+bool StorageManager::deleteKey(uint32_t key) {
+    if (!keyExists(key))
+        return false;
+    return stageRecord(key, RECORD_TOMBSTONE, nullptr, 0);
+}
 
-    // Update header
-    writeTotalUsedBytes(newUsedBytes);
+///////////////////////////////////////////////////////////////
+// Transactions
+///////////////////////////////////////////////////////////////
 
-    EEPROM.commit();
+bool StorageManager::beginTransaction() {
+    if (transactionOpen || !ensureRoom(stageCapacity() - stageUsed))
+        return false;
+    transactionStart = stageUsed;
+    transactionOpen = true;
+    return true;
+}
 
+bool StorageManager::commitTransaction() {
+    if (!transactionOpen)
+        return false;
+    transactionOpen = false;
+    if (stageUsed == transactionStart)
+        return true;  // nothing written
+
+    // room was reserved by stageRecord()
+    uint8_t *p = stage + stageUsed;
+    uint32_t crc = 0;
+    memset(p, 0, RECORD_HEADER_SIZE);
+    p[2] = RECORD_TXN_COMMIT;
+    p[3] = RECORD_COMMITTED;
+    recordCrc(p, nullptr, 0, 0, crc);
+    putUInt32(p + 8, crc);
+    stageUsed += RECORD_HEADER_SIZE;
     return true;
 }
 
+void StorageManager::abortTransaction() {
+    if (!transactionOpen)
+        return;
+    memset(stage + transactionStart, 0, stageUsed - transactionStart);
+    stageUsed = transactionStart;
+    transactionOpen = false;
+    rebuildDirectory();  // the records may have superseded older values
+}
+
+bool StorageManager::inTransaction() const {
+    return transactionOpen;
+}
+
+bool StorageManager::hasPendingWrites() const {
+    return stageUsed > 0;
+}
+
 ///////////////////////////////////////////////////////////////
 // Read Operations
 ///////////////////////////////////////////////////////////////
@@ -129,91 +396,599 @@ bool StorageManager::readValueByKey(uint32_t key, uint8_t* dst, uint16_t expecte
     if (!dst || expectedLen == 0)
         return false;
 
-    uint16_t totalUsed = readTotalUsedBytes();
-    uint16_t address = HEADER_SIZE; // skip header
-
-    while (address + ENTRY_OVERHEAD <= totalUsed) {
-        uint16_t valueLength = readUInt16(address);
-        address += sizeof(uint16_t);
+    uint32_t address = 0;
+    uint16_t valueLength = 0;
+    if (!findValue(key, address, valueLength)) {
+        return false; // key not found
+    }
+    return readStored(address, dst, std::min(valueLength, expectedLen));
+}
 
-        uint32_t storedKey = readUInt32(address);
-        address += sizeof(uint32_t);
+///////////////////////////////////////////////////////////////
+// Log
+///////////////////////////////////////////////////////////////
 
-        if ((uint32_t)address + valueLength > EEPROM.length())
-            break;  // corrupted entry
+uint32_t StorageManager::recordSize(uint16_t valueLength) {
+    return (RECORD_HEADER_SIZE + (uint32_t)valueLength + 3) & ~3u;
+}
 
-        if (storedKey == key) {
-            readBytes(address, dst, std::min(valueLength, expectedLen));
-            return true;
+uint8_t StorageManager::logOrder(uint8_t *order) {
+    uint8_t count = 0;
+    for (uint8_t s = 0; s < sectorCount; s++) {
+        if (sectors[s].state != SECTOR_LOG)
+            continue;
+        // insertion sort by sequence (at most STORAGE_MAX_SECTORS entries)
+        uint8_t i = count++;
+        while (i > 0 && sectors[order[i - 1]].sequence > sectors[s].sequence) {
+            order[i] = order[i - 1];
+            i--;
         }
-        address += valueLength;
+        order[i] = s;
     }
-    return false; // key not found
+    return count;
+}
+
+uint8_t StorageManager::freeSectors() {
+    uint8_t count = 0;
+    for (uint8_t s = 0; s < sectorCount; s++) {
+        if (sectors[s].state != SECTOR_LOG)
+            count++;
+    }
+    return count;
+}
+
+StorageManager::RecordScan StorageManager::readRecord(uint8_t sector, uint32_t &offset, Record &record) {
+    if (offset + RECORD_HEADER_SIZE > sectorBytes)
+        return RECORD_END;  // sector full
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    const uint32_t address = sector * sectorBytes + offset;
+    if (!backend.read(address, header, sizeof(header)))
+        return RECORD_TORN;
+
+    bool erased = true;
+    for (size_t i = 0; erased && i < sizeof(header); i++)
+        erased = header[i] == 0xFF;
+    if (erased)
+        return RECORD_END;
+
+    uint16_t length = (uint16_t)(header[0] | (header[1] << 8));
+    uint8_t type = header[2];
+    if (header[3] != RECORD_COMMITTED ||
+        (type != RECORD_VALUE && type != RECORD_TOMBSTONE && type != RECORD_TXN_VALUE &&
+         type != RECORD_TXN_TOMBSTONE && type != RECORD_TXN_COMMIT) ||
+        offset + recordSize(length) > sectorBytes)
+        return RECORD_TORN;
+
+    uint32_t crc = 0;
+    if (!recordCrc(header, nullptr, address + RECORD_HEADER_SIZE, length, crc) ||
+        crc != getUInt32(header + 8))
+        return RECORD_TORN;  // damaged after it was committed
+
+    record.key = getUInt32(header + 4);
+    record.address = address + RECORD_HEADER_SIZE;
+    record.length = length;
+    record.type = type;
+    offset += recordSize(length);
+    return RECORD_OK;
+}
+
+bool StorageManager::recordCrc(const uint8_t *header, const uint8_t *value, uint32_t source,
+                               uint16_t valueLength, uint32_t &crc) {
+    // the commit byte changes after programming, so it is not covered
+    crc = crc32(0, header, 3);
+    crc = crc32(crc, header + 4, 4);
+    if (value) {
+        crc = crc32(crc, value, valueLength);
+        return true;
+    }
+    uint8_t chunk[32];
+    for (uint16_t done = 0; done < valueLength;) {
+        uint16_t n = std::min((uint16_t)sizeof(chunk), (uint16_t)(valueLength - done));
+        if (!readStored(source + done, chunk, n))
+            return false;
+        crc = crc32(crc, chunk, n);
+        done += n;
+    }
+    return true;
+}
+
+uint32_t StorageManager::crc32(uint32_t crc, const uint8_t *data, size_t len) {
+    // half-byte table: 64 bytes of flash instead of 1 KB
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
 }
 
 ///////////////////////////////////////////////////////////////
-// Debug & Inspection
+// Stage
+//
+// Records are staged exactly as they will be programmed. The stage can
+// always be placed without compaction (ensureRoom()), so a flush never
+// erases a sector whose records the stage has superseded.
 ///////////////////////////////////////////////////////////////
 
-bool StorageManager::debugDumpKeys(uint8_t *dst, size_t maxLen, size_t &outLen) {
-    uint16_t totalUsed = readTotalUsedBytes();
-    if (totalUsed <= sizeof(uint16_t)) {
-        outLen = 0;
+bool StorageManager::stageRecord(uint32_t key, uint8_t type, const uint8_t *value, uint16_t valueLength) {
+    const uint32_t size = recordSize(valueLength);
+    const uint32_t reserve = transactionOpen ? RECORD_HEADER_SIZE : 0;  // transaction commit record
+    if (stageUsed + size + reserve > stageCapacity()) {
+        if (!flush())
+            return false;
+        if (stageUsed + size + reserve > stageCapacity()) {
+            if (transactionOpen)
+                return false;  // the transaction outgrew the stage
+            return appendRecord(key, type, value, 0, valueLength, false);  // too large to stage
+        }
+    }
+    if (!ensureRoom(size + reserve))
         return false;
+
+    if (transactionOpen)
+        type = type == RECORD_VALUE ? RECORD_TXN_VALUE : RECORD_TXN_TOMBSTONE;
+    uint8_t *p = stage + stageUsed;
+    memset(p, 0xFF, size);  // padding stays erased
+    p[0] = (uint8_t)valueLength;
+    p[1] = (uint8_t)(valueLength >> 8);
+    p[2] = type;
+    p[3] = RECORD_COMMITTED;
+    putUInt32(p + 4, key);
+    if (valueLength > 0)
+        memcpy(p + RECORD_HEADER_SIZE, value, valueLength);
+    uint32_t crc = 0;
+    recordCrc(p, p + RECORD_HEADER_SIZE, 0, valueLength, crc);
+    putUInt32(p + 8, crc);
+
+    Record record = { key, STAGED_ADDRESS | (stageUsed + RECORD_HEADER_SIZE), valueLength, type };
+    stageUsed += size;
+    applyRecord(record);
+    return true;
+}
+
+StorageManager::Record StorageManager::stagedRecord(uint32_t offset) const {
+    const uint8_t *p = stage + offset;
+    Record record = {
+        getUInt32(p + 4), STAGED_ADDRESS | (offset + RECORD_HEADER_SIZE),
+        (uint16_t)(p[0] | (p[1] << 8)), p[2] };
+    return record;
+}
+
+uint32_t StorageManager::stagedGroupEnd(uint32_t offset) const {
+    while (offset < stageUsed) {
+        Record record = stagedRecord(offset);
+        offset += recordSize(record.length);
+        if (!isTransactionRecord(record.type))
+            break;
     }
+    return offset;
+}
 
-    uint16_t address = HEADER_SIZE; // skip both magic and totalUsed
-    size_t written = 0;
+uint32_t StorageManager::stageCapacity() const {
+    return std::min((uint32_t)STORAGE_STAGE_SIZE, (uint32_t)(sectorBytes - SECTOR_HEADER_SIZE));
+}
 
-    while (address < totalUsed) {
-        uint16_t entryLength = readUInt16(address);
-        if (entryLength == 0 || entryLength > (totalUsed - address))
+bool StorageManager::ensureRoom(uint32_t extra) {
+    // each round flushes or compacts; bounded in case the log holds only live data
+    for (uint8_t round = 0; round <= sectorCount; round++) {
+        const uint32_t needed = stageUsed + extra;
+        if (head != NO_SECTOR && sectors[head].used + needed <= sectorBytes)
+            return true;
+        if (freeSectors() > STORAGE_RESERVED_SECTORS)
+            return true;  // head remainder plus a new sector
+        const uint32_t committed = transactionOpen ? transactionStart : stageUsed;
+        if (committed > 0) {
+            if (!flush())
+                return false;
+            continue;
+        }
+        if (stageUsed > 0 || !compactOldest())
+            return false;  // no compaction under an open transaction's records
+    }
+    return false;
+}
+
+bool StorageManager::flush() {
+    const uint32_t limit = transactionOpen ? transactionStart : stageUsed;
+    uint32_t placed = 0;
+    bool ok = true;
+
+    while (placed < limit) {
+        uint32_t end = stagedGroupEnd(placed);
+        if (head == NO_SECTOR || sectors[head].used + (end - placed) > sectorBytes) {
+            if (freeSectors() <= STORAGE_RESERVED_SECTORS || !openSector()) {
+                ok = false;
+                break;
+            }
+        }
+        // every following group that fits goes into the same programs
+        while (end < limit) {
+            uint32_t next = stagedGroupEnd(end);
+            if (sectors[head].used + (next - placed) > sectorBytes)
+                break;
+            end = next;
+        }
+        if (!placeStaged(placed, end)) {
+            ok = false;
             break;
+        }
+        placed = end;
+    }
+    dropStaged(placed);
+    return ok;
+}
 
-        uint32_t key = readUInt32(address + sizeof(uint16_t));
-        if (written + sizeof(uint32_t) <= maxLen) {
-            memcpy(dst + written, &key, sizeof(uint32_t));
-            written += sizeof(uint32_t);
+bool StorageManager::discardStaged(uint32_t key) {
+    uint32_t limit = transactionOpen ? transactionStart : stageUsed;
+    bool dropped = false;
+    for (uint32_t offset = 0; offset < limit;) {
+        const uint32_t end = stagedGroupEnd(offset);
+        Record record = stagedRecord(offset);
+        if (end - offset != recordSize(record.length) || record.key != key) {
+            offset = end;  // another key, or a committed transaction: kept whole
+            continue;
         }
+        const uint32_t size = end - offset;
+        memmove(stage + offset, stage + end, stageUsed - end);
+        memset(stage + stageUsed - size, 0, size);  // staged values may be secrets
+        stageUsed -= size;
+        limit -= size;
+        if (transactionOpen)
+            transactionStart -= size;
+        dropped = true;
+    }
+    if (dropped)
+        rebuildDirectory();  // the key is back to its value in flash, if any
+    return dropped;
+}
 
-        address += ENTRY_OVERHEAD + entryLength;
+bool StorageManager::isStaged(uint32_t key) {
+    uint32_t address = 0;
+    uint16_t valueLength = 0;
+    return findValue(key, address, valueLength) && (address & STAGED_ADDRESS);
+}
+
+bool StorageManager::placeStaged(uint32_t start, uint32_t end) {
+    const uint32_t pageBytes = backend.pageSize();
+    const uint32_t address = head * sectorBytes + sectors[head].used;
+    sectors[head].used += end - start;  // consumed even if programming fails
+
+    // 1. data, with the commit bytes that publish records still erased (transaction
+    //    records are published by their commit record)
+    for (uint32_t offset = start; offset < end; offset += recordSize(stagedRecord(offset).length)) {
+        if (!isTransactionRecord(stage[offset + 2]))
+            stage[offset + 3] = 0xFF;
+    }
+    bool ok = programBytes(address, nullptr, 0, stage + start, 0, (uint16_t)(end - start));
+
+    // nothing is committed unless every byte made it to flash
+    ok = ok && equalsStored(address, stage + start, (uint16_t)(end - start));
+
+    // 2. commit bytes in log order, one program per page
+    uint32_t commitPage = UINT32_MAX;
+    for (uint32_t offset = start; offset < end; offset += recordSize(stagedRecord(offset).length)) {
+        if (isTransactionRecord(stage[offset + 2]))
+            continue;
+        stage[offset + 3] = RECORD_COMMITTED;
+        const uint32_t commitAddress = address + (offset - start) + 3;
+        const uint32_t pageStart = commitAddress - commitAddress % pageBytes;
+        if (!ok)
+            continue;
+        if (pageStart != commitPage) {
+            if (commitPage != UINT32_MAX && !backend.programPage(commitPage, page))
+                ok = false;
+            memset(page, 0xFF, pageBytes);
+            commitPage = pageStart;
+        }
+        page[commitAddress - pageStart] = RECORD_COMMITTED;
+    }
+    if (ok && commitPage != UINT32_MAX)
+        ok = backend.programPage(commitPage, page);
+    if (!ok) {
+        sectors[head].used = sectorBytes;  // contents unknown: no more appends
+        return false;
     }
 
+    // the directory now points at flash
+    for (uint32_t offset = start; offset < end;) {
+        Record record = stagedRecord(offset);
+        const uint32_t size = recordSize(record.length);
+        const uint32_t valueAddress = address + (offset - start) + RECORD_HEADER_SIZE;
+        offset += size;
+        if (!isValueRecord(record.type))
+            continue;
+        int32_t slot = directorySlotOf(record.key);
+        if (slot >= 0 && directory[slot].address == record.address) {
+            directory[slot].address = valueAddress;
+            sectors[head].live += size;
+        } else if (slot < 0 && !directoryComplete) {
+            sectors[head].live += size;  // not indexed: assume live
+        }
+    }
+    return true;
+}
+
+void StorageManager::dropStaged(uint32_t bytes) {
+    if (bytes == 0)
+        return;
+    memmove(stage, stage + bytes, stageUsed - bytes);
+    memset(stage + stageUsed - bytes, 0, bytes);  // staged values may be secrets
+    stageUsed -= bytes;
+    transactionStart = transactionStart > bytes ? transactionStart - bytes : 0;
+    for (uint32_t i = 0; i < STORAGE_DIRECTORY_SLOTS; i++) {
+        if (directory[i].address & STAGED_ADDRESS)
+            directory[i].address -= bytes;
+    }
+}
+
+bool StorageManager::appendRecord(uint32_t key, uint8_t type, const uint8_t *value, uint32_t source,
+                                  uint16_t valueLength, bool compacting) {
+    uint32_t size = recordSize(valueLength);
+    if (size > sectorBytes - SECTOR_HEADER_SIZE || !makeRoom(size, compacting))
+        return false;
+
+    const uint32_t address = head * sectorBytes + sectors[head].used;
+    uint8_t header[RECORD_HEADER_SIZE] = {
+        (uint8_t)valueLength, (uint8_t)(valueLength >> 8), type, 0xFF };  // commit byte still erased
+    uint32_t crc = 0;
+    putUInt32(header + 4, key);
+    if (!recordCrc(header, value, source, valueLength, crc))
+        return false;
+    putUInt32(header + 8, crc);
+    sectors[head].used += size;  // consumed even if programming fails
+
+    // data first, verified, then the commit byte: a record is only replayed once complete
+    const uint8_t commit = RECORD_COMMITTED;
+    uint32_t stored = 0;
+    if (!programBytes(address, header, sizeof(header), value, source, valueLength) ||
+        !equalsStored(address, header, sizeof(header)) ||
+        !recordCrc(header, nullptr, address + RECORD_HEADER_SIZE, valueLength, stored) || stored != crc ||
+        !programBytes(address + 3, &commit, 1, nullptr, 0, 0)) {
+        sectors[head].used = sectorBytes;  // contents unknown: no more appends
+        return false;
+    }
+
+    Record record = { key, address + RECORD_HEADER_SIZE, valueLength, type };
+    applyRecord(record);
+    return true;
+}
+
+bool StorageManager::makeRoom(uint16_t size, bool compacting) {
+    // each round opens a sector or compacts one; bounded in case the log holds only live data
+    for (uint8_t round = 0; round <= sectorCount; round++) {
+        if (head != NO_SECTOR && sectors[head].used + size <= sectorBytes)
+            return true;
+        if (freeSectors() > (compacting ? 0 : STORAGE_RESERVED_SECTORS))
+            return openSector();
+        if (compacting || !compactOldest())
+            return false;
+    }
+    return false;
+}
+
+bool StorageManager::openSector() {
+    uint8_t best = NO_SECTOR;
+    for (uint8_t s = 0; s < sectorCount; s++) {
+        if (sectors[s].state == SECTOR_LOG)
+            continue;
+        if (best == NO_SECTOR || sectors[s].eraseCount < sectors[best].eraseCount ||
+            (sectors[s].eraseCount == sectors[best].eraseCount &&
+             sectors[s].state == SECTOR_ERASED && sectors[best].state == SECTOR_DIRTY))
+            best = s;
+    }
+    if (best == NO_SECTOR)
+        return false;
+    if (sectors[best].state == SECTOR_DIRTY && !eraseSector(best))
+        return false;
+
+    SectorInfo &info = sectors[best];
+    if (!writeSectorHeader(best, info.eraseCount, maxSequence + 1))
+        return false;
+    info.sequence = ++maxSequence;
+    info.used = SECTOR_HEADER_SIZE;
+    info.live = 0;
+    info.state = SECTOR_LOG;
+    head = best;
+    return true;
+}
+
+bool StorageManager::compactOldest() {
+    if (stageUsed > 0)
+        return false;  // staged records may supersede the victim's values
+    uint8_t order[STORAGE_MAX_SECTORS];
+    if (logOrder(order) == 0)
+        return false;
+    const uint8_t victim = order[0];
+    if (victim == head)
+        sectors[head].used = sectorBytes;  // copies go to a new sector
+
+    uint32_t offset = SECTOR_HEADER_SIZE;
+    Record record;
+    while (readRecord(victim, offset, record) == RECORD_OK) {
+        if (!isValueRecord(record.type))
+            continue;  // oldest sector: a tombstone has nothing older left to hide
+        uint32_t address = 0;
+        uint16_t length = 0;
+        if (!findValue(record.key, address, length) || address != record.address)
+            continue;  // superseded or deleted
+        if (!appendRecord(record.key, RECORD_VALUE, nullptr, record.address, record.length, true))
+            return false;
+    }
+    return eraseSector(victim);
+}
+
+bool StorageManager::service() {
+    if (transactionOpen)
+        return false;  // its records stay staged until committed
+    if (stageUsed > 0)
+        return flush();
+
+    uint8_t order[STORAGE_MAX_SECTORS];
+    if (logOrder(order) == 0)
+        return false;
+    const SectorInfo &oldest = sectors[order[0]];
+
+    // free space: reclaim the oldest sector's dead records
+    bool dead = oldest.live + SECTOR_HEADER_SIZE < oldest.used;
+    if (dead && freeSectors() < STORAGE_COMPACT_FREE_SECTORS)
+        return compactOldest();
+
+    // static wear levelling: move data that never changes off the least worn sector
+    uint32_t maxErases = 0;
+    for (uint8_t s = 0; s < sectorCount; s++)
+        maxErases = std::max(maxErases, sectors[s].eraseCount);
+    if (order[0] != head && maxErases - oldest.eraseCount >= STORAGE_WEAR_SPREAD)
+        return compactOldest();
+    return false;
+}
+
+bool StorageManager::eraseSector(uint8_t sector) {
+    SectorInfo &info = sectors[sector];
+    const uint32_t eraseCount = info.eraseCount + 1;
+    if (!backend.eraseSector(sector))
+        return false;
+    liveBytes -= info.live;  // only nonzero if live records could not be moved
+    memset(&info, 0, sizeof(info));
+    info.eraseCount = eraseCount;
+    info.sequence = SECTOR_FREE_SEQUENCE;
+    info.used = SECTOR_HEADER_SIZE;
+    info.state = SECTOR_ERASED;
+    if (head == sector)
+        head = NO_SECTOR;
+    return writeSectorHeader(sector, eraseCount, SECTOR_FREE_SEQUENCE);
+}
+
+bool StorageManager::writeSectorHeader(uint8_t sector, uint32_t eraseCount, uint32_t sequence) {
+    uint8_t header[SECTOR_HEADER_SIZE];
+    putUInt32(header, STORAGE_LOG_MAGIC);
+    putUInt32(header + 4, eraseCount);
+    putUInt32(header + 8, sequence);
+    putUInt32(header + 12, 0xFFFFFFFFu);
+    blank = false;
+    return programBytes(sector * sectorBytes, header, sizeof(header), nullptr, 0, 0);
+}
+
+///////////////////////////////////////////////////////////////
+// Legacy EEPROM Import
+///////////////////////////////////////////////////////////////
+
+bool StorageManager::importLegacy(const uint8_t* image, size_t size) {
+    if (!image || size < HEADER_SIZE)
+        return false;
+    uint16_t magic = (uint16_t)((image[0] << 8) | image[1]);
+    uint16_t totalUsed = (uint16_t)((image[2] << 8) | image[3]);
+    if (magic != EEPROM_MAGIC || totalUsed < HEADER_SIZE || totalUsed > size)
+        return false;
+    if (!blank)
+        return true;  // migrated on an earlier boot
+
+    uint32_t address = HEADER_SIZE;
+    while (address + ENTRY_OVERHEAD <= totalUsed) {
+        const uint8_t *p = image + address;
+        uint16_t valueLength = (uint16_t)((p[0] << 8) | p[1]);
+        uint32_t key = getUInt32(p + 2);
+        address += ENTRY_OVERHEAD;
+        if (address + valueLength > totalUsed)
+            break;  // corrupted entry
+
+        // the first entry of a key wins, as in the legacy lookup
+        if (valueLength > 0 && !keyExists(key) &&
+            !writeKeyValue(key, const_cast<uint8_t*>(image + address), valueLength))
+            return false;
+        address += valueLength;
+    }
+    blank = false;
+    return flush();  // the caller erases the image next
+}
+
+///////////////////////////////////////////////////////////////
+// Debug & Inspection
+///////////////////////////////////////////////////////////////
+
+bool StorageManager::debugDumpKeys(uint8_t *dst, size_t maxLen, size_t &outLen) {
+    size_t written = 0;
+    walkLog([&](const Record &record) {
+        uint32_t address = 0;
+        uint16_t length = 0;
+        if (!isValueRecord(record.type) || !findValue(record.key, address, length) ||
+            address != record.address)
+            return;  // only live values
+        if (written + sizeof(uint32_t) <= maxLen) {
+            memcpy(dst + written, &record.key, sizeof(uint32_t));
+            written += sizeof(uint32_t);
+        }
+    }, nullptr);
+
     outLen = written;
     return (written > 0);
 }
 
 ///////////////////////////////////////////////////////////////
-// EEPROM Read/Write Utility Helpers
+// Flash Access Helpers
+//
+// Flash is programmed a whole page at a time. Bytes outside the range are
+// left at 0xFF in the page buffer, which programs nothing, so appending a
+// record never touches the records before it.
 ///////////////////////////////////////////////////////////////
 
-void StorageManager::writeUInt16(uint16_t address, uint16_t value) {
-    EEPROM.write(address, (value >> 8) & 0xFF); // high byte first
-    EEPROM.write(address + 1, value & 0xFF);    // low byte second
-}
+bool StorageManager::programBytes(uint32_t address, const uint8_t *prefix, uint16_t prefixLength,
+                                  const uint8_t *data, uint32_t source, uint16_t dataLength) {
+    const uint32_t pageBytes = backend.pageSize();
+    const uint32_t dataStart = address + prefixLength;
+    const uint32_t end = dataStart + dataLength;
+
+    for (uint32_t pageStart = address - address % pageBytes; pageStart < end; pageStart += pageBytes) {
+        const uint32_t pageEnd = pageStart + pageBytes;
+        memset(page, 0xFF, pageBytes);
+
+        uint32_t from = std::max(address, pageStart);
+        uint32_t to = std::min(dataStart, pageEnd);
+        if (from < to)
+            memcpy(page + (from - pageStart), prefix + (from - address), to - from);
+
+        from = std::max(dataStart, pageStart);
+        to = std::min(end, pageEnd);
+        if (from < to) {
+            if (data)
+                memcpy(page + (from - pageStart), data + (from - dataStart), to - from);
+            else if (!backend.read(source + (from - dataStart), page + (from - pageStart), to - from))
+                return false;
+        }
 
-uint16_t StorageManager::readUInt16(uint16_t address) {
-    return (EEPROM.read(address) << 8) | EEPROM.read(address + 1);
+        if (!backend.programPage(pageStart, page))
+            return false;
+    }
+    return true;
 }
 
-void StorageManager::writeUInt32(uint16_t address, uint32_t value) {
-    for (int i = 0; i < 4; i++)
-        EEPROM.write(address + i, (value >> (8 * i)) & 0xFF);
+bool StorageManager::readStored(uint32_t address, uint8_t *dst, uint16_t len) {
+    if (address & STAGED_ADDRESS) {
+        memcpy(dst, stage + (address & ~STAGED_ADDRESS), len);
+        return true;
+    }
+    return backend.read(address, dst, len);
 }
 
-uint32_t StorageManager::readUInt32(uint16_t address) {
-    uint32_t value = 0;
-    for (int i = 0; i < 4; i++)
-        value |= (uint32_t)EEPROM.read(address + i) << (8 * i);
-    return value;
+bool StorageManager::equalsStored(uint32_t address, const uint8_t *data, uint16_t len) {
+    uint8_t chunk[32];
+    for (uint16_t done = 0; done < len;) {
+        uint16_t n = std::min((uint16_t)sizeof(chunk), (uint16_t)(len - done));
+        if (!readStored(address + done, chunk, n) || memcmp(chunk, data + done, n) != 0)
+            return false;
+        done += n;
+    }
+    return true;
 }
 
-void StorageManager::writeBytes(uint16_t address, const uint8_t *data, uint16_t len) {
-    for (uint16_t i = 0; i < len; i++)
-        EEPROM.write(address + i, data[i]);
+uint32_t StorageManager::getUInt32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-void StorageManager::readBytes(uint16_t address, uint8_t *dst, uint16_t len) {
-    for (uint16_t i = 0; i < len; i++)
-        dst[i] = EEPROM.read(address + i);
+void StorageManager::putUInt32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        p[i] = (value >> (8 * i)) & 0xFF;  // low byte first
 }
@@ -1,72 +1,198 @@
 #ifndef STORAGE_MANAGER_H
 #define STORAGE_MANAGER_H
 
-#include <EEPROM.h>
+#include "storage/backend/IStorageBackend.h"
 #include <algorithm>
+#include <string.h>
 
-#define EEPROM_MAGIC 0xFA55
+#define STORAGE_LOG_MAGIC 0x544C5054u    // "TPLT": sector holds log records
+#define SECTOR_HEADER_SIZE 16            // magic, erase count, sequence, reserved
+#define RECORD_HEADER_SIZE 12            // length, type, commit, key, CRC
+#define RECORD_VALUE 0xA5
+#define RECORD_TOMBSTONE 0x5A
+#define RECORD_TXN_VALUE 0xA6            // value written in a transaction
+#define RECORD_TXN_TOMBSTONE 0x59        // delete in a transaction
+#define RECORD_TXN_COMMIT 0xC3           // applies the transaction records before it
+#define RECORD_COMMITTED 0x00            // commit byte, programmed after the record
+#define SECTOR_FREE_SEQUENCE 0xFFFFFFFFu // sequence of an erased sector awaiting use
+
+#define EEPROM_MAGIC 0xFA55              // legacy EEPROM layout (importLegacy())
 #define HEADER_SIZE 4  // 2 bytes magic + 2 bytes totalUsed
 #define ENTRY_OVERHEAD (sizeof(uint16_t) + sizeof(uint32_t))  // len + key
 
+#if defined(TP_STORAGE_DIRECTORY_SLOTS)
+#define STORAGE_DIRECTORY_SLOTS TP_STORAGE_DIRECTORY_SLOTS
+#else
+#define STORAGE_DIRECTORY_SLOTS 64  // RAM directory slots (power of two, 12 bytes each)
+#endif
+#define STORAGE_DIRECTORY_MAX_KEYS (STORAGE_DIRECTORY_SLOTS * 3 / 4)  // keep probe chains short
+
+#if defined(TP_STORAGE_MAX_SECTORS)
+#define STORAGE_MAX_SECTORS TP_STORAGE_MAX_SECTORS
+#else
+#define STORAGE_MAX_SECTORS 128  // 0.5 MB filesystem region / 4 KB sectors
+#endif
+
+#if defined(TP_STORAGE_COMPACT_FREE_SECTORS)
+#define STORAGE_COMPACT_FREE_SECTORS TP_STORAGE_COMPACT_FREE_SECTORS
+#else
+#define STORAGE_COMPACT_FREE_SECTORS 2  // service() compacts while fewer sectors are free
+#endif
+
+#if defined(TP_STORAGE_WEAR_SPREAD)
+#define STORAGE_WEAR_SPREAD TP_STORAGE_WEAR_SPREAD
+#else
+#define STORAGE_WEAR_SPREAD 16  // erase count gap that makes service() move static data
+#endif
+
+#if defined(TP_STORAGE_STAGE_SIZE)
+#define STORAGE_STAGE_SIZE TP_STORAGE_STAGE_SIZE
+#else
+#define STORAGE_STAGE_SIZE 1024  // RAM stage for records awaiting flush() (multiple of 4)
+#endif
+
+#define STORAGE_RESERVED_SECTORS 1  // always kept free as compaction target
+#define STORAGE_MIN_SECTORS (STORAGE_RESERVED_SECTORS + 2)  // reserved, head, one to compact
+
 /**
  * @class StorageManager
- * @brief Simple key-value storage manager for Arduino EEPROM.
+ * @brief Log-structured, wear-levelled key-value store on flash.
+ *
+ * The log lives in an IStorageBackend: the flash filesystem region on the device, the
+ * EEPROM emulation as fallback, simulated flash in RAM or a memory-mapped file in
+ * native builds. Records are only ever appended, so a write costs a page program or
+ * two instead of a sector rewrite.
  *
- * Data layout in EEPROM:
- * [0..1]   = Magic number (0xFA55)
- * [2..3]   = Total used bytes (uint16_t)
- * [4..N]   = Repeated entries of [length][key][data]
+ * Sector layout:
+ * [0..15]  = Header: magic (STORAGE_LOG_MAGIC), erase count, sequence, reserved
+ * [16..N]  = Records, 4-byte aligned, until the first erased byte
  *
- * Each entry:
+ * Each record:
  *   uint16_t length  → number of bytes in data
+ *   uint8_t  type    → RECORD_VALUE, RECORD_TOMBSTONE (delete), RECORD_TXN_VALUE,
+ *                      RECORD_TXN_TOMBSTONE or RECORD_TXN_COMMIT
+ *   uint8_t  commit  → RECORD_COMMITTED once data is fully programmed
  *   uint32_t key     → unique 32-bit identifier
+ *   uint32_t crc     → CRC-32 of length, type, key and data
  *   uint8_t  data[]  → arbitrary binary payload
+ *
+ * Sectors are replayed in sequence order, so the newest record of a key wins and a
+ * tombstone hides older values. A record without its commit byte (power lost while
+ * writing) or failing its CRC is ignored and seals its sector.
+ *
+ * New sectors are taken from the free ones with the lowest erase count, erased ones
+ * first (a dirty sector may still hold a legacy image being migrated). Compaction
+ * copies the live records of the oldest sector to the head of the log and erases it;
+ * it runs when a write needs room and from service() once fewer than
+ * STORAGE_COMPACT_FREE_SECTORS sectors are free. Oldest-first rotation spreads erases
+ * over every sector, and service() also moves a fully live oldest sector once it has
+ * STORAGE_WEAR_SPREAD fewer erases than the most worn one (static wear levelling).
+ *
+ * begin() replays the log once into a RAM directory (key → value address/length, an
+ * open-addressing hash table), so lookups never walk the log. Beyond
+ * STORAGE_DIRECTORY_MAX_KEYS keys, keys missing from the directory are looked up by
+ * scanning the log.
+ *
+ * Writes are deferred: writeKeyValue(), updateKeyValue() and deleteKey() stage their
+ * record in a RAM buffer of STORAGE_STAGE_SIZE bytes and reads see it at once. flush()
+ * (run by service() when the device is idle, or when the stage is full) places every
+ * staged record with one program per page, reads them back against the stage, then
+ * programs their commit bytes in log order: a record is only committed once its bytes
+ * are known to be in flash, so a successful flush() needs no further verification.
+ * Records written between beginTransaction() and commitTransaction() are followed by a
+ * RECORD_TXN_COMMIT record and only replayed once it is committed.
+ *
+ * Crash consistency (power lost at any point):
+ *  - A write is durable once flush() returned true; staged writes are lost.
+ *  - Records commit in the order they were written, so the log recovers to a prefix of
+ *    the writes: a record is never replayed without every record written before it.
+ *  - A transaction recovers entirely or not at all.
+ *  - A value is never overwritten in place: the previous value stays readable until the
+ *    record replacing it is committed. The log is its own journal: the sector holding
+ *    the old record and the one receiving the new record act as A and B copies.
+ *  - A record damaged after it was committed (bit rot, a torn program) fails its CRC
+ *    and is dropped on the next begin(), like a torn record.
+ *  - Compaction only runs with an empty stage, and erases a sector only after its live
+ *    records were committed elsewhere.
+ *  - factoryReset() and values larger than the stage are written immediately.
  */
 class StorageManager {
 public:
-    StorageManager();
+    /**
+     * @brief Construct a StorageManager on a backend.
+     *
+     * @param backend Flash holding the log (must outlive the manager).
+     */
+    explicit StorageManager(IStorageBackend& backend);
 
     /**
-     * @brief Initialize the EEPROM manager and validate or reset header.
-     * 
-     * @param size Total EEPROM size in bytes (typically EEPROM.length()).
+     * @brief Open the backend and replay the log into the directory.
+     *
+     * @return true if the backend is usable, false otherwise.
      */
-    void begin(size_t size);
+    bool begin();
 
     /**
-     * @brief Get total EEPROM capacity in bytes.
-     * 
-     * @return EEPROM size (as provided to begin()).
+     * @brief Whether begin() found no log at all (never formatted, e.g. first boot
+     *        after upgrading from the EEPROM layout).
+     */
+    bool isBlank() const;
+
+    /**
+     * @brief Get the number of value bytes the log can hold (record overhead included).
      */
     size_t capacity();
 
     /**
-     * @brief Erase the entire EEPROM and reset the header.
-     * 
-     * Writes the magic number (0xFA55) and initializes the
-     * totalUsedBytes field to the header size.
+     * @brief Get the bytes held by live records.
+     */
+    size_t usedBytes() const;
+
+    /**
+     * @brief Erase every sector in use and empty the directory.
+     *
+     * Erase counts are carried over into the new sector headers.
      */
     void factoryReset();
 
     /**
-     * @brief Write a key-value pair to EEPROM.
-     * 
-     * Format: [length][key][data].
+     * @brief Write a key-value pair.
+     *
      * The write is rejected if the key already exists or if
      * insufficient space remains.
      *
      * @param key 32-bit unique identifier for this entry.
      * @param value Pointer to the data buffer to store.
-     * @param len Length of data in bytes.
+     * @param valueLength Length of data in bytes.
      * @return true if successful, false otherwise.
      */
     bool writeKeyValue(uint32_t key, uint8_t* value, uint16_t valueLength);
 
+    /**
+     * @brief Write a key-value pair, replacing the value of an existing key.
+     *
+     * The new record supersedes the old one (any length); rewriting an identical value
+     * is skipped. A missing key is written like writeKeyValue().
+     *
+     * @param key 32-bit unique identifier for this entry.
+     * @param value Pointer to the data buffer to store.
+     * @param valueLength Length of data in bytes.
+     * @return true if successful, false otherwise.
+     */
+    bool updateKeyValue(uint32_t key, const uint8_t* value, uint16_t valueLength);
+
+    /**
+     * @brief Delete a key by appending a tombstone.
+     *
+     * @param key 32-bit identifier.
+     * @return true if the key existed and was deleted, false otherwise.
+     */
+    bool deleteKey(uint32_t key);
+
     /**
      * @brief Read the value associated with a given key.
-     * 
-     * Scans sequentially for the key and copies its data
-     * into the provided buffer (up to expectedLen).
+     *
+     * Copies the data into the provided buffer (up to expectedLen).
      *
      * @param key 32-bit identifier.
      * @param dst Destination buffer for data.
@@ -76,104 +202,439 @@ public:
     bool readValueByKey(uint32_t key, uint8_t* dst, uint16_t expectedLen);
 
     /**
-     * @brief Check if a key already exists in EEPROM.
+     * @brief Check if a key exists.
      *
      * @param key 32-bit identifier to search for.
      * @return true if found, false otherwise.
      */
     bool keyExists(uint32_t key);
 
+    /**
+     * @brief Start a transaction: the writes until commitTransaction() recover together.
+     *
+     * Makes sure a full stage can be placed, so the transaction's writes only fail if
+     * they do not fit in the stage.
+     *
+     * @return true if the transaction was started, false if one is open or the log is full.
+     */
+    bool beginTransaction();
+
+    /**
+     * @brief Close the open transaction; its records are flushed with the rest of the stage.
+     *
+     * @return true if a transaction was open, false otherwise.
+     */
+    bool commitTransaction();
+
+    /**
+     * @brief Discard the writes of the open transaction.
+     */
+    void abortTransaction();
+
+    /**
+     * @brief Whether a transaction is open.
+     */
+    bool inTransaction() const;
+
+    /**
+     * @brief Whether staged writes await flush().
+     */
+    bool hasPendingWrites() const;
+
+    /**
+     * @brief Program the staged records (except those of an open transaction) to flash.
+     *
+     * @return true if every committed write is durable, false otherwise.
+     */
+    bool flush();
+
+    /**
+     * @brief Drop the staged records of a key, e.g. after a failed flush(), so the key
+     *        reads as flash holds it. Records of a transaction are kept.
+     *
+     * @param key 32-bit identifier.
+     * @return true if records were dropped, false otherwise.
+     */
+    bool discardStaged(uint32_t key);
+
+    /**
+     * @brief Whether the value of a key is staged, i.e. not yet in flash.
+     *
+     * @param key 32-bit identifier.
+     * @return true if the key's newest record awaits flush(), false otherwise.
+     */
+    bool isStaged(uint32_t key);
+
+    /**
+     * @brief Background maintenance: flush staged writes, otherwise compact one sector if
+     *        free space is low or wear is uneven. Call when idle.
+     *
+     * @return true if records were flushed or a sector was compacted.
+     */
+    bool service();
+
+    /**
+     * @brief Copy the entries of a legacy EEPROM image into the log.
+     *
+     * Legacy layout: [magic 0xFA55][totalUsed] (big-endian) followed by entries of
+     * [uint16_t length (big-endian)][uint32_t key (little-endian)][data]. Only runs on a
+     * blank log, so data already migrated is never duplicated.
+     *
+     * @param image Legacy EEPROM contents (may be NULL).
+     * @param size Length of the image.
+     * @return true if the legacy data is held by the log (imported now or before) and the
+     *         image can be erased, false if there is nothing to import or it failed.
+     */
+    bool importLegacy(const uint8_t* image, size_t size);
+
+    /**
+     * @brief Get the erase count of a sector, as recorded in its header.
+     */
+    uint32_t sectorEraseCount(size_t sector) const;
+
     // Debug tools
     bool debugDumpKeys(uint8_t *dst, size_t maxLen, size_t &outLen);
 
 
 private:
-    size_t eepromSize;
+    static_assert((STORAGE_DIRECTORY_SLOTS & (STORAGE_DIRECTORY_SLOTS - 1)) == 0,
+                  "STORAGE_DIRECTORY_SLOTS must be a power of two");
+
+    static const uint8_t NO_SECTOR = 0xFF;
+    static_assert(STORAGE_MAX_SECTORS < NO_SECTOR, "sector indexes are 8-bit");
+    static_assert(STORAGE_STAGE_SIZE % 4 == 0 && STORAGE_STAGE_SIZE <= 0x8000,
+                  "STORAGE_STAGE_SIZE must be a multiple of 4, at most 32 KB");
+
+    /// Address flag of a value held by the stage (low bits: offset in the stage)
+    static const uint32_t STAGED_ADDRESS = 0x80000000u;
+
+    /// Directory slot: where a key's value lives (address 0 = empty slot)
+    struct DirectoryEntry {
+        uint32_t key;
+        uint32_t address;
+        uint16_t length;
+    };
+
+    enum SectorState : uint8_t {
+        SECTOR_ERASED = 0,  ///< Free, ready to be opened
+        SECTOR_DIRTY,       ///< Free, unknown contents: erase before use
+        SECTOR_LOG          ///< Part of the log
+    };
+
+    struct SectorInfo {
+        uint32_t eraseCount;
+        uint32_t sequence;
+        uint16_t used;   ///< Write offset (sectorSize = sealed)
+        uint16_t live;   ///< Bytes of live value records
+        SectorState state;
+    };
+
+    /// A record as read back from flash
+    struct Record {
+        uint32_t key;
+        uint32_t address;  ///< Address of the value
+        uint16_t length;
+        uint8_t type;
+    };
+
+    enum RecordScan : uint8_t {
+        RECORD_OK,   ///< Record read, offset advanced past it
+        RECORD_END,  ///< Erased space: end of the sector's records
+        RECORD_TORN  ///< Uncommitted or corrupted record
+    };
+
+    IStorageBackend& backend;
+    size_t sectorBytes;
+    uint8_t sectorCount;
+    SectorInfo sectors[STORAGE_MAX_SECTORS];
+    uint8_t head;                ///< Sector receiving appends (NO_SECTOR = none yet)
+    uint32_t maxSequence;
+    size_t liveBytes;
+    bool blank;
+    uint8_t page[STORAGE_PAGE_SIZE];  ///< Page program buffer
+    uint8_t stage[STORAGE_STAGE_SIZE];  ///< Records awaiting flush(), in write order
+    uint16_t stageUsed;
+    uint16_t transactionStart;  ///< Stage offset of the open transaction's first record
+    bool transactionOpen;
+    DirectoryEntry directory[STORAGE_DIRECTORY_SLOTS];
+    uint16_t directoryKeys;    ///< Keys indexed in the directory
+    bool directoryComplete;    ///< Every key in the log is indexed (a miss means absent)
 
     ///////////////////////////////////////////////////////////////
-    // Header Utilities
+    // Directory
     ///////////////////////////////////////////////////////////////
 
     /**
-     * @brief Determine if header value is invalid or corrupted.
+     * @brief Empty the directory (nothing stored).
+     */
+    void clearDirectory();
+
+    /**
+     * @brief Replay the log in sequence order, then the stage, and index every live value.
+     */
+    void rebuildDirectory();
+
+    /**
+     * @brief Visit the records in effect, oldest first: the log in sequence order (a
+     *        transaction's records once its commit record is read), then the stage.
+     *
+     * @param visit Called with each record.
+     * @param ends Receives each log sector's write offset (sectorSize = sealed), may be NULL.
+     */
+    template <typename Visit>
+    void walkLog(Visit visit, uint16_t *ends);
+
+    /**
+     * @brief Apply a record to the directory and the live byte counts.
      *
-     * @param headerValue Value read from header (totalUsedBytes).
-     * @return true if invalid, false otherwise.
+     * @param record Record to apply (newer than every record applied before).
      */
-    bool isHeaderInvalid(uint16_t headerValue);
+    void applyRecord(const Record &record);
 
     /**
-     * @brief Erase all EEPROM bytes to 0xFF.
+     * @brief Find the directory slot of a key.
+     *
+     * @return Slot index, or -1 if the key is not indexed.
      */
-    void eraseEEPROM();
+    int32_t directorySlotOf(uint32_t key);
 
     /**
-     * @brief Write total used bytes field in header.
+     * @brief Remove a slot, shifting back the entries probed past it.
      *
-     * @param value New total used bytes.
+     * @param slot Slot index.
      */
-    void writeTotalUsedBytes(uint16_t value);
+    void removeSlot(uint32_t slot);
 
     /**
-     * @brief Read total used bytes from header.
+     * @brief Find the newest record of a key by walking the log (directory overflow).
      *
-     * @return Number of bytes currently in use, including header.
+     * @param key 32-bit identifier.
+     * @param valueAddress Receives the address of the value.
+     * @param valueLength Receives the length of the value.
+     * @return true if found, false otherwise.
      */
-    uint16_t readTotalUsedBytes();
+    bool scanForValue(uint32_t key, uint32_t &valueAddress, uint16_t &valueLength);
+
+    /**
+     * @brief Find the value of a key through the directory (scans the log on overflow).
+     *
+     * @param key 32-bit identifier.
+     * @param valueAddress Receives the address of the value.
+     * @param valueLength Receives the length of the value.
+     * @return true if found, false otherwise.
+     */
+    bool findValue(uint32_t key, uint32_t &valueAddress, uint16_t &valueLength);
 
     ///////////////////////////////////////////////////////////////
-    // Low-level EEPROM access helpers
+    // Log
     ///////////////////////////////////////////////////////////////
 
     /**
-     * @brief Write a 16-bit unsigned integer to EEPROM.
+     * @brief Bytes a record occupies in the log (header + value, 4-byte aligned).
+     */
+    static uint32_t recordSize(uint16_t valueLength);
+
+    /**
+     * @brief Fill order[] with the log sectors, oldest first.
+     *
+     * @return Number of log sectors.
+     */
+    uint8_t logOrder(uint8_t *order);
+
+    /**
+     * @brief Count the sectors not in the log.
+     */
+    uint8_t freeSectors();
+
+    /**
+     * @brief Read the record at an offset of a sector.
      *
-     * @param address Byte offset in EEPROM.
-     * @param value 16-bit value to write.
+     * @param sector Sector index.
+     * @param offset Offset of the record; advanced past it on RECORD_OK.
+     * @param record Receives the record.
      */
-    void writeUInt16(uint16_t address, uint16_t value);
+    RecordScan readRecord(uint8_t sector, uint32_t &offset, Record &record);
 
     /**
-     * @brief Read a 16-bit unsigned integer from EEPROM.
+     * @brief Compute the CRC of a record: its length, type and key, then its value.
      *
-     * @param address Byte offset in EEPROM.
-     * @return The 16-bit value read.
+     * @param header Record header (the commit byte and CRC field are skipped).
+     * @param value Value bytes, or NULL to read them from source.
+     * @param source Address of the value when value is NULL (may carry STAGED_ADDRESS).
+     * @param valueLength Length of the value.
+     * @param crc Receives the CRC.
+     * @return true if the value could be read, false otherwise.
      */
-    uint16_t readUInt16(uint16_t address);
+    bool recordCrc(const uint8_t *header, const uint8_t *value, uint32_t source,
+                   uint16_t valueLength, uint32_t &crc);
 
     /**
-     * @brief Write a 32-bit unsigned integer to EEPROM.
+     * @brief Update a CRC-32 (IEEE 802.3, reflected) with bytes.
      *
-     * @param address Byte offset in EEPROM.
-     * @param value 32-bit value to write.
+     * @param crc CRC so far (0 to start).
+     * @param data Bytes to add.
+     * @param len Number of bytes.
+     * @return The updated CRC.
      */
-    void writeUInt32(uint16_t address, uint32_t value);
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t len);
 
     /**
-     * @brief Read a 32-bit unsigned integer from EEPROM.
+     * @brief Append a record to the stage, flushing it first if it is full.
      *
-     * @param address Byte offset in EEPROM.
-     * @return The 32-bit value read.
+     * @param key 32-bit identifier.
+     * @param type RECORD_VALUE or RECORD_TOMBSTONE (turned into the transaction types
+     *             while a transaction is open).
+     * @param value Value bytes (NULL for a tombstone).
+     * @param valueLength Length of the value.
+     * @return true if the record was staged (or written, if larger than the stage).
+     */
+    bool stageRecord(uint32_t key, uint8_t type, const uint8_t *value, uint16_t valueLength);
+
+    /**
+     * @brief Get the stage record at an offset.
+     */
+    Record stagedRecord(uint32_t offset) const;
+
+    /**
+     * @brief Get the end of the record group at an offset of the stage: a single record,
+     *        or a transaction's records and its commit record, which share a sector.
      */
-    uint32_t readUInt32(uint16_t address);
+    uint32_t stagedGroupEnd(uint32_t offset) const;
 
     /**
-     * @brief Write a sequence of bytes to EEPROM.
+     * @brief Usable stage size (a stage must fit in one sector).
+     */
+    uint32_t stageCapacity() const;
+
+    /**
+     * @brief Make sure the stage plus extra bytes can be placed without compaction,
+     *        flushing or compacting (only with an empty stage) as needed.
      *
-     * @param address Starting address.
-     * @param data Source buffer.
-     * @param len Number of bytes to write.
+     * @param extra Bytes about to be staged.
+     * @return true if there is room, false if the log is full.
+     */
+    bool ensureRoom(uint32_t extra);
+
+    /**
+     * @brief Program stage records to the head sector: data first, verified against the
+     *        stage, then the commit bytes in log order, and point the directory at them.
+     *
+     * @param start Stage offset of the first record.
+     * @param end Stage offset past the last record (must fit in the head).
+     * @return true if successful, false otherwise (the head is sealed).
+     */
+    bool placeStaged(uint32_t start, uint32_t end);
+
+    /**
+     * @brief Remove the first bytes of the stage (placed or discarded records).
+     *
+     * @param bytes Number of bytes (whole records).
+     */
+    void dropStaged(uint32_t bytes);
+
+    /**
+     * @brief Append a record to the head of the log now, making room first if needed.
+     *
+     * @param key 32-bit identifier.
+     * @param type RECORD_VALUE or RECORD_TOMBSTONE.
+     * @param value Value bytes, or NULL to copy them from source.
+     * @param source Flash address of the value when value is NULL.
+     * @param valueLength Length of the value.
+     * @param compacting Called by compaction: may use the reserved sector.
+     * @return true if the record was verified and committed, false otherwise.
+     */
+    bool appendRecord(uint32_t key, uint8_t type, const uint8_t *value, uint32_t source,
+                      uint16_t valueLength, bool compacting);
+
+    /**
+     * @brief Make sure the head sector has room for a record.
+     *
+     * @param size Record size.
+     * @param compacting Called by compaction: may use the reserved sector.
+     * @return true if the head has room, false if the log is full.
+     */
+    bool makeRoom(uint16_t size, bool compacting);
+
+    /**
+     * @brief Start a new head sector: the free sector with the fewest erases.
+     *
+     * @return true if a sector was opened, false if none is free.
+     */
+    bool openSector();
+
+    /**
+     * @brief Copy the live records of the oldest sector to the head and erase it.
+     *
+     * @return true if a sector was compacted, false otherwise.
+     */
+    bool compactOldest();
+
+    /**
+     * @brief Erase a sector and write its free header with the next erase count.
+     *
+     * @param sector Sector index.
+     * @return true if successful, false otherwise.
      */
-    void writeBytes(uint16_t address, const uint8_t *data, uint16_t len);
+    bool eraseSector(uint8_t sector);
 
     /**
-     * @brief Read a sequence of bytes from EEPROM.
+     * @brief Program a sector header.
+     *
+     * @param sector Sector index.
+     * @param eraseCount Erase count to record.
+     * @param sequence Log sequence (SECTOR_FREE_SEQUENCE for a free sector).
+     * @return true if successful, false otherwise.
+     */
+    bool writeSectorHeader(uint8_t sector, uint32_t eraseCount, uint32_t sequence);
+
+    ///////////////////////////////////////////////////////////////
+    // Flash access helpers (page programs)
+    ///////////////////////////////////////////////////////////////
+
+    /**
+     * @brief Program bytes at any address; pages are padded with 0xFF, which leaves
+     *        the bytes around them unchanged.
      *
      * @param address Starting address.
+     * @param prefix Leading bytes (may be NULL if prefixLength is 0).
+     * @param prefixLength Number of leading bytes.
+     * @param data Following bytes, or NULL to copy them from source.
+     * @param source Flash address of the following bytes when data is NULL.
+     * @param dataLength Number of following bytes.
+     * @return true if every page was programmed, false otherwise.
+     */
+    bool programBytes(uint32_t address, const uint8_t *prefix, uint16_t prefixLength,
+                      const uint8_t *data, uint32_t source, uint16_t dataLength);
+
+    /**
+     * @brief Read stored bytes, from flash or from the stage.
+     *
+     * @param address Address of the stored bytes (may carry STAGED_ADDRESS).
      * @param dst Destination buffer.
-     * @param len Number of bytes to read.
+     * @param len Number of bytes.
+     * @return true if successful, false otherwise.
+     */
+    bool readStored(uint32_t address, uint8_t *dst, uint16_t len);
+
+    /**
+     * @brief Compare stored bytes with a buffer.
+     *
+     * @param address Address of the stored bytes.
+     * @param data Buffer to compare.
+     * @param len Number of bytes.
+     * @return true if equal, false otherwise.
+     */
+    bool equalsStored(uint32_t address, const uint8_t *data, uint16_t len);
+
+    /**
+     * @brief Read a little-endian 32-bit unsigned integer from a buffer.
+     */
+    static uint32_t getUInt32(const uint8_t *p);
+
+    /**
+     * @brief Write a little-endian 32-bit unsigned integer to a buffer.
      */
-    void readBytes(uint16_t address, uint8_t *dst, uint16_t len);
+    static void putUInt32(uint8_t *p, uint32_t value);
 };
 
 #endif // STORAGE_MANAGER_H
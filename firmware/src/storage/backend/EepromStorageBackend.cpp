@@ -0,0 +1,62 @@
+#include "storage/backend/EepromStorageBackend.h"
+#include <EEPROM.h>
+#include <string.h>
+
+EepromStorageBackend::EepromStorageBackend(size_t size)
+: size(size), open(false), programs(0), erases(0) {}
+
+bool EepromStorageBackend::begin() {
+    EEPROM.begin(size);
+    open = EEPROM.length() == size;
+    return open;
+}
+
+size_t EepromStorageBackend::sectorSize() const {
+    return EEPROM_BACKEND_SECTOR_SIZE;
+}
+
+size_t EepromStorageBackend::pageSize() const {
+    return STORAGE_PAGE_SIZE;
+}
+
+size_t EepromStorageBackend::sectorCount() const {
+    return open ? size / EEPROM_BACKEND_SECTOR_SIZE : 0;
+}
+
+bool EepromStorageBackend::read(uint32_t address, uint8_t* dst, size_t len) {
+    if (!open || (size_t)address + len > size) return false;
+    memcpy(dst, EEPROM.getConstDataPtr() + address, len);  // does not mark the shadow dirty
+    return true;
+}
+
+bool EepromStorageBackend::programPage(uint32_t address, const uint8_t* data) {
+    if (!open || address % STORAGE_PAGE_SIZE != 0 || (size_t)address + STORAGE_PAGE_SIZE > size) return false;
+    uint8_t* shadow = EEPROM.getDataPtr() + address;
+    for (size_t i = 0; i < STORAGE_PAGE_SIZE; i++) {
+        shadow[i] &= data[i];
+    }
+    programs++;
+    return EEPROM.commit();
+}
+
+bool EepromStorageBackend::eraseSector(size_t sector) {
+    if (sector >= sectorCount()) return false;
+    memset(EEPROM.getDataPtr() + sector * EEPROM_BACKEND_SECTOR_SIZE, 0xFF, EEPROM_BACKEND_SECTOR_SIZE);
+    erases++;
+    return EEPROM.commit();
+}
+
+uint32_t EepromStorageBackend::programCount() const {
+    return programs;
+}
+
+uint32_t EepromStorageBackend::eraseCount() const {
+    return erases;
+}
+
+const uint8_t* EepromStorageBackend::legacyImage(size_t& size) {
+    size = open ? this->size : 0;
+    return open ? EEPROM.getConstDataPtr() : nullptr;
+}
+
+void EepromStorageBackend::eraseLegacyImage() {}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "storage/backend/IStorageBackend.h"
+
+#if defined(TP_EEPROM_SIZE)
+#define EEPROM_SIZE TP_EEPROM_SIZE
+#else
+#define EEPROM_SIZE 4096
+#endif
+
+#define EEPROM_BACKEND_SECTOR_SIZE 1024  // virtual sectors, so the log can rotate inside the EEPROM
+
+/**
+ * @brief Flash emulated on the arduino-pico EEPROM emulation (a RAM shadow of one flash
+ *        sector). Every program or erase commits, i.e. rewrites the whole real sector.
+ *
+ * Fallback for boards without a flash filesystem region (StorageBackendFactory). Earlier
+ * firmware kept seeds in the same EEPROM, so the legacy image is migrated in place.
+ */
+class EepromStorageBackend : public IStorageBackend {
+public:
+    /**
+     * @param size EEPROM size in bytes (a multiple of EEPROM_BACKEND_SECTOR_SIZE, at most 4096).
+     */
+    explicit EepromStorageBackend(size_t size = EEPROM_SIZE);
+
+    bool begin() override;
+    size_t sectorSize() const override;
+    size_t pageSize() const override;
+    size_t sectorCount() const override;
+    bool read(uint32_t address, uint8_t* dst, size_t len) override;
+    bool programPage(uint32_t address, const uint8_t* data) override;
+    bool eraseSector(size_t sector) override;
+    uint32_t programCount() const override;
+    uint32_t eraseCount() const override;
+
+    /**
+     * @brief The EEPROM contents, as earlier firmware left them until the log is written.
+     */
+    const uint8_t* legacyImage(size_t& size) override;
+
+    /**
+     * @brief Nothing to do: the log takes the legacy bytes over as dirty sectors, which
+     *        are erased when needed (erased sectors are used first).
+     */
+    void eraseLegacyImage() override;
+
+private:
+    size_t size;
+    bool open;
+    uint32_t programs;
+    uint32_t erases;
+};
@@ -0,0 +1,84 @@
+#include "storage/backend/FlashStorageBackend.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <hardware/flash.h>
+#include <string.h>
+
+// Linker symbols of the arduino-pico flash layout
+extern uint8_t _FS_start;
+extern uint8_t _FS_end;
+extern uint8_t _EEPROM_start;
+
+FlashStorageBackend::FlashStorageBackend() : start(0), offset(0), sectors(0), programs(0), erases(0) {}
+
+bool FlashStorageBackend::begin() {
+    start = (uintptr_t)&_FS_start;
+    offset = (uint32_t)(start - XIP_BASE);
+    sectors = ((uintptr_t)&_FS_end - start) / STORAGE_SECTOR_SIZE;  // 0 without a filesystem region
+    return sectors > 0;
+}
+
+size_t FlashStorageBackend::sectorSize() const {
+    return STORAGE_SECTOR_SIZE;
+}
+
+size_t FlashStorageBackend::pageSize() const {
+    return STORAGE_PAGE_SIZE;
+}
+
+size_t FlashStorageBackend::sectorCount() const {
+    return sectors;
+}
+
+bool FlashStorageBackend::read(uint32_t address, uint8_t* dst, size_t len) {
+    if ((size_t)address + len > sectors * STORAGE_SECTOR_SIZE) return false;
+    memcpy(dst, (const uint8_t*)(start + address), len);
+    return true;
+}
+
+bool FlashStorageBackend::programPage(uint32_t address, const uint8_t* data) {
+    if (address % STORAGE_PAGE_SIZE != 0 || (size_t)address + STORAGE_PAGE_SIZE > sectors * STORAGE_SECTOR_SIZE) return false;
+    rp2040.idleOtherCore();
+    noInterrupts();
+    flash_range_program(offset + address, data, STORAGE_PAGE_SIZE);
+    interrupts();
+    rp2040.resumeOtherCore();
+    programs++;
+    return true;
+}
+
+bool FlashStorageBackend::eraseSector(size_t sector) {
+    if (sector >= sectors) return false;
+    rp2040.idleOtherCore();
+    noInterrupts();
+    flash_range_erase(offset + sector * STORAGE_SECTOR_SIZE, STORAGE_SECTOR_SIZE);
+    interrupts();
+    rp2040.resumeOtherCore();
+    erases++;
+    return true;
+}
+
+uint32_t FlashStorageBackend::programCount() const {
+    return programs;
+}
+
+uint32_t FlashStorageBackend::eraseCount() const {
+    return erases;
+}
+
+const uint8_t* FlashStorageBackend::legacyImage(size_t& size) {
+    size = LEGACY_EEPROM_SIZE;
+    return &_EEPROM_start;
+}
+
+void FlashStorageBackend::eraseLegacyImage() {
+    EEPROM.begin(LEGACY_EEPROM_SIZE);
+    memset(EEPROM.getDataPtr(), 0xFF, LEGACY_EEPROM_SIZE);
+    EEPROM.commit();
+    EEPROM.end();  // releases the RAM shadow
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "storage/backend/IStorageBackend.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#define LEGACY_EEPROM_SIZE 4096  // EEPROM emulation sector used by firmware before the log
+
+/**
+ * @brief Device backend: the flash filesystem region reserved by
+ *        board_build.filesystem_size (between _FS_start and _FS_end).
+ *
+ * Reads go straight through the XIP window. Programs and erases run with interrupts
+ * off and core1 parked, as the EEPROM emulation does for its commits.
+ */
+class FlashStorageBackend : public IStorageBackend {
+public:
+    FlashStorageBackend();
+
+    bool begin() override;
+    size_t sectorSize() const override;
+    size_t pageSize() const override;
+    size_t sectorCount() const override;
+    bool read(uint32_t address, uint8_t* dst, size_t len) override;
+    bool programPage(uint32_t address, const uint8_t* data) override;
+    bool eraseSector(size_t sector) override;
+    uint32_t programCount() const override;
+    uint32_t eraseCount() const override;
+
+    /**
+     * @brief Contents of the EEPROM emulation sector, where earlier firmware kept seeds.
+     */
+    const uint8_t* legacyImage(size_t& size) override;
+
+    /**
+     * @brief Erase the EEPROM emulation sector once its data lives in the log.
+     */
+    void eraseLegacyImage() override;
+
+private:
+    uintptr_t start;   ///< XIP address of the region
+    uint32_t offset;   ///< Flash offset of the region
+    size_t sectors;
+    uint32_t programs;
+    uint32_t erases;
+};
+
+#endif
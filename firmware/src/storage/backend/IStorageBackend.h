@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STORAGE_SECTOR_SIZE 4096  // flash erase unit
+#define STORAGE_PAGE_SIZE 256     // flash program unit
+
+/**
+ * @brief Flash-like medium StorageManager keeps its log on.
+ *
+ * The medium is a row of equal sectors. An erased byte reads 0xFF; programming a page
+ * can only clear bits (the result is old & new), so bytes left at 0xFF in the page
+ * buffer keep their current contents. Bits are set again only by erasing a sector.
+ */
+class IStorageBackend {
+public:
+    virtual ~IStorageBackend() = default;
+
+    /// Open the medium; contents survive a later begin().
+    virtual bool begin() = 0;
+
+    /// Erase unit in bytes.
+    virtual size_t sectorSize() const = 0;
+
+    /// Program unit in bytes (divides sectorSize()).
+    virtual size_t pageSize() const = 0;
+
+    /// Number of sectors (0 if the medium is unavailable).
+    virtual size_t sectorCount() const = 0;
+
+    /// Read len bytes at address.
+    virtual bool read(uint32_t address, uint8_t* dst, size_t len) = 0;
+
+    /// Program one page at a page-aligned address (pageSize() bytes).
+    virtual bool programPage(uint32_t address, const uint8_t* data) = 0;
+
+    /// Erase one sector back to 0xFF.
+    virtual bool eraseSector(size_t sector) = 0;
+
+    /// Page programs so far.
+    virtual uint32_t programCount() const = 0;
+
+    /// Sector erases so far.
+    virtual uint32_t eraseCount() const = 0;
+
+    /// Seeds left by firmware that kept them in the EEPROM emulation (legacy layout, for
+    /// StorageManager::importLegacy()), or NULL. size receives the image length.
+    virtual const uint8_t* legacyImage(size_t& size) {
+        size = 0;
+        return nullptr;
+    }
+
+    /// Release the legacy image once its data lives in the log.
+    virtual void eraseLegacyImage() {}
+};
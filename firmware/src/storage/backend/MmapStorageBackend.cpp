@@ -0,0 +1,98 @@
+#include "storage/backend/MmapStorageBackend.h"
+
+#if !defined(ARDUINO_ARCH_RP2040)
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MmapStorageBackend::MmapStorageBackend(const char* path, size_t sectors)
+: path(path), sectors(sectors), fd(-1), map(nullptr), size(0), programs(0), erases(0) {}
+
+MmapStorageBackend::~MmapStorageBackend() {
+    close();
+}
+
+bool MmapStorageBackend::begin() {
+    close();
+    const size_t newSize = sectors * STORAGE_SECTOR_SIZE;
+    fd = ::open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ftruncate(fd, (off_t)newSize) != 0) {
+        close();
+        return false;
+    }
+    void* mapped = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        return false;
+    }
+    map = (uint8_t*)mapped;
+    size = newSize;
+    if ((size_t)st.st_size < newSize) {
+        memset(map + st.st_size, 0xFF, newSize - st.st_size);  // new bytes read as erased
+    }
+    return true;
+}
+
+size_t MmapStorageBackend::sectorSize() const {
+    return STORAGE_SECTOR_SIZE;
+}
+
+size_t MmapStorageBackend::pageSize() const {
+    return STORAGE_PAGE_SIZE;
+}
+
+size_t MmapStorageBackend::sectorCount() const {
+    return map ? sectors : 0;
+}
+
+bool MmapStorageBackend::read(uint32_t address, uint8_t* dst, size_t len) {
+    if (!map || (size_t)address + len > size) return false;
+    memcpy(dst, map + address, len);
+    return true;
+}
+
+bool MmapStorageBackend::programPage(uint32_t address, const uint8_t* data) {
+    if (!map || address % STORAGE_PAGE_SIZE != 0 || (size_t)address + STORAGE_PAGE_SIZE > size) return false;
+    for (size_t i = 0; i < STORAGE_PAGE_SIZE; i++) {
+        map[address + i] &= data[i];
+    }
+    programs++;
+    return true;
+}
+
+bool MmapStorageBackend::eraseSector(size_t sector) {
+    if (!map || sector >= sectors) return false;
+    memset(map + sector * STORAGE_SECTOR_SIZE, 0xFF, STORAGE_SECTOR_SIZE);
+    erases++;
+    return true;
+}
+
+uint32_t MmapStorageBackend::programCount() const {
+    return programs;
+}
+
+uint32_t MmapStorageBackend::eraseCount() const {
+    return erases;
+}
+
+void MmapStorageBackend::close() {
+    if (map) {
+        msync(map, size, MS_SYNC);
+        munmap(map, size);
+        map = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    size = 0;
+}
+
+#endif
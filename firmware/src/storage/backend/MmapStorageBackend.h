@@ -0,0 +1,39 @@
+#pragma once
+
+#include "storage/backend/IStorageBackend.h"
+
+#if !defined(ARDUINO_ARCH_RP2040)
+
+/**
+ * @brief Native backend: flash simulated in a memory-mapped file, so stored data survives
+ *        the process and can be inspected on the host.
+ */
+class MmapStorageBackend : public IStorageBackend {
+public:
+    MmapStorageBackend(const char* path, size_t sectors = 4);
+    ~MmapStorageBackend() override;
+
+    bool begin() override;
+    size_t sectorSize() const override;
+    size_t pageSize() const override;
+    size_t sectorCount() const override;
+    bool read(uint32_t address, uint8_t* dst, size_t len) override;
+    bool programPage(uint32_t address, const uint8_t* data) override;
+    bool eraseSector(size_t sector) override;
+    uint32_t programCount() const override;
+    uint32_t eraseCount() const override;
+
+private:
+    /// Unmap and close the file.
+    void close();
+
+    const char* path;
+    size_t sectors;
+    int fd;
+    uint8_t* map;
+    size_t size;
+    uint32_t programs;
+    uint32_t erases;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "storage/backend/RamStorageBackend.h"
+#include <string.h>
+
+RamStorageBackend::RamStorageBackend(size_t sectors, size_t sectorBytes, size_t pageBytes)
+: sectorBytes(sectorBytes), pageBytes(pageBytes), flash(sectors * sectorBytes, 0xFF),
+  erases(sectors, 0), programs(0), totalErases(0), budget(-1) {}
+
+bool RamStorageBackend::begin() {
+    return true;
+}
+
+size_t RamStorageBackend::sectorSize() const {
+    return sectorBytes;
+}
+
+size_t RamStorageBackend::pageSize() const {
+    return pageBytes;
+}
+
+size_t RamStorageBackend::sectorCount() const {
+    return erases.size();
+}
+
+bool RamStorageBackend::read(uint32_t address, uint8_t* dst, size_t len) {
+    if ((size_t)address + len > flash.size()) return false;
+    memcpy(dst, &flash[address], len);
+    return true;
+}
+
+bool RamStorageBackend::programPage(uint32_t address, const uint8_t* data) {
+    if (address % pageBytes != 0 || (size_t)address + pageBytes > flash.size()) return false;
+    if (!spend()) return true;  // power cut: the host never learns
+    for (size_t i = 0; i < pageBytes; i++) {
+        flash[address + i] &= data[i];
+    }
+    programs++;
+    return true;
+}
+
+bool RamStorageBackend::eraseSector(size_t sector) {
+    if (sector >= erases.size()) return false;
+    if (!spend()) return true;
+    memset(&flash[sector * sectorBytes], 0xFF, sectorBytes);
+    erases[sector]++;
+    totalErases++;
+    return true;
+}
+
+uint32_t RamStorageBackend::programCount() const {
+    return programs;
+}
+
+uint32_t RamStorageBackend::eraseCount() const {
+    return totalErases;
+}
+
+void RamStorageBackend::setProgramBudget(long newBudget) {
+    budget = newBudget;
+}
+
+void RamStorageBackend::corrupt(uint32_t address, uint8_t mask) {
+    if (address < flash.size()) flash[address] ^= mask;
+}
+
+uint32_t RamStorageBackend::sectorErases(size_t sector) const {
+    return sector < erases.size() ? erases[sector] : 0;
+}
+
+bool RamStorageBackend::spend() {
+    if (budget < 0) return true;
+    if (budget == 0) return false;
+    budget--;
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "storage/backend/IStorageBackend.h"
+#include <vector>
+
+/**
+ * @brief Volatile NOR flash simulated in RAM.
+ *
+ * Enforces program alignment and bit-clearing semantics and counts programs and erases
+ * per sector, so tests and benchmarks can measure wear. setProgramBudget() simulates a
+ * power cut: once the budget is used up, programs and erases stop having any effect.
+ * corrupt() damages data that was already programmed.
+ */
+class RamStorageBackend : public IStorageBackend {
+public:
+    RamStorageBackend(size_t sectors = 4, size_t sectorBytes = STORAGE_SECTOR_SIZE,
+                      size_t pageBytes = STORAGE_PAGE_SIZE);
+
+    bool begin() override;
+    size_t sectorSize() const override;
+    size_t pageSize() const override;
+    size_t sectorCount() const override;
+    bool read(uint32_t address, uint8_t* dst, size_t len) override;
+    bool programPage(uint32_t address, const uint8_t* data) override;
+    bool eraseSector(size_t sector) override;
+    uint32_t programCount() const override;
+    uint32_t eraseCount() const override;
+
+    /// Allow only this many more programs/erases (-1 = unlimited).
+    void setProgramBudget(long budget);
+
+    /// Erases of one sector so far.
+    uint32_t sectorErases(size_t sector) const;
+
+    /// Flip bits of a stored byte (simulates bit rot or a disturbed cell).
+    void corrupt(uint32_t address, uint8_t mask);
+
+    /// Raw contents, for inspection.
+    const uint8_t* data() const { return flash.data(); }
+
+private:
+    /// Spend one operation of the budget; false once the power is gone.
+    bool spend();
+
+    size_t sectorBytes;
+    size_t pageBytes;
+    std::vector<uint8_t> flash;
+    std::vector<uint32_t> erases;  // per sector
+    uint32_t programs;
+    uint32_t totalErases;
+    long budget;
+};
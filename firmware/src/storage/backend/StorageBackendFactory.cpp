@@ -0,0 +1,19 @@
+#include "storage/backend/StorageBackendFactory.h"
+#include "storage/backend/EepromStorageBackend.h"
+#include "storage/backend/FlashStorageBackend.h"
+#include "storage/StorageManager.h"
+
+// -----------------------------------------------------------------------------
+// Factory method (backends are constructed on first use, so create() may run
+// during static initialization)
+// -----------------------------------------------------------------------------
+IStorageBackend* StorageBackendFactory::create() {
+#if defined(ARDUINO_ARCH_RP2040)
+    static FlashStorageBackend flashBackend;
+    if (flashBackend.begin() && flashBackend.sectorCount() >= STORAGE_MIN_SECTORS) {
+        return &flashBackend;
+    }
+#endif
+    static EepromStorageBackend eepromBackend;
+    return &eepromBackend;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "storage/backend/IStorageBackend.h"
+
+/**
+ * @class StorageBackendFactory
+ * @brief Factory responsible for choosing the medium the seed log lives on.
+ */
+class StorageBackendFactory {
+public:
+    /**
+     * @brief Return the flash filesystem region backend (page programs, no RAM shadow),
+     *        or the EEPROM emulation on boards where the region is missing or too small.
+     */
+    static IStorageBackend* create();
+};
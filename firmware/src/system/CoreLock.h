@@ -0,0 +1,30 @@
+#ifndef CORE_LOCK_H
+#define CORE_LOCK_H
+
+#include "pico/mutex.h"
+
+/**
+ * @class CoreLock
+ * @brief Scoped owner of a pico-sdk mutex shared between core0 and core1.
+ *
+ * Enters the mutex on construction and exits it on destruction, so every
+ * return path releases the lock.
+ */
+class CoreLock {
+public:
+    explicit CoreLock(mutex_t &mutex) : mutex_(mutex) {
+        mutex_enter_blocking(&mutex_);
+    }
+
+    ~CoreLock() {
+        mutex_exit(&mutex_);
+    }
+
+    CoreLock(const CoreLock &) = delete;
+    CoreLock &operator=(const CoreLock &) = delete;
+
+private:
+    mutex_t &mutex_;
+};
+
+#endif  // CORE_LOCK_H
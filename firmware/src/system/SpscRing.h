@@ -0,0 +1,130 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <algorithm>
+
+/**
+ * @class SpscRing
+ * @brief Bounded lock-free ring buffer for one producer and one consumer.
+ *
+ * Used to pass items between core0 and core1: each index is only written by
+ * one side, so plain 32-bit atomic loads and stores are enough (no
+ * read-modify-write, which the Cortex-M0+ lacks).
+ *
+ * @tparam T Item type (copied in and out).
+ * @tparam N Capacity, must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    /**
+     * @brief Append an item (producer side).
+     * @return false if the ring is full.
+     */
+    bool push(const T &item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == N) return false;
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item (consumer side).
+     * @return false if the ring is empty.
+     */
+    bool pop(T &item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Append up to count items in at most two block copies (producer side).
+     * @return Number of items appended (fewer if the ring fills up).
+     */
+    size_t push(const T *items, size_t count) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        count = std::min(count, (size_t)(N - (head - tail_.load(std::memory_order_acquire))));
+        const size_t start = head & (N - 1);
+        const size_t first = std::min(count, N - start);
+        std::copy(items, items + first, items_ + start);
+        std::copy(items + first, items + count, items_);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Copy up to count of the oldest items without removing them (consumer side).
+     * @return Number of items copied (fewer if the ring runs empty).
+     */
+    size_t peek(T *items, size_t count) const {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        count = std::min(count, (size_t)(head_.load(std::memory_order_acquire) - tail));
+        const size_t start = tail & (N - 1);
+        const size_t first = std::min(count, N - start);
+        std::copy(items_ + start, items_ + start + first, items);
+        std::copy(items_, items_ + (count - first), items + first);
+        return count;
+    }
+
+    /**
+     * @brief Remove up to count of the oldest items (consumer side).
+     * @param wipe Reset the slots to T() before releasing them (the items were secret).
+     * @return Number of items removed.
+     */
+    size_t skip(size_t count, bool wipe = false) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        count = std::min(count, (size_t)(head_.load(std::memory_order_acquire) - tail));
+        if (wipe) {
+            const size_t start = tail & (N - 1);
+            const size_t first = std::min(count, N - start);
+            std::fill(items_ + start, items_ + start + first, T());
+            std::fill(items_, items_ + (count - first), T());
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Remove up to count of the oldest items in at most two block copies
+     *        (consumer side).
+     * @param wipe Reset the slots read to T() before releasing them (the items were secret).
+     * @return Number of items removed (fewer if the ring runs empty).
+     */
+    size_t pop(T *items, size_t count, bool wipe = false) {
+        return skip(peek(items, count), wipe);
+    }
+
+    /**
+     * @brief Number of queued items (approximate when called from a third party).
+     */
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Number of items that can still be pushed (exact on the producer side).
+     */
+    size_t space() const { return N - size(); }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T items_[N];
+    std::atomic<uint32_t> head_;  ///< Next slot to write (producer only)
+    std::atomic<uint32_t> tail_;  ///< Next slot to read (consumer only)
+};
+
+#endif  // SPSC_RING_H
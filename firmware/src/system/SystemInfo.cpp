@@ -1,4 +1,5 @@
 #include "system/SystemInfo.h"
+#include "SHA512.h"
 
 void deviceInfo(turtlpass_Response &response) {
     // Mark this response as a success
@@ -38,4 +39,15 @@ void deviceInfo(turtlpass_Response &response) {
            PICO_UNIQUE_BOARD_ID_SIZE_BYTES);
 
     response.device_info.unique_board_id.size = PICO_UNIQUE_BOARD_ID_SIZE_BYTES;
+
+    // Hash of the fields above as encoded: hosts can cache this reply and compare hashes
+    uint8_t encoded[turtlpass_DeviceInfo_size];
+    pb_ostream_t stream = pb_ostream_from_buffer(encoded, sizeof(encoded));
+    info.info_hash.size = 0;  // not part of its own hash
+    if (pb_encode(&stream, turtlpass_DeviceInfo_fields, &info)) {
+        SHA512 sha512;
+        sha512.update(encoded, stream.bytes_written);
+        sha512.finalize(info.info_hash.bytes, sizeof(info.info_hash.bytes));
+        info.info_hash.size = sizeof(info.info_hash.bytes);
+    }
 }
@@ -15,7 +15,9 @@ const uint8_t LedManager::colors[NUM_COLORS][3] = {
     {255, 20, 147},  // 8: 🩷 pink
 };
 
-LedManager::LedManager(ILedDriver* driver) : driver(driver) {}
+LedManager::LedManager(ILedDriver* driver) : driver(driver) {
+    mutex_init(&frameMutex);
+}
 
 void LedManager::begin() {
     if (driver) driver->begin();
@@ -29,8 +31,21 @@ void LedManager::loop() {
     driver->setColor(c[0], c[1], c[2]);
     driver->setBrightness(brightness);
     driver->show();
+}
 
-    delay(1000 / LED_UPDATES_PER_SECOND); // frame rate
+bool LedManager::tick() {
+    uint32_t owner;
+    if (!mutex_try_enter(&frameMutex, &owner)) {
+        return false;  // the other core is rendering a frame
+    }
+    uint32_t now = millis();
+    bool due = now - lastLoopTime >= 1000 / LED_UPDATES_PER_SECOND;  // frame rate
+    if (due) {
+        lastLoopTime = now;
+        loop();
+    }
+    mutex_exit(&frameMutex);
+    return due;
 }
 
 void LedManager::setColorIndex(uint8_t colorIndex) {
@@ -89,6 +104,19 @@ uint8_t LedManager::getCurrentBrightness() const {
     return led.brightness;
 }
 
+bool LedManager::isAnimating() const {
+    switch (led.state) {
+        case LED_PULSING:
+        case LED_BLINKING:
+        case LED_FADE_OUT_LOOP:
+            return true;
+        case LED_FADE_OUT_ONCE:
+            return led.brightness > 0;
+        default:
+            return false;
+    }
+}
+
 int LedManager::mapExponentially(float value, float inMin, float inMax, float outMin, float outMax) {
     float normalized = (value - inMin) / (inMax - inMin);
     return (int)((outMax - outMin) * pow(normalized, 0.2f) + outMin);
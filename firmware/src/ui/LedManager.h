@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include "pico/mutex.h"
 #include "ui/driver/ILedDriver.h"
 
 #define LED_UPDATES_PER_SECOND 100
@@ -44,13 +45,22 @@ public:
     void begin();
 
     /**
-     * @brief Periodically updates LED brightness and effects.
+     * @brief Renders one frame: updates brightness and effects and pushes them to the driver.
      *
-     * This should be called regularly inside the main loop to maintain
-     * smooth animations (e.g., every 10–20 ms).
+     * Does not wait; use tick() to pace frames at LED_UPDATES_PER_SECOND.
      */
     void loop();
 
+    /**
+     * @brief Renders a frame if the frame deadline has passed.
+     *
+     * Non-blocking: call it as often as possible from both cores' loops, so frames keep
+     * coming while either core runs a derivation. A frame the other core is rendering
+     * is skipped.
+     * @return true if a frame was rendered.
+     */
+    bool tick();
+
     /**
      * @brief Turn LED off immediately.
      */
@@ -107,6 +117,14 @@ public:
      */
     uint8_t getCurrentBrightness() const;
 
+    /**
+     * @brief Whether an animation is running (pulsing, blinking or fading).
+     *
+     * Flash programs stall both cores and would freeze the animation mid-frame.
+     * @return true while the brightness changes from frame to frame.
+     */
+    bool isAnimating() const;
+
 private:
     /**
      * @enum State
@@ -139,7 +157,8 @@ private:
     } led;
 
     ILedDriver* driver;         ///< Hardware-specific LED driver instance.
-    uint32_t lastLoopTime = 0;  ///< Timestamp of the last main loop update.
+    uint32_t lastLoopTime = 0;  ///< Timestamp of the last frame rendered by tick().
+    mutex_t frameMutex;         ///< Held by the core rendering a frame in tick().
 
     /**
      * @brief Compute the next brightness value based on current animation.
@@ -3,16 +3,20 @@
 
 #include "crypto/Kdf.h"
 #include "crypto/Kdf.cpp"
+#include "crypto/HmacSha512.cpp"
 #include "crypto/EncryptionManager.h"
 #include "crypto/EncryptionManager.cpp"
 #include "storage/StorageManager.h"
 #include "storage/StorageManager.cpp"
+#include "storage/backend/EepromStorageBackend.cpp"
+#include "storage/SeedSession.cpp"
 #include "storage/SeedManager.h"
 #include "storage/SeedManager.cpp"
 #include "proto/turtlpass.pb.h"
 
 // Global instance under test
-SeedManager seedManager;
+EepromStorageBackend storageBackend;
+SeedManager seedManager(storageBackend);
 
 // --- Helper utilities ---
 
@@ -3,15 +3,19 @@
 
 #include "crypto/Kdf.h"
 #include "crypto/Kdf.cpp"
+#include "crypto/HmacSha512.cpp"
 #include "crypto/EncryptionManager.h"
 #include "crypto/EncryptionManager.cpp"
 #include "storage/StorageManager.h"
 #include "storage/StorageManager.cpp"
+#include "storage/backend/EepromStorageBackend.cpp"
+#include "storage/SeedSession.cpp"
 #include "storage/SeedManager.h"
 #include "storage/SeedManager.cpp"
 #include "proto/turtlpass.pb.h"
 
-SeedManager seedManager;
+EepromStorageBackend storageBackend;
+SeedManager seedManager(storageBackend);
 
 // ---------- Utilities ----------
 static void fillTestSeed(uint8_t* buf, size_t len, uint8_t base = 0x10) {
@@ -2,14 +2,19 @@
 #include <unity.h>
 #include "storage/StorageManager.h"
 #include "storage/StorageManager.cpp"
+#include "storage/backend/EepromStorageBackend.cpp"
+#include "storage/backend/FlashStorageBackend.cpp"
 
-StorageManager storageManager;
+EepromStorageBackend storageBackend;
+StorageManager storageManager(storageBackend);
+FlashStorageBackend flashBackend;
+StorageManager flashStorage(flashBackend);
 
 // ---------- Test Setup ----------
 
 void setUp(void) {
     // Called before each test
-    storageManager.begin(4096);
+    storageManager.begin();
     storageManager.factoryReset();
 }
 
@@ -35,6 +40,27 @@ void test_eeprom_roundtrip(void) {
     TEST_ASSERT_EQUAL_MEMORY_MESSAGE(testData, readBack, sizeof(testData), "EEPROM data mismatch");
 }
 
+// Same on the flash filesystem region, across a restart
+void test_flash_roundtrip(void) {
+    TEST_ASSERT_TRUE_MESSAGE(flashStorage.begin(), "no flash filesystem region");
+    flashStorage.factoryReset();
+
+    const uint32_t testKey = 0xABCD0002;
+    uint8_t testData[64];
+    for (int i = 0; i < 64; i++) testData[i] = 0xC0 + i;
+    TEST_ASSERT_TRUE(flashStorage.writeKeyValue(testKey, testData, sizeof(testData)));
+    TEST_ASSERT_TRUE(flashStorage.deleteKey(testKey));
+    TEST_ASSERT_TRUE(flashStorage.writeKeyValue(testKey, testData, sizeof(testData)));
+    TEST_ASSERT_TRUE(flashStorage.flush());
+
+    StorageManager restarted(flashBackend);
+    TEST_ASSERT_TRUE(restarted.begin());
+    uint8_t readBack[64] = {0};
+    TEST_ASSERT_TRUE(restarted.readValueByKey(testKey, readBack, sizeof(readBack)));
+    TEST_ASSERT_EQUAL_MEMORY(testData, readBack, sizeof(testData));
+    restarted.factoryReset();
+}
+
 
 // ---------- Test Runner ----------
 
@@ -45,6 +71,7 @@ void setup() {
 
     UNITY_BEGIN();
     RUN_TEST(test_eeprom_roundtrip);
+    RUN_TEST(test_flash_roundtrip);
     UNITY_END();
 }
 
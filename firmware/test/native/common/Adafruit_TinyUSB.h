@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in for Adafruit TinyUSB: tests provide the HidKeyboard.h functions they need
+#include "tusb.h"
@@ -27,6 +27,11 @@ inline uint32_t millis(void) {
     return fakeMillisTime();
 }
 
+// micros() follows the fake millisecond clock
+inline uint32_t micros(void) {
+    return fakeMillisTime() * 1000u;
+}
+
 // Advance time manually
 inline void advanceMillis(uint32_t ms) {
     fakeMillisTime() += ms;
@@ -0,0 +1,56 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// Host stand-in for the arduino-pico EEPROM emulation: a RAM shadow of one flash
+// sector, written back by commit()
+class EEPROMClass {
+public:
+    void begin(size_t size) {
+        if (data_.size() != size) data_.assign(size, 0xFF);  // erased flash
+    }
+
+    uint8_t read(int address) {
+        if (address < 0 || (size_t)address >= data_.size()) return 0;
+        return data_[address];
+    }
+
+    void write(int address, uint8_t value) {
+        if (address < 0 || (size_t)address >= data_.size()) return;
+        if (data_[address] != value) dirty_ = true;
+        data_[address] = value;
+    }
+
+    bool commit() {
+        if (dirty_) commits++;  // one sector program
+        dirty_ = false;
+        return true;
+    }
+
+    uint8_t *getDataPtr() {
+        dirty_ = true;
+        return data_.data();
+    }
+
+    const uint8_t *getConstDataPtr() const {
+        return data_.data();
+    }
+
+    uint16_t length() const {
+        return (uint16_t)data_.size();
+    }
+
+    size_t commits = 0;  // flash sector programs so far
+
+private:
+    std::vector<uint8_t> data_;
+    bool dirty_ = false;
+};
+
+inline EEPROMClass EEPROM;
+
+#endif  // EEPROM_H
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include <cstring>
+#include <vector>
+
+// Host stand-in for the USB CDC serial port: records what is written, serves queued input
+struct FakeSerial {
+    std::vector<uint8_t> output;    // bytes written since the last clear()
+    std::vector<uint8_t> input;     // bytes waiting to be read
+    size_t writes = 0;              // write() calls
+    size_t flushes = 0;             // flush() calls
+
+    void begin(unsigned long) {}
+    bool dtr() { return true; }
+
+    int available() { return (int)input.size(); }
+    int read() {
+        if (input.empty()) return -1;
+        uint8_t b = input.front();
+        input.erase(input.begin());
+        return b;
+    }
+    size_t read(uint8_t *dst, size_t len) {
+        len = len < input.size() ? len : input.size();
+        memcpy(dst, input.data(), len);
+        input.erase(input.begin(), input.begin() + len);
+        return len;
+    }
+
+    size_t write(uint8_t b) { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t len) {
+        output.insert(output.end(), data, data + len);
+        writes++;
+        return len;
+    }
+    void flush() { flushes++; }
+    void print(const char *) {}
+    void println(const char *) {}
+
+    void clear() {
+        output.clear();
+        writes = 0;
+        flushes = 0;
+    }
+};
+
+inline FakeSerial Serial;
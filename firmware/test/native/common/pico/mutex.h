@@ -0,0 +1,27 @@
+#ifndef PICO_MUTEX_H
+#define PICO_MUTEX_H
+
+#include <stdint.h>
+#include <mutex>
+
+// Host stand-in for the pico-sdk mutex: one std::mutex per mutex_t
+typedef struct {
+    std::mutex m;
+} mutex_t;
+
+inline void mutex_init(mutex_t*) {}
+
+inline void mutex_enter_blocking(mutex_t* mtx) {
+    mtx->m.lock();
+}
+
+inline bool mutex_try_enter(mutex_t* mtx, uint32_t* owner_out) {
+    (void)owner_out;
+    return mtx->m.try_lock();
+}
+
+inline void mutex_exit(mutex_t* mtx) {
+    mtx->m.unlock();
+}
+
+#endif  // PICO_MUTEX_H
@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for TinyUSB: tests provide the HidKeyboard.h functions they need
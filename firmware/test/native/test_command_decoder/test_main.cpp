@@ -0,0 +1,351 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Include module under test
+// -----------------------------------------------------------------------------
+#include "proto/CommandDecoder.h"
+#include "proto/CommandDecoder.cpp"
+#include "proto/turtlpass.pb.c"
+#include "pb_encode.h"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static uint32_t rngState = 0x2545F491;
+static uint32_t nextRandom() {
+    // xorshift32: deterministic across runs
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Mostly small values (the usual case), sometimes any 32 bits
+static uint32_t randomValue() {
+    switch (nextRandom() % 4) {
+        case 0: return 0;
+        case 1: return nextRandom() % 16;
+        case 2: return nextRandom() % 300;
+        default: return nextRandom();
+    }
+}
+
+typedef std::vector<uint8_t> Bytes;
+
+static void putVarint(Bytes &out, uint64_t value, size_t padding = 0) {
+    // padding adds redundant continuation bytes (non-canonical, still valid protobuf)
+    while (value >= 0x80 || padding > 0) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+        if (value == 0 && padding > 0) padding--;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static void putKey(Bytes &out, uint32_t tag, uint32_t wireType) {
+    putVarint(out, ((uint64_t)tag << 3) | wireType, nextRandom() % 16 == 0 ? 1 : 0);
+}
+
+static void putVarintField(Bytes &out, uint32_t tag, uint64_t value) {
+    putKey(out, tag, PB_WT_VARINT);
+    putVarint(out, value, nextRandom() % 16 == 0 ? nextRandom() % 6 : 0);
+}
+
+static void putBytesField(Bytes &out, uint32_t tag, const Bytes &value) {
+    putKey(out, tag, PB_WT_STRING);
+    putVarint(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+static Bytes randomBytes(size_t maxLength) {
+    Bytes bytes(nextRandom() % (maxLength + 1));
+    for (auto &b : bytes) b = (uint8_t)nextRandom();
+    return bytes;
+}
+
+// A field nanopb does not know, with any wire type it can skip
+static void putUnknownField(Bytes &out) {
+    const uint32_t tag = 9 + nextRandom() % 100;
+    switch (nextRandom() % 4) {
+        case 0: putVarintField(out, tag, randomValue()); break;
+        case 1: putBytesField(out, tag, randomBytes(8)); break;
+        case 2: putKey(out, tag, PB_WT_32BIT); for (int i = 0; i < 4; i++) out.push_back((uint8_t)nextRandom()); break;
+        default: putKey(out, tag, PB_WT_64BIT); for (int i = 0; i < 8; i++) out.push_back((uint8_t)nextRandom()); break;
+    }
+}
+
+// Fields of a parameter message, in random order, sometimes repeated (the last one wins)
+static Bytes randomParameters(uint32_t commandTag, bool unknownFields) {
+    Bytes out;
+    const int fields = (int)(nextRandom() % 5);
+    for (int i = 0; i < fields; i++) {
+        switch (commandTag) {
+            case turtlpass_Command_gen_pass_tag:
+                switch (nextRandom() % 4) {
+                    case 0: putBytesField(out, turtlpass_GeneratePasswordParams_entropy_tag, randomBytes(nextRandom() % 8 ? 64 : 70)); break;
+                    case 1: putVarintField(out, turtlpass_GeneratePasswordParams_length_tag, randomValue()); break;
+                    case 2: putVarintField(out, turtlpass_GeneratePasswordParams_charset_tag, randomValue()); break;
+                    default: putVarintField(out, turtlpass_GeneratePasswordParams_delivery_tag, randomValue()); break;
+                }
+                break;
+            case turtlpass_Command_init_seed_tag:
+                putBytesField(out, turtlpass_InitializeSeedParams_seed_tag, randomBytes(nextRandom() % 8 ? 64 : 70));
+                break;
+            case turtlpass_Command_session_tag:
+                putVarintField(out, turtlpass_SessionParams_timeout_ms_tag, randomValue());
+                break;
+            case turtlpass_Command_gen_batch_tag:
+                for (int entry = (int)(nextRandom() % (nextRandom() % 8 ? 5 : 18)); entry > 0; entry--) {
+                    putBytesField(out, turtlpass_GeneratePasswordBatchParams_entries_tag,
+                                  randomParameters(turtlpass_Command_gen_pass_tag, unknownFields));
+                }
+                break;
+            case turtlpass_Command_keyboard_tag:
+                putVarintField(out, nextRandom() % 2 ? turtlpass_KeyboardParams_layout_tag : turtlpass_KeyboardParams_host_profile_tag,
+                               randomValue());
+                break;
+            default:
+                putVarintField(out, turtlpass_FramingParams_framing_tag, randomValue());
+                break;
+        }
+        if (unknownFields && nextRandom() % 8 == 0) putUnknownField(out);
+    }
+    return out;
+}
+
+static const uint32_t PARAMETER_TAGS[] = {
+    turtlpass_Command_gen_pass_tag, turtlpass_Command_init_seed_tag, turtlpass_Command_session_tag,
+    turtlpass_Command_gen_batch_tag, turtlpass_Command_keyboard_tag, turtlpass_Command_framing_tag };
+
+// A well-formed Command, fields in any order, oneof members possibly switched or merged
+static Bytes randomCommand(bool unknownFields) {
+    Bytes out;
+    const int fields = 1 + (int)(nextRandom() % 5);
+    for (int i = 0; i < fields; i++) {
+        switch (nextRandom() % 4) {
+            case 0: putVarintField(out, turtlpass_Command_type_tag, nextRandom() % 4 ? nextRandom() % 12 : randomValue()); break;
+            case 1: putVarintField(out, turtlpass_Command_request_id_tag, randomValue()); break;
+            default: {
+                const uint32_t tag = PARAMETER_TAGS[nextRandom() % 6];
+                putBytesField(out, tag, randomParameters(tag, unknownFields));
+                break;
+            }
+        }
+        if (unknownFields && nextRandom() % 8 == 0) putUnknownField(out);
+    }
+    return out;
+}
+
+// Damage a frame: flip, drop, insert or truncate
+static void mutate(Bytes &frame) {
+    const int edits = 1 + (int)(nextRandom() % 3);
+    for (int i = 0; i < edits; i++) {
+        const size_t pos = frame.empty() ? 0 : nextRandom() % frame.size();
+        switch (nextRandom() % 5) {
+            case 0: if (!frame.empty()) frame[pos] ^= (uint8_t)(1u << (nextRandom() % 8)); break;
+            case 1: if (!frame.empty()) frame[pos] = (uint8_t)nextRandom(); break;
+            case 2: if (!frame.empty()) frame.erase(frame.begin() + pos); break;
+            case 3: frame.insert(frame.begin() + pos, (uint8_t)nextRandom()); break;
+            default: frame.resize(pos); break;
+        }
+    }
+}
+
+static size_t parametersSize(pb_size_t tag) {
+    switch (tag) {
+        case turtlpass_Command_gen_pass_tag: return pb_membersize(turtlpass_Command, parameters.gen_pass);
+        case turtlpass_Command_init_seed_tag: return pb_membersize(turtlpass_Command, parameters.init_seed);
+        case turtlpass_Command_session_tag: return pb_membersize(turtlpass_Command, parameters.session);
+        case turtlpass_Command_gen_batch_tag: return pb_membersize(turtlpass_Command, parameters.gen_batch);
+        case turtlpass_Command_keyboard_tag: return pb_membersize(turtlpass_Command, parameters.keyboard);
+        case turtlpass_Command_framing_tag: return pb_membersize(turtlpass_Command, parameters.framing);
+        default: return 0;
+    }
+}
+
+// Same fields and the same active oneof member, byte for byte
+static bool sameCommand(const turtlpass_Command &a, const turtlpass_Command &b) {
+    return memcmp(&a.type, &b.type, sizeof(a.type)) == 0 &&
+           a.which_parameters == b.which_parameters &&
+           a.request_id == b.request_id &&
+           memcmp(&a.parameters, &b.parameters, parametersSize(a.which_parameters)) == 0;
+}
+
+struct Differential {
+    size_t frames = 0;
+    size_t decoded = 0;
+    size_t fastPath = 0;
+};
+
+// Decode with both decoders from the same (dirty) starting state and compare
+static void checkFrame(const Bytes &frame, Differential &stats) {
+    static turtlpass_Command expected, actual, fast;
+    const uint8_t fill = (uint8_t)nextRandom();
+    memset(&expected, fill, sizeof(expected));
+    memset(&actual, fill, sizeof(actual));
+    memset(&fast, fill, sizeof(fast));
+
+    pb_istream_t stream = pb_istream_from_buffer(frame.data(), frame.size());
+    const bool expectedOk = pb_decode(&stream, turtlpass_Command_fields, &expected);
+    const bool actualOk = decodeCommand(frame.data(), frame.size(), actual);
+    const bool fastOk = decodeCommandFast(frame.data(), frame.size(), fast);
+
+    stats.frames++;
+    TEST_ASSERT_EQUAL(expectedOk, actualOk);
+    if (fastOk) {
+        TEST_ASSERT_TRUE(expectedOk);  // the fast path never accepts what nanopb rejects
+        TEST_ASSERT_TRUE(sameCommand(expected, fast));
+        stats.fastPath++;
+    }
+    if (expectedOk) {
+        TEST_ASSERT_TRUE(sameCommand(expected, actual));
+        stats.decoded++;
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+void test_encoded_commands_take_the_fast_path() {
+    // what hosts send: pb_encode() output of valid commands
+    for (int round = 0; round < 3000; round++) {
+        turtlpass_Command command = turtlpass_Command_init_zero;
+        command.type = (turtlpass_CommandType)(nextRandom() % 12);
+        command.request_id = randomValue();
+        const uint32_t tag = nextRandom() % 7 ? PARAMETER_TAGS[nextRandom() % 6] : 0;
+        Bytes parameters = randomParameters(tag, false);
+        if (tag != 0) {
+            // let nanopb build the parameters, then re-encode the whole command with pb_encode()
+            Bytes frame;
+            putBytesField(frame, tag, parameters);
+            pb_istream_t in = pb_istream_from_buffer(frame.data(), frame.size());
+            turtlpass_Command parsed = turtlpass_Command_init_zero;
+            if (!pb_decode(&in, turtlpass_Command_fields, &parsed)) continue;  // e.g. 17 batch entries
+            command.which_parameters = parsed.which_parameters;
+            command.parameters = parsed.parameters;
+        }
+
+        uint8_t buffer[turtlpass_Command_size];
+        pb_ostream_t out = pb_ostream_from_buffer(buffer, sizeof(buffer));
+        TEST_ASSERT_TRUE(pb_encode(&out, turtlpass_Command_fields, &command));
+
+        turtlpass_Command expected = turtlpass_Command_init_zero;
+        turtlpass_Command decoded = turtlpass_Command_init_zero;
+        pb_istream_t in = pb_istream_from_buffer(buffer, out.bytes_written);
+        TEST_ASSERT_TRUE(pb_decode(&in, turtlpass_Command_fields, &expected));
+        TEST_ASSERT_TRUE(decodeCommandFast(buffer, out.bytes_written, decoded));
+        TEST_ASSERT_TRUE(sameCommand(expected, decoded));
+    }
+}
+
+void test_differential_fuzz_against_nanopb() {
+    Differential valid, unknown, damaged, noise;
+    for (int round = 0; round < 40000; round++) {
+        checkFrame(randomCommand(false), valid);
+        checkFrame(randomCommand(true), unknown);
+
+        Bytes frame = randomCommand(round % 2 == 0);
+        mutate(frame);
+        checkFrame(frame, damaged);
+
+        checkFrame(randomBytes(48), noise);
+    }
+    printf("  well-formed: %zu frames, %zu valid, %zu on the fast path\n", valid.frames, valid.decoded, valid.fastPath);
+    printf("  unknown fields: %zu frames, %zu valid, %zu on the fast path\n", unknown.frames, unknown.decoded, unknown.fastPath);
+    printf("  damaged: %zu frames, %zu valid, %zu on the fast path\n", damaged.frames, damaged.decoded, damaged.fastPath);
+    printf("  noise: %zu frames, %zu valid, %zu on the fast path\n", noise.frames, noise.decoded, noise.fastPath);
+
+    TEST_ASSERT_TRUE(unknown.fastPath < unknown.decoded);  // unknown fields went through pb_decode()
+    TEST_ASSERT_TRUE(damaged.decoded > 0 && damaged.decoded < damaged.frames);
+}
+
+void test_unknown_field_falls_back_to_pb_decode() {
+    Bytes frame;
+    putVarintField(frame, turtlpass_Command_type_tag, turtlpass_CommandType_GET_DEVICE_INFO);
+    putBytesField(frame, 42, Bytes(3, 0x7F));
+    putVarintField(frame, turtlpass_Command_request_id_tag, 7);
+
+    turtlpass_Command command = turtlpass_Command_init_zero;
+    TEST_ASSERT_FALSE(decodeCommandFast(frame.data(), frame.size(), command));
+    TEST_ASSERT_TRUE(decodeCommand(frame.data(), frame.size(), command));
+    TEST_ASSERT_EQUAL(turtlpass_CommandType_GET_DEVICE_INFO, command.type);
+    TEST_ASSERT_EQUAL_UINT32(7, command.request_id);
+}
+
+void test_benchmark_decode_per_frame() {
+    struct Sample {
+        const char *name;
+        Bytes frame;
+    } samples[4];
+
+    samples[0].name = "GET_DEVICE_INFO";
+    putVarintField(samples[0].frame, turtlpass_Command_type_tag, turtlpass_CommandType_GET_DEVICE_INFO);
+    putVarintField(samples[0].frame, turtlpass_Command_request_id_tag, 1234);
+
+    Bytes entry;
+    putBytesField(entry, turtlpass_GeneratePasswordParams_entropy_tag, Bytes(64, 0x5A));
+    putVarintField(entry, turtlpass_GeneratePasswordParams_length_tag, 100);
+    putVarintField(entry, turtlpass_GeneratePasswordParams_charset_tag, turtlpass_Charset_LETTERS_NUMBERS_SYMBOLS);
+
+    samples[1].name = "GENERATE_PASSWORD";
+    putVarintField(samples[1].frame, turtlpass_Command_type_tag, turtlpass_CommandType_GENERATE_PASSWORD);
+    putBytesField(samples[1].frame, turtlpass_Command_gen_pass_tag, entry);
+
+    samples[2].name = "INITIALIZE_SEED";
+    Bytes seed;
+    putBytesField(seed, turtlpass_InitializeSeedParams_seed_tag, Bytes(64, 0xA5));
+    putVarintField(samples[2].frame, turtlpass_Command_type_tag, turtlpass_CommandType_INITIALIZE_SEED);
+    putBytesField(samples[2].frame, turtlpass_Command_init_seed_tag, seed);
+
+    samples[3].name = "BATCH x16";
+    Bytes batch;
+    for (int i = 0; i < 16; i++) putBytesField(batch, turtlpass_GeneratePasswordBatchParams_entries_tag, entry);
+    putVarintField(samples[3].frame, turtlpass_Command_type_tag, turtlpass_CommandType_GENERATE_PASSWORD_BATCH);
+    putBytesField(samples[3].frame, turtlpass_Command_gen_batch_tag, batch);
+
+    static turtlpass_Command command;
+    const int iterations = 20000;
+    for (const Sample &sample : samples) {
+        TEST_ASSERT_TRUE(decodeCommandFast(sample.frame.data(), sample.frame.size(), command));
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            pb_istream_t stream = pb_istream_from_buffer(sample.frame.data(), sample.frame.size());
+            pb_decode(&stream, turtlpass_Command_fields, &command);
+        }
+        const double nanopbNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            decodeCommand(sample.frame.data(), sample.frame.size(), command);
+        }
+        const double fastNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        printf("  %-18s %4zu B: pb_decode %8.0f ns, decodeCommand %8.0f ns (x%.1f)\n",
+               sample.name, sample.frame.size(), nanopbNs, fastNs, nanopbNs / fastNs);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_encoded_commands_take_the_fast_path);
+    RUN_TEST(test_differential_fuzz_against_nanopb);
+    RUN_TEST(test_unknown_field_falls_back_to_pb_decode);
+    RUN_TEST(test_benchmark_decode_per_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,416 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define PIO_BOARD_NAME "native"
+#define private public
+#include "core/CommandProcessor.h"
+#undef private
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+#include "crypto/EncryptionManager.cpp"
+#include "storage/SeedSession.cpp"
+#include "storage/StorageManager.cpp"
+#include "storage/SeedManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+#include "core/CryptoWorker.cpp"
+#include "core/PasswordPrecompute.cpp"
+#include "core/PasswordBatch.cpp"
+#include "ui/LedManager.cpp"
+#include "proto/ProtoHelper.cpp"
+#include "proto/FrameCodec.cpp"
+#include "proto/CommandDecoder.cpp"
+#include "system/SystemInfo.cpp"
+#include "proto/turtlpass.pb.c"
+#include "core/CommandProcessor.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Host stand-ins
+// -----------------------------------------------------------------------------
+
+// HID calibration: finishes on the first poll
+bool hidCalibrateStart() { return true; }
+bool hidCalibratePoll() { return false; }
+bool hidCalibrateResult(HidHostTiming &timing) {
+    timing = { HID_TIMING_VERSION, HID_TIMING_CALIBRATED, 2, 2 };
+    return true;
+}
+
+struct MockLedDriver : public ILedDriver {
+    void begin() override {}
+    void setColor(uint8_t, uint8_t, uint8_t) override {}
+    void setBrightness(uint8_t) override {}
+    void show() override {}
+};
+
+// A device with a committed seed in slot 1; core1 is driven by hand (runCore1())
+struct Device {
+    RamStorageBackend flash;
+    SeedManager seeds;
+    Kdf kdf;
+    CryptoWorker worker;
+    PasswordPrecompute precompute;
+    PasswordBatch batch;
+    MockLedDriver driver;
+    LedManager led;
+    InternalState state;
+    uint8_t output[MAX_PASS_SIZE + 1];
+    CommandProcessor processor;
+
+    Device()
+        : flash(8), seeds(flash), worker(seeds), led(&driver), state(IDLE),
+          processor(seeds, kdf, worker, precompute, batch, led, state, output, sizeof(output)) {
+        seeds.begin();
+        uint8_t seed[SeedManager::SEED_SIZE];
+        memset(seed, 0x11, sizeof(seed));
+        seeds.initializeSeed(1, seed, sizeof(seed));
+        seeds.flushStorage();
+    }
+
+    // core1: run every queued job
+    void runCore1() {
+        for (int i = 0; i < CRYPTO_QUEUE_DEPTH; i++) worker.loop();
+    }
+
+    // Stage a slot for the next commands (slot = LED color index + 1)
+    void selectSlot(uint8_t slot) {
+        led.setColorIndex(slot - 1);
+    }
+};
+
+struct Reply {
+    bool success;
+    turtlpass_ErrorCode error;
+    uint32_t requestId;
+    std::string data;
+};
+
+static bool decodeData(pb_istream_t *stream, const pb_field_t *, void **arg) {
+    std::string *out = static_cast<std::string *>(*arg);
+    out->resize(stream->bytes_left);
+    return pb_read(stream, reinterpret_cast<pb_byte_t *>(&(*out)[0]), out->size());
+}
+
+// Replies sent since the last call, in order (length-prefixed framing)
+static std::vector<Reply> replies() {
+    std::vector<Reply> out;
+    const std::vector<uint8_t> &bytes = Serial.output;
+    for (size_t offset = 0; offset + 2 <= bytes.size();) {
+        size_t length = bytes[offset] | (bytes[offset + 1] << 8);
+        offset += 2;
+        Reply reply;
+        turtlpass_Response response = turtlpass_Response_init_zero;
+        response.data.funcs.decode = decodeData;
+        response.data.arg = &reply.data;
+        pb_istream_t stream = pb_istream_from_buffer(&bytes[offset], length);
+        if (!pb_decode(&stream, turtlpass_Response_fields, &response)) break;
+        reply.success = response.success;
+        reply.error = response.error;
+        reply.requestId = response.request_id;
+        out.push_back(reply);
+        offset += length;
+    }
+    Serial.clear();
+    return out;
+}
+
+static bool send(Device &device, turtlpass_Command &command) {
+    uint8_t buffer[turtlpass_Command_size];
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+    if (!pb_encode(&stream, turtlpass_Command_fields, &command)) return false;
+    return device.processor.processProtoCommand(buffer, stream.bytes_written);
+}
+
+static bool generate(Device &device, uint32_t requestId,
+                     turtlpass_PasswordDelivery delivery = turtlpass_PasswordDelivery_TYPE_ON_TOUCH) {
+    turtlpass_Command command = turtlpass_Command_init_zero;
+    command.type = turtlpass_CommandType_GENERATE_PASSWORD;
+    command.request_id = requestId;
+    command.which_parameters = turtlpass_Command_gen_pass_tag;
+    command.parameters.gen_pass.length = 20;
+    command.parameters.gen_pass.charset = turtlpass_Charset_LETTERS_NUMBERS;
+    command.parameters.gen_pass.delivery = delivery;
+    int n = snprintf((char *)command.parameters.gen_pass.entropy.bytes,
+                     sizeof(command.parameters.gen_pass.entropy.bytes), "site-%u", (unsigned)requestId);
+    command.parameters.gen_pass.entropy.size = (pb_size_t)n;
+    return send(device, command);
+}
+
+static bool initializeSeed(Device &device, uint32_t requestId) {
+    turtlpass_Command command = turtlpass_Command_init_zero;
+    command.type = turtlpass_CommandType_INITIALIZE_SEED;
+    command.request_id = requestId;
+    command.which_parameters = turtlpass_Command_init_seed_tag;
+    command.parameters.init_seed.seed.size = SeedManager::SEED_SIZE;
+    memset(command.parameters.init_seed.seed.bytes, 0x22, SeedManager::SEED_SIZE);
+    return send(device, command);
+}
+
+static bool simpleCommand(Device &device, turtlpass_CommandType type, uint32_t requestId) {
+    turtlpass_Command command = turtlpass_Command_init_zero;
+    command.type = type;
+    command.request_id = requestId;
+    return send(device, command);
+}
+
+// The password GENERATE_PASSWORD request `requestId` derives from slot 1
+static std::string expectedPassword(Device &device, uint32_t requestId) {
+    Kdf kdf;
+    char input[32];
+    snprintf(input, sizeof(input), "site-%u", (unsigned)requestId);
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    CryptoWorker::derivePassword(device.seeds, kdf, 1, turtlpass_Charset_LETTERS_NUMBERS, out, 20, input);
+    return std::string((const char *)out);
+}
+
+static bool isZero(const uint8_t *bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (bytes[i] != 0) return false;
+    }
+    return true;
+}
+
+void setUp(void) {
+    fakeMillisTime() = 1000;
+    Serial.clear();
+}
+
+void tearDown(void) {}
+
+
+// -----------------------------------------------------------------------------
+// Tests: request_id pipelining
+// -----------------------------------------------------------------------------
+
+// request_id 0: one command at a time, queries included, answered in order
+void test_lockstep_commands_stay_serial(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 0));
+    TEST_ASSERT_FALSE(generate(device, 0));  // the first is still in flight
+    TEST_ASSERT_FALSE(simpleCommand(device, turtlpass_CommandType_GET_DEVICE_INFO, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+
+    device.runCore1();
+    device.processor.loop();
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_TRUE(sent[0].success);
+    TEST_ASSERT_EQUAL_UINT32(0, sent[0].requestId);
+
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_GET_DEVICE_INFO, 0));
+    TEST_ASSERT_TRUE(generate(device, 0));
+}
+
+// Tagged derivations queue up and run on both cores; tagged queries overtake them
+void test_tagged_derivations_overlap(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 1));
+    TEST_ASSERT_TRUE(generate(device, 2));
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_GET_DEVICE_INFO, 3));
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(3, sent[0].requestId);
+
+    const int first = device.worker.claim(false);  // core1 starts request 1
+    TEST_ASSERT_TRUE(first >= 0);
+    device.processor.loop();                       // core0 derives request 2 meanwhile
+    TEST_ASSERT_EQUAL_UINT8(1, device.worker.running_);
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+    device.worker.run((uint8_t)first, device.worker.kdf_);
+    device.processor.loop();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(2, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(1, sent[0].requestId);
+    TEST_ASSERT_EQUAL_UINT32(2, sent[1].requestId);
+}
+
+// Jobs finishing out of order are answered in order, each with its own request_id
+void test_out_of_order_completions_keep_their_request_id(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 10, turtlpass_PasswordDelivery_RETURN_ON_TOUCH));
+    TEST_ASSERT_TRUE(generate(device, 20));
+
+    const int first = device.worker.claim(false);
+    TEST_ASSERT_TRUE(device.worker.work(device.kdf));  // request 20 finishes first
+    device.processor.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());     // request 10 is still running
+
+    device.worker.run((uint8_t)first, device.worker.kdf_);
+    device.processor.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());     // 10 waits for its touch, 20 behind it
+    device.processor.confirmPending();
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(10, sent[0].requestId);
+    TEST_ASSERT_EQUAL_STRING(expectedPassword(device, 10).c_str(), sent[0].data.c_str());
+
+    device.processor.loop();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(20, sent[0].requestId);
+    TEST_ASSERT_EQUAL_STRING(expectedPassword(device, 20).c_str(), (const char *)device.output);
+}
+
+// A seed job runs alone and its reply waits for the flush; a wipe waits for everything before it
+void test_seed_and_wipe_commands_are_barriers(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 1));
+    device.selectSlot(2);
+    TEST_ASSERT_TRUE(initializeSeed(device, 2));
+    device.selectSlot(1);
+
+    const int first = device.worker.claim(false);
+    device.processor.loop();  // core0 does not take the seed job beside the derivation
+    TEST_ASSERT_EQUAL_UINT8(1, device.worker.running_);
+    TEST_ASSERT_EQUAL_UINT32(1, device.worker.pending_.size());
+    device.worker.run((uint8_t)first, device.worker.kdf_);
+    device.processor.loop();
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(1, sent[0].requestId);
+
+    device.runCore1();
+    device.processor.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());  // staged: answered after the flush
+    TEST_ASSERT_FALSE(simpleCommand(device, turtlpass_CommandType_FACTORY_RESET, 3));
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_GET_SESSION_STATE, 4));
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(4, sent[0].requestId);
+
+    TEST_ASSERT_TRUE(device.seeds.serviceStorage(true));
+    device.processor.loop();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(2, sent[0].requestId);
+    TEST_ASSERT_TRUE(sent[0].success);
+
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_FACTORY_RESET, 3));
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(3, sent[0].requestId);
+    uint8_t seed[SeedManager::SEED_SIZE];
+    TEST_ASSERT_FALSE(device.seeds.getSeed(2, seed, sizeof(seed)));
+}
+
+
+// A derivation pipelined behind INITIALIZE_SEED waits for the commit, then reads the new seed
+void test_derivation_waits_for_a_pipelined_seed(void) {
+    Device device;
+    device.selectSlot(2);
+    TEST_ASSERT_TRUE(initializeSeed(device, 1));
+    TEST_ASSERT_FALSE(generate(device, 2));  // the seed job is queued
+
+    device.runCore1();
+    device.processor.loop();
+    TEST_ASSERT_TRUE(device.processor.seedCommitPending_);
+    TEST_ASSERT_FALSE(generate(device, 2));  // staged, not yet readable
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_GET_SESSION_STATE, 3));
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(3, sent[0].requestId);
+
+    TEST_ASSERT_TRUE(device.seeds.serviceStorage(true));
+    device.processor.loop();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(1, sent[0].requestId);
+    TEST_ASSERT_TRUE(sent[0].success);
+
+    TEST_ASSERT_TRUE(generate(device, 2));
+    device.runCore1();
+    device.processor.loop();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(2, sent[0].requestId);
+    TEST_ASSERT_TRUE(sent[0].success);
+    TEST_ASSERT_EQUAL_UINT8(0, device.processor.seedJobs_);
+}
+
+
+// -----------------------------------------------------------------------------
+// Tests: RETURN_ON_TOUCH delivery
+// -----------------------------------------------------------------------------
+
+// The password is only sent on the touch, then wiped from outputBuffer_
+void test_returned_password_waits_for_the_touch(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 5, turtlpass_PasswordDelivery_RETURN_ON_TOUCH));
+    device.runCore1();
+    device.processor.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+    TEST_ASSERT_EQUAL(AWAITING_CONFIRMATION, device.state);
+    TEST_ASSERT_FALSE(isZero(device.output, sizeof(device.output)));
+
+    // queries are still answered; other commands wait for the touch
+    TEST_ASSERT_TRUE(simpleCommand(device, turtlpass_CommandType_GET_DEVICE_INFO, 6));
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_EQUAL_UINT32(6, sent[0].requestId);
+    TEST_ASSERT_FALSE(generate(device, 7));
+    fakeMillisTime() += CONFIRM_TIMEOUT_MS - 1;
+    device.processor.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+
+    device.processor.confirmPending();
+    sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_TRUE(sent[0].success);
+    TEST_ASSERT_EQUAL_UINT32(5, sent[0].requestId);
+    TEST_ASSERT_EQUAL_STRING(expectedPassword(device, 5).c_str(), sent[0].data.c_str());
+    TEST_ASSERT_TRUE(isZero(device.output, sizeof(device.output)));
+    TEST_ASSERT_EQUAL(IDLE, device.state);
+    TEST_ASSERT_FALSE(device.processor.deliveryPending_);
+
+    device.processor.confirmPending();  // a second touch sends nothing
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+    TEST_ASSERT_TRUE(generate(device, 7));
+}
+
+// Without a touch the password is wiped and the host gets an error instead
+void test_unconfirmed_password_times_out(void) {
+    Device device;
+    TEST_ASSERT_TRUE(generate(device, 8, turtlpass_PasswordDelivery_RETURN_ON_TOUCH));
+    device.runCore1();
+    device.processor.loop();
+    TEST_ASSERT_FALSE(isZero(device.output, sizeof(device.output)));
+
+    fakeMillisTime() += CONFIRM_TIMEOUT_MS;
+    device.processor.loop();
+    std::vector<Reply> sent = replies();
+    TEST_ASSERT_EQUAL_UINT32(1, sent.size());
+    TEST_ASSERT_FALSE(sent[0].success);
+    TEST_ASSERT_EQUAL(turtlpass_ErrorCode_INTERNAL_ERROR, sent[0].error);
+    TEST_ASSERT_EQUAL_UINT32(8, sent[0].requestId);
+    TEST_ASSERT_EQUAL_STRING("Password not confirmed", sent[0].data.c_str());
+    TEST_ASSERT_TRUE(isZero(device.output, sizeof(device.output)));
+    TEST_ASSERT_EQUAL(IDLE, device.state);
+
+    device.processor.confirmPending();  // a late touch sends nothing
+    TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+}
+
+
+// -----------------------------------------------------------------------------
+// Test runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lockstep_commands_stay_serial);
+    RUN_TEST(test_tagged_derivations_overlap);
+    RUN_TEST(test_out_of_order_completions_keep_their_request_id);
+    RUN_TEST(test_seed_and_wipe_commands_are_barriers);
+    RUN_TEST(test_derivation_waits_for_a_pipelined_seed);
+    RUN_TEST(test_returned_password_waits_for_the_touch);
+    RUN_TEST(test_unconfirmed_password_times_out);
+    return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "storage/StorageManager.h"
+#include "storage/SeedManager.h"
+#include "core/CryptoWorker.h"
+#undef private
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+#include "crypto/EncryptionManager.cpp"
+#include "storage/SeedSession.cpp"
+#include "storage/StorageManager.cpp"
+#include "storage/SeedManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+#include "core/CryptoWorker.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+// A device with a committed seed in slot 1
+struct Device {
+    RamStorageBackend flash;
+    SeedManager seeds;
+    CryptoWorker worker;
+
+    Device() : flash(4), seeds(flash), worker(seeds) {
+        seeds.begin();
+        uint8_t seed[SeedManager::SEED_SIZE];
+        for (size_t i = 0; i < sizeof(seed); i++) seed[i] = (uint8_t)(i * 3 + 1);
+        seeds.initializeSeed(1, seed, sizeof(seed));
+        seeds.flushStorage();
+    }
+};
+
+static void submitDerivation(CryptoWorker &worker, uint32_t requestId) {
+    CryptoJob *job = worker.acquire();
+    TEST_ASSERT_NOT_NULL(job);
+    job->type = CryptoJob::DERIVE_PASSWORD;
+    job->requestId = requestId;
+    job->slot = 1;
+    job->charset = turtlpass_Charset_LETTERS_NUMBERS;
+    job->length = 20;
+    snprintf(job->input, sizeof(job->input), "site-%u", (unsigned)requestId);
+    TEST_ASSERT_TRUE(worker.submit(job));
+}
+
+static void submitSeed(CryptoWorker &worker, uint32_t requestId, uint8_t slot) {
+    CryptoJob *job = worker.acquire();
+    TEST_ASSERT_NOT_NULL(job);
+    job->type = CryptoJob::INITIALIZE_SEED;
+    job->requestId = requestId;
+    job->slot = slot;
+    memset(job->seed, slot, sizeof(job->seed));
+    TEST_ASSERT_TRUE(worker.submit(job));
+}
+
+// The password a lone derivation of the same request gives
+static void expectedPassword(SeedManager &seeds, uint32_t requestId, uint8_t *out) {
+    Kdf kdf;
+    char input[32];
+    snprintf(input, sizeof(input), "site-%u", (unsigned)requestId);
+    TEST_ASSERT_EQUAL(CryptoJob::OK, CryptoWorker::derivePassword(seeds, kdf, 1, turtlpass_Charset_LETTERS_NUMBERS,
+                                                                 out, 20, input));
+}
+
+void setUp(void) {
+    fakeMillisTime() = 1000;
+}
+
+void tearDown(void) {}
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// core0 only steps in while core1 is busy with a derivation
+void test_core0_takes_a_derivation_alongside_core1(void) {
+    Device device;
+    CryptoWorker &worker = device.worker;
+    Kdf kdf;
+
+    submitDerivation(worker, 1);
+    TEST_ASSERT_FALSE(worker.work(kdf));  // core1 is idle: it takes the job
+
+    const int first = worker.claim(false);  // core1 starts job 1
+    TEST_ASSERT_TRUE(first >= 0);
+    submitDerivation(worker, 2);
+    TEST_ASSERT_TRUE(worker.work(kdf));  // core0 runs job 2 meanwhile
+    TEST_ASSERT_NULL(worker.poll());     // answered in submission order: job 1 first
+
+    worker.run((uint8_t)first, worker.kdf_);
+    uint8_t expected[MAX_PASS_SIZE + 1];
+    for (uint32_t requestId = 1; requestId <= 2; requestId++) {
+        CryptoJob *job = worker.poll();
+        TEST_ASSERT_NOT_NULL(job);
+        TEST_ASSERT_EQUAL_UINT32(requestId, job->requestId);
+        TEST_ASSERT_EQUAL(CryptoJob::OK, job->status);
+        expectedPassword(device.seeds, requestId, expected);
+        TEST_ASSERT_EQUAL_STRING((const char *)expected, (const char *)job->output);
+        worker.release(job);
+    }
+    TEST_ASSERT_FALSE(worker.isBusy());
+}
+
+// A seed job never overlaps a derivation, in either order
+void test_seed_jobs_run_alone(void) {
+    Device device;
+    CryptoWorker &worker = device.worker;
+    Kdf kdf;
+
+    submitDerivation(worker, 1);
+    submitSeed(worker, 2, 2);
+    submitDerivation(worker, 3);
+
+    const int first = worker.claim(false);
+    TEST_ASSERT_TRUE(first >= 0);
+    TEST_ASSERT_FALSE(worker.work(kdf));           // the seed job is next: it waits
+    TEST_ASSERT_EQUAL_INT(-1, worker.claim(false));
+    worker.run((uint8_t)first, worker.kdf_);
+
+    const int seed = worker.claim(false);
+    TEST_ASSERT_TRUE(seed >= 0);
+    TEST_ASSERT_EQUAL(CryptoJob::INITIALIZE_SEED, worker.jobs_[seed].type);
+    TEST_ASSERT_FALSE(worker.work(kdf));           // no derivation beside a seed job
+    worker.run((uint8_t)seed, worker.kdf_);
+
+    worker.loop();
+    for (uint32_t requestId = 1; requestId <= 3; requestId++) {
+        CryptoJob *job = worker.poll();
+        TEST_ASSERT_NOT_NULL(job);
+        TEST_ASSERT_EQUAL_UINT32(requestId, job->requestId);
+        TEST_ASSERT_EQUAL(CryptoJob::OK, job->status);
+        worker.release(job);
+    }
+}
+
+// Both cores draining a full queue: every result is right and comes back in order
+void test_both_cores_drain_the_queue(void) {
+    Device device;
+    CryptoWorker &worker = device.worker;
+    Kdf kdf;
+    std::atomic<bool> stop(false);
+
+    // std::thread stands in for core1
+    std::thread core1([&]() {
+        while (!stop.load()) worker.loop();
+    });
+
+    uint32_t nextRequest = 1, nextAnswer = 1;
+    uint8_t expected[MAX_PASS_SIZE + 1];
+    while (nextAnswer <= 40) {
+        while (nextRequest <= 40 && worker.hasFreeJob()) submitDerivation(worker, nextRequest++);
+        worker.work(kdf);
+        CryptoJob *job;
+        while ((job = worker.poll()) != nullptr) {
+            TEST_ASSERT_EQUAL_UINT32(nextAnswer, job->requestId);
+            expectedPassword(device.seeds, nextAnswer, expected);
+            TEST_ASSERT_EQUAL_STRING((const char *)expected, (const char *)job->output);
+            worker.release(job);
+            nextAnswer++;
+        }
+    }
+    stop.store(true);
+    core1.join();
+    TEST_ASSERT_FALSE(worker.isBusy());
+}
+
+
+// -----------------------------------------------------------------------------
+// Test runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_core0_takes_a_derivation_alongside_core1);
+    RUN_TEST(test_seed_jobs_run_alone);
+    RUN_TEST(test_both_cores_drain_the_queue);
+    return UNITY_END();
+}
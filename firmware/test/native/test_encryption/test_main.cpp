@@ -11,11 +11,12 @@
 #define private public
 #define protected public
 #include "crypto/Kdf.h"
+#include "crypto/EncryptionManager.h"
 #undef private
 #undef protected
+#include "crypto/HmacSha512.cpp"
 #include "crypto/Kdf.cpp"
 
-#include "crypto/EncryptionManager.h"
 #include "crypto/EncryptionManager.cpp"
 
 
@@ -460,6 +461,44 @@ void test_repeated_encryption_consistency(void) {
     TEST_ASSERT_EQUAL_UINT8_ARRAY(ct1.data(), ct2.data(), size);
 }
 
+/**
+* @test Cached slot keys match a fresh derivation and skip the KDF.
+*
+* Verifies that the second init() of a slot copies the cached key/IV (no SHA-512 work)
+* and that clearCache() wipes every entry so the next init() derives again.
+*/
+void test_slot_key_cache(void) {
+    EncryptionManager em;
+    const uint8_t slot = 4;
+
+    em.init(slot);
+    uint32_t firstCost = em.kdf.compressionCount();
+    TEST_ASSERT_TRUE(firstCost > 0);
+    TEST_ASSERT_TRUE(em.slotCache[slot - 1].valid);
+
+    // fresh derivation of the same slot, bypassing the cache
+    uint8_t key[ENCRYPTION_KEY_SIZE], iv[ENCRYPTION_IV_SIZE];
+    em.deriveSlotKeys(slot, key, iv);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(key, em.encryptionKey, ENCRYPTION_KEY_SIZE);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(iv, em.encryptionIV, ENCRYPTION_IV_SIZE);
+
+    // cache hit: no KDF work
+    em.kdf.resetCompressionCount();
+    em.init(slot);
+    TEST_ASSERT_EQUAL_UINT32(0, em.kdf.compressionCount());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(key, em.encryptionKey, ENCRYPTION_KEY_SIZE);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(iv, em.encryptionIV, ENCRYPTION_IV_SIZE);
+
+    // wipe: everything zeroed, next init() derives again
+    em.clearCache();
+    TEST_ASSERT_FALSE(em.isInitialized());
+    uint8_t zero[sizeof(em.slotCache)] = {0};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, em.slotCache, sizeof(zero));
+    em.init(slot);
+    TEST_ASSERT_EQUAL_UINT32(firstCost, em.kdf.compressionCount());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(key, em.encryptionKey, ENCRYPTION_KEY_SIZE);
+}
+
 
 // -----------------------------------------------------------------------------
 // Test Runner
@@ -478,5 +517,6 @@ int main() {
     RUN_TEST(test_slot_isolation);
     RUN_TEST(test_invalid_slot);
     RUN_TEST(test_repeated_encryption_consistency);
+    RUN_TEST(test_slot_key_cache);
     return UNITY_END();
 }
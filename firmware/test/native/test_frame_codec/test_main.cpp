@@ -0,0 +1,314 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Include module under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "proto/FrameCodec.h"
+#undef private
+#include "proto/FrameCodec.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t MAX_MESSAGE = 1259;  // turtlpass_Command_size
+
+static uint32_t rngState = 0x12345678;
+static uint32_t nextRandom() {
+    // xorshift32: deterministic across runs
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Random message; about one byte in eight is zero
+static std::vector<uint8_t> randomMessage(size_t len) {
+    std::vector<uint8_t> message(len);
+    for (auto &b : message) b = nextRandom() % 8 == 0 ? 0 : (uint8_t)nextRandom();
+    return message;
+}
+
+static std::vector<uint8_t> encode(const std::vector<uint8_t> &message) {
+    std::vector<uint8_t> out;
+    writeCobsFrame(message.data(), message.size(),
+                   [&](const uint8_t *data, size_t len) { out.insert(out.end(), data, data + len); });
+    return out;
+}
+
+// Decode a whole stream, collecting good messages and reported errors
+struct Decoded {
+    std::vector<std::vector<uint8_t>> messages;
+    std::vector<size_t> messageEnds;  // stream offset after each message
+    size_t errors = 0;
+};
+
+static Decoded decodeStream(CobsFrameDecoder &decoder, const std::vector<uint8_t> &stream, size_t chunk) {
+    Decoded decoded;
+    for (size_t offset = 0; offset < stream.size();) {
+        const size_t len = std::min(chunk, stream.size() - offset);
+        size_t used = 0;
+        CobsFrameDecoder::Result result = decoder.feed(stream.data() + offset, len, used);
+        offset += used;
+        if (result == CobsFrameDecoder::FRAME_OK) {
+            decoded.messages.emplace_back(decoder.message(), decoder.message() + decoder.messageLength());
+            decoded.messageEnds.push_back(offset);
+            decoder.release();
+        } else if (result == CobsFrameDecoder::FRAME_ERROR) {
+            decoded.errors++;
+        }
+    }
+    return decoded;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+void test_crc16_check_value() {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t *)"123456789", 9));
+}
+
+void test_cobs_encoding() {
+    // known vector: 11 22 00 33 + CRC, delimited
+    const std::vector<uint8_t> message = { 0x11, 0x22, 0x00, 0x33 };
+    const uint16_t crc = crc16(message.data(), message.size());
+    std::vector<uint8_t> expected = { 0x03, 0x11, 0x22, 0x04, 0x33, (uint8_t)crc, (uint8_t)(crc >> 8), 0x00 };
+    TEST_ASSERT_TRUE((crc & 0xFF) != 0 && (crc >> 8) != 0);  // no zero in the CRC of this vector
+    std::vector<uint8_t> frame = encode(message);
+    TEST_ASSERT_EQUAL(expected.size(), frame.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), frame.data(), expected.size());
+}
+
+void test_roundtrip_edge_lengths() {
+    static uint8_t buffer[MAX_MESSAGE + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    const size_t lengths[] = { 0, 1, 2, 252, 253, 254, 255, 256, 507, 508, 509, 1000, MAX_MESSAGE };
+
+    for (size_t len : lengths) {
+        for (int variant = 0; variant < 3; variant++) {
+            std::vector<uint8_t> message = randomMessage(len);
+            if (variant == 1) for (auto &b : message) b = b ? b : 0x5A;  // no zeros: full blocks
+            if (variant == 2) for (auto &b : message) b = 0;             // zeros only
+
+            std::vector<uint8_t> frame = encode(message);
+            TEST_ASSERT_TRUE(frame.size() <= len + FRAME_CRC_SIZE + (len + FRAME_CRC_SIZE) / COBS_MAX_RUN + 2);
+            for (size_t i = 0; i + 1 < frame.size(); i++) TEST_ASSERT_NOT_EQUAL(0, frame[i]);
+            TEST_ASSERT_EQUAL(0, frame.back());
+
+            // whole and byte by byte
+            for (size_t chunk : { frame.size(), (size_t)1 }) {
+                Decoded decoded = decodeStream(decoder, frame, chunk);
+                TEST_ASSERT_EQUAL(0, decoded.errors);
+                TEST_ASSERT_EQUAL(1, decoded.messages.size());
+                TEST_ASSERT_TRUE(decoded.messages[0] == message);
+            }
+        }
+    }
+}
+
+void test_zero_after_full_block() {
+    // a zero right after a full block needs its own (empty) block
+    std::vector<uint8_t> message(COBS_MAX_RUN, 0x41);
+    message.push_back(0x00);
+    message.push_back(0x42);
+    std::vector<uint8_t> frame = encode(message);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, frame[1 + COBS_MAX_RUN]);
+
+    uint8_t buffer[512];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    Decoded decoded = decodeStream(decoder, frame, frame.size());
+    TEST_ASSERT_EQUAL(1, decoded.messages.size());
+    TEST_ASSERT_TRUE(decoded.messages[0] == message);
+}
+
+void test_streamed_pieces_match_whole() {
+    static uint8_t buffer[MAX_MESSAGE + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+
+    for (int round = 0; round < 200; round++) {
+        std::vector<uint8_t> message = randomMessage(nextRandom() % MAX_MESSAGE);
+        std::vector<uint8_t> streamed;
+        auto write = [&](const uint8_t *data, size_t len) { streamed.insert(streamed.end(), data, data + len); };
+        {
+            // pieces as small as a protobuf tag or as large as a bytes field
+            CobsFrameEncoder<decltype(write)> encoder(write);
+            for (size_t offset = 0; offset < message.size();) {
+                const size_t len = std::min<size_t>(nextRandom() % 2 ? 1 : nextRandom() % 600, message.size() - offset);
+                encoder.append(message.data() + offset, len);
+                offset += len;
+            }
+            encoder.finish();
+        }
+        TEST_ASSERT_TRUE(streamed == encode(message));
+
+        Decoded decoded = decodeStream(decoder, streamed, 64);
+        TEST_ASSERT_EQUAL(1, decoded.messages.size());
+        TEST_ASSERT_TRUE(decoded.messages[0] == message);
+    }
+}
+
+void test_oversized_frame_is_dropped() {
+    uint8_t buffer[64 + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    std::vector<uint8_t> stream = encode(randomMessage(65));
+    std::vector<uint8_t> fits = randomMessage(64);
+    std::vector<uint8_t> next = encode(fits);
+    stream.insert(stream.end(), next.begin(), next.end());
+
+    Decoded decoded = decodeStream(decoder, stream, 16);
+    TEST_ASSERT_EQUAL(1, decoded.errors);
+    TEST_ASSERT_EQUAL(1, decoded.messages.size());
+    TEST_ASSERT_TRUE(decoded.messages[0] == fits);
+}
+
+void test_every_single_byte_corruption_is_caught() {
+    uint8_t buffer[MAX_MESSAGE + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    const std::vector<uint8_t> message = randomMessage(300);
+    const std::vector<uint8_t> frame = encode(message);
+    const std::vector<uint8_t> next = encode(randomMessage(20));
+
+    for (size_t i = 0; i + 1 < frame.size(); i++) {
+        for (uint8_t mask : { 0x01, 0x80, 0xFF }) {
+            std::vector<uint8_t> stream = frame;
+            stream[i] ^= mask;
+            stream.insert(stream.end(), next.begin(), next.end());
+
+            Decoded decoded = decodeStream(decoder, stream, stream.size());
+            // the damaged frame never passes; the next one does, with one error report
+            TEST_ASSERT_EQUAL(1, decoded.errors);
+            TEST_ASSERT_EQUAL(1, decoded.messages.size());
+            TEST_ASSERT_EQUAL(20, decoded.messages[0].size());
+        }
+    }
+}
+
+// Noise bursts at full speed: every frame after the delimiter ending a burst is
+// received, and each burst costs exactly one error report however long it is.
+void test_noisy_stream_recovers_at_next_delimiter() {
+    static uint8_t buffer[MAX_MESSAGE + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+
+    const size_t FRAMES = 4000;
+    std::vector<uint8_t> stream;
+    std::vector<std::vector<uint8_t>> sent;
+    std::vector<size_t> burstEnds;  // stream offset after each burst
+    size_t bursts = 0;
+
+    for (size_t f = 0; f < FRAMES; f++) {
+        std::vector<uint8_t> message = randomMessage(4 + nextRandom() % 120);
+        std::vector<uint8_t> frame = encode(message);
+        bool hit = nextRandom() % 10 == 0;
+        if (hit) {
+            // garbage up to 300 bytes, with or without zeros, ending in a delimiter:
+            // the line resynchronises there, the frame after it must be received
+            size_t len = 1 + nextRandom() % 300;
+            bool zeros = nextRandom() % 2 == 0;
+            for (size_t i = 0; i < len; i++) {
+                uint8_t b = (uint8_t)nextRandom();
+                stream.push_back(zeros || b ? b : 0x55);
+            }
+            stream.push_back(FRAME_DELIMITER);
+            burstEnds.push_back(stream.size());
+            bursts++;
+        }
+        stream.insert(stream.end(), frame.begin(), frame.end());
+        sent.push_back(message);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    Decoded decoded = decodeStream(decoder, stream, 64);  // USB packets
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+    // every frame arrives in order: a burst ending in a delimiter never takes a frame with it
+    TEST_ASSERT_EQUAL(sent.size(), decoded.messages.size());
+    for (size_t i = 0; i < sent.size(); i++) TEST_ASSERT_TRUE(decoded.messages[i] == sent[i]);
+
+    // at most one report per burst (a burst may decode as empty or good-looking frames: never
+    // more than one error between two good frames)
+    TEST_ASSERT_TRUE(decoded.errors <= bursts);
+    TEST_ASSERT_TRUE(decoded.errors > bursts / 2);
+
+    // recovery time: bytes from the end of a burst to the end of the next good frame
+    size_t worst = 0, m = 0;
+    for (size_t end : burstEnds) {
+        while (decoded.messageEnds[m] < end) m++;
+        worst = std::max(worst, decoded.messageEnds[m] - end);
+    }
+    TEST_ASSERT_TRUE(worst <= 124 + FRAME_CRC_SIZE + 2);  // exactly the next frame
+
+    printf("\n%zu frames, %zu bursts, %zu bytes: %zu errors reported, %u frames dropped\n",
+           FRAMES, bursts, stream.size(), decoded.errors, (unsigned)decoder.droppedFrames());
+    printf("decode %.1f MB/s, worst recovery %zu bytes after a burst\n", stream.size() / us, worst);
+}
+
+// Without the delimiter the host sends after noise, only the first frame after a burst is lost
+void test_noise_without_delimiter_costs_one_frame() {
+    static uint8_t buffer[MAX_MESSAGE + FRAME_CRC_SIZE];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> a = randomMessage(40), b = randomMessage(40), c = randomMessage(40);
+    std::vector<uint8_t> fa = encode(a), fb = encode(b), fc = encode(c);
+
+    stream.insert(stream.end(), fa.begin(), fa.end());
+    for (int i = 0; i < 500; i++) stream.push_back((uint8_t)(nextRandom() | 1));  // no zeros
+    stream.insert(stream.end(), fb.begin(), fb.end());
+    stream.insert(stream.end(), fc.begin(), fc.end());
+
+    Decoded decoded = decodeStream(decoder, stream, 64);
+    TEST_ASSERT_EQUAL(1, decoded.errors);
+    TEST_ASSERT_EQUAL(2, decoded.messages.size());
+    TEST_ASSERT_TRUE(decoded.messages[0] == a);
+    TEST_ASSERT_TRUE(decoded.messages[1] == c);
+}
+
+void test_buffer_is_wiped() {
+    uint8_t buffer[64 + FRAME_CRC_SIZE] = { 0 };
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    std::vector<uint8_t> message(60, 0xAB);
+    std::vector<uint8_t> frame = encode(message);
+
+    size_t used = 0;
+    TEST_ASSERT_EQUAL(CobsFrameDecoder::FRAME_OK, decoder.feed(frame.data(), frame.size(), used));
+    decoder.release();
+    for (uint8_t b : buffer) TEST_ASSERT_EQUAL_UINT8(0, b);
+
+    // a partial frame dropped by reset()
+    TEST_ASSERT_EQUAL(CobsFrameDecoder::FRAME_NONE, decoder.feed(frame.data(), 30, used));
+    TEST_ASSERT_TRUE(decoder.inFrame());
+    decoder.reset();
+    TEST_ASSERT_FALSE(decoder.inFrame());
+    for (uint8_t b : buffer) TEST_ASSERT_EQUAL_UINT8(0, b);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_cobs_encoding);
+    RUN_TEST(test_roundtrip_edge_lengths);
+    RUN_TEST(test_zero_after_full_block);
+    RUN_TEST(test_streamed_pieces_match_whole);
+    RUN_TEST(test_oversized_frame_is_dropped);
+    RUN_TEST(test_every_single_byte_corruption_is_caught);
+    RUN_TEST(test_noisy_stream_recovers_at_next_delimiter);
+    RUN_TEST(test_noise_without_delimiter_costs_one_frame);
+    RUN_TEST(test_buffer_is_wiped);
+
+    return UNITY_END();
+}
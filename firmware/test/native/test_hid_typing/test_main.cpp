@@ -0,0 +1,526 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <functional>
+
+// -----------------------------------------------------------------------------
+// Include module under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "keyboard/HidTyper.h"
+#undef private
+#include "keyboard/KeyboardLayout.cpp"
+#include "keyboard/HidReportStream.cpp"
+#include "keyboard/HidTyper.cpp"
+#include "keyboard/HidCalibrator.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+static const KeyboardLayout &US = keyboardLayout(LAYOUT_US);
+
+// Character a host with this layout produces for a key (0 for none)
+static char charFor(const KeyboardLayout &layout, uint8_t modifier, uint8_t keycode) {
+    for (int c = 0; c < 128; c++) {
+        if (layout.keys[c].keycode == keycode && layout.keys[c].modifier == modifier) return (char)c;
+    }
+    return 0;
+}
+
+/**
+ * @brief Simulated host polling the interrupt endpoint every intervalMs.
+ *
+ * A report is taken at the first poll after it was queued; ready() stays false until then.
+ * Each idle() advances the fake clock by 1 ms. Key-downs are decoded like a host would:
+ * keys present in a report but not in the previous one, through the host layout. A dead
+ * key is held until the next key, which must be a space to produce its character.
+ * Report completions are timestamped at the poll that took the report.
+ */
+struct SimulatedHost : public IHidReportSink {
+    uint32_t intervalMs;
+    const KeyboardLayout &layout;
+    char deadKey = 0;
+    std::function<uint32_t(size_t)> lateBy;       // polls the host skips before taking the n-th report
+    bool feedback = true;                         // report-complete callbacks arrive
+    bool pending = false;
+    uint32_t completions = 0;
+    uint32_t completedUs = 0;
+    uint32_t takenAt = 0;
+    bool polling = true;
+    std::vector<HidReport> reports;
+    std::string typed;
+    uint32_t maxNewKeysPerReport = 0;
+    HidReport previous = {};
+
+    explicit SimulatedHost(uint32_t interval, const KeyboardLayout &hostLayout = US)
+        : intervalMs(interval), layout(hostLayout) {}
+
+    bool ready() override {
+        return polling && millis() >= takenAt;
+    }
+
+    void idle() override {
+        advanceMillis(1);
+    }
+
+    void settle() {
+        if (pending && polling && millis() >= takenAt) {
+            pending = false;
+            completions++;
+            completedUs = takenAt * 1000;
+        }
+    }
+
+    uint32_t completedReports() override {
+        settle();
+        return feedback ? completions : 0;
+    }
+
+    uint32_t lastCompletedUs() override {
+        settle();
+        return completedUs;
+    }
+
+    bool send(const HidReport &report) override {
+        if (!ready()) return false;
+        uint32_t now = millis();
+        takenAt = (now / intervalMs + 1) * intervalMs;
+        if (lateBy) takenAt += lateBy(reports.size()) * intervalMs;
+        pending = true;
+        reports.push_back(report);
+
+        uint32_t newKeys = 0;
+        for (int i = 0; i < HID_KEYS_PER_REPORT; i++) {
+            uint8_t key = report.keycodes[i];
+            if (key && !memchr(previous.keycodes, key, HID_KEYS_PER_REPORT)) {
+                char c = charFor(layout, report.modifier, key);
+                if (deadKey) {
+                    typed += (key == HID_KEY_SPACE_CODE && report.modifier == 0) ? deadKey : '?';
+                    deadKey = 0;
+                } else if (c && layout.keys[(uint8_t)c].dead) {
+                    deadKey = c;
+                } else {
+                    typed += c ? c : '?';
+                }
+                newKeys++;
+            }
+        }
+        if (newKeys > maxNewKeysPerReport) maxNewKeysPerReport = newKeys;
+        previous = report;
+        return true;
+    }
+};
+
+static bool isReleaseReport(const HidReport &r) {
+    static const HidReport zero = {};
+    return memcmp(&r, &zero, sizeof(r)) == 0;
+}
+
+static void assertReport(const HidReport &r, uint8_t modifier, std::initializer_list<uint8_t> keys) {
+    TEST_ASSERT_EQUAL_HEX8(modifier, r.modifier);
+    uint8_t expected[HID_KEYS_PER_REPORT] = {0};
+    size_t i = 0;
+    for (uint8_t k : keys) expected[i++] = k;
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, r.keycodes, HID_KEYS_PER_REPORT);
+}
+
+/**
+ * @brief Types str through the simulated host and reports the achieved chars/sec.
+ */
+static void typeAndMeasure(SimulatedHost &host, const char *str, HidTypingSpeed speed, double &charsPerSec) {
+    HidTyper typer(host);
+    uint32_t start = millis();
+    TEST_ASSERT_TRUE(typer.type(str, hidTypingProfile(speed), host.layout));
+    uint32_t elapsed = millis() - start;
+    TEST_ASSERT_EQUAL_UINT32(strlen(str), typer.typed());
+    TEST_ASSERT_EQUAL_STRING(str, host.typed.c_str());
+    TEST_ASSERT_TRUE(isReleaseReport(host.reports.back()));
+    charsPerSec = elapsed ? strlen(str) * 1000.0 / elapsed : 0;
+}
+
+static const char *PASSWORD =
+    "q7Rk2mXvP9aLd3TfWc8nBz4HsJy6GuEo1iVbN5tKrQx0Yp2MwCe7AjSd9LhFg3UvZn8RkTq4XmPa6DyWc1EbJs5GoHi0VlNt";
+
+void setUp(void) {
+    fakeMillisTime() = 1000;
+}
+
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_distinct_keys_roll_over(void) {
+    HidReport r[16];
+    size_t n = renderHidReports("abc", US, 6, r, 16, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(4, n);
+    assertReport(r[0], 0, {0x04});
+    assertReport(r[1], 0, {0x04, 0x05});
+    assertReport(r[2], 0, {0x04, 0x05, 0x06});
+    TEST_ASSERT_TRUE(isReleaseReport(r[3]));
+}
+
+void test_release_on_repeat_and_modifier_change(void) {
+    HidReport r[16];
+    // 'a' repeats, then 'A' needs shift, then 'b' drops it again
+    size_t n = renderHidReports("aaAb", US, 6, r, 16, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(8, n);
+    assertReport(r[0], 0, {0x04});
+    TEST_ASSERT_TRUE(isReleaseReport(r[1]));
+    assertReport(r[2], 0, {0x04});
+    TEST_ASSERT_TRUE(isReleaseReport(r[3]));
+    assertReport(r[4], HID_MODIFIER_LEFTSHIFT, {0x04});
+    TEST_ASSERT_TRUE(isReleaseReport(r[5]));
+    assertReport(r[6], 0, {0x05});
+    TEST_ASSERT_TRUE(isReleaseReport(r[7]));
+}
+
+void test_full_report_is_released(void) {
+    HidReport r[16];
+    size_t n = renderHidReports("abcdefg", US, 6, r, 16, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(9, n);
+    assertReport(r[5], 0, {0x04, 0x05, 0x06, 0x07, 0x08, 0x09});
+    TEST_ASSERT_TRUE(isReleaseReport(r[6]));
+    assertReport(r[7], 0, {0x0A});
+}
+
+void test_compatible_profile_matches_legacy_reports(void) {
+    const HidTypingProfile &p = hidTypingProfile(HID_SPEED_COMPATIBLE);
+    TEST_ASSERT_EQUAL_UINT8(1, p.maxKeysPerReport);
+    HidReport r[16];
+    size_t n = renderHidReports("ab", US, p.maxKeysPerReport, r, 16, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(4, n);
+    assertReport(r[0], 0, {0x04});
+    TEST_ASSERT_TRUE(isReleaseReport(r[1]));
+    assertReport(r[2], 0, {0x05});
+    TEST_ASSERT_TRUE(isReleaseReport(r[3]));
+}
+
+void test_unmapped_chars_are_skipped(void) {
+    HidReport r[16];
+    size_t consumed = 0;
+    size_t n = renderHidReports("a\x01\xC3" "b", US, 6, r, 16, &consumed);
+    TEST_ASSERT_EQUAL_UINT32(4, consumed);
+    TEST_ASSERT_EQUAL_UINT32(3, n);
+    assertReport(r[1], 0, {0x04, 0x05});
+}
+
+void test_chunks_end_with_a_release(void) {
+    HidReport r[5];
+    size_t consumed = 0;
+    size_t n = renderHidReports("abcdef", US, 6, r, 5, &consumed);
+    TEST_ASSERT_EQUAL_UINT32(4, consumed);
+    TEST_ASSERT_EQUAL_UINT32(5, n);
+    TEST_ASSERT_TRUE(isReleaseReport(r[4]));
+
+    // the next chunk starts from the first character left
+    n = renderHidReports("abcdef" + consumed, US, 6, r, 5, &consumed);
+    TEST_ASSERT_EQUAL_UINT32(2, consumed);
+    assertReport(r[1], 0, {0x08, 0x09});
+}
+
+void test_host_sees_password_in_order(void) {
+    for (int speed = HID_SPEED_COMPATIBLE; speed <= HID_SPEED_FAST; speed++) {
+        SimulatedHost host(2);
+        double charsPerSec = 0;
+        typeAndMeasure(host, PASSWORD, (HidTypingSpeed)speed, charsPerSec);
+        TEST_ASSERT_EQUAL_UINT32(1, host.maxNewKeysPerReport);
+    }
+}
+
+void test_throughput_per_profile(void) {
+    double compatible = 0, standard = 0, fast = 0;
+    SimulatedHost legacy(2);
+    typeAndMeasure(legacy, PASSWORD, HID_SPEED_COMPATIBLE, compatible);
+    SimulatedHost standardHost(2);
+    typeAndMeasure(standardHost, PASSWORD, HID_SPEED_STANDARD, standard);
+    SimulatedHost fastHost(1);
+    typeAndMeasure(fastHost, PASSWORD, HID_SPEED_FAST, fast);
+
+    printf("chars/sec: compatible %.0f, standard %.0f, fast %.0f\n", compatible, standard, fast);
+    TEST_ASSERT_TRUE(compatible <= 80.0);   // 13 ms per character, as before
+    TEST_ASSERT_TRUE(standard >= 250.0);    // one report per 2 ms poll; case changes cost a release
+    TEST_ASSERT_TRUE(fast >= standard);
+}
+
+void test_stalled_host_times_out(void) {
+    SimulatedHost host(2);
+    HidTyper typer(host);
+    TEST_ASSERT_TRUE(typer.start("abc", hidTypingProfile(HID_SPEED_FAST), US));
+    TEST_ASSERT_TRUE(typer.poll());
+    host.polling = false;  // e.g. suspended
+
+    uint32_t start = millis();
+    while (typer.poll()) host.idle();
+    TEST_ASSERT_TRUE(typer.failed());
+    TEST_ASSERT_TRUE(millis() - start >= HID_REPORT_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, host.reports.size());
+    TEST_ASSERT_FALSE(typer.isTyping());
+}
+
+void test_poll_sends_one_report_at_a_time(void) {
+    SimulatedHost host(2);
+    HidTyper typer(host);
+    TEST_ASSERT_TRUE(typer.start("abc", hidTypingProfile(HID_SPEED_STANDARD), US));
+    TEST_ASSERT_FALSE(typer.start("xyz", hidTypingProfile(HID_SPEED_STANDARD), US));  // busy
+    TEST_ASSERT_EQUAL_UINT32(3, typer.total());
+
+    // the caller's loop keeps running: polls without progress just return
+    TEST_ASSERT_TRUE(typer.poll());
+    TEST_ASSERT_TRUE(typer.poll());
+    TEST_ASSERT_TRUE(typer.poll());
+    TEST_ASSERT_EQUAL_UINT32(1, host.reports.size());
+    TEST_ASSERT_EQUAL_UINT32(1, typer.typed());
+
+    advanceMillis(2);
+    TEST_ASSERT_TRUE(typer.poll());
+    TEST_ASSERT_EQUAL_UINT32(2, host.reports.size());
+    TEST_ASSERT_EQUAL_UINT32(2, typer.typed());
+
+    while (typer.poll()) host.idle();
+    TEST_ASSERT_FALSE(typer.failed());
+    TEST_ASSERT_EQUAL_STRING("abc", host.typed.c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, typer.typed());
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, (const uint8_t *)typer.reports_, sizeof(typer.reports_));
+}
+
+void test_reports_are_rendered_before_typing(void) {
+    SimulatedHost host(2);
+    HidTyper typer(host);
+    TEST_ASSERT_TRUE(typer.start("aB", hidTypingProfile(HID_SPEED_STANDARD), US));
+    TEST_ASSERT_EQUAL_UINT32(0, host.reports.size());
+    TEST_ASSERT_EQUAL_UINT32(2, typer.rendered_);
+    TEST_ASSERT_EQUAL_UINT32(4, typer.count_);
+    assertReport(typer.reports_[2], HID_MODIFIER_LEFTSHIFT, {0x05});
+    while (typer.poll()) host.idle();
+    TEST_ASSERT_EQUAL_STRING("aB", host.typed.c_str());
+}
+
+void test_layout_tables(void) {
+    const KeyboardLayout &de = keyboardLayout(LAYOUT_DE);
+    TEST_ASSERT_EQUAL_HEX8(0x1D, de.keys['y'].keycode);  // QWERTZ
+    TEST_ASSERT_EQUAL_HEX8(0x1C, de.keys['z'].keycode);
+    TEST_ASSERT_EQUAL_HEX8(HID_MODIFIER_RIGHTALT, de.keys['@'].modifier);
+    TEST_ASSERT_EQUAL_HEX8(0x14, de.keys['@'].keycode);
+    TEST_ASSERT_TRUE(de.keys['^'].dead);
+
+    const KeyboardLayout &fr = keyboardLayout(LAYOUT_FR);
+    TEST_ASSERT_EQUAL_HEX8(0x14, fr.keys['a'].keycode);  // AZERTY
+    TEST_ASSERT_EQUAL_HEX8(HID_MODIFIER_LEFTSHIFT, fr.keys['1'].modifier);
+    TEST_ASSERT_TRUE(fr.keys['~'].dead);
+
+    const KeyboardLayout &uk = keyboardLayout(LAYOUT_UK);
+    TEST_ASSERT_EQUAL_HEX8(0x34, uk.keys['@'].keycode);
+    TEST_ASSERT_EQUAL_HEX8(0x32, uk.keys['#'].keycode);
+
+    const KeyboardLayout &dvorak = keyboardLayout(LAYOUT_DVORAK);
+    TEST_ASSERT_EQUAL_HEX8(0x33, dvorak.keys['s'].keycode);
+    TEST_ASSERT_EQUAL_HEX8(0x07, dvorak.keys['e'].keycode);
+
+    TEST_ASSERT_EQUAL_PTR(&US, &keyboardLayout((KeyboardLayoutId)LAYOUT_COUNT));
+}
+
+void test_dead_key_is_followed_by_space(void) {
+    HidReport r[16];
+    size_t n = renderHidReports("a~", keyboardLayout(LAYOUT_FR), 6, r, 16, nullptr);
+    TEST_ASSERT_EQUAL_UINT32(6, n);
+    assertReport(r[0], 0, {0x14});
+    TEST_ASSERT_TRUE(isReleaseReport(r[1]));
+    assertReport(r[2], HID_MODIFIER_RIGHTALT, {0x1F});
+    TEST_ASSERT_TRUE(isReleaseReport(r[3]));
+    assertReport(r[4], 0, {HID_KEY_SPACE_CODE});
+    TEST_ASSERT_TRUE(isReleaseReport(r[5]));
+
+    // a dead key that does not fit is left for the next chunk
+    size_t consumed = 0;
+    renderHidReports("a~", keyboardLayout(LAYOUT_FR), 6, r, 5, &consumed);
+    TEST_ASSERT_EQUAL_UINT32(1, consumed);
+}
+
+void test_every_layout_types_printable_ascii(void) {
+    char printable[96] = {0};
+    for (int c = ' '; c <= '~'; c++) printable[c - ' '] = (char)c;
+
+    for (int id = 0; id < LAYOUT_COUNT; id++) {
+        const KeyboardLayout &layout = keyboardLayout((KeyboardLayoutId)id);
+        for (int c = ' '; c <= '~'; c++) {
+            TEST_ASSERT_NOT_EQUAL(0, layout.keys[c].keycode);
+        }
+        for (int speed = HID_SPEED_COMPATIBLE; speed <= HID_SPEED_FAST; speed++) {
+            SimulatedHost host(2, layout);
+            double charsPerSec = 0;
+            typeAndMeasure(host, printable, (HidTypingSpeed)speed, charsPerSec);
+            TEST_ASSERT_EQUAL_UINT32(1, host.maxNewKeysPerReport);
+        }
+    }
+}
+
+static void assertFallback(const HidCalibrator &calibrator) {
+    TEST_ASSERT_FALSE(calibrator.isCalibrating());
+    TEST_ASSERT_EQUAL_UINT8(HID_TIMING_FALLBACK, calibrator.result().source);
+    TEST_ASSERT_EQUAL_UINT8(hidTypingProfile(HID_SPEED_COMPATIBLE).pressMs, calibrator.result().pressMs);
+    TEST_ASSERT_EQUAL_UINT8(hidTypingProfile(HID_SPEED_COMPATIBLE).releaseMs, calibrator.result().releaseMs);
+}
+
+void test_calibration_converges_to_host_interval(void) {
+    const uint32_t intervals[] = { 1, 2, 4, 8 };
+    for (uint32_t interval : intervals) {
+        SimulatedHost host(interval);
+        HidCalibrator calibrator(host);
+        TEST_ASSERT_TRUE(calibrator.run());
+        TEST_ASSERT_EQUAL_UINT8(HID_TIMING_VERSION, calibrator.result().version);
+        TEST_ASSERT_EQUAL_UINT8(HID_TIMING_CALIBRATED, calibrator.result().source);
+        TEST_ASSERT_EQUAL_UINT8(interval, calibrator.result().pressMs);
+        TEST_ASSERT_EQUAL_UINT8(interval, calibrator.result().releaseMs);
+
+        // two agreeing rounds of probes, none of them typing anything
+        TEST_ASSERT_EQUAL_UINT32(2 * HID_CALIBRATION_SAMPLES, host.reports.size());
+        for (const HidReport &r : host.reports) TEST_ASSERT_TRUE(isReleaseReport(r));
+        TEST_ASSERT_EQUAL_STRING("", host.typed.c_str());
+    }
+}
+
+void test_calibration_settles_on_slowest_poll(void) {
+    // every fifth poll is late: the timing covers it
+    SimulatedHost host(1);
+    host.lateBy = [](size_t n) { return n % 5 == 4 ? 2u : 0u; };
+    HidCalibrator calibrator(host);
+    TEST_ASSERT_TRUE(calibrator.run());
+    TEST_ASSERT_EQUAL_UINT8(3, calibrator.result().pressMs);
+
+    // the calibrated timing types the password in order
+    SimulatedHost typingHost(1);
+    typingHost.lateBy = host.lateBy;
+    HidTyper typer(typingHost);
+    TEST_ASSERT_TRUE(typer.type(PASSWORD, hidTimingProfile(calibrator.result(), HID_SPEED_STANDARD), US));
+    TEST_ASSERT_EQUAL_STRING(PASSWORD, typingHost.typed.c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, typingHost.maxNewKeysPerReport);
+}
+
+void test_calibration_polled_from_a_busy_loop(void) {
+    // one probe step per loop pass, with other work in between: the timestamps still
+    // measure the host, not the loop
+    const uint32_t intervals[] = { 1, 2, 4 };
+    for (uint32_t interval : intervals) {
+        SimulatedHost host(interval);
+        HidCalibrator calibrator(host);
+        calibrator.start();
+        while (calibrator.poll()) {
+            advanceMillis(3);
+        }
+        TEST_ASSERT_EQUAL_UINT8(HID_TIMING_CALIBRATED, calibrator.result().source);
+        TEST_ASSERT_EQUAL_UINT8(interval, calibrator.result().pressMs);
+        TEST_ASSERT_EQUAL_STRING("", host.typed.c_str());
+    }
+}
+
+void test_calibration_falls_back_to_conservative_timing(void) {
+    SimulatedHost noFeedback(2);
+    noFeedback.feedback = false;
+    HidCalibrator blind(noFeedback);
+    TEST_ASSERT_FALSE(blind.run());
+    assertFallback(blind);
+
+    SimulatedHost stalled(2);
+    stalled.polling = false;
+    HidCalibrator stalledCalibrator(stalled);
+    uint32_t start = millis();
+    TEST_ASSERT_FALSE(stalledCalibrator.run());
+    TEST_ASSERT_TRUE(millis() - start >= HID_REPORT_TIMEOUT_MS);
+    assertFallback(stalledCalibrator);
+
+    SimulatedHost slow(16);
+    HidCalibrator slowCalibrator(slow);
+    TEST_ASSERT_FALSE(slowCalibrator.run());
+    assertFallback(slowCalibrator);
+
+    // a host slowing down every round never settles
+    SimulatedHost drifting(1);
+    drifting.lateBy = [](size_t n) { return (uint32_t)(n / HID_CALIBRATION_SAMPLES); };
+    HidCalibrator driftingCalibrator(drifting);
+    TEST_ASSERT_FALSE(driftingCalibrator.run());
+    assertFallback(driftingCalibrator);
+}
+
+void test_timing_profile(void) {
+    HidHostTiming timing = {};
+    const HidTypingProfile &standard = hidTypingProfile(HID_SPEED_STANDARD);
+    HidTypingProfile p = hidTimingProfile(timing, HID_SPEED_STANDARD);
+    TEST_ASSERT_EQUAL_UINT8(standard.pressMs, p.pressMs);
+    TEST_ASSERT_EQUAL_UINT8(standard.maxKeysPerReport, p.maxKeysPerReport);
+
+    timing = { HID_TIMING_VERSION, HID_TIMING_CALIBRATED, 3, 2 };
+    p = hidTimingProfile(timing, HID_SPEED_STANDARD);
+    TEST_ASSERT_EQUAL_UINT8(HID_KEYS_PER_REPORT, p.maxKeysPerReport);
+    TEST_ASSERT_EQUAL_UINT8(3, p.pressMs);
+    TEST_ASSERT_EQUAL_UINT8(2, p.releaseMs);
+
+    timing.source = HID_TIMING_FALLBACK;
+    p = hidTimingProfile(timing, HID_SPEED_FAST);
+    TEST_ASSERT_EQUAL_UINT8(1, p.maxKeysPerReport);
+    TEST_ASSERT_EQUAL_UINT8(hidTypingProfile(HID_SPEED_COMPATIBLE).pressMs, p.pressMs);
+
+    timing.version = 0xFF;  // erased storage
+    p = hidTimingProfile(timing, HID_SPEED_FAST);
+    TEST_ASSERT_EQUAL_UINT8(hidTypingProfile(HID_SPEED_FAST).pressMs, p.pressMs);
+}
+
+void test_cancel_releases_keys(void) {
+    SimulatedHost host(2);
+    HidTyper typer(host);
+    TEST_ASSERT_TRUE(typer.start("abcdef", hidTypingProfile(HID_SPEED_STANDARD), US));
+    while (typer.typed() < 2) {
+        typer.poll();
+        host.idle();
+    }
+    typer.cancel();
+    TEST_ASSERT_TRUE(typer.isTyping());  // a release is still due
+    while (typer.poll()) host.idle();
+
+    TEST_ASSERT_EQUAL_STRING("ab", host.typed.c_str());
+    TEST_ASSERT_TRUE(isReleaseReport(host.reports.back()));
+    TEST_ASSERT_EQUAL_UINT32(2, typer.typed());
+    TEST_ASSERT_FALSE(typer.failed());
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, (const uint8_t *)typer.reports_, sizeof(typer.reports_));
+
+    // nothing down: cancel stops at once
+    TEST_ASSERT_TRUE(typer.start("gh", hidTypingProfile(HID_SPEED_STANDARD), US));
+    typer.cancel();
+    TEST_ASSERT_FALSE(typer.isTyping());
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_distinct_keys_roll_over);
+    RUN_TEST(test_release_on_repeat_and_modifier_change);
+    RUN_TEST(test_full_report_is_released);
+    RUN_TEST(test_compatible_profile_matches_legacy_reports);
+    RUN_TEST(test_unmapped_chars_are_skipped);
+    RUN_TEST(test_chunks_end_with_a_release);
+    RUN_TEST(test_host_sees_password_in_order);
+    RUN_TEST(test_throughput_per_profile);
+    RUN_TEST(test_stalled_host_times_out);
+    RUN_TEST(test_poll_sends_one_report_at_a_time);
+    RUN_TEST(test_cancel_releases_keys);
+    RUN_TEST(test_reports_are_rendered_before_typing);
+    RUN_TEST(test_layout_tables);
+    RUN_TEST(test_dead_key_is_followed_by_space);
+    RUN_TEST(test_every_layout_types_printable_ascii);
+    RUN_TEST(test_calibration_converges_to_host_interval);
+    RUN_TEST(test_calibration_settles_on_slowest_poll);
+    RUN_TEST(test_calibration_polled_from_a_busy_loop);
+    RUN_TEST(test_calibration_falls_back_to_conservative_timing);
+    RUN_TEST(test_timing_profile);
+
+    return UNITY_END();
+}
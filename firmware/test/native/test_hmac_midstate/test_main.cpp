@@ -0,0 +1,209 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Include classes under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#define protected public
+#include "crypto/Kdf.h"
+#undef private
+#undef protected
+
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t BENCH_PASS_LENGTH = 100;  // default password length
+static const char *HEX_SEED = "1f517340d371cbf900369c48085c3a253821f77ce0adc494c2d8937068f91d7e";
+
+static void fillPattern(uint8_t *buf, size_t len, uint8_t start) {
+    for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(start + i * 7);
+}
+
+/**
+ * @brief SHA-512 compressions of the previous HKDF<SHA512>-based derivation.
+ *
+ * Every HMAC recomputed its ipad and opad blocks: extract cost 2 + data + 1,
+ * and each expand block 2 + data + 1 as well.
+ */
+static uint32_t legacyCompressions(size_t inputLength, size_t keyLength) {
+    auto blocks = [](size_t len) { return (uint32_t)((len + 17 + 127) / 128); };
+    uint32_t total = 2 + blocks(inputLength) + 1;  // extract
+    size_t remaining = keyLength;
+    for (uint8_t counter = 1; remaining > 0; ++counter) {
+        size_t data = (counter != 1 ? SHA512::HASH_SIZE : 0) + 9 /* "turtlpass" */ + 1;
+        total += 2 + blocks(data) + 1;
+        remaining -= std::min(remaining, (size_t)SHA512::HASH_SIZE);
+    }
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_midstate_hmac_matches_sha512_hmac(void) {
+    size_t keyLengths[] = {0, 1, 32, 64, 127, 128, 129, 200};
+    size_t dataLengths[] = {0, 1, 73, 110, 111, 112, 128, 300};
+
+    for (size_t keyLen : keyLengths) {
+        std::vector<uint8_t> key(keyLen + 1);
+        fillPattern(key.data(), keyLen, 0x11);
+        HmacSha512::Midstate midstate;
+        HmacSha512 hmac;
+        hmac.precompute(midstate, key.data(), keyLen);
+        TEST_ASSERT_TRUE(midstate.valid);
+
+        for (size_t dataLen : dataLengths) {
+            std::vector<uint8_t> data(dataLen + 1);
+            fillPattern(data.data(), dataLen, 0x5A);
+
+            uint8_t expected[SHA512::HASH_SIZE];
+            SHA512 sha;
+            sha.resetHMAC(key.data(), keyLen);
+            sha.update(data.data(), dataLen);
+            sha.finalizeHMAC(key.data(), keyLen, expected, sizeof(expected));
+
+            uint8_t actual[SHA512::HASH_SIZE];
+            hmac.begin(midstate);
+            hmac.update(data.data(), dataLen);
+            hmac.finish(midstate, actual, sizeof(actual));
+
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, sizeof(expected));
+        }
+    }
+}
+
+void test_midstate_clear_wipes_state(void) {
+    uint8_t key[16];
+    fillPattern(key, sizeof(key), 1);
+    HmacSha512::Midstate midstate;
+    HmacSha512 hmac;
+    hmac.precompute(midstate, key, sizeof(key));
+
+    midstate.clear();
+    TEST_ASSERT_FALSE(midstate.valid);
+    uint8_t zero[sizeof(midstate.inner)] = {0};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, midstate.inner, sizeof(zero));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zero, midstate.outer, sizeof(zero));
+}
+
+void test_cached_derivation_matches_uncached(void) {
+    Kdf kdf;
+    HmacSha512::Midstate slotCache;
+
+    for (int round = 0; round < 2; ++round) {  // first fills the cache, second resumes from it
+        for (size_t len = 1; len <= MAX_PASS_SIZE; ++len) {
+            uint8_t expected[MAX_PASS_SIZE + 1] = {0};
+            uint8_t actual[MAX_PASS_SIZE + 1] = {0};
+
+            // base62 rejects a few lengths by design; the cache must not change that either
+            bool okExpected = kdf.derivatePass(expected, len, "example.com", HEX_SEED);
+            bool okActual = kdf.derivatePass(actual, len, "example.com", HEX_SEED, &slotCache);
+            TEST_ASSERT_EQUAL(okExpected, okActual);
+            TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)actual);
+
+            TEST_ASSERT_TRUE(kdf.derivatePassWithSymbols(expected, len, "example.com", HEX_SEED));
+            TEST_ASSERT_TRUE(kdf.derivatePassWithSymbols(actual, len, "example.com", HEX_SEED, &slotCache));
+            TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)actual);
+        }
+        TEST_ASSERT_TRUE(slotCache.valid);
+    }
+}
+
+void test_valid_cache_skips_seed_parsing(void) {
+    Kdf kdf;
+    HmacSha512::Midstate slotCache;
+    uint8_t expected[17] = {0};
+    uint8_t actual[17] = {0};
+
+    TEST_ASSERT_TRUE(kdf.derivatePass(expected, 16, "test", HEX_SEED, &slotCache));
+    // The midstate already encodes the salt, so the seed string is not consulted
+    TEST_ASSERT_TRUE(kdf.derivatePass(actual, 16, "test", "", &slotCache));
+    TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)actual);
+
+    slotCache.clear();
+    TEST_ASSERT_TRUE(kdf.derivatePass(actual, 16, "test", "", &slotCache));
+    TEST_ASSERT_TRUE(strcmp((char *)expected, (char *)actual) != 0);
+}
+
+void test_benchmark_compressions_per_password(void) {
+    const size_t lengths[] = {16, 32, 64, 100, MAX_PASS_SIZE};
+    const char *input = "default";
+
+    printf("\n%-6s %-10s %-10s %-10s %-10s\n", "len", "legacy", "uncached", "cached", "saved");
+    for (size_t len : lengths) {
+        Kdf kdf;
+        HmacSha512::Midstate slotCache;
+        uint8_t out[MAX_PASS_SIZE + 1];
+
+        // first call fills the cache
+        kdf.derivatePass(out, len, input, HEX_SEED, &slotCache);
+
+        kdf.resetCompressionCount();
+        kdf.derivatePass(out, len, input, HEX_SEED);
+        uint32_t uncached = kdf.compressionCount();
+
+        kdf.resetCompressionCount();
+        kdf.derivatePass(out, len, input, HEX_SEED, &slotCache);
+        uint32_t cached = kdf.compressionCount();
+
+        char lengthStr[8];
+        snprintf(lengthStr, sizeof(lengthStr), "%zu", len);
+        uint32_t legacy = legacyCompressions(strlen(input) + strlen(lengthStr), Kdf::base62InputLength(len));
+
+        printf("%-6zu %-10u %-10u %-10u %-10u\n", len, legacy, uncached, cached, legacy - cached);
+
+        // salt midstate saves its ipad/opad blocks on every cached request
+        TEST_ASSERT_EQUAL_UINT32(uncached - 2, cached);
+        // the shared PRK midstate never costs more than the legacy schedule
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(legacy, uncached);
+        TEST_ASSERT_LESS_THAN_UINT32(legacy, cached);
+    }
+}
+
+void test_benchmark_wall_clock(void) {
+    const int iterations = 2000;
+    Kdf kdf;
+    HmacSha512::Midstate slotCache;
+    uint8_t out[BENCH_PASS_LENGTH + 1];
+    kdf.derivatePass(out, BENCH_PASS_LENGTH, "default", HEX_SEED, &slotCache);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) kdf.derivatePass(out, BENCH_PASS_LENGTH, "default", HEX_SEED);
+    auto uncached = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) kdf.derivatePass(out, BENCH_PASS_LENGTH, "default", HEX_SEED, &slotCache);
+    auto cached = std::chrono::steady_clock::now() - start;
+
+    double uncachedUs = std::chrono::duration<double, std::micro>(uncached).count() / iterations;
+    double cachedUs = std::chrono::duration<double, std::micro>(cached).count() / iterations;
+    printf("\n[%zu chars] uncached: %.2f us/password, cached: %.2f us/password\n",
+           BENCH_PASS_LENGTH, uncachedUs, cachedUs);
+    TEST_ASSERT_TRUE(cachedUs > 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_midstate_hmac_matches_sha512_hmac);
+    RUN_TEST(test_midstate_clear_wipes_state);
+    RUN_TEST(test_cached_derivation_matches_uncached);
+    RUN_TEST(test_valid_cache_skips_seed_parsing);
+    RUN_TEST(test_benchmark_compressions_per_password);
+    RUN_TEST(test_benchmark_wall_clock);
+
+    return UNITY_END();
+}
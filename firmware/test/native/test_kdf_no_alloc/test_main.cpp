@@ -0,0 +1,274 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <new>
+
+// -----------------------------------------------------------------------------
+// Heap instrumentation
+// -----------------------------------------------------------------------------
+// Every allocation made while `heapTracking` is set is counted. operator new is
+// replaced portably; malloc/calloc/realloc are interposed on glibc only.
+static volatile bool heapTracking = false;
+static volatile size_t heapCalls = 0;
+
+static inline void countHeapCall() {
+    if (heapTracking) heapCalls = heapCalls + 1;
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) { countHeapCall(); return __libc_malloc(size); }
+void *calloc(size_t count, size_t size) { countHeapCall(); return __libc_calloc(count, size); }
+void *realloc(void *ptr, size_t size) { countHeapCall(); return __libc_realloc(ptr, size); }
+void free(void *ptr) { if (ptr) countHeapCall(); __libc_free(ptr); }
+}
+#endif
+
+void *operator new(size_t size) {
+    countHeapCall();
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+struct HeapScope {
+    HeapScope() { heapCalls = 0; heapTracking = true; }
+    ~HeapScope() { heapTracking = false; }
+    size_t calls() const { return heapCalls; }
+};
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#define protected public
+#include "crypto/Kdf.h"
+#undef private
+#undef protected
+
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp" // explicit include
+
+// -----------------------------------------------------------------------------
+// Reference implementation
+// -----------------------------------------------------------------------------
+// The heap-based pipeline Kdf used before it became allocation-free: std::string
+// input concatenation, malloc'ed source/salt buffers, std::vector key and
+// std::string encoders. Kept here so the new path can be diffed against it.
+namespace legacy {
+
+static bool derivateKey(uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
+    size_t srcLength = strlen(input);
+    uint8_t *src = (uint8_t *)malloc(srcLength + 1);
+    memcpy(src, input, srcLength);
+    const size_t saltLength = strlen(seed) / 2;
+    uint8_t *salt = (uint8_t *)malloc(saltLength ? saltLength : 1);
+    for (size_t i = 0; i < saltLength; i++) {
+        char buf[3] = { seed[i * 2], seed[i * 2 + 1], '\0' };
+        unsigned long value = strtoul(buf, NULL, 16);
+        if (value > UINT8_MAX) { free(src); free(salt); return false; }
+        salt[i] = (uint8_t)value;
+    }
+    HKDF<SHA512> hkdf;
+    hkdf.setKey(src, srcLength, salt, saltLength);
+    hkdf.extract(dst, dstLength, "turtlpass", 9);
+    free(src);
+    free(salt);
+    return true;
+}
+
+template <typename KeyLengthFunc, typename EncodeFunc>
+static bool deriveAndEncode(uint8_t *dst, size_t dstLength, const char *input, const char *seed,
+                            KeyLengthFunc keyLengthFunc, EncodeFunc encodeFunc) {
+    std::string inputWithLength(input);
+    inputWithLength += std::to_string(dstLength);
+    std::vector<uint8_t> key(keyLengthFunc(dstLength));
+    if (key.empty()) return false;
+    if (!derivateKey(key.data(), key.size(), inputWithLength.c_str(), seed)) return false;
+    std::string encoded;
+    if (!encodeFunc(key, encoded)) return false;
+    size_t copyLength = std::min(encoded.size(), dstLength);
+    memcpy(dst, encoded.data(), copyLength);
+    dst[copyLength] = '\0';
+    return true;
+}
+
+static bool derive(int charset, uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
+    switch (charset) {
+        case 0:
+            return deriveAndEncode(dst, dstLength, input, seed, Kdf::base62InputLength,
+                [](const std::vector<uint8_t> &key, std::string &out) {
+                    size_t len = (key.size() * 2) + 1;
+                    char *buf = (char *)malloc(len);
+                    char *encoded = base62_encode(buf, len, key.data(), key.size());
+                    if (encoded) out.assign(encoded);
+                    free(buf);
+                    return encoded != nullptr;
+                });
+        case 1:
+            return deriveAndEncode(dst, dstLength, input, seed, Kdf::base94InputLength,
+                [](const std::vector<uint8_t> &key, std::string &out) {
+                    Base94 base94;
+                    return base94.encode(key, out);
+                });
+        case 2:
+            return deriveAndEncode(dst, dstLength, input, seed, Kdf::base52InputLength,
+                [](const std::vector<uint8_t> &key, std::string &out) {
+                    const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+                    for (uint8_t b : key) out += LETTERS[b % 52];
+                    return true;
+                });
+        default:
+            return deriveAndEncode(dst, dstLength, input, seed, Kdf::base10InputLength,
+                [](const std::vector<uint8_t> &key, std::string &out) {
+                    for (uint8_t b : key) out += (char)('0' + b % 10);
+                    return true;
+                });
+    }
+}
+
+} // namespace legacy
+
+static bool deriveNew(Kdf &kdf, int charset, uint8_t *dst, size_t dstLength, const char *input, const char *seed) {
+    switch (charset) {
+        case 0: return kdf.derivatePass(dst, dstLength, input, seed);
+        case 1: return kdf.derivatePassWithSymbols(dst, dstLength, input, seed);
+        case 2: return kdf.derivatePassLettersOnly(dst, dstLength, input, seed);
+        default: return kdf.derivatePassNumbersOnly(dst, dstLength, input, seed);
+    }
+}
+
+static const char *HEX_SEED = "1f517340d371cbf900369c48085c3a253821f77ce0adc494c2d8937068f91d7e";
+
+// A raw binary seed, as CommandProcessor passes decrypted seed bytes straight through
+static void rawSeed(char *out, size_t size, uint8_t start) {
+    for (size_t i = 0; i + 1 < size; ++i) {
+        uint8_t b = (uint8_t)(start + i * 37);
+        out[i] = b ? (char)b : (char)0x01;
+    }
+    out[size - 1] = '\0';
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_matches_legacy_for_every_charset_and_length(void) {
+    Kdf kdf;
+    char raw[SHA512::HASH_SIZE + 1];
+    rawSeed(raw, sizeof(raw), 0x30);
+    char longHex[2 * 200 + 1];  // 200-byte salt, longer than one SHA-512 block
+    for (size_t i = 0; i < sizeof(longHex) - 1; ++i) longHex[i] = "0123456789abcdef"[i % 16];
+    longHex[sizeof(longHex) - 1] = '\0';
+
+    const char *seeds[] = { HEX_SEED, raw, longHex, "" };
+    const char *inputs[] = { "test", "default", "" };
+
+    for (const char *seed : seeds) {
+        for (const char *input : inputs) {
+            for (int charset = 0; charset < 4; ++charset) {
+                for (size_t len = 1; len <= MAX_PASS_SIZE; ++len) {
+                    uint8_t expected[MAX_PASS_SIZE + 1] = {0};
+                    uint8_t actual[MAX_PASS_SIZE + 1] = {0};
+                    bool expectedOk = legacy::derive(charset, expected, len, input, seed);
+                    bool actualOk = deriveNew(kdf, charset, actual, len, input, seed);
+                    TEST_ASSERT_EQUAL(expectedOk, actualOk);
+                    TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)actual);
+                }
+            }
+        }
+    }
+}
+
+void test_derivateKey_matches_legacy(void) {
+    Kdf kdf;
+    char input[] = "key_slot_3";
+    for (size_t len = 1; len <= 200; len += 7) {
+        std::vector<uint8_t> expected(len), actual(len);
+        TEST_ASSERT_TRUE(legacy::derivateKey(expected.data(), len, input, HEX_SEED));
+        TEST_ASSERT_TRUE(kdf.derivateKey(actual.data(), len, input, HEX_SEED));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), actual.data(), len);
+    }
+}
+
+void test_zero_heap_calls_per_derivation(void) {
+    Kdf kdf;
+    char raw[SHA512::HASH_SIZE + 1];
+    rawSeed(raw, sizeof(raw), 0x41);
+
+    for (int charset = 0; charset < 4; ++charset) {
+        for (size_t len : {1u, 16u, 100u, (unsigned)MAX_PASS_SIZE}) {
+            uint8_t dst[MAX_PASS_SIZE + 1] = {0};
+            size_t calls;
+            bool ok;
+            {
+                HeapScope scope;
+                ok = deriveNew(kdf, charset, dst, len, "example.com", raw);
+                calls = scope.calls();
+            }
+            TEST_ASSERT_TRUE(ok);
+            TEST_ASSERT_EQUAL_size_t(0, calls);
+        }
+    }
+
+    uint8_t key[32];
+    char context[] = "iv_slot_1";
+    size_t calls;
+    {
+        HeapScope scope;
+        kdf.derivateKey(key, sizeof(key), context, "A0A1A2A3A4A5A6A7");
+        calls = scope.calls();
+    }
+    TEST_ASSERT_EQUAL_size_t(0, calls);
+}
+
+void test_heap_instrumentation_detects_allocations(void) {
+    // Sanity check that the hooks above are live
+    size_t calls;
+    {
+        HeapScope scope;
+        uint8_t dst[17];
+        legacy::derive(0, dst, 16, "test", HEX_SEED);
+        calls = scope.calls();
+    }
+    TEST_ASSERT_GREATER_THAN(0, calls);
+}
+
+void test_rejects_lengths_beyond_max_pass_size(void) {
+    Kdf kdf;
+    uint8_t dst[MAX_PASS_SIZE + 2] = {0};
+    TEST_ASSERT_FALSE(kdf.derivatePass(dst, MAX_PASS_SIZE + 1, "test", HEX_SEED));
+    TEST_ASSERT_FALSE(kdf.derivatePassWithSymbols(dst, MAX_PASS_SIZE + 1, "test", HEX_SEED));
+    TEST_ASSERT_FALSE(kdf.derivatePassLettersOnly(dst, MAX_PASS_SIZE + 1, "test", HEX_SEED));
+    TEST_ASSERT_FALSE(kdf.derivatePassNumbersOnly(dst, MAX_PASS_SIZE + 1, "test", HEX_SEED));
+    TEST_ASSERT_FALSE(kdf.derivatePassLettersOnly(dst, 0, "test", HEX_SEED));
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_matches_legacy_for_every_charset_and_length);
+    RUN_TEST(test_derivateKey_matches_legacy);
+    RUN_TEST(test_heap_instrumentation_detects_allocations);
+    RUN_TEST(test_zero_heap_calls_per_derivation);
+    RUN_TEST(test_rejects_lengths_beyond_max_pass_size);
+
+    return UNITY_END();
+}
@@ -15,6 +15,7 @@
 #undef private
 #undef protected
 
+#include "crypto/HmacSha512.cpp"
 #include "crypto/Kdf.cpp" // explicit include
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,277 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "core/PasswordBatch.h"
+#undef private
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+#include "core/PasswordBatch.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Build a seed string the way CommandProcessor::getSelectedSeed does.
+ */
+static void makeSeed(char *seed, uint8_t start) {
+    for (size_t i = 0; i < BATCH_SEED_SIZE; i++) seed[i] = (char)('0' + (start + i) % 10);
+    seed[BATCH_SEED_SIZE] = '\0';
+}
+
+/**
+ * @brief Entry i gets its own entropy, a length and a charset cycling through all four.
+ */
+static void makeEntries(turtlpass_GeneratePasswordParams *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        entries[i] = turtlpass_GeneratePasswordParams_init_zero;
+        int n = snprintf((char *)entries[i].entropy.bytes, sizeof(entries[i].entropy.bytes), "site-%u.example", (unsigned)i);
+        entries[i].entropy.size = (pb_size_t)n;
+        entries[i].length = 8 + (uint32_t)(i * 7) % (MAX_PASS_SIZE - 8);
+        entries[i].charset = (turtlpass_Charset)(i % 4);
+    }
+}
+
+/**
+ * @brief Reference result: one independent derivation without any shared state.
+ */
+static void expectedPassword(const char *seed, const turtlpass_GeneratePasswordParams &entry, uint8_t *out) {
+    Kdf kdf;
+    char input[MAX_ENTROPY_SIZE + 1] = {0};
+    memcpy(input, entry.entropy.bytes, entry.entropy.size);
+    memset(out, 0, MAX_PASS_SIZE + 1);
+    TEST_ASSERT_TRUE(derivePasswordForCharset(kdf, entry.charset, out, entry.length, input, seed));
+}
+
+static bool isWiped(const PasswordBatch &b) {
+    for (size_t i = 0; i < sizeof(b.seed_); i++) if (b.seed_[i]) return false;
+    const uint8_t *raw = (const uint8_t *)b.entries_;
+    for (size_t i = 0; i < sizeof(b.entries_); i++) if (raw[i]) return false;
+    return !b.active_ && !b.salt_.valid;
+}
+
+static void checkAllResults(PasswordBatch &b, const char *seed,
+                            const turtlpass_GeneratePasswordParams *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t expected[MAX_PASS_SIZE + 1];
+        expectedPassword(seed, entries[i], expected);
+        uint8_t out[MAX_PASS_SIZE + 1] = {0};
+        size_t length = 0;
+        TEST_ASSERT_EQUAL_UINT32(i, b.taken());
+        TEST_ASSERT_TRUE(b.take(out, sizeof(out), length));
+        TEST_ASSERT_EQUAL_UINT32(entries[i].length, length);
+        TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)out);
+    }
+    TEST_ASSERT_TRUE(b.isComplete());
+}
+
+void setUp(void) {
+    fakeMillisTime() = 5000;
+}
+
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_batch_matches_single_derivations(void) {
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 1);
+    turtlpass_GeneratePasswordParams entries[BATCH_MAX_ENTRIES];
+    makeEntries(entries, BATCH_MAX_ENTRIES);
+    HmacSha512::Midstate salt;
+
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, BATCH_MAX_ENTRIES, 42));
+    TEST_ASSERT_TRUE(b.isActive());
+    TEST_ASSERT_EQUAL_UINT32(42, b.requestId());
+    TEST_ASSERT_EQUAL_UINT32(BATCH_MAX_ENTRIES, b.total());
+
+    Kdf kdf;
+    size_t derived = 0;
+    while (b.work(kdf)) derived++;
+    TEST_ASSERT_EQUAL_UINT32(BATCH_MAX_ENTRIES, derived);
+
+    // seed wiped once the last entry was claimed; salt state learnt from the first entry
+    for (size_t i = 0; i < sizeof(b.seed_); i++) TEST_ASSERT_EQUAL_UINT8(0, b.seed_[i]);
+    HmacSha512::Midstate learnt;
+    TEST_ASSERT_TRUE(b.saltMidstate(learnt));
+
+    checkAllResults(b, seed, entries, BATCH_MAX_ENTRIES);
+    b.discard();
+    TEST_ASSERT_TRUE(isWiped(b));
+}
+
+void test_cached_salt_midstate_is_shared(void) {
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 5);
+    turtlpass_GeneratePasswordParams entries[4];
+    makeEntries(entries, 4);
+
+    // learn the salt midstate with a first batch
+    PasswordBatch first;
+    HmacSha512::Midstate salt;
+    TEST_ASSERT_TRUE(first.start(seed, salt, entries, 1, 1));
+    Kdf kdf;
+    first.work(kdf);
+    TEST_ASSERT_TRUE(first.saltMidstate(salt));
+
+    // a batch starting from the cached midstate gives the same passwords with fewer compressions
+    PasswordBatch b;
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, 4, 2));
+    Kdf counted;
+    counted.resetCompressionCount();
+    while (b.work(counted)) {}
+    uint32_t withCache = counted.compressionCount();
+
+    PasswordBatch cold;
+    HmacSha512::Midstate none;
+    TEST_ASSERT_TRUE(cold.start(seed, none, entries, 4, 3));
+    Kdf coldKdf;
+    coldKdf.resetCompressionCount();
+    while (cold.work(coldKdf)) {}
+    TEST_ASSERT_TRUE(withCache < coldKdf.compressionCount());
+
+    checkAllResults(b, seed, entries, 4);
+    salt.clear();
+}
+
+void test_results_are_taken_in_order(void) {
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 2);
+    turtlpass_GeneratePasswordParams entries[3];
+    makeEntries(entries, 3);
+    HmacSha512::Midstate salt;
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, 3, 7));
+
+    // entry 0 is claimed by "another core" that has not finished yet
+    b.entries_[0].state = PasswordBatch::RUNNING;
+    b.next_ = 1;
+    Kdf kdf;
+    TEST_ASSERT_TRUE(b.work(kdf));  // entry 1
+
+    size_t length = 0;
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(b.nextReady(length));
+    TEST_ASSERT_FALSE(b.take(out, sizeof(out), length));
+    TEST_ASSERT_EQUAL_UINT32(0, b.taken());
+}
+
+void test_rejects_invalid_arguments(void) {
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 3);
+    turtlpass_GeneratePasswordParams entries[2];
+    makeEntries(entries, 2);
+    HmacSha512::Midstate salt;
+
+    TEST_ASSERT_FALSE(b.start(nullptr, salt, entries, 2, 1));
+    TEST_ASSERT_FALSE(b.start(seed, salt, entries, 0, 1));
+    TEST_ASSERT_FALSE(b.start(seed, salt, entries, BATCH_MAX_ENTRIES + 1, 1));
+
+    entries[1].length = MAX_PASS_SIZE + 1;
+    TEST_ASSERT_FALSE(b.start(seed, salt, entries, 2, 1));
+    entries[1].length = 10;
+    entries[1].entropy.size = 0;
+    TEST_ASSERT_FALSE(b.start(seed, salt, entries, 2, 1));
+    TEST_ASSERT_FALSE(b.isActive());
+
+    // one batch at a time
+    makeEntries(entries, 2);
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, 2, 1));
+    TEST_ASSERT_FALSE(b.start(seed, salt, entries, 2, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, b.requestId());
+}
+
+void test_confirmation_timeout(void) {
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 4);
+    turtlpass_GeneratePasswordParams entries[1];
+    makeEntries(entries, 1);
+    HmacSha512::Midstate salt;
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, 1, 1));
+
+    advanceMillis(CONFIRM_TIMEOUT_MS - 1);
+    TEST_ASSERT_FALSE(b.confirmationExpired());
+    advanceMillis(1);
+    TEST_ASSERT_TRUE(b.confirmationExpired());
+
+    // a confirmed batch never expires
+    b.confirm();
+    TEST_ASSERT_TRUE(b.isConfirmed());
+    TEST_ASSERT_FALSE(b.confirmationExpired());
+}
+
+void test_discarded_entry_is_dropped(void) {
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 6);
+    turtlpass_GeneratePasswordParams entries[2];
+    makeEntries(entries, 2);
+    HmacSha512::Midstate salt;
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, 2, 1));
+
+    uint32_t generation = b.generation_;
+    b.discard();
+    TEST_ASSERT_NOT_EQUAL(generation, b.generation_);
+    Kdf kdf;
+    TEST_ASSERT_FALSE(b.work(kdf));  // nothing to claim
+    TEST_ASSERT_TRUE(isWiped(b));
+}
+
+void test_two_cores_share_the_batch(void) {
+    // std::thread stands in for core1
+    PasswordBatch b;
+    char seed[BATCH_SEED_SIZE + 1];
+    makeSeed(seed, 8);
+    turtlpass_GeneratePasswordParams entries[BATCH_MAX_ENTRIES];
+    makeEntries(entries, BATCH_MAX_ENTRIES);
+    HmacSha512::Midstate salt;
+    TEST_ASSERT_TRUE(b.start(seed, salt, entries, BATCH_MAX_ENTRIES, 9));
+
+    size_t core1Count = 0;
+    std::thread core1([&]() {
+        while (b.work(b.kdf_)) {
+            core1Count++;
+            std::this_thread::yield();
+        }
+    });
+    Kdf kdf;
+    size_t core0Count = 0;
+    while (b.work(kdf)) {
+        core0Count++;
+        std::this_thread::yield();
+    }
+    core1.join();
+
+    TEST_ASSERT_EQUAL_UINT32(BATCH_MAX_ENTRIES, core0Count + core1Count);
+    checkAllResults(b, seed, entries, BATCH_MAX_ENTRIES);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_batch_matches_single_derivations);
+    RUN_TEST(test_cached_salt_midstate_is_shared);
+    RUN_TEST(test_results_are_taken_in_order);
+    RUN_TEST(test_rejects_invalid_arguments);
+    RUN_TEST(test_confirmation_timeout);
+    RUN_TEST(test_discarded_entry_is_dropped);
+    RUN_TEST(test_two_cores_share_the_batch);
+
+    return UNITY_END();
+}
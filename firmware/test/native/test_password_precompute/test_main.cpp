@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "core/PasswordPrecompute.h"
+#undef private
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+#include "core/PasswordPrecompute.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t PASS_SIZE = 100;
+
+/**
+ * @brief Build a seed string the way CommandProcessor::getSelectedSeed does.
+ */
+static void makeSeed(char *seed, uint8_t start) {
+    for (size_t i = 0; i < PRECOMPUTE_SEED_SIZE; i++) seed[i] = (char)('0' + (start + i) % 10);
+    seed[PRECOMPUTE_SEED_SIZE] = '\0';
+}
+
+/**
+ * @brief Synchronous reference derivation (the path used without precompute).
+ */
+static void expectedPassword(const char *seed, uint8_t *out) {
+    Kdf kdf;
+    memset(out, 0, MAX_PASS_SIZE + 1);
+    TEST_ASSERT_TRUE(kdf.derivatePass(out, PASS_SIZE, "default", seed));
+}
+
+static bool isWiped(const PasswordPrecompute &p) {
+    for (size_t i = 0; i < sizeof(p.password_); i++) if (p.password_[i]) return false;
+    for (size_t i = 0; i < sizeof(p.seed_); i++) if (p.seed_[i]) return false;
+    return p.state_ == PasswordPrecompute::EMPTY;
+}
+
+void setUp(void) {
+    fakeMillisTime() = 5000;
+}
+
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_precomputed_matches_synchronous(void) {
+    PasswordPrecompute p;
+    char seed[PRECOMPUTE_SEED_SIZE + 1];
+    makeSeed(seed, 1);
+    uint8_t expected[MAX_PASS_SIZE + 1];
+    expectedPassword(seed, expected);
+
+    TEST_ASSERT_TRUE(p.request(2, seed, PASS_SIZE));
+    TEST_ASSERT_TRUE(p.covers(2));
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(p.take(2, out, sizeof(out)));  // not derived yet
+
+    p.loop();
+    TEST_ASSERT_TRUE(p.take(2, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)out);
+
+    // taken once, then wiped
+    TEST_ASSERT_TRUE(isWiped(p));
+    TEST_ASSERT_FALSE(p.take(2, out, sizeof(out)));
+}
+
+void test_slot_mismatch_is_not_served(void) {
+    PasswordPrecompute p;
+    char seed[PRECOMPUTE_SEED_SIZE + 1];
+    makeSeed(seed, 3);
+    p.request(1, seed, PASS_SIZE);
+    p.loop();
+
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(p.take(2, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8(0, out[0]);
+
+    // slot changed: expire() wipes it
+    p.expire(2);
+    TEST_ASSERT_TRUE(isWiped(p));
+}
+
+void test_timeout_discards(void) {
+    PasswordPrecompute p;
+    char seed[PRECOMPUTE_SEED_SIZE + 1];
+    makeSeed(seed, 4);
+    p.request(1, seed, PASS_SIZE);
+    p.loop();
+
+    advanceMillis(PRECOMPUTE_TIMEOUT_MS - 1);
+    p.expire(1);
+    TEST_ASSERT_TRUE(p.covers(1));
+
+    advanceMillis(1);
+    p.expire(1);
+    TEST_ASSERT_TRUE(isWiped(p));
+
+    // take() honours the timeout on its own too
+    p.request(1, seed, PASS_SIZE);
+    p.loop();
+    advanceMillis(PRECOMPUTE_TIMEOUT_MS);
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(p.take(1, out, sizeof(out)));
+    TEST_ASSERT_TRUE(isWiped(p));
+}
+
+void test_superseded_job_is_dropped(void) {
+    PasswordPrecompute p;
+    char seedA[PRECOMPUTE_SEED_SIZE + 1], seedB[PRECOMPUTE_SEED_SIZE + 1];
+    makeSeed(seedA, 1);
+    makeSeed(seedB, 7);
+
+    // core1 picked up job A, then core0 discarded it before it finished
+    p.request(1, seedA, PASS_SIZE);
+    uint32_t generation = p.generation_;
+    p.discard();
+    TEST_ASSERT_NOT_EQUAL(generation, p.generation_);
+    p.loop();  // nothing pending
+    TEST_ASSERT_TRUE(isWiped(p));
+
+    // a newer request replaces the pending one
+    p.request(1, seedA, PASS_SIZE);
+    p.request(2, seedB, PASS_SIZE);
+    p.loop();
+    uint8_t expected[MAX_PASS_SIZE + 1];
+    expectedPassword(seedB, expected);
+    uint8_t out[MAX_PASS_SIZE + 1] = {0};
+    TEST_ASSERT_FALSE(p.take(1, out, sizeof(out)));
+    TEST_ASSERT_TRUE(p.take(2, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING((char *)expected, (char *)out);
+}
+
+void test_rejects_invalid_arguments(void) {
+    PasswordPrecompute p;
+    char seed[PRECOMPUTE_SEED_SIZE + 1];
+    makeSeed(seed, 1);
+    TEST_ASSERT_FALSE(p.request(0, seed, PASS_SIZE));
+    TEST_ASSERT_FALSE(p.request(1, nullptr, PASS_SIZE));
+    TEST_ASSERT_FALSE(p.request(1, seed, 0));
+    TEST_ASSERT_FALSE(p.request(1, seed, MAX_PASS_SIZE + 1));
+
+    p.request(1, seed, PASS_SIZE);
+    p.loop();
+    uint8_t small[PASS_SIZE];  // no room for the terminator
+    TEST_ASSERT_FALSE(p.take(1, small, sizeof(small)));
+    TEST_ASSERT_TRUE(p.covers(1));
+}
+
+void test_concurrent_requests_never_serve_wrong_slot(void) {
+    PasswordPrecompute p;
+    char seeds[3][PRECOMPUTE_SEED_SIZE + 1];
+    uint8_t expected[3][MAX_PASS_SIZE + 1];
+    for (int i = 0; i < 3; i++) {
+        makeSeed(seeds[i], (uint8_t)(i * 3 + 1));
+        expectedPassword(seeds[i], expected[i]);
+    }
+
+    std::atomic<bool> running(true);
+    std::thread core1([&]() {
+        while (running) p.loop();
+    });
+
+    int served = 0;
+    for (int round = 0; round < 300; round++) {
+        uint8_t slot = (uint8_t)(round % 3 + 1);
+        p.request(slot, seeds[slot - 1], PASS_SIZE);
+        uint8_t out[MAX_PASS_SIZE + 1] = {0};
+        for (int spin = 0; spin < 200000 && !p.take(slot, out, sizeof(out)); spin++) {
+            std::this_thread::yield();
+        }
+        if (out[0]) {
+            TEST_ASSERT_EQUAL_STRING((char *)expected[slot - 1], (char *)out);
+            served++;
+        }
+    }
+    running = false;
+    core1.join();
+    TEST_ASSERT_TRUE(served > 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_precomputed_matches_synchronous);
+    RUN_TEST(test_slot_mismatch_is_not_served);
+    RUN_TEST(test_timeout_discards);
+    RUN_TEST(test_superseded_job_is_dropped);
+    RUN_TEST(test_rejects_invalid_arguments);
+    RUN_TEST(test_concurrent_requests_never_serve_wrong_slot);
+
+    return UNITY_END();
+}
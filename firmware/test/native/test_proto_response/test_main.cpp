@@ -0,0 +1,264 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Include module under test (Serial is the host stand-in from test/native/common)
+// -----------------------------------------------------------------------------
+#define PIO_BOARD_NAME "native"
+#include "proto/ProtoHelper.h"
+#include "proto/ProtoHelper.cpp"
+#include "proto/FrameCodec.cpp"
+#include "system/SystemInfo.cpp"
+#include "proto/turtlpass.pb.c"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+typedef std::vector<uint8_t> Bytes;
+
+// Response.data for the reference encoding, independent of setResponseData()
+static bool referenceData(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+    const Bytes *data = static_cast<const Bytes *>(*arg);
+    if (data->empty()) return true;
+    return pb_encode_tag_for_field(stream, field) && pb_encode_string(stream, data->data(), data->size());
+}
+
+// What pb_encode() makes of a response, with data (if any) as its data field (empty if it fails)
+static Bytes referenceMessage(turtlpass_Response response, const Bytes &data) {
+    response.data.funcs.encode = referenceData;
+    response.data.arg = const_cast<Bytes *>(&data);
+    Bytes out(2048);
+    pb_ostream_t stream = pb_ostream_from_buffer(out.data(), out.size());
+    out.resize(pb_encode(&stream, turtlpass_Response_fields, &response) ? stream.bytes_written : 0);
+    return out;
+}
+
+// The message as it goes on the wire in a framing
+static Bytes frame(const Bytes &message, turtlpass_Framing framing) {
+    Bytes out;
+    if (framing == turtlpass_Framing_COBS_CRC16) {
+        writeCobsFrame(message.data(), message.size(),
+                       [&](const uint8_t *data, size_t len) { out.insert(out.end(), data, data + len); });
+    } else {
+        out.push_back((uint8_t)(message.size() & 0xFF));
+        out.push_back((uint8_t)(message.size() >> 8));
+        out.insert(out.end(), message.begin(), message.end());
+    }
+    return out;
+}
+
+// Zeros (COBS), runs longer than a COBS block and than the serial stage
+static Bytes pattern(size_t len) {
+    Bytes data(len);
+    for (size_t i = 0; i < len; i++) data[i] = i % 7 == 0 ? 0 : (uint8_t)(i * 13 + 1);
+    return data;
+}
+
+static const turtlpass_Framing FRAMINGS[] = { turtlpass_Framing_LENGTH_PREFIXED, turtlpass_Framing_COBS_CRC16 };
+
+static void assertSent(const Bytes &expected) {
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), Serial.output.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), Serial.output.data(), expected.size());
+    TEST_ASSERT_EQUAL_UINT32(1, Serial.flushes);  // one transfer per reply
+}
+
+void setUp(void) {
+    Serial.clear();
+}
+
+void tearDown(void) {
+    setProtoFraming(turtlpass_Framing_LENGTH_PREFIXED);
+}
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// Fixed-size fields only: streamed bytes match pb_encode() in both framings
+void test_streamed_response_without_data(void) {
+    turtlpass_Response response = turtlpass_Response_init_zero;
+    response.success = true;
+    response.request_id = 70000;  // 3-byte varint
+    response.has_session_state = true;
+    response.session_state.enabled = true;
+    response.session_state.slot = 3;
+    response.session_state.timeout_ms = 300000;
+    response.session_state.remaining_ms = 1234;
+
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+        Serial.clear();
+        sendProtoResponse(response);
+        assertSent(frame(referenceMessage(response, Bytes()), framing));
+    }
+}
+
+// Response.data streamed from the caller's buffer: small, staged writes and large ones
+// that bypass the stage give the same bytes as pb_encode()
+void test_streamed_response_with_data(void) {
+    const size_t lengths[] = { 1, 20, 31, 32, 33, 253, 254, 255, RESPONSE_DATA_MAX_SIZE };
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+        for (size_t length : lengths) {
+            Bytes data = pattern(length);
+            turtlpass_Response response = turtlpass_Response_init_zero;
+            response.success = true;
+            response.request_id = 9;
+            response.has_batch = true;
+            response.batch.first_index = 2;
+            response.batch.count = 1;
+            response.batch.total = 4;
+            const ProtoBytes bytes = { data.data(), data.size() };
+            setResponseData(response, bytes);
+
+            Serial.clear();
+            sendProtoResponse(response);
+            assertSent(frame(referenceMessage(response, data), framing));
+        }
+    }
+}
+
+// The helpers building data replies stream the same bytes too
+void test_data_helpers_match_pb_encode(void) {
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+
+        Bytes password = pattern(40);
+        turtlpass_Response success = turtlpass_Response_init_zero;
+        success.success = true;
+        success.request_id = 1;
+        Serial.clear();
+        sendSuccessBytesResponse(password.data(), (uint16_t)password.size(), 1);
+        assertSent(frame(referenceMessage(success, password), framing));
+
+        const char *message = "Seed slot already populated";
+        Bytes text(message, message + strlen(message));
+        turtlpass_Response error = turtlpass_Response_init_zero;
+        error.error = turtlpass_ErrorCode_INTERNAL_ERROR;
+        error.request_id = 0;
+        Serial.clear();
+        sendErrorMessageResponse(turtlpass_ErrorCode_INTERNAL_ERROR, message, 0);
+        assertSent(frame(referenceMessage(error, text), framing));
+
+        // an empty data field is left out, as pb_encode() does
+        Serial.clear();
+        sendSuccessBytesResponse(password.data(), 0, 1);
+        assertSent(frame(referenceMessage(success, Bytes()), framing));
+    }
+}
+
+// What the host decodes from a streamed COBS frame is the response that was sent
+void test_cobs_frame_decodes_to_the_response(void) {
+    setProtoFraming(turtlpass_Framing_COBS_CRC16);
+    Bytes data = pattern(300);
+    sendSuccessBytesResponse(data.data(), (uint16_t)data.size(), 77);
+
+    uint8_t buffer[1024];
+    CobsFrameDecoder decoder(buffer, sizeof(buffer));
+    size_t used = 0;
+    TEST_ASSERT_EQUAL(CobsFrameDecoder::FRAME_OK, decoder.feed(Serial.output.data(), Serial.output.size(), used));
+    TEST_ASSERT_EQUAL_UINT32(Serial.output.size(), used);
+
+    Bytes decodedData(RESPONSE_DATA_MAX_SIZE);
+    turtlpass_Response decoded = turtlpass_Response_init_zero;
+    decoded.data.funcs.decode = [](pb_istream_t *stream, const pb_field_t *, void **arg) {
+        Bytes *out = static_cast<Bytes *>(*arg);
+        out->resize(stream->bytes_left);
+        return pb_read(stream, out->data(), out->size());
+    };
+    decoded.data.arg = &decodedData;
+    pb_istream_t stream = pb_istream_from_buffer(decoder.message(), decoder.messageLength());
+    TEST_ASSERT_TRUE(pb_decode(&stream, turtlpass_Response_fields, &decoded));
+    TEST_ASSERT_TRUE(decoded.success);
+    TEST_ASSERT_EQUAL_UINT32(77, decoded.request_id);
+    TEST_ASSERT_EQUAL_UINT32(data.size(), decodedData.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data.data(), decodedData.data(), data.size());
+}
+
+// request_id 0 (left out), one byte, and multi-byte varints
+static const uint32_t REQUEST_IDS[] = { 0, 5, 300, 0xFFFFFFFFu };
+
+// Pre-encoded success reply plus its appended request_id equals pb_encode()
+void test_constant_success_matches_pb_encode(void) {
+    initConstantResponses();
+    TEST_ASSERT_NOT_NULL(successReply.bytes);
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+        for (uint32_t requestId : REQUEST_IDS) {
+            turtlpass_Response response = turtlpass_Response_init_zero;
+            response.success = true;
+            response.request_id = requestId;
+            Serial.clear();
+            sendSuccessResponse(requestId);
+            assertSent(frame(referenceMessage(response, Bytes()), framing));
+        }
+    }
+}
+
+// Every error code has its own pre-encoded reply, equal to pb_encode()
+void test_constant_errors_match_pb_encode(void) {
+    initConstantResponses();
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+        for (int error = _turtlpass_ErrorCode_MIN; error <= _turtlpass_ErrorCode_MAX; error++) {
+            TEST_ASSERT_NOT_NULL(errorReplies[error].bytes);
+            for (uint32_t requestId : REQUEST_IDS) {
+                turtlpass_Response response = turtlpass_Response_init_zero;
+                response.error = (turtlpass_ErrorCode)error;
+                response.request_id = requestId;
+                Serial.clear();
+                sendErrorResponse((turtlpass_ErrorCode)error, requestId);
+                assertSent(frame(referenceMessage(response, Bytes()), framing));
+            }
+        }
+    }
+}
+
+// The device info reply, hash included, is pre-encoded as pb_encode() would send it
+void test_constant_device_info_matches_pb_encode(void) {
+    initConstantResponses();
+    TEST_ASSERT_NOT_NULL(deviceInfoReply.bytes);
+    for (turtlpass_Framing framing : FRAMINGS) {
+        setProtoFraming(framing);
+        for (uint32_t requestId : REQUEST_IDS) {
+            turtlpass_Response response = turtlpass_Response_init_zero;
+            deviceInfo(response);
+            response.request_id = requestId;
+            Serial.clear();
+            sendDeviceInfoResponse(requestId);
+            assertSent(frame(referenceMessage(response, Bytes()), framing));
+        }
+    }
+}
+
+// All constant replies fit the buffer reserved for them
+void test_constant_responses_fit(void) {
+    initConstantResponses();
+    TEST_ASSERT_TRUE(constantBytesUsed <= sizeof(constantBytes));
+    size_t total = successReply.length + deviceInfoReply.length;
+    for (int error = _turtlpass_ErrorCode_MIN; error <= _turtlpass_ErrorCode_MAX; error++) {
+        total += errorReplies[error].length;
+    }
+    TEST_ASSERT_EQUAL_UINT32(total, constantBytesUsed);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_streamed_response_without_data);
+    RUN_TEST(test_streamed_response_with_data);
+    RUN_TEST(test_data_helpers_match_pb_encode);
+    RUN_TEST(test_cobs_frame_decodes_to_the_response);
+    RUN_TEST(test_constant_success_matches_pb_encode);
+    RUN_TEST(test_constant_errors_match_pb_encode);
+    RUN_TEST(test_constant_device_info_matches_pb_encode);
+    RUN_TEST(test_constant_responses_fit);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "storage/StorageManager.h"
+#include "storage/SeedManager.h"
+#undef private
+#include "crypto/HmacSha512.cpp"
+#include "crypto/Kdf.cpp"
+#include "crypto/EncryptionManager.cpp"
+#include "storage/SeedSession.cpp"
+#include "storage/StorageManager.cpp"
+#include "storage/SeedManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static void fillSeed(uint8_t* seed, uint8_t start) {
+    for (size_t i = 0; i < SeedManager::SEED_SIZE; i++) seed[i] = (uint8_t)(start + i);
+}
+
+// Whether the next boot finds a seed in a slot (and which one)
+static bool reopenedSeed(RamStorageBackend& flash, uint8_t slot, uint8_t* seedOut) {
+    SeedManager reopened(flash);
+    reopened.begin();
+    return reopened.getSeed(slot, seedOut, SeedManager::SEED_SIZE);
+}
+
+void setUp(void) {
+    fakeMillisTime() = 1000;
+}
+
+void tearDown(void) {}
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// A new seed waits for the idle flush like any other write, and is unusable until then
+void test_seed_is_committed_by_the_idle_flush(void) {
+    RamStorageBackend flash(4);
+    SeedManager seeds(flash);
+    seeds.begin();
+    uint8_t input[SeedManager::SEED_SIZE], stored[SeedManager::SEED_SIZE], out[SeedManager::SEED_SIZE];
+    fillSeed(input, 1);
+
+    const uint32_t programs = flash.programCount();
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(1, input, sizeof(input)));
+    TEST_ASSERT_EQUAL_UINT32(programs, flash.programCount());
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.commitResult(1));
+    TEST_ASSERT_FALSE(seeds.getSeed(1, out, sizeof(out)));  // may still be dropped
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::ALREADY_POPULATED, seeds.initializeSeed(1, input, sizeof(input)));
+
+    // busy (e.g. an LED animation): nothing is programmed before the deadline
+    TEST_ASSERT_FALSE(seeds.serviceStorage(false));
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.commitResult(1));
+
+    TEST_ASSERT_TRUE(seeds.serviceStorage(true));
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::OK, seeds.commitResult(1));
+    TEST_ASSERT_TRUE(seeds.getSeed(1, stored, sizeof(stored)));
+    TEST_ASSERT_TRUE(reopenedSeed(flash, 1, out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(stored, out, sizeof(out));
+}
+
+// A seed that could not be committed leaves no trace: the reply matches the store
+void test_failed_commit_unstages_the_seed(void) {
+    RamStorageBackend flash(4);
+    SeedManager seeds(flash);
+    seeds.begin();
+    uint8_t input[SeedManager::SEED_SIZE], stored[SeedManager::SEED_SIZE], out[SeedManager::SEED_SIZE];
+    fillSeed(input, 1);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(1, input, sizeof(input)));
+    TEST_ASSERT_TRUE(seeds.flushStorage());
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::OK, seeds.commitResult(1));
+
+    HmacSha512::Midstate midstate;
+    uint32_t epochBefore = 0, epochAfter = 0;
+    TEST_ASSERT_TRUE(seeds.loadSaltMidstate(2, midstate, epochBefore));
+
+    fillSeed(input, 2);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(2, input, sizeof(input)));
+    flash.setProgramBudget(0);  // power failing: programs do nothing
+    TEST_ASSERT_FALSE(seeds.serviceStorage(true));
+    flash.setProgramBudget(-1);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::VERIFY_FAIL, seeds.commitResult(2));
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::OK, seeds.commitResult(2));  // reported once
+
+    TEST_ASSERT_FALSE(seeds.storageManager.keyExists(2));
+    TEST_ASSERT_FALSE(seeds.storageManager.hasPendingWrites());
+    TEST_ASSERT_FALSE(seeds.getSeed(2, out, sizeof(out)));
+    TEST_ASSERT_TRUE(seeds.loadSaltMidstate(2, midstate, epochAfter));
+    TEST_ASSERT_EQUAL_UINT32(epochBefore, epochAfter);  // nothing to invalidate
+
+    // a later flush must not store the seed the host was told failed
+    fakeMillisTime() += STORAGE_FLUSH_DEADLINE_MS;
+    seeds.serviceStorage(true);
+    TEST_ASSERT_FALSE(reopenedSeed(flash, 2, out));
+    TEST_ASSERT_TRUE(reopenedSeed(flash, 1, out));
+
+    // the host retries
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(2, input, sizeof(input)));
+    TEST_ASSERT_TRUE(seeds.serviceStorage(true));
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::OK, seeds.commitResult(2));
+    TEST_ASSERT_TRUE(seeds.getSeed(2, stored, sizeof(stored)));
+    TEST_ASSERT_TRUE(reopenedSeed(flash, 2, out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(stored, out, sizeof(out));
+}
+
+// Other staged writes survive the failure and reach flash with the next flush
+void test_failed_commit_keeps_other_staged_writes(void) {
+    RamStorageBackend flash(4);
+    SeedManager seeds(flash);
+    seeds.begin();
+    uint8_t input[SeedManager::SEED_SIZE], out[SeedManager::SEED_SIZE];
+    fillSeed(input, 1);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(1, input, sizeof(input)));
+    TEST_ASSERT_TRUE(seeds.flushStorage());
+
+    const uint32_t settingKey = SeedManager::NUM_SLOTS + 1;
+    const uint8_t setting[4] = { 1, 2, 3, 4 };
+    uint8_t settingOut[4] = {0};
+    TEST_ASSERT_TRUE(seeds.writeSetting(settingKey, setting, sizeof(setting)));
+
+    fillSeed(input, 3);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(3, input, sizeof(input)));
+    flash.setProgramBudget(0);
+    TEST_ASSERT_FALSE(seeds.flushStorage());
+    flash.setProgramBudget(-1);
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::VERIFY_FAIL, seeds.commitResult(3));
+
+    TEST_ASSERT_TRUE(seeds.storageManager.hasPendingWrites());
+    TEST_ASSERT_TRUE(seeds.readSetting(settingKey, settingOut, sizeof(settingOut)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(setting, settingOut, sizeof(setting));
+    TEST_ASSERT_TRUE(seeds.flushStorage());
+
+    SeedManager reopened(flash);
+    reopened.begin();
+    memset(settingOut, 0, sizeof(settingOut));
+    TEST_ASSERT_TRUE(reopened.readSetting(settingKey, settingOut, sizeof(settingOut)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(setting, settingOut, sizeof(setting));
+    TEST_ASSERT_FALSE(reopened.getSeed(3, out, sizeof(out)));
+    TEST_ASSERT_TRUE(reopened.getSeed(1, out, sizeof(out)));
+}
+
+// Seeds staged in a transaction are committed together, with the transaction
+void test_seeds_in_a_transaction_commit_together(void) {
+    RamStorageBackend flash(4);
+    SeedManager seeds(flash);
+    seeds.begin();
+    uint8_t input[SeedManager::SEED_SIZE], out[SeedManager::SEED_SIZE];
+
+    TEST_ASSERT_TRUE(seeds.beginTransaction());
+    for (uint8_t slot = 1; slot <= 3; slot++) {
+        fillSeed(input, slot);
+        TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.initializeSeed(slot, input, sizeof(input)));
+    }
+    seeds.serviceStorage(true);  // an open transaction stays staged
+    TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::STAGED, seeds.commitResult(1));
+    TEST_ASSERT_FALSE(reopenedSeed(flash, 1, out));
+
+    TEST_ASSERT_TRUE(seeds.commitTransaction());
+    TEST_ASSERT_TRUE(seeds.serviceStorage(true));
+    for (uint8_t slot = 1; slot <= 3; slot++) {
+        TEST_ASSERT_EQUAL(SeedManager::SeedInitResult::OK, seeds.commitResult(slot));
+        TEST_ASSERT_TRUE(reopenedSeed(flash, slot, out));
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Test runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_seed_is_committed_by_the_idle_flush);
+    RUN_TEST(test_failed_commit_unstages_the_seed);
+    RUN_TEST(test_failed_commit_keeps_other_staged_writes);
+    RUN_TEST(test_seeds_in_a_transaction_commit_together);
+    return UNITY_END();
+}
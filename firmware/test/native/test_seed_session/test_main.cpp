@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "storage/SeedSession.h"
+#undef private
+#include "storage/SeedSession.cpp"
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static void fillSeed(uint8_t* seed, uint8_t start) {
+    for (size_t i = 0; i < SeedSession::SEED_SIZE; i++) seed[i] = (uint8_t)(start + i);
+}
+
+static bool isWiped(const SeedSession& session) {
+    for (size_t i = 0; i < sizeof(session.seed_); i++) {
+        if (session.seed_[i] != 0) return false;
+    }
+    return session.slot_ == 0;
+}
+
+void setUp(void) {
+    fakeMillisTime() = 1000;
+}
+
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_disabled_by_default(void) {
+    SeedSession session;
+    uint8_t seed[SeedSession::SEED_SIZE];
+    fillSeed(seed, 1);
+
+    TEST_ASSERT_FALSE(session.isEnabled());
+    TEST_ASSERT_FALSE(session.unlock(1, seed, sizeof(seed)));
+    TEST_ASSERT_FALSE(session.isUnlocked());
+    TEST_ASSERT_TRUE(isWiped(session));
+}
+
+void test_hit_returns_seed_and_restarts_timer(void) {
+    SeedSession session;
+    TEST_ASSERT_TRUE(session.setTimeout(1000));
+
+    uint8_t seed[SeedSession::SEED_SIZE];
+    uint8_t out[SeedSession::SEED_SIZE] = {0};
+    fillSeed(seed, 7);
+    TEST_ASSERT_TRUE(session.unlock(3, seed, sizeof(seed)));
+    TEST_ASSERT_EQUAL_UINT8(3, session.slot());
+
+    advanceMillis(900);
+    TEST_ASSERT_TRUE(session.read(3, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(seed, out, sizeof(seed));
+    TEST_ASSERT_EQUAL_UINT32(1000, session.remainingMs());
+
+    advanceMillis(900);  // 1800 ms after unlock, 900 ms after last hit
+    TEST_ASSERT_TRUE(session.read(3, out, sizeof(out)));
+}
+
+void test_idle_timeout_wipes(void) {
+    SeedSession session;
+    session.setTimeout(500);
+    uint8_t seed[SeedSession::SEED_SIZE];
+    uint8_t out[SeedSession::SEED_SIZE] = {0};
+    fillSeed(seed, 9);
+    session.unlock(2, seed, sizeof(seed));
+
+    advanceMillis(499);
+    session.loop(2);
+    TEST_ASSERT_TRUE(session.isUnlocked());
+
+    advanceMillis(1);
+    TEST_ASSERT_FALSE(session.isUnlocked());
+    session.loop(2);
+    TEST_ASSERT_TRUE(isWiped(session));
+    TEST_ASSERT_FALSE(session.read(2, out, sizeof(out)));
+}
+
+void test_slot_change_wipes(void) {
+    SeedSession session;
+    session.setTimeout(10000);
+    uint8_t seed[SeedSession::SEED_SIZE];
+    uint8_t out[SeedSession::SEED_SIZE] = {0};
+    fillSeed(seed, 5);
+
+    // selected slot changed while idle
+    session.unlock(1, seed, sizeof(seed));
+    session.loop(2);
+    TEST_ASSERT_TRUE(isWiped(session));
+
+    // request for another slot
+    session.unlock(1, seed, sizeof(seed));
+    TEST_ASSERT_FALSE(session.read(4, out, sizeof(out)));
+    TEST_ASSERT_TRUE(isWiped(session));
+}
+
+void test_lock_and_set_timeout_wipe(void) {
+    SeedSession session;
+    session.setTimeout(10000);
+    uint8_t seed[SeedSession::SEED_SIZE];
+    fillSeed(seed, 3);
+
+    session.unlock(1, seed, sizeof(seed));
+    session.lock();
+    TEST_ASSERT_TRUE(isWiped(session));
+    TEST_ASSERT_EQUAL_UINT32(0, session.remainingMs());
+
+    session.unlock(1, seed, sizeof(seed));
+    TEST_ASSERT_TRUE(session.setTimeout(20000));
+    TEST_ASSERT_TRUE(isWiped(session));
+
+    // disabling sessions keeps them wiped
+    TEST_ASSERT_TRUE(session.setTimeout(0));
+    TEST_ASSERT_FALSE(session.unlock(1, seed, sizeof(seed)));
+}
+
+void test_rejects_invalid_arguments(void) {
+    SeedSession session;
+    uint8_t seed[SeedSession::SEED_SIZE];
+    fillSeed(seed, 1);
+
+    TEST_ASSERT_FALSE(session.setTimeout(SEED_SESSION_MAX_TIMEOUT_MS + 1));
+    TEST_ASSERT_TRUE(session.setTimeout(SEED_SESSION_MAX_TIMEOUT_MS));
+
+    TEST_ASSERT_FALSE(session.unlock(0, seed, sizeof(seed)));
+    TEST_ASSERT_FALSE(session.unlock(1, nullptr, sizeof(seed)));
+    TEST_ASSERT_FALSE(session.unlock(1, seed, sizeof(seed) - 1));
+
+    session.unlock(1, seed, sizeof(seed));
+    uint8_t small[SeedSession::SEED_SIZE - 1];
+    TEST_ASSERT_FALSE(session.read(1, small, sizeof(small)));
+    TEST_ASSERT_TRUE(session.isUnlocked());
+}
+
+void test_timer_survives_millis_wraparound(void) {
+    SeedSession session;
+    session.setTimeout(1000);
+    uint8_t seed[SeedSession::SEED_SIZE];
+    uint8_t out[SeedSession::SEED_SIZE];
+    fillSeed(seed, 1);
+
+    fakeMillisTime() = 0xFFFFFF00u;
+    session.unlock(1, seed, sizeof(seed));
+    advanceMillis(0x200);  // wraps
+    TEST_ASSERT_TRUE(session.read(1, out, sizeof(out)));
+    advanceMillis(1000);
+    TEST_ASSERT_FALSE(session.read(1, out, sizeof(out)));
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_disabled_by_default);
+    RUN_TEST(test_hit_returns_seed_and_restarts_timer);
+    RUN_TEST(test_idle_timeout_wipes);
+    RUN_TEST(test_slot_change_wipes);
+    RUN_TEST(test_lock_and_set_timeout_wipe);
+    RUN_TEST(test_rejects_invalid_arguments);
+    RUN_TEST(test_timer_survives_millis_wraparound);
+
+    return UNITY_END();
+}
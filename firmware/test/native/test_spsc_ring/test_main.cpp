@@ -0,0 +1,132 @@
+#include <unity.h>
+#include <cstdint>
+#include <thread>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "system/SpscRing.h"
+#undef private
+
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+void test_push_pop_in_order() {
+    SpscRing<uint32_t, 4> ring;
+    uint32_t value = 0;
+
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop(value));
+
+    for (uint32_t i = 1; i <= 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+    TEST_ASSERT_FALSE(ring.push(5));  // full
+
+    for (uint32_t i = 1; i <= 4; i++) {
+        TEST_ASSERT_TRUE(ring.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_indices_wrap_around() {
+    SpscRing<uint32_t, 2> ring;
+    uint32_t value = 0;
+
+    // start close to the 32-bit wrap point
+    ring.head_.store(0xFFFFFFFFu);
+    ring.tail_.store(0xFFFFFFFFu);
+
+    TEST_ASSERT_TRUE(ring.push(10));
+    TEST_ASSERT_TRUE(ring.push(11));
+    TEST_ASSERT_FALSE(ring.push(12));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.size());
+
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(10, value);
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(11, value);
+    TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+void test_bulk_push_pop_wraps() {
+    SpscRing<uint8_t, 8> ring;
+    uint8_t in[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t out[8] = { 0 };
+
+    // move the indices past the end of the storage first
+    TEST_ASSERT_EQUAL(5, ring.push(in, 5));
+    TEST_ASSERT_EQUAL(5, ring.pop(out, 5));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in, out, 5);
+
+    TEST_ASSERT_EQUAL(8, ring.space());
+    TEST_ASSERT_EQUAL(8, ring.push(in, sizeof(in)));  // 3 at the end, 5 at the start
+    TEST_ASSERT_EQUAL(0, ring.push(in, 1));           // full
+    TEST_ASSERT_EQUAL(0, ring.space());
+
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQUAL(6, ring.pop(out, 6, true));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in, out, 6);
+    for (size_t i = 0; i < 8; i++) {
+        // the 2 items left are in slots 3 and 4, the rest was wiped
+        TEST_ASSERT_EQUAL_UINT8(i == 3 || i == 4 ? in[6 + (i - 3)] : 0, ring.items_[i]);
+    }
+    TEST_ASSERT_EQUAL(2, ring.peek(out, sizeof(out)));  // fewer than asked, kept
+    TEST_ASSERT_EQUAL(2, ring.size());
+    TEST_ASSERT_EQUAL(2, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8(7, out[0]);
+    TEST_ASSERT_EQUAL_UINT8(8, out[1]);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_cross_thread_ordering() {
+    // std::thread stands in for core1
+    static const uint32_t COUNT = 200000;
+    SpscRing<uint32_t, 8> ring;
+    uint32_t mismatches = 0;
+
+    std::thread consumer([&]() {
+        uint32_t expected = 0;
+        uint32_t value = 0;
+        while (expected < COUNT) {
+            if (ring.pop(value)) {
+                if (value != expected) mismatches++;
+                expected++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint32_t i = 0; i < COUNT; ) {
+        if (ring.push(i)) {
+            i++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_push_pop_in_order);
+    RUN_TEST(test_indices_wrap_around);
+    RUN_TEST(test_bulk_push_pop_wraps);
+    RUN_TEST(test_cross_thread_ordering);
+
+    return UNITY_END();
+}
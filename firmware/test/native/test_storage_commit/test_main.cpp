@@ -0,0 +1,398 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+// A small stage, so overflow flushes and values too large to stage are exercised
+#define TP_STORAGE_STAGE_SIZE 512
+
+#define private public
+#include "storage/StorageManager.h"
+#undef private
+#include "storage/StorageManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t SECTORS = 8;
+
+static void fillPattern(uint8_t *buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(seed * 31 + i * 7);
+}
+
+static void assertValue(StorageManager &storage, uint32_t key, uint32_t seed, uint16_t len) {
+    uint8_t expected[600], out[600];
+    fillPattern(expected, len, seed);
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_TRUE(storage.readValueByKey(key, out, len));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, len);
+}
+
+// Whether the value of a key, as found on the next boot, was written with a seed
+static bool reopenedHolds(RamStorageBackend &flash, uint32_t key, uint32_t seed, uint16_t len) {
+    StorageManager reopened(flash);
+    uint8_t expected[600], out[600];
+    fillPattern(expected, len, seed);
+    return reopened.begin() && reopened.readValueByKey(key, out, len) &&
+           memcmp(expected, out, len) == 0;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_writes_are_staged_until_flush(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+
+    uint32_t programs = flash.programCount();
+    for (uint32_t slot = 1; slot <= 5; slot++) {
+        fillPattern(value, sizeof(value), slot);
+        TEST_ASSERT_TRUE(storage.writeKeyValue(slot, value, sizeof(value)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(programs, flash.programCount());  // nothing programmed yet
+    TEST_ASSERT_TRUE(storage.hasPendingWrites());
+    for (uint32_t slot = 1; slot <= 5; slot++) assertValue(storage, slot, slot, sizeof(value));
+    TEST_ASSERT_TRUE(storage.deleteKey(5));
+    TEST_ASSERT_FALSE(storage.keyExists(5));
+    TEST_ASSERT_FALSE(storage.writeKeyValue(1, value, sizeof(value)));  // staged keys exist
+
+    StorageManager before(flash);
+    TEST_ASSERT_TRUE(before.begin());
+    TEST_ASSERT_FALSE(before.keyExists(1));
+
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_FALSE(storage.hasPendingWrites());
+    TEST_ASSERT_EQUAL_UINT32(4 * StorageManager::recordSize(sizeof(value)), storage.usedBytes());
+    for (uint32_t slot = 1; slot <= 4; slot++) {
+        assertValue(storage, slot, slot, sizeof(value));
+        TEST_ASSERT_TRUE(reopenedHolds(flash, slot, slot, sizeof(value)));
+    }
+    TEST_ASSERT_FALSE(storage.keyExists(5));
+    TEST_ASSERT_TRUE(storage.flush());  // nothing left: no programs
+}
+
+void test_flush_coalesces_programs(void) {
+    uint8_t value[64];
+    uint32_t immediate = 0, coalesced = 0;
+
+    for (int mode = 0; mode < 2; mode++) {
+        RamStorageBackend flash(SECTORS);
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        uint8_t warmup = 0;
+        TEST_ASSERT_TRUE(storage.writeKeyValue(100, &warmup, 1));
+        TEST_ASSERT_TRUE(storage.flush());  // opens the head sector
+
+        uint32_t programs = flash.programCount();
+        for (uint32_t slot = 1; slot <= 5; slot++) {
+            fillPattern(value, sizeof(value), slot);
+            TEST_ASSERT_TRUE(storage.writeKeyValue(slot, value, sizeof(value)));
+            if (mode == 0) TEST_ASSERT_TRUE(storage.flush());
+        }
+        TEST_ASSERT_TRUE(storage.flush());
+        (mode == 0 ? immediate : coalesced) = flash.programCount() - programs;
+        TEST_ASSERT_EQUAL_UINT32(0, flash.eraseCount());
+    }
+    printf("\n5 x 64 B writes: %u programs flushed one by one, %u coalesced\n",
+           (unsigned)immediate, (unsigned)coalesced);
+    TEST_ASSERT_TRUE(immediate >= 10);  // record (1-2 pages) + commit byte each
+    TEST_ASSERT_TRUE(coalesced <= 4);   // 2 data pages + their commit bytes
+}
+
+void test_stage_overflow_flushes(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[100];
+    for (uint32_t key = 1; key <= 20; key++) {  // 2 KB through a 512 B stage
+        fillPattern(value, sizeof(value), key);
+        TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+        TEST_ASSERT_TRUE(storage.stageUsed <= TP_STORAGE_STAGE_SIZE);
+    }
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, sizeof(value)));  // flushed on overflow
+    TEST_ASSERT_TRUE(storage.flush());
+    for (uint32_t key = 1; key <= 20; key++) {
+        assertValue(storage, key, key, sizeof(value));
+        TEST_ASSERT_TRUE(reopenedHolds(flash, key, key, sizeof(value)));
+    }
+}
+
+void test_value_larger_than_stage_is_written_now(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[600];
+    fillPattern(value, 16, 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, 16));
+    fillPattern(value, sizeof(value), 2);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(2, value, sizeof(value)));
+    TEST_ASSERT_FALSE(storage.hasPendingWrites());  // the staged write went first
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, 16));
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 2, 2, sizeof(value)));
+}
+
+void test_transaction_and_service(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+
+    TEST_ASSERT_TRUE(storage.beginTransaction());
+    TEST_ASSERT_FALSE(storage.beginTransaction());  // not nested
+    fillPattern(value, sizeof(value), 2);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(2, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.deleteKey(1));
+    assertValue(storage, 2, 2, sizeof(value));  // read your own writes
+    TEST_ASSERT_FALSE(storage.keyExists(1));
+
+    // the open transaction stays in RAM; writes before it may go
+    TEST_ASSERT_FALSE(storage.service());
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_TRUE(storage.hasPendingWrites());
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, sizeof(value)));
+    TEST_ASSERT_FALSE(reopenedHolds(flash, 2, 2, sizeof(value)));
+
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_FALSE(storage.commitTransaction());
+    TEST_ASSERT_TRUE(storage.service());  // flushes
+    TEST_ASSERT_FALSE(storage.hasPendingWrites());
+
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.keyExists(1));
+    assertValue(reopened, 2, 2, sizeof(value));
+    TEST_ASSERT_EQUAL_UINT32(storage.usedBytes(), reopened.usedBytes());
+}
+
+void test_abort_restores_previous_values(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+    fillPattern(value, sizeof(value), 2);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(2, value, sizeof(value)));  // staged, outside
+    const size_t used = storage.usedBytes();
+
+    TEST_ASSERT_TRUE(storage.beginTransaction());
+    fillPattern(value, sizeof(value), 3);
+    TEST_ASSERT_TRUE(storage.updateKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.deleteKey(2));
+    TEST_ASSERT_TRUE(storage.writeKeyValue(3, value, sizeof(value)));
+    storage.abortTransaction();
+    TEST_ASSERT_FALSE(storage.inTransaction());
+
+    assertValue(storage, 1, 1, sizeof(value));
+    assertValue(storage, 2, 2, sizeof(value));
+    TEST_ASSERT_FALSE(storage.keyExists(3));
+    TEST_ASSERT_EQUAL_UINT32(used, storage.usedBytes());
+
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, sizeof(value)));
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 2, 2, sizeof(value)));
+}
+
+void test_transaction_larger_than_stage_fails(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[100];
+    fillPattern(value, sizeof(value), 1);
+    TEST_ASSERT_TRUE(storage.beginTransaction());
+    uint32_t key = 1;
+    while (storage.writeKeyValue(key, value, sizeof(value))) key++;
+    TEST_ASSERT_TRUE(key > 1);
+    storage.abortTransaction();
+    TEST_ASSERT_FALSE(storage.keyExists(1));
+    TEST_ASSERT_FALSE(storage.hasPendingWrites());
+}
+
+// Cut the power after every possible number of flash operations while a transaction
+// is flushed: on the next boot either every record of it is there or none is.
+void test_power_loss_during_transaction(void) {
+    uint8_t value[120];
+    bool sawOld = false, sawNew = false;
+
+    for (long budget = 0; budget < 16; budget++) {
+        RamStorageBackend flash(4);
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        for (uint32_t key = 1; key <= 4; key++) {
+            fillPattern(value, sizeof(value), key);
+            TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+        }
+        TEST_ASSERT_TRUE(storage.flush());
+
+        TEST_ASSERT_TRUE(storage.beginTransaction());
+        for (uint32_t key = 1; key <= 3; key++) {
+            fillPattern(value, sizeof(value), 100 + key);
+            TEST_ASSERT_TRUE(storage.updateKeyValue(key, value, sizeof(value)));
+        }
+        TEST_ASSERT_TRUE(storage.deleteKey(4));
+        TEST_ASSERT_TRUE(storage.commitTransaction());
+
+        flash.setProgramBudget(budget);
+        storage.flush();
+        flash.setProgramBudget(-1);
+
+        StorageManager reopened(flash);
+        TEST_ASSERT_TRUE(reopened.begin());
+        bool isNew = !reopened.keyExists(4);
+        for (uint32_t key = 1; key <= 3; key++) {
+            assertValue(reopened, key, isNew ? 100 + key : key, sizeof(value));
+        }
+        if (!isNew) assertValue(reopened, 4, 4, sizeof(value));
+        sawOld |= !isNew;
+        sawNew |= isNew;
+
+        // and the store keeps working afterwards
+        fillPattern(value, sizeof(value), 7);
+        TEST_ASSERT_TRUE(reopened.updateKeyValue(4, value, sizeof(value)));
+        TEST_ASSERT_TRUE(reopened.flush());
+        TEST_ASSERT_TRUE(reopenedHolds(flash, 4, 7, sizeof(value)));
+    }
+    TEST_ASSERT_TRUE(sawOld && sawNew);
+}
+
+// Records commit in write order: whatever survives a cut flush is a prefix of the writes
+void test_power_loss_during_flush_keeps_write_order(void) {
+    uint8_t value[60];
+    for (long budget = 0; budget < 8; budget++) {
+        RamStorageBackend flash(4);
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        for (uint32_t key = 1; key <= 7; key++) {
+            fillPattern(value, sizeof(value), key);
+            TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+        }
+        flash.setProgramBudget(budget);
+        storage.flush();
+        flash.setProgramBudget(-1);
+
+        StorageManager reopened(flash);
+        TEST_ASSERT_TRUE(reopened.begin());
+        uint32_t present = 0;
+        while (present < 7 && reopened.keyExists(present + 1)) present++;
+        for (uint32_t key = 1; key <= 7; key++) {
+            TEST_ASSERT_EQUAL(key <= present, reopened.keyExists(key));
+            if (key <= present) assertValue(reopened, key, key, sizeof(value));
+        }
+    }
+}
+
+// Programs that silently do nothing (power already failing) must not be committed
+void test_flush_verifies_before_commit(void) {
+    RamStorageBackend flash(4);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[60];
+    fillPattern(value, sizeof(value), 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());  // opens the head sector
+
+    fillPattern(value, sizeof(value), 2);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(2, value, sizeof(value)));
+    flash.setProgramBudget(0);
+    TEST_ASSERT_FALSE(storage.flush());  // the readback does not match
+    flash.setProgramBudget(-1);
+    TEST_ASSERT_TRUE(storage.hasPendingWrites());
+    assertValue(storage, 2, 2, sizeof(value));  // still staged
+    TEST_ASSERT_FALSE(reopenedHolds(flash, 2, 2, sizeof(value)));
+
+    // the next flush places it in a fresh sector
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, sizeof(value)));
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 2, 2, sizeof(value)));
+}
+
+// A committed record whose bytes change later fails its CRC and is dropped on boot
+void test_corrupted_record_is_dropped(void) {
+    RamStorageBackend flash(4);
+    uint8_t value[60];
+    {
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        for (uint32_t key = 1; key <= 3; key++) {
+            fillPattern(value, sizeof(value), key);
+            TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+            TEST_ASSERT_TRUE(storage.flush());
+        }
+    }
+    // one bit of key 3's value
+    uint32_t address = 0;
+    uint16_t length = 0;
+    {
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        TEST_ASSERT_TRUE(storage.findValue(3, address, length));
+    }
+    flash.corrupt(address + 10, 0x04);
+
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    assertValue(reopened, 1, 1, sizeof(value));
+    assertValue(reopened, 2, 2, sizeof(value));
+    TEST_ASSERT_FALSE(reopened.keyExists(3));
+
+    // the sector is sealed, new records go elsewhere
+    fillPattern(value, sizeof(value), 4);
+    TEST_ASSERT_TRUE(reopened.writeKeyValue(3, value, sizeof(value)));
+    TEST_ASSERT_TRUE(reopened.flush());
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 3, 4, sizeof(value)));
+    TEST_ASSERT_TRUE(reopenedHolds(flash, 1, 1, sizeof(value)));
+}
+
+void test_compaction_waits_for_an_empty_stage(void) {
+    RamStorageBackend flash(4);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[180];
+
+    // far more updates than the flash holds, with an open transaction now and then
+    for (uint32_t round = 0; round < 600; round++) {
+        bool transaction = round % 7 == 0;
+        if (transaction) TEST_ASSERT_TRUE(storage.beginTransaction());
+        fillPattern(value, sizeof(value), round);
+        TEST_ASSERT_TRUE(storage.updateKeyValue(round % 5, value, sizeof(value)));
+        if (transaction) TEST_ASSERT_FALSE(storage.compactOldest());
+        if (transaction) TEST_ASSERT_TRUE(storage.commitTransaction());
+    }
+    for (uint32_t key = 0; key < 5; key++) assertValue(storage, key, 595 + key, sizeof(value));
+    TEST_ASSERT_TRUE(storage.flush());
+    for (uint32_t key = 0; key < 5; key++) {
+        TEST_ASSERT_TRUE(reopenedHolds(flash, key, 595 + key, sizeof(value)));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_writes_are_staged_until_flush);
+    RUN_TEST(test_flush_coalesces_programs);
+    RUN_TEST(test_stage_overflow_flushes);
+    RUN_TEST(test_value_larger_than_stage_is_written_now);
+    RUN_TEST(test_transaction_and_service);
+    RUN_TEST(test_abort_restores_previous_values);
+    RUN_TEST(test_transaction_larger_than_stage_fails);
+    RUN_TEST(test_power_loss_during_transaction);
+    RUN_TEST(test_power_loss_during_flush_keeps_write_order);
+    RUN_TEST(test_compaction_waits_for_an_empty_stage);
+    RUN_TEST(test_flush_verifies_before_commit);
+    RUN_TEST(test_corrupted_record_is_dropped);
+
+    return UNITY_END();
+}
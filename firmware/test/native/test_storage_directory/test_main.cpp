@@ -0,0 +1,211 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// Include class under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "storage/StorageManager.h"
+#undef private
+#include "storage/StorageManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t SECTORS = 8;
+static const uint32_t LAST_SLOT = STORAGE_DIRECTORY_SLOTS - 1;
+
+static void fillPattern(uint8_t *buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(seed * 31 + i * 7);
+}
+
+static bool writeValue(StorageManager &storage, uint32_t key, uint32_t seed, uint16_t len = 8) {
+    uint8_t value[32];
+    fillPattern(value, len, seed);
+    return storage.writeKeyValue(key, value, len);
+}
+
+static void assertValue(StorageManager &storage, uint32_t key, uint32_t seed, uint16_t len = 8) {
+    uint8_t expected[32], out[32];
+    fillPattern(expected, len, seed);
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_TRUE(storage.readValueByKey(key, out, len));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, len);
+}
+
+// The n-th key (from 1 up) whose home slot is `home`
+static uint32_t keyWithHome(uint32_t home, uint32_t n) {
+    for (uint32_t key = 1;; key++) {
+        if (directorySlot(key) == home && --n == 0) return key;
+    }
+}
+
+// Directory slot a key is indexed in (-1 = not indexed)
+static int32_t slotOf(StorageManager &storage, uint32_t key) {
+    return storage.directorySlotOf(key);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_insert_and_lookup(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+
+    for (uint32_t key = 1; key <= 9; key++) {  // seed slots
+        TEST_ASSERT_TRUE(writeValue(storage, key, key));
+    }
+    TEST_ASSERT_EQUAL_UINT16(9, storage.directoryKeys);
+    TEST_ASSERT_TRUE(storage.directoryComplete);
+    for (uint32_t key = 1; key <= 9; key++) {
+        TEST_ASSERT_TRUE(slotOf(storage, key) >= 0);
+        assertValue(storage, key, key);
+    }
+    // a miss in a complete directory means absent, without touching the log
+    TEST_ASSERT_EQUAL_INT32(-1, slotOf(storage, 10));
+    TEST_ASSERT_FALSE(storage.keyExists(10));
+
+    // committed entries point at flash, and the next boot indexes the same keys
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_EQUAL_UINT32(0, storage.directory[slotOf(storage, 1)].address & StorageManager::STAGED_ADDRESS);
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL_UINT16(9, reopened.directoryKeys);
+    for (uint32_t key = 1; key <= 9; key++) assertValue(reopened, key, key);
+}
+
+void test_overwrite_keeps_one_entry(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_TRUE(writeValue(storage, 5, 1, 8));
+    const int32_t slot = slotOf(storage, 5);
+    TEST_ASSERT_FALSE(writeValue(storage, 5, 2, 8));  // writeKeyValue() never overwrites
+
+    uint8_t value[16];
+    fillPattern(value, 16, 3);
+    TEST_ASSERT_TRUE(storage.updateKeyValue(5, value, 16));
+    TEST_ASSERT_EQUAL_UINT16(1, storage.directoryKeys);
+    TEST_ASSERT_EQUAL_INT32(slot, slotOf(storage, 5));
+    TEST_ASSERT_EQUAL_UINT16(16, storage.directory[slot].length);
+    assertValue(storage, 5, 3, 16);
+
+    TEST_ASSERT_TRUE(storage.flush());
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL_UINT16(1, reopened.directoryKeys);
+    assertValue(reopened, 5, 3, 16);
+}
+
+void test_tombstone_removes_the_entry(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_TRUE(writeValue(storage, 3, 3));
+    TEST_ASSERT_TRUE(writeValue(storage, 4, 4));
+    TEST_ASSERT_TRUE(storage.flush());
+
+    TEST_ASSERT_TRUE(storage.deleteKey(3));
+    TEST_ASSERT_EQUAL_UINT16(1, storage.directoryKeys);
+    TEST_ASSERT_EQUAL_INT32(-1, slotOf(storage, 3));
+    TEST_ASSERT_FALSE(storage.keyExists(3));
+    TEST_ASSERT_FALSE(storage.deleteKey(3));
+    assertValue(storage, 4, 4);
+
+    // the tombstone is replayed at boot: the older value in the log stays deleted
+    TEST_ASSERT_TRUE(storage.flush());
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL_UINT16(1, reopened.directoryKeys);
+    TEST_ASSERT_FALSE(reopened.keyExists(3));
+    TEST_ASSERT_TRUE(writeValue(reopened, 3, 9));  // the key can be written again
+    assertValue(reopened, 3, 9);
+}
+
+void test_collisions_probe_to_the_next_slots(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    const uint32_t home = 10;
+    const uint32_t a = keyWithHome(home, 1), b = keyWithHome(home, 2), c = keyWithHome(home, 3);
+    TEST_ASSERT_TRUE(writeValue(storage, a, 1));
+    TEST_ASSERT_TRUE(writeValue(storage, b, 2));
+    TEST_ASSERT_TRUE(writeValue(storage, c, 3));
+    TEST_ASSERT_EQUAL_INT32(home, slotOf(storage, a));
+    TEST_ASSERT_EQUAL_INT32(home + 1, slotOf(storage, b));
+    TEST_ASSERT_EQUAL_INT32(home + 2, slotOf(storage, c));
+
+    // deleting the middle entry shifts the next one back, so the chain has no gap
+    TEST_ASSERT_TRUE(storage.deleteKey(b));
+    TEST_ASSERT_EQUAL_INT32(home + 1, slotOf(storage, c));
+    TEST_ASSERT_EQUAL_UINT32(0, storage.directory[home + 2].address);
+    assertValue(storage, a, 1);
+    assertValue(storage, c, 3);
+
+    // an entry already in its home slot stays there
+    const uint32_t d = keyWithHome(home + 2, 1);
+    TEST_ASSERT_TRUE(writeValue(storage, d, 4));
+    TEST_ASSERT_EQUAL_INT32(home + 2, slotOf(storage, d));
+    TEST_ASSERT_TRUE(storage.deleteKey(a));
+    TEST_ASSERT_EQUAL_INT32(home, slotOf(storage, c));
+    TEST_ASSERT_EQUAL_INT32(home + 2, slotOf(storage, d));
+    assertValue(storage, d, 4);
+}
+
+void test_probing_wraps_around_the_table(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    const uint32_t a = keyWithHome(LAST_SLOT, 1), b = keyWithHome(LAST_SLOT, 2), c = keyWithHome(0, 1);
+    TEST_ASSERT_TRUE(writeValue(storage, a, 1));
+    TEST_ASSERT_TRUE(writeValue(storage, b, 2));
+    TEST_ASSERT_TRUE(writeValue(storage, c, 3));
+    TEST_ASSERT_EQUAL_INT32(LAST_SLOT, slotOf(storage, a));
+    TEST_ASSERT_EQUAL_INT32(0, slotOf(storage, b));  // wrapped
+    TEST_ASSERT_EQUAL_INT32(1, slotOf(storage, c));  // displaced by the wrapped entry
+    for (uint32_t key : { a, b, c }) TEST_ASSERT_TRUE(storage.keyExists(key));
+
+    // the shift back crosses the end of the table too
+    TEST_ASSERT_TRUE(storage.deleteKey(a));
+    TEST_ASSERT_EQUAL_INT32(LAST_SLOT, slotOf(storage, b));
+    TEST_ASSERT_EQUAL_INT32(0, slotOf(storage, c));
+    TEST_ASSERT_EQUAL_UINT32(0, storage.directory[1].address);
+    assertValue(storage, b, 2);
+    assertValue(storage, c, 3);
+
+    // the same layout comes back at boot
+    TEST_ASSERT_TRUE(storage.flush());
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.keyExists(a));
+    assertValue(reopened, b, 2);
+    assertValue(reopened, c, 3);
+}
+
+void test_default_size_holds_seeds_and_settings(void) {
+    // 9 seed slots, host timing profiles and the other settings fit without scanning
+    TEST_ASSERT_TRUE(STORAGE_DIRECTORY_MAX_KEYS >= 32);
+    TEST_ASSERT_TRUE(sizeof(StorageManager::DirectoryEntry) * STORAGE_DIRECTORY_SLOTS <= 1024);
+}
+
+
+// -----------------------------------------------------------------------------
+// Test runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_and_lookup);
+    RUN_TEST(test_overwrite_keeps_one_entry);
+    RUN_TEST(test_tombstone_removes_the_entry);
+    RUN_TEST(test_collisions_probe_to_the_next_slots);
+    RUN_TEST(test_probing_wraps_around_the_table);
+    RUN_TEST(test_default_size_holds_seeds_and_settings);
+    return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include "storage/StorageManager.h"
+#include "storage/StorageManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+#include "storage/backend/MmapStorageBackend.cpp"
+
+// Test data buffers
+uint8_t testData1[] = {0x01, 0x02, 0x03, 0x04};
+uint8_t testData2[] = {0x10, 0x20, 0x30, 0x40, 0x50};
+uint8_t readBuffer[16];
+
+// Every test runs on each backend
+static const char* FILE_PATH = "/tmp/turtlpass_test_storage_full.bin";
+RamStorageBackend ramBackend;
+MmapStorageBackend fileBackend(FILE_PATH);
+StorageManager ramStorage(ramBackend);
+StorageManager fileStorage(fileBackend);
+StorageManager* storageManager = &ramStorage;
+IStorageBackend* backend = &ramBackend;
+
+void setUp(void) {
+    storageManager->begin();
+    storageManager->factoryReset();
+}
+
+void tearDown(void) {}
+
+///////////////////////////////////////////////////////////////
+// Test: Initialization and Factory Reset
+///////////////////////////////////////////////////////////////
+void test_storage_initialization_and_factory_reset() {
+    storageManager->begin();
+    storageManager->factoryReset();
+
+    // After reset, no keys exist
+    TEST_ASSERT_FALSE(storageManager->keyExists(0xAAAA1111));
+    TEST_ASSERT_FALSE(storageManager->keyExists(0xBBBB2222));
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Single Entry Write/Read
+///////////////////////////////////////////////////////////////
+void test_storage_write_and_read_single_entry() {
+    storageManager->factoryReset();
+
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_TRUE(storageManager->readValueByKey(0xAAAA1111, readBuffer, sizeof(testData1)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testData1, readBuffer, sizeof(testData1));
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Multiple Entries Write/Read
+///////////////////////////////////////////////////////////////
+void test_storage_multiple_entries() {
+    storageManager->factoryReset();
+
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xBBBB2222, testData2, sizeof(testData2)));
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_TRUE(storageManager->readValueByKey(0xAAAA1111, readBuffer, sizeof(testData1)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testData1, readBuffer, sizeof(testData1));
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_TRUE(storageManager->readValueByKey(0xBBBB2222, readBuffer, sizeof(testData2)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testData2, readBuffer, sizeof(testData2));
+}
+
+///////////////////////////////////////////////////////////////
+// Test: No-overwrite Behavior
+///////////////////////////////////////////////////////////////
+void test_storage_no_overwrite_behavior() {
+    storageManager->factoryReset();
+
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+    // Attempting to write same key again should fail
+    TEST_ASSERT_FALSE(storageManager->writeKeyValue(0xAAAA1111, testData2, sizeof(testData2)));
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Invalid Input Protection
+///////////////////////////////////////////////////////////////
+void test_storage_invalid_input_protection() {
+    storageManager->factoryReset();
+
+    TEST_ASSERT_FALSE(storageManager->writeKeyValue(0xAAAA1111, nullptr, sizeof(testData1)));
+    TEST_ASSERT_FALSE(storageManager->writeKeyValue(0xAAAA1111, testData1, 0));
+    TEST_ASSERT_FALSE(storageManager->readValueByKey(0xAAAA1111, nullptr, sizeof(testData1)));
+    TEST_ASSERT_FALSE(storageManager->readValueByKey(0xAAAA1111, readBuffer, 0));
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Overflow Protection
+///////////////////////////////////////////////////////////////
+void test_storage_overflow_protection() {
+    storageManager->factoryReset();
+
+    // a record never spans sectors
+    uint16_t oversized = STORAGE_SECTOR_SIZE - SECTOR_HEADER_SIZE - RECORD_HEADER_SIZE + 10;
+    uint8_t* largeBuffer = new uint8_t[oversized];
+    memset(largeBuffer, 0xAA, oversized);
+
+    TEST_ASSERT_FALSE(storageManager->writeKeyValue(0xDEADBEAF, largeBuffer, oversized));
+    delete[] largeBuffer;
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Magic Header Recovery (implicit)
+///////////////////////////////////////////////////////////////
+void test_storage_magic_header_recovery() {
+    storageManager->factoryReset();
+
+    // Call begin() again simulates reinitialization
+    storageManager->begin();
+
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_TRUE(storageManager->readValueByKey(0xAAAA1111, readBuffer, sizeof(testData1)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testData1, readBuffer, sizeof(testData1));
+}
+
+
+///////////////////////////////////////////////////////////////
+// Test: Entries Survive a Restart
+///////////////////////////////////////////////////////////////
+void test_storage_persists_committed_entries() {
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+    TEST_ASSERT_TRUE(storageManager->flush());
+
+    // a second manager on the same backend sees what the first committed
+    StorageManager restarted(*backend);
+    restarted.begin();
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_TRUE(restarted.readValueByKey(0xAAAA1111, readBuffer, sizeof(testData1)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testData1, readBuffer, sizeof(testData1));
+    storageManager->begin();  // restarted re-opened the region
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Flash Operations per Write (page programs, never a sector rewrite)
+///////////////////////////////////////////////////////////////
+void test_storage_program_counts() {
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xAAAA1111, testData1, sizeof(testData1)));
+    TEST_ASSERT_TRUE(storageManager->flush());  // opens a sector
+
+    uint32_t programs = backend->programCount();
+    uint32_t erases = backend->eraseCount();
+    TEST_ASSERT_TRUE(storageManager->writeKeyValue(0xBBBB2222, testData2, sizeof(testData2)));
+    TEST_ASSERT_EQUAL_UINT32(programs, backend->programCount());  // staged
+    TEST_ASSERT_TRUE(storageManager->flush());
+    TEST_ASSERT_EQUAL_UINT32(programs + 2, backend->programCount());  // record, commit byte
+    TEST_ASSERT_EQUAL_UINT32(erases, backend->eraseCount());
+
+    programs = backend->programCount();
+    TEST_ASSERT_TRUE(storageManager->readValueByKey(0xAAAA1111, readBuffer, sizeof(testData1)));
+    TEST_ASSERT_TRUE(storageManager->keyExists(0xAAAA1111));
+    TEST_ASSERT_EQUAL_UINT32(programs, backend->programCount());
+
+    uint8_t update[sizeof(testData1)] = {9, 9, 9, 9};
+    programs = backend->programCount();
+    TEST_ASSERT_TRUE(storageManager->updateKeyValue(0xAAAA1111, update, sizeof(update)));
+    TEST_ASSERT_TRUE(storageManager->flush());
+    TEST_ASSERT_EQUAL_UINT32(programs + 2, backend->programCount());
+    TEST_ASSERT_TRUE(storageManager->updateKeyValue(0xAAAA1111, update, sizeof(update)));  // unchanged
+    TEST_ASSERT_FALSE(storageManager->hasPendingWrites());
+    TEST_ASSERT_EQUAL_UINT32(programs + 2, backend->programCount());
+
+    programs = backend->programCount();
+    erases = backend->eraseCount();
+    storageManager->factoryReset();
+    TEST_ASSERT_EQUAL_UINT32(erases + 1, backend->eraseCount());      // the one log sector
+    TEST_ASSERT_EQUAL_UINT32(programs + 1, backend->programCount());  // its free header
+}
+
+///////////////////////////////////////////////////////////////
+// Test: Appends Fill a Sector Without Erasing
+///////////////////////////////////////////////////////////////
+void test_storage_append_only() {
+    uint32_t erases = backend->eraseCount();
+    for (uint32_t key = 1; key <= 100; key++) {
+        TEST_ASSERT_TRUE(storageManager->writeKeyValue(key, testData1, sizeof(testData1)));
+    }
+    TEST_ASSERT_TRUE(storageManager->flush());
+    TEST_ASSERT_EQUAL_UINT32(erases, backend->eraseCount());
+
+    // the same on the next boot
+    StorageManager restarted(*backend);
+    TEST_ASSERT_TRUE(restarted.begin());
+    for (uint32_t key = 1; key <= 100; key++) {
+        TEST_ASSERT_TRUE(restarted.keyExists(key));
+    }
+    storageManager->begin();
+}
+
+
+//////////////////////////////////////////////////////////
+// Test Runner
+//////////////////////////////////////////////////////////
+
+static void runAll(const char* name, StorageManager* storage, IStorageBackend* storageBackend) {
+    printf("\n[%s backend]\n", name);
+    storageManager = storage;
+    backend = storageBackend;
+    RUN_TEST(test_storage_initialization_and_factory_reset);
+    RUN_TEST(test_storage_write_and_read_single_entry);
+    RUN_TEST(test_storage_multiple_entries);
+    RUN_TEST(test_storage_no_overwrite_behavior);
+    RUN_TEST(test_storage_invalid_input_protection);
+    RUN_TEST(test_storage_overflow_protection);
+    RUN_TEST(test_storage_magic_header_recovery);
+    RUN_TEST(test_storage_persists_committed_entries);
+    RUN_TEST(test_storage_program_counts);
+    RUN_TEST(test_storage_append_only);
+}
+
+int main(int, char**) {
+    unlink(FILE_PATH);
+    UNITY_BEGIN();
+    runAll("RAM", &ramStorage, &ramBackend);
+    runAll("mmap file", &fileStorage, &fileBackend);
+    int failures = UNITY_END();
+    unlink(FILE_PATH);
+    return failures;
+}
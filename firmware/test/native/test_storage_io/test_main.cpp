@@ -0,0 +1,352 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+
+// -----------------------------------------------------------------------------
+// Include module under test (with private access opened for testing)
+// -----------------------------------------------------------------------------
+#define private public
+#include "storage/StorageManager.h"
+#undef private
+#include "storage/StorageManager.cpp"
+#include "storage/backend/EepromStorageBackend.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+#include "storage/backend/MmapStorageBackend.cpp"
+#include "storage/backend/StorageBackendFactory.cpp"
+#include <EEPROM.h>
+
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t STORAGE_SIZE = 4096;
+static EepromStorageBackend eepromBackend(STORAGE_SIZE);  // same EEPROM the per-byte paths use
+
+static void fillPattern(uint8_t *buf, size_t len, uint8_t start) {
+    for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(start + i * 7);
+}
+
+// Per-byte reference paths (the EEPROM implementation before block I/O)
+static void perByteRead(uint16_t address, uint8_t *dst, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) dst[i] = EEPROM.read(address + i);
+}
+
+static void perByteWrite(uint16_t address, const uint8_t *src, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) EEPROM.write(address + i, src[i]);
+}
+
+template <typename F>
+static double microsPerCall(int iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+void setUp(void) {
+    EEPROM.begin(STORAGE_SIZE);
+    memset(EEPROM.getDataPtr(), 0xFF, STORAGE_SIZE);  // blank flash
+}
+
+void tearDown(void) {}
+
+// Legacy EEPROM image: [magic BE][totalUsed BE] then [length BE][key LE][data] entries
+static size_t buildLegacyImage(uint8_t *image, size_t size) {
+    memset(image, 0xFF, size);
+    size_t used = HEADER_SIZE;
+    const struct { uint32_t key; uint8_t length; uint8_t start; } entries[] = {
+        { 1, 64, 0x10 }, { 2, 64, 0x20 }, { 0x48540000u, 2, 0x30 }, { 1, 64, 0x40 },  // duplicate: first wins
+    };
+    for (auto &e : entries) {
+        uint8_t *p = image + used;
+        p[0] = 0;
+        p[1] = e.length;
+        for (int i = 0; i < 4; i++) p[2 + i] = (uint8_t)(e.key >> (8 * i));
+        fillPattern(p + ENTRY_OVERHEAD, e.length, e.start);
+        used += ENTRY_OVERHEAD + e.length;
+    }
+    image[0] = 0xFA;
+    image[1] = 0x55;
+    image[2] = (uint8_t)(used >> 8);
+    image[3] = (uint8_t)used;
+    return used;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_on_flash_format(void) {
+    RamStorageBackend ram;
+    StorageManager storage(ram);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[3] = { 0xAA, 0xBB, 0xCC };
+    TEST_ASSERT_TRUE(storage.writeKeyValue(0x11223344, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+
+    // sector header: [magic][erase count][sequence][reserved], little-endian
+    const uint8_t header[] = { 0x54, 0x50, 0x4C, 0x54, 0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+    // record: [length LE][type][commit][key LE][CRC-32 LE][data], padded to 4 bytes;
+    // the CRC covers length, type, key and data (zlib.crc32 of those 10 bytes)
+    const uint8_t record[] = { 0x03, 0x00, RECORD_VALUE, RECORD_COMMITTED, 0x44, 0x33, 0x22, 0x11,
+                               0x34, 0x73, 0x12, 0xCA, 0xAA, 0xBB, 0xCC, 0xFF, 0xFF, 0xFF };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(header, ram.data(), sizeof(header));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(record, ram.data() + SECTOR_HEADER_SIZE, sizeof(record));
+    TEST_ASSERT_EQUAL_UINT32(16, StorageManager::recordSize(3));
+
+    // CRC-32 check value
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, StorageManager::crc32(0, (const uint8_t *)"123456789", 9));
+}
+
+void test_values_survive_reopen(void) {
+    uint8_t values[20][40];
+    {
+        StorageManager storage(eepromBackend);
+        TEST_ASSERT_TRUE(storage.begin());
+        for (uint32_t k = 0; k < 20; k++) {
+            fillPattern(values[k], sizeof(values[k]), (uint8_t)k);
+            TEST_ASSERT_TRUE(storage.writeKeyValue(k + 1, values[k], (uint16_t)(10 + k)));
+        }
+        TEST_ASSERT_TRUE(storage.flush());
+    }
+    StorageManager reopened(eepromBackend);
+    TEST_ASSERT_TRUE(reopened.begin());
+    for (uint32_t k = 0; k < 20; k++) {
+        uint8_t out[40] = {0};
+        TEST_ASSERT_TRUE(reopened.readValueByKey(k + 1, out, sizeof(out)));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(values[k], out, 10 + k);
+    }
+    TEST_ASSERT_FALSE(reopened.keyExists(21));
+}
+
+void test_factory_reset_erases_everything(void) {
+    StorageManager storage(eepromBackend);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 3);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+
+    storage.factoryReset();
+    const uint8_t *data = EEPROM.getConstDataPtr();
+    for (size_t s = 0; s < eepromBackend.sectorCount(); s++) {
+        const uint8_t *sector = data + s * EEPROM_BACKEND_SECTOR_SIZE;
+        TEST_ASSERT_EACH_EQUAL_UINT8(0xFF, sector + SECTOR_HEADER_SIZE,
+                                     EEPROM_BACKEND_SECTOR_SIZE - SECTOR_HEADER_SIZE);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, storage.sectorEraseCount(0));  // carried in the free header
+    TEST_ASSERT_FALSE(storage.keyExists(1));
+    TEST_ASSERT_FALSE(storage.isBlank());
+}
+
+void test_out_of_range_access_is_rejected(void) {
+    RamStorageBackend ram;
+    MmapStorageBackend file("/tmp/turtlpass_test_storage_io.bin");
+    IStorageBackend *backends[] = { &eepromBackend, &ram, &file };
+    for (IStorageBackend *backend : backends) {
+        TEST_ASSERT_TRUE(backend->begin());
+        const uint32_t size = backend->sectorCount() * backend->sectorSize();
+        uint8_t out[4];
+        TEST_ASSERT_FALSE(backend->read(size - 2, out, sizeof(out)));
+
+        uint8_t page[STORAGE_PAGE_SIZE];
+        memset(page, 0, sizeof(page));
+        TEST_ASSERT_FALSE(backend->programPage(size, page));  // past the end
+        TEST_ASSERT_FALSE(backend->programPage(10, page));    // not page-aligned
+        TEST_ASSERT_FALSE(backend->eraseSector(backend->sectorCount()));
+    }
+    unlink("/tmp/turtlpass_test_storage_io.bin");
+}
+
+void test_programming_only_clears_bits(void) {
+    RamStorageBackend ram;
+    uint8_t page[STORAGE_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    page[0] = 0x0F;
+    TEST_ASSERT_TRUE(ram.programPage(0, page));
+    page[0] = 0xF0;
+    TEST_ASSERT_TRUE(ram.programPage(0, page));
+    TEST_ASSERT_EQUAL_HEX8(0x00, ram.data()[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, ram.data()[1]);
+    TEST_ASSERT_TRUE(ram.eraseSector(0));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, ram.data()[0]);
+}
+
+void test_legacy_import(void) {
+    uint8_t image[STORAGE_SIZE];
+    size_t used = buildLegacyImage(image, sizeof(image));
+    RamStorageBackend ram;
+    StorageManager storage(ram);
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_TRUE(storage.isBlank());
+    TEST_ASSERT_TRUE(storage.importLegacy(image, sizeof(image)));
+
+    uint8_t expected[64], out[64];
+    fillPattern(expected, sizeof(expected), 0x10);
+    TEST_ASSERT_TRUE(storage.readValueByKey(1, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, sizeof(out));
+    fillPattern(expected, 2, 0x30);
+    TEST_ASSERT_TRUE(storage.readValueByKey(0x48540000u, out, 2));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, 2);
+
+    // a log that exists is never imported into again
+    StorageManager reopened(ram);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.isBlank());
+    uint32_t programs = ram.programCount();
+    TEST_ASSERT_TRUE(reopened.importLegacy(image, sizeof(image)));
+    TEST_ASSERT_EQUAL_UINT32(programs, ram.programCount());
+
+    // nothing to import
+    image[0] = 0xFF;
+    TEST_ASSERT_FALSE(reopened.importLegacy(image, sizeof(image)));
+    TEST_ASSERT_FALSE(reopened.importLegacy(nullptr, 0));
+    image[0] = 0xFA;
+    TEST_ASSERT_FALSE(storage.importLegacy(image, used - 1));  // truncated
+}
+
+void test_factory_falls_back_to_eeprom(void) {
+    // no flash filesystem region off the device
+    IStorageBackend *backend = StorageBackendFactory::create();
+    TEST_ASSERT_NOT_NULL(backend);
+    TEST_ASSERT_EQUAL_PTR(backend, StorageBackendFactory::create());
+    TEST_ASSERT_TRUE(backend->begin());
+    TEST_ASSERT_EQUAL_UINT32(EEPROM_BACKEND_SECTOR_SIZE, backend->sectorSize());
+    TEST_ASSERT_TRUE(backend->sectorCount() >= STORAGE_MIN_SECTORS);
+}
+
+// Fallback boards: seeds of earlier firmware sit in the EEPROM the log is about to use
+void test_legacy_migration_in_place(void) {
+    size_t used = buildLegacyImage(EEPROM.getDataPtr(), STORAGE_SIZE);
+    TEST_ASSERT_TRUE(used <= EEPROM_BACKEND_SECTOR_SIZE);
+    {
+        StorageManager storage(eepromBackend);
+        TEST_ASSERT_TRUE(storage.begin());
+        TEST_ASSERT_TRUE(storage.isBlank());
+        size_t size = 0;
+        const uint8_t *image = eepromBackend.legacyImage(size);
+        TEST_ASSERT_EQUAL_UINT32(STORAGE_SIZE, size);
+        uint32_t erases = eepromBackend.eraseCount();
+        TEST_ASSERT_TRUE(storage.importLegacy(image, size));
+        eepromBackend.eraseLegacyImage();
+        TEST_ASSERT_EQUAL_UINT32(erases, eepromBackend.eraseCount());  // erased sectors first
+        TEST_ASSERT_EQUAL_HEX8(0xFA, EEPROM.getConstDataPtr()[0]);     // legacy copy kept
+    }
+
+    StorageManager reopened(eepromBackend);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.isBlank());
+    uint8_t expected[64], out[64];
+    fillPattern(expected, sizeof(expected), 0x20);
+    TEST_ASSERT_TRUE(reopened.readValueByKey(2, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, sizeof(out));
+    size_t size = 0;
+    const uint8_t *image = eepromBackend.legacyImage(size);
+    TEST_ASSERT_TRUE(reopened.importLegacy(image, size));  // already held
+
+    // the legacy sector is reclaimed once the log needs it
+    uint8_t value[200];
+    for (uint32_t round = 0; round < 20; round++) {
+        fillPattern(value, sizeof(value), round);
+        TEST_ASSERT_TRUE(reopened.updateKeyValue(100 + round % 3, value, sizeof(value)));
+        TEST_ASSERT_TRUE(reopened.flush());
+    }
+    TEST_ASSERT_FALSE(reopened.importLegacy(image, size));
+    TEST_ASSERT_TRUE(reopened.readValueByKey(2, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, sizeof(out));
+}
+
+void test_benchmark_per_byte_vs_block(void) {
+    const int iterations = 2000;
+    StorageManager storage(eepromBackend);
+    TEST_ASSERT_TRUE(storage.begin());
+
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 5);
+    uint8_t a[sizeof(value)], b[sizeof(value)];
+
+    double eraseByte = microsPerCall(iterations, [] {
+        for (uint16_t i = 0; i < EEPROM_BACKEND_SECTOR_SIZE; i++) EEPROM.write(i, 0xFF);
+        EEPROM.commit();
+    });
+    double eraseBlock = microsPerCall(iterations, [&] { eepromBackend.eraseSector(0); });
+    perByteWrite(100, value, sizeof(value));
+
+    double readByte = microsPerCall(iterations, [&] { perByteRead(100, a, sizeof(a)); });
+    double readBlock = microsPerCall(iterations, [&] { eepromBackend.read(100, b, sizeof(b)); });
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(a, b, sizeof(a));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(value, b, sizeof(b));
+
+    // directory rebuild: one header read per record
+    RamStorageBackend ram(16);
+    StorageManager log(ram);
+    log.begin();
+    for (uint32_t k = 1; k <= 400; k++) log.writeKeyValue(k, value, 1);
+    double rebuild = microsPerCall(200, [&] { log.rebuildDirectory(); });
+    TEST_ASSERT_EQUAL_UINT16(std::min(400, STORAGE_DIRECTORY_MAX_KEYS), log.directoryKeys);  // rest: scanned
+
+    printf("\n%-22s %-12s %-12s\n", "operation", "per-byte us", "block us");
+    printf("%-22s %-12.3f %-12.3f\n", "erase 1024 B", eraseByte, eraseBlock);
+    printf("%-22s %-12.3f %-12.3f\n", "read 64 B", readByte, readBlock);
+    printf("%-22s %-12s %-12.3f\n", "rebuild 400 keys", "-", rebuild);
+    TEST_ASSERT_TRUE(eraseBlock < eraseByte);
+}
+
+
+void test_benchmark_backends(void) {
+    RamStorageBackend ram;
+    MmapStorageBackend file("/tmp/turtlpass_test_storage_io.bin");
+    struct { const char *name; IStorageBackend *backend; } backends[] = {
+        { "EEPROM (mock)", &eepromBackend }, { "RAM", &ram }, { "mmap file", &file },
+    };
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 9);
+
+    printf("\n%-14s %-10s %-10s %-9s %-9s %-14s\n", "backend", "write us", "lookup us", "programs",
+           "erases", "EEPROM commits");
+    for (auto &b : backends) {
+        StorageManager storage(*b.backend);
+        TEST_ASSERT_TRUE(storage.begin());
+        storage.factoryReset();
+        uint32_t programs = b.backend->programCount();
+        uint32_t erases = b.backend->eraseCount();
+        size_t commits = EEPROM.commits;
+        uint32_t key = 1;
+        double write = microsPerCall(20, [&] { storage.writeKeyValue(key++, value, sizeof(value)); });
+        TEST_ASSERT_TRUE(storage.flush());
+        programs = b.backend->programCount() - programs;
+        erases = b.backend->eraseCount() - erases;
+        commits = EEPROM.commits - commits;
+        uint8_t out[sizeof(value)];
+        double lookup = microsPerCall(20000, [&] { storage.readValueByKey(15, out, sizeof(out)); });
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(value, out, sizeof(value));
+        TEST_ASSERT_TRUE(programs <= 3 * 20);  // record (1-2 pages) + commit byte, sector headers
+        TEST_ASSERT_EQUAL_UINT32(0, erases);
+        printf("%-14s %-10.3f %-10.3f %-9u %-9u %-14u\n", b.name, write, lookup, (unsigned)programs,
+               (unsigned)erases, (unsigned)commits);
+    }
+    unlink("/tmp/turtlpass_test_storage_io.bin");
+}
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_on_flash_format);
+    RUN_TEST(test_values_survive_reopen);
+    RUN_TEST(test_factory_reset_erases_everything);
+    RUN_TEST(test_out_of_range_access_is_rejected);
+    RUN_TEST(test_programming_only_clears_bits);
+    RUN_TEST(test_legacy_import);
+    RUN_TEST(test_factory_falls_back_to_eeprom);
+    RUN_TEST(test_legacy_migration_in_place);
+    RUN_TEST(test_benchmark_per_byte_vs_block);
+    RUN_TEST(test_benchmark_backends);
+
+    return UNITY_END();
+}
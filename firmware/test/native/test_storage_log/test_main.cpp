@@ -0,0 +1,363 @@
+#include <unity.h>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+
+// A small directory, so overflow scanning and deletion shifts are exercised too
+#define TP_STORAGE_DIRECTORY_SLOTS 64
+
+#define private public
+#include "storage/StorageManager.h"
+#undef private
+#include "storage/StorageManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+static const size_t SECTORS = 16;
+
+static void fillPattern(uint8_t *buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(seed * 31 + i * 7);
+}
+
+static void assertValue(StorageManager &storage, uint32_t key, uint32_t seed, uint16_t len) {
+    uint8_t expected[256], out[256];
+    fillPattern(expected, len, seed);
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_TRUE(storage.readValueByKey(key, out, len));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, len);
+}
+
+static void printWear(const char *label, RamStorageBackend &flash) {
+    uint32_t lo = UINT32_MAX, hi = 0, total = 0;
+    printf("\n%s: erases per sector:", label);
+    for (size_t s = 0; s < flash.sectorCount(); s++) {
+        uint32_t e = flash.sectorErases(s);
+        printf(" %u", (unsigned)e);
+        lo = e < lo ? e : lo;
+        hi = e > hi ? e : hi;
+        total += e;
+    }
+    printf("\n  min %u, max %u, total %u, programs %u\n", (unsigned)lo, (unsigned)hi,
+           (unsigned)total, (unsigned)flash.programCount());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+void test_update_replaces_value_of_any_length(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[200];
+    fillPattern(value, 8, 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(7, value, 8));
+    fillPattern(value, 200, 2);
+    TEST_ASSERT_TRUE(storage.updateKeyValue(7, value, 200));
+    assertValue(storage, 7, 2, 200);
+    TEST_ASSERT_EQUAL_UINT32(StorageManager::recordSize(200), storage.usedBytes());
+    TEST_ASSERT_TRUE(storage.flush());
+
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    assertValue(reopened, 7, 2, 200);
+    TEST_ASSERT_EQUAL_UINT32(StorageManager::recordSize(200), reopened.usedBytes());
+}
+
+void test_delete_writes_tombstone(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 3);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.writeKeyValue(2, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+
+    uint32_t programs = flash.programCount();
+    TEST_ASSERT_TRUE(storage.deleteKey(1));
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_EQUAL_UINT32(programs + 2, flash.programCount());  // tombstone, commit byte
+    TEST_ASSERT_FALSE(storage.keyExists(1));
+    TEST_ASSERT_FALSE(storage.deleteKey(1));
+    TEST_ASSERT_TRUE(storage.keyExists(2));
+
+    // the tombstone survives a restart; the key can then be written again
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.keyExists(1));
+    TEST_ASSERT_TRUE(reopened.writeKeyValue(1, value, 16));
+    assertValue(reopened, 1, 3, 16);
+}
+
+void test_directory_delete_keeps_probe_chains(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[4];
+    for (uint32_t key = 1; key <= 40; key++) {  // collisions in 64 slots
+        fillPattern(value, sizeof(value), key);
+        TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+    }
+    for (uint32_t key = 1; key <= 40; key += 3) {
+        TEST_ASSERT_TRUE(storage.deleteKey(key));
+    }
+    for (uint32_t key = 1; key <= 40; key++) {
+        if ((key - 1) % 3 == 0) {
+            TEST_ASSERT_FALSE(storage.keyExists(key));
+        } else {
+            assertValue(storage, key, key, sizeof(value));
+        }
+    }
+    TEST_ASSERT_TRUE(storage.directoryComplete);
+}
+
+void test_directory_overflow_respects_tombstones(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[4];
+    const uint32_t keys = STORAGE_DIRECTORY_MAX_KEYS + 20;
+    for (uint32_t key = 1; key <= keys; key++) {
+        fillPattern(value, sizeof(value), key);
+        TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+    }
+    TEST_ASSERT_FALSE(storage.directoryComplete);
+    TEST_ASSERT_TRUE(storage.deleteKey(keys));  // only found by scanning
+    TEST_ASSERT_FALSE(storage.keyExists(keys));
+    fillPattern(value, sizeof(value), 99);
+    TEST_ASSERT_TRUE(storage.updateKeyValue(keys - 1, value, sizeof(value)));
+    assertValue(storage, keys - 1, 99, sizeof(value));
+    assertValue(storage, 1, 1, sizeof(value));
+}
+
+void test_compaction_reclaims_superseded_records(void) {
+    RamStorageBackend flash(4);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[100];
+
+    // far more updates than the flash holds: compaction has to keep up
+    for (uint32_t round = 0; round < 1000; round++) {
+        uint32_t key = round % 10;
+        fillPattern(value, sizeof(value), round);
+        TEST_ASSERT_TRUE(storage.updateKeyValue(key, value, sizeof(value)));
+    }
+    for (uint32_t key = 0; key < 10; key++) {
+        assertValue(storage, key, 990 + key, sizeof(value));
+    }
+    TEST_ASSERT_TRUE(flash.eraseCount() > 0);
+    TEST_ASSERT_TRUE(storage.freeSectors() >= STORAGE_RESERVED_SECTORS);
+    TEST_ASSERT_TRUE(storage.flush());
+
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    for (uint32_t key = 0; key < 10; key++) {
+        assertValue(reopened, key, 990 + key, sizeof(value));
+    }
+    TEST_ASSERT_EQUAL_UINT32(storage.usedBytes(), reopened.usedBytes());
+}
+
+void test_full_log_rejects_writes(void) {
+    RamStorageBackend flash(4);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[200];
+    fillPattern(value, sizeof(value), 5);
+    uint32_t key = 1;
+    while (storage.writeKeyValue(key, value, sizeof(value))) key++;
+    TEST_ASSERT_TRUE(storage.usedBytes() + StorageManager::recordSize(sizeof(value)) > storage.capacity());
+
+    // everything written is still there, and deleting makes room again
+    for (uint32_t k = 1; k < key; k++) assertValue(storage, k, 5, sizeof(value));
+    TEST_ASSERT_TRUE(storage.deleteKey(1));
+    TEST_ASSERT_TRUE(storage.writeKeyValue(key, value, sizeof(value)));
+    assertValue(storage, key, 5, sizeof(value));
+}
+
+void test_wear_distribution(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+
+    // nine seeds written once, one setting rewritten over and over
+    for (uint32_t slot = 1; slot <= 9; slot++) {
+        fillPattern(value, sizeof(value), slot);
+        TEST_ASSERT_TRUE(storage.writeKeyValue(slot, value, sizeof(value)));
+    }
+    for (uint32_t round = 0; round < 20000; round++) {
+        fillPattern(value, 8, round);
+        TEST_ASSERT_TRUE(storage.updateKeyValue(0x48540000u, value, 8));
+        storage.service();
+    }
+    printWear("20000 setting updates", flash);
+
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (size_t s = 0; s < SECTORS; s++) {
+        lo = std::min(lo, flash.sectorErases(s));
+        hi = std::max(hi, flash.sectorErases(s));
+        TEST_ASSERT_EQUAL_UINT32(flash.sectorErases(s), storage.sectorEraseCount(s));
+    }
+    TEST_ASSERT_TRUE(lo > 0);                        // every sector takes its share
+    TEST_ASSERT_TRUE(hi - lo <= STORAGE_WEAR_SPREAD); // including the seeds' sector
+
+    // a rewrite costs page programs; erases are amortized over a sector of records
+    double programsPerUpdate = (double)flash.programCount() / 20009;
+    double erasesPerUpdate = (double)flash.eraseCount() / 20009;
+    printf("  %.2f programs and %.4f erases per write\n", programsPerUpdate, erasesPerUpdate);
+    TEST_ASSERT_TRUE(programsPerUpdate < 3.0);
+    TEST_ASSERT_TRUE(erasesPerUpdate < 0.02);
+
+    for (uint32_t slot = 1; slot <= 9; slot++) {
+        assertValue(storage, slot, slot, sizeof(value));
+    }
+}
+
+void test_background_compaction_keeps_sectors_free(void) {
+    RamStorageBackend flash(8);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[120];
+    for (uint32_t round = 0; round < 400; round++) {
+        fillPattern(value, sizeof(value), round);
+        TEST_ASSERT_TRUE(storage.updateKeyValue(round % 4, value, sizeof(value)));
+        while (storage.service()) {}
+        TEST_ASSERT_TRUE(storage.freeSectors() >= STORAGE_COMPACT_FREE_SECTORS - 1);
+    }
+    TEST_ASSERT_FALSE(storage.service());  // nothing left to do
+}
+
+// Cut the power after every possible number of flash operations during an update:
+// the key must read back as the old or the new value, never anything else.
+void test_power_loss_during_update(void) {
+    uint8_t oldValue[150], newValue[150];
+    fillPattern(oldValue, sizeof(oldValue), 1);
+    fillPattern(newValue, sizeof(newValue), 2);
+
+    for (long budget = 0; budget < 12; budget++) {
+        RamStorageBackend flash(4);
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        // fill the head sector so the update also opens a sector
+        TEST_ASSERT_TRUE(storage.writeKeyValue(1, oldValue, sizeof(oldValue)));
+        uint8_t filler[200];
+        memset(filler, 0x5A, sizeof(filler));
+        for (uint32_t k = 100; k < 118; k++) TEST_ASSERT_TRUE(storage.writeKeyValue(k, filler, sizeof(filler)));
+        TEST_ASSERT_TRUE(storage.flush());
+
+        flash.setProgramBudget(budget);
+        storage.updateKeyValue(1, newValue, sizeof(newValue));
+        storage.flush();
+        flash.setProgramBudget(-1);
+
+        StorageManager reopened(flash);
+        TEST_ASSERT_TRUE(reopened.begin());
+        uint8_t out[sizeof(oldValue)];
+        TEST_ASSERT_TRUE(reopened.readValueByKey(1, out, sizeof(out)));
+        bool isOld = memcmp(out, oldValue, sizeof(out)) == 0;
+        bool isNew = memcmp(out, newValue, sizeof(out)) == 0;
+        TEST_ASSERT_TRUE(isOld || isNew);
+        if (budget >= 11) TEST_ASSERT_TRUE(isNew);
+
+        // and the store keeps working afterwards
+        TEST_ASSERT_TRUE(reopened.updateKeyValue(1, newValue, 10));
+        for (uint32_t k = 100; k < 118; k++) TEST_ASSERT_TRUE(reopened.keyExists(k));
+    }
+}
+
+void test_power_loss_during_compaction(void) {
+    uint8_t value[180];
+    for (long budget = 0; budget < 30; budget++) {
+        RamStorageBackend flash(4);
+        StorageManager storage(flash);
+        TEST_ASSERT_TRUE(storage.begin());
+        for (uint32_t round = 0; round < 60; round++) {
+            fillPattern(value, sizeof(value), round);
+            TEST_ASSERT_TRUE(storage.updateKeyValue(round % 5, value, sizeof(value)));
+        }
+        TEST_ASSERT_TRUE(storage.flush());
+
+        flash.setProgramBudget(budget);
+        storage.compactOldest();
+        flash.setProgramBudget(-1);
+
+        StorageManager reopened(flash);
+        TEST_ASSERT_TRUE(reopened.begin());
+        for (uint32_t key = 0; key < 5; key++) {
+            assertValue(reopened, key, 55 + key, sizeof(value));
+        }
+        fillPattern(value, sizeof(value), 1000);
+        TEST_ASSERT_TRUE(reopened.updateKeyValue(0, value, sizeof(value)));
+    }
+}
+
+void test_factory_reset_keeps_erase_counts(void) {
+    RamStorageBackend flash(SECTORS);
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    uint8_t value[64];
+    fillPattern(value, sizeof(value), 1);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+    storage.factoryReset();
+    storage.factoryReset();  // free sectors are not erased again
+
+    StorageManager reopened(flash);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_FALSE(reopened.isBlank());
+    TEST_ASSERT_FALSE(reopened.keyExists(1));
+    uint32_t total = 0;
+    for (size_t s = 0; s < SECTORS; s++) {
+        TEST_ASSERT_EQUAL_UINT32(flash.sectorErases(s), reopened.sectorEraseCount(s));
+        total += reopened.sectorEraseCount(s);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, total);
+}
+
+void test_dirty_sector_is_erased_before_use(void) {
+    RamStorageBackend flash(4);
+    uint8_t page[STORAGE_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    for (size_t s = 0; s < 4; s++) {
+        page[100] = 0x00;  // garbage in the body, no header
+        TEST_ASSERT_TRUE(flash.programPage(s * STORAGE_SECTOR_SIZE, page));
+    }
+    StorageManager storage(flash);
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_TRUE(storage.isBlank());
+    uint8_t value[200];
+    fillPattern(value, sizeof(value), 4);
+    TEST_ASSERT_TRUE(storage.writeKeyValue(1, value, sizeof(value)));
+    TEST_ASSERT_TRUE(storage.flush());
+    TEST_ASSERT_EQUAL_UINT32(1, flash.eraseCount());
+    assertValue(storage, 1, 4, sizeof(value));
+}
+
+// -----------------------------------------------------------------------------
+// Test Runner
+// -----------------------------------------------------------------------------
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_update_replaces_value_of_any_length);
+    RUN_TEST(test_delete_writes_tombstone);
+    RUN_TEST(test_directory_delete_keeps_probe_chains);
+    RUN_TEST(test_directory_overflow_respects_tombstones);
+    RUN_TEST(test_compaction_reclaims_superseded_records);
+    RUN_TEST(test_full_log_rejects_writes);
+    RUN_TEST(test_wear_distribution);
+    RUN_TEST(test_background_compaction_keeps_sectors_free);
+    RUN_TEST(test_power_loss_during_update);
+    RUN_TEST(test_power_loss_during_compaction);
+    RUN_TEST(test_factory_reset_keeps_erase_counts);
+    RUN_TEST(test_dirty_sector_is_erased_before_use);
+
+    return UNITY_END();
+}
@@ -1,14 +1,18 @@
-#include <Arduino.h>
 #include <unity.h>
+#include <cstdint>
+#include <cstring>
 #include "crypto/Kdf.h"
 #include "crypto/Kdf.cpp"
+#include "crypto/HmacSha512.cpp"
 #include "crypto/EncryptionManager.h"
 #include "crypto/EncryptionManager.cpp"
 #include "storage/StorageManager.h"
 #include "storage/StorageManager.cpp"
+#include "storage/backend/RamStorageBackend.cpp"
 
 EncryptionManager encryption;
-StorageManager storageManager;
+RamStorageBackend storageBackend;
+StorageManager storageManager(storageBackend);
 
 const uint32_t BASE_KEY = 0xABCD0000;
 const int NUM_SLOTS = 4;
@@ -49,7 +53,7 @@ static void test_encryption_roundtrip_slot(uint8_t slot) {
 
 void setUp(void) {
     // Called before each test
-    storageManager.begin(1024);
+    storageManager.begin();
     storageManager.factoryReset();
 }
 
@@ -62,17 +66,11 @@ void test_encryption_roundtrip_slot1(void) { test_encryption_roundtrip_slot(1);
 void test_encryption_roundtrip_slot2(void) { test_encryption_roundtrip_slot(2); }
 void test_encryption_roundtrip_slot3(void) { test_encryption_roundtrip_slot(3); }
 
-void setup() {
-    Serial.begin(115200);
-    while (!Serial) delay(10);
-    delay(500);
-
+int main(int, char**) {
     UNITY_BEGIN();
     RUN_TEST(test_encryption_roundtrip_slot0);
     RUN_TEST(test_encryption_roundtrip_slot1);
     RUN_TEST(test_encryption_roundtrip_slot2);
     RUN_TEST(test_encryption_roundtrip_slot3);
-    UNITY_END();
+    return UNITY_END();
 }
-
-void loop() {}